@@ -19,7 +19,17 @@
 #include <cassert>
 #include <cstdlib>
 #include <climits>
+#include <limits>
 #include <cmath>
+#include <algorithm>
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+#include <immintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#elif defined( _MSC_VER )
+#include <intrin.h>
+#endif
 #include <cv.h>
 #include <highgui.h>
 
@@ -478,51 +488,344 @@ MyReadTextMapString( const char *filepath,
 // ベクトル、行列操作
 //#########################################################################################
 
+/*
+ * --- 単精度、混合精度 ---
+ * - ベクトル（vector< T >）、行列（MyMatT< T >）の演算、変換、連立一次方程式の解法は、
+ *   double だけでなく float でも使える（T = float, double）。
+ *   float なら SIMD １命令で扱える要素数が倍になり、メモリの読み書きの量も半分になる。
+ * - 普通に呼んだ場合は、格納している型（float なら float）で計算する。
+ * - 混合精度：足し込み（内積の総和など）を行う関数では、最初のテンプレート引数に足し込みに使う型を指定できる。
+ *   例えば MyVecDot< double >( a, b ) は、float のベクトルの内積を double で足し込んで double で返す。
+ *   格納は float のまま、丸め誤差の溜まりやすい足し込みだけを double で行う。
+ * - 従来の vector< vector< double > > 版の関数は double のみ。
+ */
+
+/**
+ * T が実数型（float か double）のときだけ R を type として定義する
+ * - テンプレートの演算子が vector< int > や vector< vector< double > > などに使われないようにするため。
+ */
+template < class T, class R > struct MyIfReal { };
+template < class R > struct MyIfReal< float, R > { typedef R type; };
+template < class R > struct MyIfReal< double, R > { typedef R type; };
+
+/*
+ * --- ベクトル演算の式テンプレート ---
+ * - vector< T >（T = float, double）の +, -, スカラー倍, スカラー割りは、その場では計算せずに「式」のオブジェクトを返す。
+ * - 式は vector< T > に代入（変換）されたときに、１つのループでまとめて計算される。
+ *   例えば x + t * dx は、一時ベクトルを作らずに１回のメモリ確保で計算される。
+ * - 既存のベクトルに書き込むときは MyVecEval() や +=, -= を使えば、メモリ確保は起きない。
+ * - 式は元のベクトルへの参照を持つので、式そのものを変数にとっておいてはいけない（その文の中で使い切ること）。
+ * - 要素ごとの計算なので、MyVecEval( x + t * dx, x ) のように出力先が式の中に現れてもよい。
+ * - 式の中のベクトルは全部同じ型であること（float と double を混ぜない）。
+ */
+
+/**
+ * ベクトルの式の基底クラス
+ * - E は派生クラス自身（CRTP）。T は要素の型。
+ * - size() と operator [] で要素を取り出せる。
+ */
+template < class E, class T = double >
+struct MyVecExpr {
+  typedef T value_type;
+  const E & self() const { return static_cast< const E & >( *this ); }
+  size_t size() const { return self().size(); }
+  T operator [] ( size_t i ) const { return self()[ i ]; }
+
+  /**
+   * vector< T > への変換（ここで初めて計算する）
+   */
+  operator std::vector< T > () const {
+    std::vector< T > c( size() );
+    for( size_t i = 0; i < c.size(); i++ ) c[ i ] = self()[ i ];
+    return c;
+  }
+};
+
+/**
+ * 式の葉：vector< T > への参照
+ */
+template < class T >
+struct MyVecRefT : public MyVecExpr< MyVecRefT< T >, T > {
+  const std::vector< T > &_v;
+  MyVecRefT( const std::vector< T > &v ) : _v( v ) {}
+  size_t size() const { return _v.size(); }
+  T operator [] ( size_t i ) const { return _v[ i ]; }
+};
+
+typedef MyVecRefT< double > MyVecRef;
+
+/**
+ * 要素ごとの足し算
+ */
+struct MyVecOpAdd {
+  template < class T > static T apply( T a, T b ){ return a + b; }
+};
+
+/**
+ * 要素ごとの引き算
+ */
+struct MyVecOpSub {
+  template < class T > static T apply( T a, T b ){ return a - b; }
+};
+
+/**
+ * 式の節：２つの式の要素ごとの演算
+ */
+template < class L, class R, class Op >
+struct MyVecBinary : public MyVecExpr< MyVecBinary< L, R, Op >, typename L::value_type > {
+  typedef typename L::value_type T;
+  L _l;
+  R _r;
+  MyVecBinary( const L &l, const R &r ) : _l( l ), _r( r ) {
+    assert( l.size() == r.size() );
+  }
+  size_t size() const { return _l.size(); }
+  T operator [] ( size_t i ) const { return Op::apply( _l[ i ], _r[ i ] ); }
+};
+
+/**
+ * 式の節：スカラー倍
+ */
+template < class E >
+struct MyVecScale : public MyVecExpr< MyVecScale< E >, typename E::value_type > {
+  typedef typename E::value_type T;
+  T _k;
+  E _e;
+  MyVecScale( T k, const E &e ) : _k( k ), _e( e ) {}
+  size_t size() const { return _e.size(); }
+  T operator [] ( size_t i ) const { return _k * _e[ i ]; }
+};
+
+/**
+ * 式の節：スカラー割り
+ */
+template < class E >
+struct MyVecDiv : public MyVecExpr< MyVecDiv< E >, typename E::value_type > {
+  typedef typename E::value_type T;
+  E _e;
+  T _k;
+  MyVecDiv( const E &e, T k ) : _e( e ), _k( k ) {}
+  size_t size() const { return _e.size(); }
+  T operator [] ( size_t i ) const { return _e[ i ] / _k; }
+};
+
+/**
+ * 式を計算して既存のベクトルに書き込む
+ * - out のサイズが違うときはリサイズする。容量が足りていればメモリ確保は起きない。
+ */
+template < class E, class T >
+inline
+void
+MyVecEval( const MyVecExpr< E, T > &e, std::vector< T > &out ){
+  const E &x = e.self();
+  out.resize( x.size() );
+  for( size_t i = 0; i < out.size(); i++ ) out[ i ] = x[ i ];
+}
+
 /**
  * ベクトルの足し算
  */
+template < class T >
 inline
-std::vector< double > operator + ( const std::vector< double > &a,
-                                   const std::vector< double > &b ){
-  assert( a.size() == b.size() );
-  std::vector< double > c( a.size() );
-  for( int i = 0; i < a.size(); i++ ) c[ i ] = a[ i ] + b[ i ];
-  return c;
+typename MyIfReal< T, MyVecBinary< MyVecRefT< T >, MyVecRefT< T >, MyVecOpAdd > >::type
+operator + ( const std::vector< T > &a,
+             const std::vector< T > &b ){
+  return MyVecBinary< MyVecRefT< T >, MyVecRefT< T >, MyVecOpAdd >( MyVecRefT< T >( a ), MyVecRefT< T >( b ) );
+}
+
+template < class E, class T >
+inline
+MyVecBinary< E, MyVecRefT< T >, MyVecOpAdd >
+operator + ( const MyVecExpr< E, T > &a, const std::vector< T > &b ){
+  return MyVecBinary< E, MyVecRefT< T >, MyVecOpAdd >( a.self(), MyVecRefT< T >( b ) );
+}
+
+template < class E, class T >
+inline
+MyVecBinary< MyVecRefT< T >, E, MyVecOpAdd >
+operator + ( const std::vector< T > &a, const MyVecExpr< E, T > &b ){
+  return MyVecBinary< MyVecRefT< T >, E, MyVecOpAdd >( MyVecRefT< T >( a ), b.self() );
+}
+
+template < class E1, class E2, class T >
+inline
+MyVecBinary< E1, E2, MyVecOpAdd >
+operator + ( const MyVecExpr< E1, T > &a, const MyVecExpr< E2, T > &b ){
+  return MyVecBinary< E1, E2, MyVecOpAdd >( a.self(), b.self() );
 }
 
 /**
  * ベクトルの引き算
  */
+template < class T >
 inline
-std::vector< double > operator - ( const std::vector< double > &a,
-                                   const std::vector< double > &b ){
-  assert( a.size() == b.size() );
-  std::vector< double > c( a.size() );
-  for( int i = 0; i < a.size(); i++ ) c[ i ] = a[ i ] - b[ i ];
-  return c;
+typename MyIfReal< T, MyVecBinary< MyVecRefT< T >, MyVecRefT< T >, MyVecOpSub > >::type
+operator - ( const std::vector< T > &a,
+             const std::vector< T > &b ){
+  return MyVecBinary< MyVecRefT< T >, MyVecRefT< T >, MyVecOpSub >( MyVecRefT< T >( a ), MyVecRefT< T >( b ) );
+}
+
+template < class E, class T >
+inline
+MyVecBinary< E, MyVecRefT< T >, MyVecOpSub >
+operator - ( const MyVecExpr< E, T > &a, const std::vector< T > &b ){
+  return MyVecBinary< E, MyVecRefT< T >, MyVecOpSub >( a.self(), MyVecRefT< T >( b ) );
+}
+
+template < class E, class T >
+inline
+MyVecBinary< MyVecRefT< T >, E, MyVecOpSub >
+operator - ( const std::vector< T > &a, const MyVecExpr< E, T > &b ){
+  return MyVecBinary< MyVecRefT< T >, E, MyVecOpSub >( MyVecRefT< T >( a ), b.self() );
+}
+
+template < class E1, class E2, class T >
+inline
+MyVecBinary< E1, E2, MyVecOpSub >
+operator - ( const MyVecExpr< E1, T > &a, const MyVecExpr< E2, T > &b ){
+  return MyVecBinary< E1, E2, MyVecOpSub >( a.self(), b.self() );
 }
 
 /**
  * ベクトルのスカラー倍
+ * - k はベクトルの要素の型に変換してから掛ける。
  */
+template < class T >
 inline
-std::vector< double > operator * ( const double k,
-                                   const std::vector< double > &a ){
-  std::vector< double > c( a.size() );
-  for( int i = 0; i < a.size(); i++ ) c[ i ] = k * a[ i ];
-  return c;
+typename MyIfReal< T, MyVecScale< MyVecRefT< T > > >::type
+operator * ( const double k,
+             const std::vector< T > &a ){
+  return MyVecScale< MyVecRefT< T > >( (T)k, MyVecRefT< T >( a ) );
+}
+
+template < class E, class T >
+inline
+MyVecScale< E >
+operator * ( const double k, const MyVecExpr< E, T > &a ){
+  return MyVecScale< E >( (T)k, a.self() );
 }
 
 /**
  * ベクトルのスカラー割り
  */
+template < class T >
+inline
+typename MyIfReal< T, MyVecDiv< MyVecRefT< T > > >::type
+operator / ( const std::vector< T > &a,
+             const double k ){
+  assert( k != 0 );
+  return MyVecDiv< MyVecRefT< T > >( MyVecRefT< T >( a ), (T)k );
+}
+
+template < class E, class T >
 inline
-std::vector< double > operator / ( const std::vector< double > &a,
-                                   const double k ){
+MyVecDiv< E >
+operator / ( const MyVecExpr< E, T > &a, const double k ){
   assert( k != 0 );
-  std::vector< double > c( a.size() );
-  for( int i = 0; i < a.size(); i++ ) c[ i ] = a[ i ] / k;
-  return c;
+  return MyVecDiv< E >( a.self(), (T)k );
+}
+
+/**
+ * ベクトルに足し込む
+ * - メモリ確保なし
+ */
+template < class T >
+inline
+typename MyIfReal< T, std::vector< T > & >::type
+operator += ( std::vector< T > &a,
+              const std::vector< T > &b ){
+  assert( a.size() == b.size() );
+  for( size_t i = 0; i < a.size(); i++ ) a[ i ] += b[ i ];
+  return a;
+}
+
+template < class E, class T >
+inline
+std::vector< T > & operator += ( std::vector< T > &a, const MyVecExpr< E, T > &b ){
+  const E &x = b.self();
+  assert( a.size() == x.size() );
+  for( size_t i = 0; i < a.size(); i++ ) a[ i ] += x[ i ];
+  return a;
+}
+
+/**
+ * ベクトルから引く
+ * - メモリ確保なし
+ */
+template < class T >
+inline
+typename MyIfReal< T, std::vector< T > & >::type
+operator -= ( std::vector< T > &a,
+              const std::vector< T > &b ){
+  assert( a.size() == b.size() );
+  for( size_t i = 0; i < a.size(); i++ ) a[ i ] -= b[ i ];
+  return a;
+}
+
+template < class E, class T >
+inline
+std::vector< T > & operator -= ( std::vector< T > &a, const MyVecExpr< E, T > &b ){
+  const E &x = b.self();
+  assert( a.size() == x.size() );
+  for( size_t i = 0; i < a.size(); i++ ) a[ i ] -= x[ i ];
+  return a;
+}
+
+/**
+ * ベクトルの足し算 out = a + b
+ * - out が空ならリサイズする。空でなければサイズが合っていること。
+ * - out は a や b と同じでもよい。
+ */
+template < class T >
+inline
+void
+MyVecAddInto( const std::vector< T > &a, const std::vector< T > &b,
+              std::vector< T > &out ){
+  if( out.empty() ) out.resize( a.size() );
+  else assert( out.size() == a.size() );
+  MyVecEval( a + b, out );
+}
+
+/**
+ * ベクトルの引き算 out = a - b
+ * - out が空ならリサイズする。空でなければサイズが合っていること。
+ * - out は a や b と同じでもよい。
+ */
+template < class T >
+inline
+void
+MyVecSubInto( const std::vector< T > &a, const std::vector< T > &b,
+              std::vector< T > &out ){
+  if( out.empty() ) out.resize( a.size() );
+  else assert( out.size() == a.size() );
+  MyVecEval( a - b, out );
+}
+
+/**
+ * ベクトルのスカラー倍 out = k * a
+ * - out が空ならリサイズする。空でなければサイズが合っていること。
+ * - out は a と同じでもよい。
+ */
+template < class T >
+inline
+void
+MyVecScaleInto( double k, const std::vector< T > &a, std::vector< T > &out ){
+  if( out.empty() ) out.resize( a.size() );
+  else assert( out.size() == a.size() );
+  MyVecEval( k * a, out );
+}
+
+/**
+ * ベクトルの型の変換 out = a（float <-> double）
+ * - out が空ならリサイズする。空でなければサイズが合っていること。
+ */
+template < class S, class T >
+inline
+void
+MyVecConvertInto( const std::vector< S > &a, std::vector< T > &out ){
+  if( out.empty() ) out.resize( a.size() );
+  else assert( out.size() == a.size() );
+  for( size_t i = 0; i < a.size(); i++ ) out[ i ] = (T)a[ i ];
 }
 
 /**
@@ -535,31 +838,118 @@ std::ostream & operator << ( std::ostream &os,
   return os;
 }
 
+inline
+std::ostream & operator << ( std::ostream &os,
+                             const std::vector< float > &a ){
+  for( size_t i = 0; i < a.size(); i++ ) os << a[ i ] << "\t";
+  return os;
+}
+
+/**
+ * ベクトルの式の表示
+ */
+template < class E, class T >
+inline
+std::ostream & operator << ( std::ostream &os, const MyVecExpr< E, T > &a ){
+  const E &x = a.self();
+  for( size_t i = 0; i < x.size(); i++ ) os << x[ i ] << "\t";
+  return os;
+}
+
 /**
  * ベクトルのノルムを返す
+ * - 足し込みは A 型で行う（MyVecNorm< double >( a ) で float のベクトルを double で足し込む）。
  */
+template < class A, class T >
+inline
+A MyVecNorm( const std::vector< T > &a ){
+  A sum = 0.0;
+  for( size_t i = 0; i < a.size(); i++ ){
+    sum += (A)a[ i ] * (A)a[ i ];
+  }
+  return sqrt( sum );
+}
+
 inline
 double MyVecNorm( const std::vector< double > &a ){
-  double sum = 0.0;
-  for( int i = 0; i < a.size(); i++ ){
-    sum += a[ i ] * a[ i ];
+  return MyVecNorm< double >( a );
+}
+
+inline
+float MyVecNorm( const std::vector< float > &a ){
+  return MyVecNorm< float >( a );
+}
+
+/**
+ * ベクトルの式のノルムを返す
+ * - 式を vector< T > にせずに計算する。
+ */
+template < class E, class T >
+inline
+T MyVecNorm( const MyVecExpr< E, T > &a ){
+  const E &x = a.self();
+  T sum = 0.0;
+  for( size_t i = 0; i < x.size(); i++ ){
+    T xi = x[ i ];
+    sum += xi * xi;
   }
   return sqrt( sum );
 }
 
 /**
  * ベクトルの内積を計算
+ * - 足し込みは A 型で行う（MyVecDot< double >( a, b ) で float のベクトルを double で足し込む）。
  */
+template < class A, class T >
 inline
-double MyVecDot( const std::vector< double > &a, const std::vector< double > &b ){
+A MyVecDot( const std::vector< T > &a, const std::vector< T > &b ){
   assert( a.size() == b.size() );
-  double sum = 0.0;
-  for( int i = 0; i < a.size(); i++ ){
-    sum += a[ i ] * b[ i ];
+  A sum = 0.0;
+  for( size_t i = 0; i < a.size(); i++ ){
+    sum += (A)a[ i ] * (A)b[ i ];
+  }
+  return sum;
+}
+
+inline
+double MyVecDot( const std::vector< double > &a, const std::vector< double > &b ){
+  return MyVecDot< double >( a, b );
+}
+
+inline
+float MyVecDot( const std::vector< float > &a, const std::vector< float > &b ){
+  return MyVecDot< float >( a, b );
+}
+
+/**
+ * ベクトルの式との内積を計算
+ * - 式を vector< T > にせずに計算する。
+ */
+template < class E1, class E2, class T >
+inline
+T MyVecDot( const MyVecExpr< E1, T > &a, const MyVecExpr< E2, T > &b ){
+  const E1 &x = a.self();
+  const E2 &y = b.self();
+  assert( x.size() == y.size() );
+  T sum = 0.0;
+  for( size_t i = 0; i < x.size(); i++ ){
+    sum += x[ i ] * y[ i ];
   }
   return sum;
 }
 
+template < class E, class T >
+inline
+T MyVecDot( const std::vector< T > &a, const MyVecExpr< E, T > &b ){
+  return MyVecDot( MyVecRefT< T >( a ), b );
+}
+
+template < class E, class T >
+inline
+T MyVecDot( const MyVecExpr< E, T > &a, const std::vector< T > &b ){
+  return MyVecDot( a, MyVecRefT< T >( b ) );
+}
+
 /**
  * ベクトルの要素のヒストグラムを計算
  */
@@ -639,1217 +1029,10382 @@ MyMatAreTheSameSize( const std::vector< std::vector< double > > &A,
 }
 
 /**
- * 行列の足し算
+ * 行列のメモリ領域のアライメント（バイト数）
  */
-
-inline
-std::vector< std::vector< double > >
-operator + ( const std::vector< std::vector< double > > &A,
-             const std::vector< std::vector< double > > &B ){
-  assert( A.size() > 0 && A[ 0 ].size() > 0 );
-  std::vector< std::vector< double > > C( A.size(), std::vector< double >( A[ 0 ].size() ) );
-  assert( A.size() == B.size() );
-  for( int i = 0; i < A.size(); i++ ){
-    assert( A[ i ].size() == B[ i ].size() );
-    for( int j = 0; j < A[ i ].size(); j++ ){
-      C[ i ][ j ] = A[ i ][ j ] + B[ i ][ j ];
-    }
-  }
-  return C;
-}
+#ifndef MY_MAT_ALIGN
+#define MY_MAT_ALIGN 64
+#endif
 
 /**
- * 行列の引き算
+ * 行列のビュー（メモリ領域を持たない行列）
+ * - 他の行列やバッファの要素を、ストライドを使ってコピーせずに参照する。
+ * - 要素 (i,j) の位置は data() + i * rowStride() + j * colStride() 。
+ * - 転置、行、列、対角成分、部分行列を、ビューとして取り出せる（trans(), row(), col(), diag(), block()）。
+ *   どれもメモリ確保なしで、ストライドを付け替えるだけ。
+ * - ビューのコピーは参照先を共有する（浅いコピー）。ビューへの代入は、参照先の要素への書き込みになる。
+ * - 参照先の寿命は呼び出し側で管理すること。
+ * - MyMat はこのクラスの派生クラスなので、const MyMatView & を受け取る関数には MyMat もそのまま渡せる。
+ * - T は要素の型。MyMatView（double）、MyMatViewf（float）を使う。
  */
+template < class T >
+class MyMatViewT
+{
+ protected:
+  T *_data; //!< 要素 (0,0) の位置
+  int _rows;     //!< 行数
+  int _cols;     //!< 列数
+  int _rs;       //!< 行方向のストライド（次の行の同じ列までの要素数）
+  int _cs;       //!< 列方向のストライド（同じ行の次の列までの要素数）
 
-inline
-std::vector< std::vector< double > >
-operator - ( const std::vector< std::vector< double > > &A,
-             const std::vector< std::vector< double > > &B ){
-  assert( A.size() > 0 && A[ 0 ].size() > 0 );
-  std::vector< std::vector< double > > C( A.size(), std::vector< double >( A[ 0 ].size() ) );
-  assert( A.size() == B.size() );
-  for( int i = 0; i < A.size(); i++ ){
-    assert( A[ i ].size() == B[ i ].size() );
-    for( int j = 0; j < A[ i ].size(); j++ ){
-      C[ i ][ j ] = A[ i ][ j ] - B[ i ][ j ];
+  /**
+   * 同じサイズの行列から要素をコピー
+   * - 参照先のメモリ領域が重なっている場合（A = A.trans() など）は、一旦作業領域にコピーしてから書き込む。
+   */
+  void copyFrom( const MyMatViewT &A ){
+    assert( _rows == A.rows() && _cols == A.cols() );
+    if( empty() ) return;
+    if( _data == A.data() && _rs == A.rowStride() && _cs == A.colStride() ) return;
+    if( overlaps( A ) ){
+      std::vector< T > tmp( (size_t)_rows * _cols );
+      for( int i = 0; i < _rows; i++ ){
+        for( int j = 0; j < _cols; j++ ) tmp[ (size_t)i * _cols + j ] = A( i, j );
+      }
+      copyFrom( MyMatViewT( &tmp[ 0 ], _rows, _cols, _cols ) );
+      return;
+    }
+    if( isContiguous() && A.isContiguous() ){
+      std::copy( A.data(), A.data() + (size_t)_rows * _cols, _data );
+      return;
+    }
+    for( int i = 0; i < _rows; i++ ){
+      for( int j = 0; j < _cols; j++ ){
+        (*this)( i, j ) = A( i, j );
+      }
     }
   }
-  return C;
-}
 
-/**
- * 行列の掛け算
- */
-inline
-std::vector< std::vector< double > >
-operator * ( const std::vector< std::vector< double > > &A,
-             const std::vector< std::vector< double > > &B ){
-  assert( A.size() > 0 && A[ 0 ].size() > 0 );
-  assert( A[ 0 ].size() == B.size() && B[ 0 ].size() > 0 );
-  std::vector< std::vector< double > > C( A.size(), std::vector< double >( B[ 0 ].size() ) );
-  for( int i = 0; i < C.size(); i++ ){
-    for( int j = 0; j < C[ i ].size(); j++ ){
-      C[ i ][ j ] = 0;
-      for( int k = 0; k < B.size(); k++ ){
-        C[ i ][ j ] += A[ i ][ k ] * B[ k ][ j ];
+ public:
+  MyMatViewT() : _data( 0 ), _rows( 0 ), _cols( 0 ), _rs( 0 ), _cs( 1 ) { }
+
+  /**
+   * バッファを参照する
+   * @param data 要素 (0,0) の位置
+   * @param rs 行方向のストライド（要素数）
+   * @param cs 列方向のストライド（要素数）
+   */
+  MyMatViewT( T *data, int rows, int cols, int rs, int cs = 1 )
+      : _data( data ), _rows( rows ), _cols( cols ), _rs( rs ), _cs( cs ) { }
+
+  /**
+   * 代入
+   * - 参照先の要素に書き込む。サイズは同じであること。
+   */
+  MyMatViewT & operator = ( const MyMatViewT &A ){
+    copyFrom( A );
+    return *this;
+  }
+
+  /**
+   * 全要素を val にする
+   */
+  void fill( T val ){
+    for( int i = 0; i < _rows; i++ ){
+      for( int j = 0; j < _cols; j++ ){
+        (*this)( i, j ) = val;
       }
     }
   }
-  return C;
-}
 
-/**
- * 行列のスカラー倍
- */
+  // アクセサ
+  int rows() const { return _rows; }
+  int cols() const { return _cols; }
+  int rowStride() const { return _rs; }
+  int colStride() const { return _cs; }
+  T *data() { return _data; }
+  const T *data() const { return _data; }
+  bool empty() const { return _rows == 0 || _cols == 0; }
+  bool isContiguous() const { return _cs == 1 && _rs == _cols; }
+  T & operator () ( int i, int j ) { return _data[ (size_t)i * _rs + (size_t)j * _cs ]; }
+  T operator () ( int i, int j ) const { return _data[ (size_t)i * _rs + (size_t)j * _cs ]; }
+  T * ptr( int i, int j ) { return _data + (size_t)i * _rs + (size_t)j * _cs; }
+  const T * ptr( int i, int j ) const { return _data + (size_t)i * _rs + (size_t)j * _cs; }
+  T * operator [] ( int i ) { assert( _cs == 1 ); return _data + (size_t)i * _rs; }
+  const T * operator [] ( int i ) const { assert( _cs == 1 ); return _data + (size_t)i * _rs; }
 
-inline
-std::vector< std::vector< double > >
-operator * ( double k,
-             const std::vector< std::vector< double > > &A ){
-  assert( A.size() > 0 && A[ 0 ].size() > 0 );
-  std::vector< std::vector< double > > C( A.size(), std::vector< double >( A[ 0 ].size() ) );
-  for( int i = 0; i < A.size(); i++ ){
-    for( int j = 0; j < A[ i ].size(); j++ ){
-      C[ i ][ j ] = k * A[ i ][ j ];
-    }
+  /**
+   * 参照しているメモリ範囲が A と重なっているかどうか
+   */
+  bool overlaps( const MyMatViewT &A ) const {
+    if( empty() || A.empty() ) return false;
+    const T *p1 = _data, *q1 = ptr( _rows - 1, _cols - 1 );
+    const T *p2 = A.data(), *q2 = A.ptr( A.rows() - 1, A.cols() - 1 );
+    const T *lo1 = std::min( p1, q1 ), *hi1 = std::max( p1, q1 );
+    const T *lo2 = std::min( p2, q2 ), *hi2 = std::max( p2, q2 );
+    return lo1 <= hi2 && lo2 <= hi1;
   }
-  return C;
-}
 
-/**
- * 行列のスカラー割
- */
+  // ビュー
+  /** 転置 */
+  MyMatViewT trans() { return MyMatViewT( _data, _cols, _rows, _cs, _rs ); }
+  const MyMatViewT trans() const { return MyMatViewT( _data, _cols, _rows, _cs, _rs ); }
+  /** i 行目（1 x cols） */
+  MyMatViewT row( int i ) { assert( i >= 0 && i < _rows ); return MyMatViewT( ptr( i, 0 ), 1, _cols, _rs, _cs ); }
+  const MyMatViewT row( int i ) const { assert( i >= 0 && i < _rows ); return MyMatViewT( _data + (size_t)i * _rs, 1, _cols, _rs, _cs ); }
+  /** j 列目（rows x 1） */
+  MyMatViewT col( int j ) { assert( j >= 0 && j < _cols ); return MyMatViewT( ptr( 0, j ), _rows, 1, _rs, _cs ); }
+  const MyMatViewT col( int j ) const { assert( j >= 0 && j < _cols ); return MyMatViewT( _data + (size_t)j * _cs, _rows, 1, _rs, _cs ); }
+  /** 対角成分（min(rows,cols) x 1） */
+  MyMatViewT diag() { return MyMatViewT( _data, MyMin( _rows, _cols ), 1, _rs + _cs, _cs ); }
+  const MyMatViewT diag() const { return MyMatViewT( _data, MyMin( _rows, _cols ), 1, _rs + _cs, _cs ); }
+  /** (i,j) から始まる rows x cols の部分行列 */
+  MyMatViewT block( int i, int j, int rows, int cols ){
+    assert( i >= 0 && j >= 0 && rows >= 0 && cols >= 0 && i + rows <= _rows && j + cols <= _cols );
+    return MyMatViewT( ptr( i, j ), rows, cols, _rs, _cs );
+  }
+  const MyMatViewT block( int i, int j, int rows, int cols ) const {
+    assert( i >= 0 && j >= 0 && rows >= 0 && cols >= 0 && i + rows <= _rows && j + cols <= _cols );
+    return MyMatViewT( _data + (size_t)i * _rs + (size_t)j * _cs, rows, cols, _rs, _cs );
+  }
 
-inline
-std::vector< std::vector< double > >
-operator / ( const std::vector< std::vector< double > > &A,
-             double k ){
-  assert( A.size() > 0 && A[ 0 ].size() > 0 && k != 0 );
-  std::vector< std::vector< double > > C( A.size(), std::vector< double >( A[ 0 ].size() ) );
-  for( int i = 0; i < A.size(); i++ ){
-    for( int j = 0; j < A[ i ].size(); j++ ){
-      C[ i ][ j ] = A[ i ][ j ] * k;
+  /**
+   * vector< vector< T > > に変換
+   */
+  void get( std::vector< std::vector< T > > &A ) const {
+    A.resize( _rows );
+    for( int i = 0; i < _rows; i++ ){
+      A[ i ].resize( _cols );
+      for( int j = 0; j < _cols; j++ ) A[ i ][ j ] = (*this)( i, j );
     }
   }
-  return C;
-}
-
-/** 
- * 行列の転置
- */
 
-inline
-std::vector< std::vector< double > >
-MyMatTrans( const std::vector< std::vector< double > > &A ){
-  assert( A.size() > 0 && A[ 0 ].size() > 0 );
-  std::vector< std::vector< double > > C( A[ 0 ].size(), std::vector< double >( A.size() ) );
-  for( int i = 0; i < C.size(); i++ ){
-    for( int j = 0; j < C[ i ].size(); j++ ){
-      C[ i ][ j ] = A[ j ][ i ];
+  /**
+   * vector< T > に行優先で書き出す（行や列のビューをベクトルとして取り出すときなど）
+   */
+  void get( std::vector< T > &v ) const {
+    v.resize( (size_t)_rows * _cols );
+    for( int i = 0; i < _rows; i++ ){
+      for( int j = 0; j < _cols; j++ ) v[ (size_t)i * _cols + j ] = (*this)( i, j );
     }
   }
-  return C;
-}
 
-/**
- * 行列の表示
- */
+  /**
+   * vector< vector< T > > から要素をセット。サイズは同じであること。
+   */
+  void set( const std::vector< std::vector< T > > &A ){
+    assert( (int)A.size() == _rows );
+    for( int i = 0; i < _rows; i++ ){
+      assert( (int)A[ i ].size() == _cols );
+      for( int j = 0; j < _cols; j++ ) (*this)( i, j ) = A[ i ][ j ];
+    }
+  }
 
-inline
-std::ostream & operator << ( std::ostream &os,
-                             const std::vector< std::vector< double > > &A)
-{
-  for( int i = 0; i < A.size(); i++ ){
-    for( int j = 0; j < A[ 0 ].size(); j++ ){
-      os << A[ i ][ j ] << "\t";
+  /**
+   * 行優先で並んだ vector< T > から要素をセット。要素数は同じであること。
+   */
+  void set( const std::vector< T > &v ){
+    assert( v.size() == (size_t)_rows * _cols );
+    for( int i = 0; i < _rows; i++ ){
+      for( int j = 0; j < _cols; j++ ) (*this)( i, j ) = v[ (size_t)i * _cols + j ];
     }
-    os << std::endl;
   }
-  return os;
-}
+};
 
 /**
- * 行列の等号
+ * 行列クラス
+ * - 全要素を一つの連続したメモリ領域に行優先で持つ。領域の先頭は MY_MAT_ALIGN バイト境界に揃えてある。
+ * - 要素 (i,j) の位置は data() + i * rowStride() + j * colStride() 。
+ * - vector< vector< double > > と違い、行ごとのメモリ確保がなく、ポインタを辿る必要もない。
+ * - 外部のバッファ（vector< T > など）をコピーせずにそのまま包んで使うこともできる。その場合メモリの解放はしない。
+ * - vector< vector< T > > からの変換は、コピー１回（行ごとに別の領域なので、コピーなしにはできない）。
+ * - A[ i ][ j ] の形でもアクセスできる（列方向のストライドが１の場合のみ）。
+ * - MyMatViewT< T > の派生クラス。ビュー（A.trans() など）から MyMat を作ると、自前の領域にコピーされる。
+ * - T は要素の型。MyMat（double）、MyMatf（float）を使う。
  */
-inline
-bool operator == ( const std::vector< std::vector< double > > &A,
-                   const std::vector< std::vector< double > > &B ){
-  if( A.size() != B.size() ) return false;
-  for( int i = 0; i < A.size(); i++ ){
-    if( A[ i ].size() != B[ i ].size() ) return false;
-    for( int j = 0; j < A[ i ].size(); j++ ){
-      if( A[ i ][ j ] != B[ i ][ j ] ) return false;
+template < class T >
+class MyMatT : public MyMatViewT< T >
+{
+ protected:
+  using MyMatViewT< T >::_data;
+  using MyMatViewT< T >::_rows;
+  using MyMatViewT< T >::_cols;
+  using MyMatViewT< T >::_rs;
+  using MyMatViewT< T >::_cs;
+
+ private:
+  T *_buf;  //!< 確保したメモリ領域（解放用）
+  bool _own;     //!< メモリ領域を自分で確保したかどうか
+
+  /**
+   * メモリ確保。行優先の連続領域になる。
+   */
+  void alloc( int rows, int cols ){
+    assert( rows >= 0 && cols >= 0 );
+    _rows = rows;
+    _cols = cols;
+    _rs = cols;
+    _cs = 1;
+    _own = true;
+    size_t n = (size_t)rows * cols;
+    if( n == 0 ){
+      _buf = 0;
+      _data = 0;
+      return;
     }
+    _buf = (T *)malloc( n * sizeof( T ) + MY_MAT_ALIGN );
+    assert( _buf != 0 );
+    _data = (T *)( ( (size_t)_buf + MY_MAT_ALIGN - 1 ) & ~( (size_t)MY_MAT_ALIGN - 1 ) );
   }
-  return true;
-}
 
-/**
- * 行列のノットイコール
- */
-inline
-bool operator != ( const std::vector< std::vector< double > > &A,
-                   const std::vector< std::vector< double > > &B ){
-  return !( A == B );
-}
+  /**
+   * メモリ解放
+   */
+  void release(){
+    if( _own && _buf ) free( _buf );
+    _buf = 0;
+    _data = 0;
+  }
 
-/**
- * ベクトルの等号
- */
-inline
-bool operator == ( const std::vector< double > &A,
-                   const std::vector< double > &B ){
-  if( A.size() != B.size() ) return false;
-  for( int i = 0; i < A.size(); i++ ){
-    if( A[ i ] != B[ i ] ) return false;
+ public:
+  MyMatT() : _buf( 0 ), _own( true ) { }
+
+  /**
+   * rows x cols の行列。全要素を val で初期化。
+   */
+  MyMatT( int rows, int cols, T val = 0 ){
+    alloc( rows, cols );
+    this->fill( val );
   }
-  return true;
-}
 
-/**
- * ベクトルのノットイコール
- */
-inline
-bool operator != ( const std::vector< double > &A,
-                   const std::vector< double > &B ){
-  return !( A == B );
-}
+  /**
+   * vector< vector< T > > からの変換。コピーが１回だけ行われる。
+   */
+  explicit MyMatT( const std::vector< std::vector< T > > &A ){
+    alloc( A.size(), A.empty() ? 0 : A[ 0 ].size() );
+    this->set( A );
+  }
 
-/**
- * 行列とベクトルの掛け算
- * - ベクトルになる
- * - M x N * N x 1 => M x 1
- */
-inline
-std::vector< double >
-operator * ( const std::vector< std::vector< double > > &A,
-             const std::vector< double > &x
-             ){
-  assert( A.size() > 0 && A[ 0 ].size() > 0 && A[ 0 ].size() == x.size() );
-  std::vector< double > b( A[ 0 ].size(), 0 );
-  for( int i = 0; i < A.size(); i++ ){
-    for( int j = 0; j < A[ i ].size(); j++ ){
-      b[ i ] += A[ i ][ j ] * x[ j ];
+  /**
+   * 外部のバッファを包む。コピーなし。
+   * - バッファの寿命は呼び出し側で管理すること。
+   * @param data 要素 (0,0) の位置
+   * @param rs 行方向のストライド（要素数）
+   * @param cs 列方向のストライド（要素数）
+   */
+  MyMatT( T *data, int rows, int cols, int rs, int cs = 1 )
+      : MyMatViewT< T >( data, rows, cols, rs, cs ), _buf( 0 ), _own( false ) { }
+
+  /**
+   * 行優先で要素の並んだ vector< T > を rows x cols の行列として包む。コピーなし。
+   */
+  MyMatT( std::vector< T > &v, int rows, int cols )
+      : MyMatViewT< T >( v.empty() ? 0 : &v[ 0 ], rows, cols, cols ), _buf( 0 ), _own( false ) {
+    assert( v.size() == (size_t)rows * cols );
+  }
+
+  /**
+   * コピーコンストラクタ
+   * - 元の行列のストライドにかかわらず、自前の連続領域にコピーする。
+   */
+  MyMatT( const MyMatT &A ) : MyMatViewT< T >() {
+    alloc( A.rows(), A.cols() );
+    this->copyFrom( A );
+  }
+
+  /**
+   * ビューからの変換
+   * - 自前の連続領域にコピーする。
+   */
+  MyMatT( const MyMatViewT< T > &A ){
+    alloc( A.rows(), A.cols() );
+    this->copyFrom( A );
+  }
+
+  ~MyMatT(){ release(); }
+
+  /**
+   * 代入
+   * - サイズが同じなら今のメモリ領域に要素をコピーする（外部バッファを包んでいる場合はそのバッファに書き込まれる）。
+   * - サイズが違う場合は確保し直す（外部バッファを包んでいる場合はエラー）。
+   * - 自分自身のビューを代入してもよい（A = A.trans() など）。
+   */
+  MyMatT & operator = ( const MyMatViewT< T > &A ){
+    if( _rows != A.rows() || _cols != A.cols() ){
+      assert( _own );
+      MyMatT tmp( A );
+      swap( tmp );
     }
+    else this->copyFrom( A );
+    return *this;
   }
-  return b;
-}
 
-/**
- * ベクトルの転置
- * - 横１列の行列になる
- * - N x 1 ベクトル => 1 x N 行列
- */
-inline
-std::vector< std::vector< double > >
-MyVecTrans( const std::vector< double > &x ){
-  assert( x.size() > 0 );
-  std::vector< std::vector< double > > A( 1, std::vector< double >( x.size() ) );
-  for( int i = 0; i < x.size(); i++ ){
-    A[ 0 ][ i ] = x[ i ];
+  MyMatT & operator = ( const MyMatT &A ){
+    return operator = ( static_cast< const MyMatViewT< T > & >( A ) );
   }
-  return A;
-}
 
-/**
- * ベクトルの行列化
- * - 縦１列の行列になる
- */
-inline
-std::vector< std::vector< double > >
-MyVec2Mat( const std::vector< double > &x ){
-  using namespace std;
-  assert( x.size() > 0 );
-  std::vector< std::vector< double > > A( x.size(), vector< double >( 1 ) );
-  for( int i = 0; i < x.size(); i++ ){
-    A[ i ][ 0 ] = x[ i ];
+  /**
+   * サイズ変更
+   * - サイズが変わる場合、中身はゼロで初期化される。
+   */
+  void resize( int rows, int cols ){
+    if( rows == _rows && cols == _cols ) return;
+    assert( _own );
+    release();
+    alloc( rows, cols );
+    this->fill( 0 );
   }
-  return A;
-}
+
+  /**
+   * 中身の入れ替え（メモリ領域ごと）
+   */
+  void swap( MyMatT &A ){
+    std::swap( _buf, A._buf );
+    std::swap( _data, A._data );
+    std::swap( _rows, A._rows );
+    std::swap( _cols, A._cols );
+    std::swap( _rs, A._rs );
+    std::swap( _cs, A._cs );
+    std::swap( _own, A._own );
+  }
+
+  bool isOwner() const { return _own; }
+
+  /**
+   * 単位行列を返す
+   */
+  static MyMatT identity( int n ){
+    MyMatT A( n, n, 0 );
+    for( int i = 0; i < n; i++ ) A( i, i ) = 1;
+    return A;
+  }
+};
+
+typedef MyMatViewT< double > MyMatView;
+typedef MyMatT< double > MyMat;
+typedef MyMatViewT< float > MyMatViewf;
+typedef MyMatT< float > MyMatf;
 
 /**
- * ゼロベクトルを返す
+ * 行列の行数と列数を構造体にまとめて返す
+ * - MyMat 版
  */
+template < class T >
 inline
-std::vector< double >
-MyVecZero( int n ){
-  return std::vector< double >( n, 0 );
+MyPoint2< int >
+MyMatSize( const MyMatViewT< T > &A ){
+  return MyPoint2< int >( A.rows(), A.cols() );
 }
 
 /**
- * ゼロ行列を返す
+ * 正方行列かどうかのチェック
+ * - MyMat 版
  */
+template < class T >
 inline
-std::vector< std::vector< double > >
-MyMatZero( int n ){
-  return std::vector< std::vector< double > >( n, std::vector< double >( n, 0 ) );
+bool
+MyMatIsSquare( const MyMatViewT< T > &A ){
+  return A.rows() == A.cols();
 }
 
 /**
- * 単位行列を返す
+ * ２つの行列の行数と列数が同じかどうかのチェック
+ * - MyMat 版
  */
+template < class T >
 inline
-std::vector< std::vector< double > >
-MyMatIdentity( int n ){
-  std::vector< std::vector< double > > A( n, std::vector< double >( n, 0 ) );
-  for( int i = 0; i < n; i++ ) A[ i ][ i ] = 1;
-  return A;
+bool
+MyMatAreTheSameSize( const MyMatViewT< T > &A, const MyMatViewT< T > &B ){
+  return MyMatSize( A ) == MyMatSize( B );
 }
 
 /**
- * 行列から指定された位置の列ベクトルを取り出す
+ * 行列の型の変換 C = A（float <-> double）
+ * - C が空ならリサイズする。空でなければサイズが合っていること。
  */
+template < class S, class T >
 inline
-std::vector< double >
-MyGetColVector( const std::vector< std::vector< double > > &A,
-                int col_index ){
-  assert( A.size() > 0 );
-  assert( MyMatIsRect( A ) );
-  assert( col_index >= 0 && col_index < A[ 0 ].size() );
-  std::vector< double > col_vec( A.size() );
-  for( int i = 0; i < A.size(); i++ ){
-    col_vec[ i ] = A[ i ][ col_index ];
+void
+MyMatConvertInto( const MyMatViewT< S > &A, MyMatT< T > &C ){
+  if( C.empty() ) C.resize( A.rows(), A.cols() );
+  else assert( C.rows() == A.rows() && C.cols() == A.cols() );
+  for( int i = 0; i < A.rows(); i++ ){
+    for( int j = 0; j < A.cols(); j++ ) C( i, j ) = (T)A( i, j );
   }
-  return col_vec;
 }
 
-/**
- * MyGetColVector() の別名
+/*
+ * --- 作業領域（ワークスペース） ---
+ * - ライブラリ内部の計算で使う一時的なメモリ領域。スレッドごとに１つずつ持つ。
+ * - 大きなメモリブロック（チャンク）の先頭からポインタをずらしていくだけで領域を切り出す（バンプポインタ方式）。
+ * - 切り出した領域は MyWorkspaceScope を抜けるときにまとめて返却される。チャンク自体は解放せずに次に使い回す。
+ *   なので、同じ大きさの計算を繰り返す場合、２回目以降はヒープのメモリ確保が起きない。
+ * - 足りなくなったら、より大きなチャンクを確保して継ぎ足す。
+ * - 使い方：
+ *     MyWorkspaceScope scope;
+ *     MyWorkspace &ws = scope.workspace();
+ *     double *p = ws.alloc( n );            // n 要素の領域
+ *     vector< double > &v = ws.vec( n );    // n 要素のベクトル
+ *     MyMat &T = ws.mat( rows, cols );      // rows x cols の行列
+ *     vector< float > &f = ws.vec< float >( n ); // 要素の型を指定する場合（alloc, mat も同様）
+ *     ...                                   // scope を抜けると全部返却される
  */
-inline
-std::vector< double >
-MyMatColVec( const std::vector< std::vector< double > > &A,
-             int col_index ){
-  return MyGetColVector( A, col_index );
-}
+
+// スレッドローカル変数の指定子
+#ifndef MY_THREAD_LOCAL
+#if defined( _MSC_VER )
+#define MY_THREAD_LOCAL __declspec( thread )
+#else
+#define MY_THREAD_LOCAL __thread
+#endif
+#endif
 
 /**
- * 列ベクトルの配列を返す。
- *
- * 行列の転置と同じ
+ * 排他制御のロック
+ * - OpenMP があれば omp_lock_t を使う。なければアトミック命令のスピンロックにする
+ *  （OpenMP なしでビルドしても、pthread などの複数のスレッドから使える。ライブラリのリンクも要らない）。
+ * - ロックしている時間が短い所（キャッシュの表の操作など）に使う。MyMutexLock でスコープごとにロックする。
  */
-inline
-std::vector< std::vector< double > >
-MyGetColVectors( const std::vector< std::vector< double > > &A ){
-  return MyMatTrans( A );
-}
+class MyMutex
+{
+#ifdef _OPENMP
+  omp_lock_t _lock;
+#else
+  volatile long _lock;
+#endif
+
+  // コピー禁止
+  MyMutex( const MyMutex & );
+  MyMutex & operator = ( const MyMutex & );
+
+ public:
+#ifdef _OPENMP
+  MyMutex(){ omp_init_lock( &_lock ); }
+  ~MyMutex(){ omp_destroy_lock( &_lock ); }
+  void lock(){ omp_set_lock( &_lock ); }
+  void unlock(){ omp_unset_lock( &_lock ); }
+#elif defined( _MSC_VER )
+  MyMutex() : _lock( 0 ) { }
+  void lock(){ while( _InterlockedExchange( &_lock, 1 ) ) { } }
+  void unlock(){ _InterlockedExchange( &_lock, 0 ); }
+#else
+  MyMutex() : _lock( 0 ) { }
+  void lock(){ while( __sync_lock_test_and_set( &_lock, 1 ) ) { } }
+  void unlock(){ __sync_lock_release( &_lock ); }
+#endif
+};
 
 /**
- * MyGetColVectors() の別名
+ * スコープの間 MyMutex をロックする
  */
-inline
-std::vector< std::vector< double > >
-MyMatColVecs( const std::vector< std::vector< double > > &A ){
-  return MyMatTrans( A );
-}
+class MyMutexLock
+{
+  MyMutex &_m;
+
+  // コピー禁止
+  MyMutexLock( const MyMutexLock & );
+  MyMutexLock & operator = ( const MyMutexLock & );
+
+ public:
+  explicit MyMutexLock( MyMutex &m ) : _m( m ) { _m.lock(); }
+  ~MyMutexLock(){ _m.unlock(); }
+};
+
+// 最初に確保するチャンクの大きさ（要素数）
+#ifndef MY_WORKSPACE_CHUNK
+#define MY_WORKSPACE_CHUNK ( 1 << 15 )
+#endif
 
 /**
- * 行列の対角成分を返す。
+ * 作業領域
+ * - 通常は MyGetWorkspace() でスレッドごとのものを使う。
+ * - 切り出した領域の中身は不定。
  */
-inline
-std::vector< double >
-MyGetDiagVector( const std::vector< std::vector< double > > &A ){
-  assert( MyMatIsRect( A ) );
-  int n = A.size();
-  std::vector< double > diag_vec( n );
-  for( int i = 0; i < n; i++ ){
-    diag_vec[ i ] = A[ i ][ i ];
+class MyWorkspace
+{
+ public:
+  /**
+   * 使用状況の印（MyWorkspaceScope で使う）
+   */
+  struct Mark {
+    size_t chunk; //!< 使用中のチャンク
+    size_t used;  //!< 使用中のチャンクで使った要素数
+    size_t nvec;  //!< 貸し出し中のベクトルの数
+    size_t nmat;  //!< 貸し出し中の行列の数
+    size_t nfvec; //!< 貸し出し中の float のベクトルの数
+    size_t nfmat; //!< 貸し出し中の float の行列の数
+  };
+
+ private:
+  /**
+   * チャンク
+   */
+  struct Chunk {
+    double *buf;  //!< 確保したメモリ領域（解放用）
+    double *data; //!< アライメント済みの先頭
+    size_t size;  //!< 要素数
+  };
+
+  std::vector< Chunk > _chunks; //!< 確保済みのチャンク
+  size_t _chunk;                //!< 使用中のチャンク
+  size_t _used;                 //!< 使用中のチャンクで使った要素数
+  std::vector< std::vector< double > * > _vecs; //!< 貸し出し用のベクトル
+  size_t _nvec;                 //!< 貸し出し中のベクトルの数
+  std::vector< MyMat * > _mats; //!< 貸し出し用の行列
+  size_t _nmat;                 //!< 貸し出し中の行列の数
+  std::vector< std::vector< float > * > _fvecs; //!< 貸し出し用の float のベクトル
+  size_t _nfvec;                //!< 貸し出し中の float のベクトルの数
+  std::vector< MyMatf * > _fmats; //!< 貸し出し用の float の行列
+  size_t _nfmat;                //!< 貸し出し中の float の行列の数
+
+  // コピー禁止
+  MyWorkspace( const MyWorkspace & );
+  MyWorkspace & operator = ( const MyWorkspace & );
+
+  /**
+   * n 要素のチャンクを確保する
+   */
+  static Chunk newChunk( size_t n ){
+    Chunk c;
+    c.buf = (double *)malloc( n * sizeof( double ) + MY_MAT_ALIGN );
+    assert( c.buf != 0 );
+    c.data = (double *)( ( (size_t)c.buf + MY_MAT_ALIGN - 1 ) & ~( (size_t)MY_MAT_ALIGN - 1 ) );
+    c.size = n;
+    return c;
   }
-  return diag_vec;
-}
+
+  // 要素の型ごとの貸し出し（vec< T >(), mat< T >() から使う）
+  std::vector< double > &vecOf( size_t n, double * ){ return vec( n ); }
+  std::vector< float > &vecOf( size_t n, float * ){
+    if( _nfvec == _fvecs.size() ) _fvecs.push_back( new std::vector< float >() );
+    std::vector< float > &v = *_fvecs[ _nfvec++ ];
+    v.resize( n );
+    return v;
+  }
+  MyMat &matOf( int rows, int cols, double * ){ return mat( rows, cols ); }
+  MyMatf &matOf( int rows, int cols, float * ){
+    if( _nfmat == _fmats.size() ) _fmats.push_back( new MyMatf() );
+    MyMatf &A = *_fmats[ _nfmat++ ];
+    MyMatf tmp( alloc< float >( (size_t)rows * cols ), rows, cols, cols );
+    A.swap( tmp );
+    return A;
+  }
+
+ public:
+  MyWorkspace() : _chunk( 0 ), _used( 0 ), _nvec( 0 ), _nmat( 0 ), _nfvec( 0 ), _nfmat( 0 ) { }
+
+  ~MyWorkspace(){
+    for( size_t i = 0; i < _chunks.size(); i++ ) free( _chunks[ i ].buf );
+    for( size_t i = 0; i < _vecs.size(); i++ ) delete _vecs[ i ];
+    for( size_t i = 0; i < _mats.size(); i++ ) delete _mats[ i ];
+    for( size_t i = 0; i < _fvecs.size(); i++ ) delete _fvecs[ i ];
+    for( size_t i = 0; i < _fmats.size(); i++ ) delete _fmats[ i ];
+  }
+
+  /**
+   * n 要素（double）の領域を切り出す
+   * - 先頭は MY_MAT_ALIGN バイト境界に揃えてある。
+   */
+  double *alloc( size_t n ){
+    const size_t a = MY_MAT_ALIGN / sizeof( double );
+    n = ( n + a - 1 ) / a * a;
+    if( _chunks.empty() ) _chunks.push_back( newChunk( MyMax< size_t >( n, MY_WORKSPACE_CHUNK ) ) );
+    if( _used + n > _chunks[ _chunk ].size ){
+      // 次のチャンクに移る。なければ、または小さすぎれば（まだ使っていないので）大きなものを確保し直す。
+      _chunk++;
+      _used = 0;
+      size_t size = MyMax< size_t >( n, 2 * _chunks.back().size );
+      if( _chunk == _chunks.size() ) _chunks.push_back( newChunk( size ) );
+      else if( _chunks[ _chunk ].size < n ){
+        free( _chunks[ _chunk ].buf );
+        _chunks[ _chunk ] = newChunk( size );
+      }
+    }
+    double *p = _chunks[ _chunk ].data + _used;
+    _used += n;
+    return p;
+  }
+
+  /**
+   * T 型 n 要素の領域を切り出す
+   */
+  template < class T >
+  T *alloc( size_t n ){
+    return reinterpret_cast< T * >( alloc( ( n * sizeof( T ) + sizeof( double ) - 1 ) / sizeof( double ) ) );
+  }
+
+  /**
+   * n 要素のベクトルを借りる
+   * - ベクトル自体も使い回すので、一度 n 要素以上に使ったものならメモリ確保は起きない。
+   */
+  std::vector< double > &vec( size_t n ){
+    if( _nvec == _vecs.size() ) _vecs.push_back( new std::vector< double >() );
+    std::vector< double > &v = *_vecs[ _nvec++ ];
+    v.resize( n );
+    return v;
+  }
+
+  /**
+   * 要素が T 型（float, double）の n 要素のベクトルを借りる
+   */
+  template < class T >
+  std::vector< T > &vec( size_t n ){
+    return vecOf( n, (T *)0 );
+  }
+
+  /**
+   * rows x cols の行列を借りる
+   * - alloc() で切り出した領域を包んだ MyMat（メモリの解放はしない）。
+   * - resize() などで大きさを変えないこと。
+   */
+  MyMat &mat( int rows, int cols ){
+    if( _nmat == _mats.size() ) _mats.push_back( new MyMat() );
+    MyMat &A = *_mats[ _nmat++ ];
+    MyMat tmp( alloc( (size_t)rows * cols ), rows, cols, cols );
+    A.swap( tmp );
+    return A;
+  }
+
+  /**
+   * 要素が T 型（float, double）の rows x cols の行列を借りる
+   */
+  template < class T >
+  MyMatT< T > &mat( int rows, int cols ){
+    return matOf( rows, cols, (T *)0 );
+  }
+
+  /**
+   * 現在の使用状況
+   */
+  Mark mark() const {
+    Mark m = { _chunk, _used, _nvec, _nmat, _nfvec, _nfmat };
+    return m;
+  }
+
+  /**
+   * mark() の時点以降に切り出した領域をまとめて返却する
+   */
+  void release( const Mark &m ){
+    _chunk = m.chunk;
+    _used = m.used;
+    _nvec = m.nvec;
+    _nmat = m.nmat;
+    _nfvec = m.nfvec;
+    _nfmat = m.nfmat;
+  }
+
+  /**
+   * 確保済みのチャンクの合計の大きさ（要素数）
+   */
+  size_t capacity() const {
+    size_t n = 0;
+    for( size_t i = 0; i < _chunks.size(); i++ ) n += _chunks[ i ].size;
+    return n;
+  }
+};
 
 /**
- * MyGetDiagVector() の別名
+ * このスレッドの作業領域
+ * - スレッドごとに最初に呼ばれたときに作られる。スレッドが終わっても解放はしない
+ *  （OpenMP のスレッドプールのように、同じスレッドを使い回す前提）。
  */
 inline
-std::vector< double >
-MyMatDiagVec( const std::vector< std::vector< double > > &A ){
-  return MyGetDiagVector( A );
+MyWorkspace &
+MyGetWorkspace(){
+  static MY_THREAD_LOCAL MyWorkspace *ws = 0;
+  if( ! ws ) ws = new MyWorkspace();
+  return *ws;
 }
 
 /**
- * 行列が対称行列かどうかのチェック
+ * 作業領域のスコープ
+ * - 作ったときの使用状況を覚えておき、スコープを抜けるときにそれ以降に切り出した領域を返却する。
+ */
+class MyWorkspaceScope
+{
+  MyWorkspace &_ws;
+  MyWorkspace::Mark _mark;
+
+  // コピー禁止
+  MyWorkspaceScope( const MyWorkspaceScope & );
+  MyWorkspaceScope & operator = ( const MyWorkspaceScope & );
+
+ public:
+  explicit MyWorkspaceScope( MyWorkspace &ws = MyGetWorkspace() ) : _ws( ws ), _mark( ws.mark() ) { }
+  ~MyWorkspaceScope(){ _ws.release( _mark ); }
+  MyWorkspace &workspace() { return _ws; }
+};
+
+/*
+ * --- 出力先を指定する演算（〜Into） ---
+ * - 結果を新しく確保して返す代わりに、呼び出し側が用意した出力先に書き込む。
+ * - 出力先が空ならその大きさに確保する。空でなければ大きさが合っていること（確保し直しはしない）。
+ * - 繰り返し計算の中で同じ出力先を使い回せば、ヒープのメモリ確保が起きない。
+ * - 演算子（A + B など）はこれらを使って実装してある。
  */
+
+/**
+ * 行列の足し算 C = A + B
+ * - MyMat 版
+ * - C は A や B と同じでもよい。
+ */
+template < class T >
 inline
-bool
-MyMatIsSymmetric( const std::vector< std::vector< double > > &A ){
-  return MyMatTrans( A ) == A;
+void
+MyMatAddInto( const MyMatViewT< T > &A, const MyMatViewT< T > &B, MyMatT< T > &C ){
+  assert( MyMatAreTheSameSize( A, B ) );
+  if( C.empty() ) C.resize( A.rows(), A.cols() );
+  else assert( MyMatAreTheSameSize( A, C ) );
+  for( int i = 0; i < A.rows(); i++ ){
+    for( int j = 0; j < A.cols(); j++ ){
+      C( i, j ) = A( i, j ) + B( i, j );
+    }
+  }
 }
 
 /**
- * 与えられたベクトルの要素を対角要素とする行列を返す
+ * 行列の引き算 C = A - B
+ * - MyMat 版
+ * - C は A や B と同じでもよい。
  */
+template < class T >
 inline
-std::vector< std::vector< double > >
-MyMatDiag( const std::vector< double > &V ){
-  assert( V.size() > 0 );
-  std::vector< std::vector< double > > A( V.size(), std::vector< double >( V.size(), 0 ) );
-  for( int i = 0; i < V.size(); i++ ){
-    A[ i ][ i ] = V[ i ];
+void
+MyMatSubInto( const MyMatViewT< T > &A, const MyMatViewT< T > &B, MyMatT< T > &C ){
+  assert( MyMatAreTheSameSize( A, B ) );
+  if( C.empty() ) C.resize( A.rows(), A.cols() );
+  else assert( MyMatAreTheSameSize( A, C ) );
+  for( int i = 0; i < A.rows(); i++ ){
+    for( int j = 0; j < A.cols(); j++ ){
+      C( i, j ) = A( i, j ) - B( i, j );
+    }
   }
-  return A;
 }
 
-//#########################################################################################
-// 数学
-//#########################################################################################
+/**
+ * 行列の足し算
+ * - MyMat 版
+ */
+template < class T >
+inline
+MyMatT< T >
+operator + ( const MyMatViewT< T > &A, const MyMatViewT< T > &B ){
+  MyMatT< T > C;
+  MyMatAddInto( A, B, C );
+  return C;
+}
 
 /**
- * １変数関数の数値微分を計算
- * - double fx( double x ) な関数
- * - 中心差分
- * @param fx 関数へのポインタ
- * @param x この値での微分値を計算
- * @param[out] out 出力値
- * @param h 微分計算時に用いる微小変化量。デフォルトは、1E-6
+ * 行列の引き算
+ * - MyMat 版
  */
+template < class T >
 inline
-int MyCalcGrad( double (*fx)( double ), double x, double *out, double h = 1E-06 ){
+MyMatT< T >
+operator - ( const MyMatViewT< T > &A, const MyMatViewT< T > &B ){
+  MyMatT< T > C;
+  MyMatSubInto( A, B, C );
+  return C;
+}
 
-  // h が 0 だとゼロ割になってしまうのでダメ
-  assert( h != 0 );
+/*
+ * --- 並列化の設定 ---
+ * - 行列積などの並列化には OpenMP のスレッドプールを使う（-fopenmp などでコンパイルしたときだけ有効）。
+ * - OpenMP なしでコンパイルした場合は、すべて１スレッドで計算する。
+ * - スレッド数、並列化する最小の計算量（浮動小数点演算の回数）、決定的モードを設定できる。
+ * - 決定的モードでは、足し算の順番がシリアル版と同じになる分割だけを使う。結果はシリアル版とビット単位で一致する。
+ */
 
-  // 両隣の関数値の変化から微分値を計算（中心差分方式）   
-  *out = ( fx( x + h ) - fx( x - h ) ) / ( 2 * h );
+// 並列化する最小の計算量（浮動小数点演算の回数）のデフォルト値
+#ifndef MY_PARALLEL_MIN_FLOPS
+#define MY_PARALLEL_MIN_FLOPS ( 1 << 21 )
+#endif
 
-  return 0;
+/**
+ * 並列化の設定値
+ */
+struct MyParallelConfig {
+  int numThreads;     //!< スレッド数（0 なら OpenMP のデフォルト）
+  double minFlops;    //!< これより計算量が少なければシリアルで計算する
+  bool deterministic; //!< 決定的モード
+};
+
+/**
+ * 並列化の設定値（プロセスで１つ）
+ */
+inline
+MyParallelConfig &
+MyParallel(){
+  static MyParallelConfig config = { 0, MY_PARALLEL_MIN_FLOPS, false };
+  return config;
 }
 
 /**
- * １変数関数の数値微分を計算
- * - 値を返す版
+ * スレッド数を設定する
+ * - 0 を指定すると OpenMP のデフォルト（OMP_NUM_THREADS など）に戻る。
  */
 inline
-double MyCalcGrad( double (*fx)( double ), double x, double h = 1E-06 ){
-  double out;
-  MyCalcGrad( fx, x, &out, h );
-  return out;
+void
+MySetNumThreads( int n ){
+  assert( n >= 0 );
+  MyParallel().numThreads = n;
 }
 
 /**
- * 多変数関数の勾配（ナブラ）を返す
- * - vector< double > fx( const vector< double > &x ) な関数
- * - 数値微分（中心差分）
- * @param fx 多変数関数へのポインタ
- * @param x この位置での勾配を計算
- * @param [out] 出力値
- * @param h 数値微分に用いる微小変化値。デフォルトは、1E-6
+ * 使うスレッド数を取得する
  */
 inline
 int
-MyVecGrad( double (*fx)( const std::vector< double > & ),
-           const std::vector< double > &x,
-           std::vector< double > &out,
-           double h = 1E-06
-           ){
-  using namespace std;
+MyGetNumThreads(){
+#ifdef _OPENMP
+  int n = MyParallel().numThreads;
+  return ( n > 0 ) ? n : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
 
-  // h が 0 だとゼロ割になってしまうのでダメ
-  assert( h != 0 );
+/**
+ * 並列化する最小の計算量（浮動小数点演算の回数）を設定する
+ */
+inline
+void
+MySetParallelThreshold( double flops ){
+  assert( flops >= 0 );
+  MyParallel().minFlops = flops;
+}
 
-  // ベクトルの次元数
-  int n = x.size();
+/**
+ * 決定的モードを設定する
+ * - true にすると、スレッド数によらずシリアル版とビット単位で同じ結果になる。
+ */
+inline
+void
+MySetDeterministic( bool on ){
+  MyParallel().deterministic = on;
+}
 
-  // もし出力ベクトルがからだったらリサイズ
-  if( out.empty() ) out.resize( n );
+/**
+ * 計算量 flops の処理に使うスレッド数を返す
+ * - しきい値より小さいとき、既に並列領域の中にいるときは 1 を返す。
+ */
+inline
+int
+MyNumThreadsFor( double flops ){
+#ifdef _OPENMP
+  if( flops < MyParallel().minFlops || omp_in_parallel() ) return 1;
+  return MyGetNumThreads();
+#else
+  (void)flops;
+  return 1;
+#endif
+}
 
-  // そうでなければ、ベクトルのサイズはあらかじめ確保されているものとする
-  else assert( out.size() == n );
+/*
+ * --- 行列積（GEMM）エンジン ---
+ * - C = alpha * A * B + beta * C を、キャッシュブロッキング＋パネルのパッキング＋レジスタタイルで計算する。
+ * - A は MC x KC、B は KC x NC のブロックに切り出し、それぞれ MR 行、NR 列ごとのパネルに詰め直す（パッキング）。
+ * - MR x NR の小さなタイルをマイクロカーネルがレジスタ上で計算する。
+ * - マイクロカーネルは、AVX-512、AVX2+FMA、ポータブル（C++ のみ）の３種類。
+ *   それぞれ double 用と float 用がある（float 用はレジスタ１本に倍の要素が入るので、タイルの列数が倍）。
+ *   GCC/clang では実行時に CPU を調べて使えるものを選ぶ。それ以外ではコンパイル時のマクロで選ぶ。
+ * - MY_NO_SIMD を定義すると常にポータブル版を使う。
+ */
 
-  // 各成分ごとに
-  for( int i = 0; i < n; i++ ){
+#if !defined( MY_NO_SIMD ) && ( defined( __x86_64__ ) || defined( __i386__ ) ) && \
+  ( defined( __clang__ ) || ( defined( __GNUC__ ) && __GNUC__ >= 5 ) )
+#define MY_SIMD_DISPATCH
+#define MY_TARGET_AVX2 __attribute__(( target( "avx2,fma" ) ))
+#define MY_TARGET_AVX512 __attribute__(( target( "avx512f" ) ))
+#define MY_USE_AVX2
+#define MY_USE_AVX512
+#else
+#define MY_TARGET_AVX2
+#define MY_TARGET_AVX512
+#if !defined( MY_NO_SIMD ) && defined( __AVX2__ ) && defined( __FMA__ )
+#define MY_USE_AVX2
+#endif
+#if !defined( MY_NO_SIMD ) && defined( __AVX512F__ )
+#define MY_USE_AVX512
+#endif
+#endif
 
-    // その成分だけを少し動かすベクトル
-    vector< double > dx( n, 0 );
-    dx[ i ] = h;
+// 関数を必ずインライン展開させる指定（SIMD 版の関数の中で、型だけ変えて同じ式を使い回すため）
+#if defined( __GNUC__ )
+#define MY_ALWAYS_INLINE inline __attribute__(( always_inline ))
+#else
+#define MY_ALWAYS_INLINE inline
+#endif
 
-    // 両隣の関数値の変化から微分値を計算（中心差分方式）   
-    out[ i ] = ( fx( x + dx ) - fx( x - dx ) ) / ( 2 * h );
-  }
-  
-  return 0;
-}
+/**
+ * 実行中の CPU で使える SIMD 命令セット
+ */
+enum MySimdLevelType {
+  MY_SIMD_NONE = 0, //!< なし（ポータブル版を使う）
+  MY_SIMD_AVX2,     //!< AVX2 + FMA
+  MY_SIMD_AVX512    //!< AVX-512
+};
 
 /**
- * 勾配ベクトルを返り値として返すパターン
+ * CPU を調べて、使える SIMD 命令セットを返す
+ * - コンパイル時に無効になっているもの（MY_NO_SIMD を定義した場合など）は使えないものとして扱う。
  */
-inline std::vector< double >
-MyVecGrad( double (*fx)( const std::vector< double > & ),
-           const std::vector< double > &x, double h = 1E-06 ){
-  std::vector< double > out;
-  MyVecGrad( fx, x, out, h );
-  return out;
+inline
+MySimdLevelType
+MySimdDetect(){
+#ifdef MY_SIMD_DISPATCH
+  __builtin_cpu_init();
+  bool has_avx512 = __builtin_cpu_supports( "avx512f" );
+  bool has_avx2 = __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" );
+#else
+  bool has_avx512 = true; // コンパイル時に有効になっていれば使える
+  bool has_avx2 = true;
+#endif
+  MySimdLevelType level = MY_SIMD_NONE;
+#ifdef MY_USE_AVX2
+  if( has_avx2 ) level = MY_SIMD_AVX2;
+#endif
+#ifdef MY_USE_AVX512
+  if( has_avx512 ) level = MY_SIMD_AVX512;
+#endif
+  (void)has_avx512;
+  (void)has_avx2;
+  return level;
 }
 
 /**
- * 数値微分（微小差分）でヘッセを計算する
- * - d2f/dxdy = ( f(x+h,y+h) - f(x-h,y+h) - f(x+h,y-h) + f(x-h,y-h) ) / (4*h*h)
- * @param h 差分計算時の微小変化量。二乗されることに注意。小さくしすぎると値がおかしくなる。
+ * 使える SIMD 命令セット（初回呼び出し時に調べる）
  */
 inline
-int
-MyMatHessian( double (*fx)( const std::vector< double > & ),
-              const std::vector< double > &x,
-              std::vector< std::vector< double > > &out,
-              double h = 1E-3 ){
-  using namespace std;
+MySimdLevelType
+MySimdLevel(){
+  static const MySimdLevelType level = MySimdDetect();
+  return level;
+}
 
-  // 入力チェック
-  assert( h != 0 );
-  
-  // 次元
-  int N = x.size();
+// ブロックサイズ（要素数）。MC は全カーネルの MR の倍数、NC は全カーネルの NR の倍数にしておくこと。
+#ifndef MY_GEMM_MC
+#define MY_GEMM_MC 96
+#endif
+#ifndef MY_GEMM_KC
+#define MY_GEMM_KC 256
+#endif
+#ifndef MY_GEMM_NC
+#define MY_GEMM_NC 2048
+#endif
 
-  // 出力バッファ
-  if( out.empty() ) out.resize( N, vector< double >( N ) );
-  else assert( MyMatSize( out ) == MyPoint2i( N, N ) );
-  
-  for( int i = 0; i < N; i++ ){
-    for( int j = i; j < N; j++ ){
-      vector< double > h1( x );
-      h1[ i ] += h;
-      h1[ j ] += h;
-      vector< double > h2( x );
-      h2[ i ] -= h;
-      h2[ j ] += h;
-      vector< double > h3( x );
-      h3[ i ] += h;
-      h3[ j ] -= h;
-      vector< double > h4( x );
-      h4[ i ] -= h;
-      h4[ j ] -= h;
-      out[ i ][ j ] = ( fx( h1 ) - fx( h2 ) - fx( h3 ) + fx( h4 ) ) / ( 4 * h * h );
-      out[ j ][ i ] = out[ i ][ j ];
-    }//j
-  }//i
-  
-  return 0;
-}
+// マイクロタイルの最大サイズ
+#define MY_GEMM_MAX_MR 8
+#define MY_GEMM_MAX_NR 32
 
 /**
- * ３x３の逆行列
- * - 解析解
- * @param [in] src 計算対象の行列。
- * @param [out] dst メモリが確保済みでなければ内部で確保。src と同じサイズの確保済みを渡しても OK 。
- * @return 行列式の値を返す。行列式がゼロの場合はエラー。
+ * 使用するマイクロカーネルの情報
+ * - T は要素の型（float, double）。
+ * - カーネル関数は c += alpha * ( a の kc 列分 ) * ( b の kc 行分 ) を計算する。
+ *   a は MR 個ずつ、b は NR 個ずつ k の順に詰めてあること。
+ *   c は rs_c, cs_c のストライドで MR x NR の領域。
  */
-inline
-double
-MyMatInv3x3( const std::vector< std::vector< double > > &src,
-             std::vector< std::vector< double > > &dst )
-{
-  // assert( src.size() == 3 );
-  // assert( src[ 0 ].size() == 3 );
-  assert( MyMatSize( src ) == MyPoint2i( 3, 3 ) );
+template < class T >
+struct MyGemmKernelInfoT {
+  typedef void (*Kernel)( int kc, T alpha, const T *a, const T *b, T *c, int rs_c, int cs_c );
+  int mr; //!< タイルの行数
+  int nr; //!< タイルの列数
+  Kernel kernel; //!< カーネル関数
+  const char *name; //!< 名前（デバッグ表示用）
+};
 
-  double detA =
-      src[0][0] * src[1][1] * src[2][2] +
-      src[1][0] * src[2][1] * src[0][2] +
-      src[2][0] * src[0][1] * src[1][2] -
-      src[0][0] * src[2][1] * src[1][2] -
-      src[2][0] * src[1][1] * src[0][2] -
-      src[1][0] * src[0][1] * src[2][2];
+typedef MyGemmKernelInfoT< double > MyGemmKernelInfo;
+typedef MyGemmKernelInfo::Kernel MyGemmKernelType;
 
-  assert( detA != 0 );
+/**
+ * マイクロカーネル（ポータブル版）
+ * - 4 x 4
+ */
+template < class T >
+inline
+void
+MyGemmKernel_Ref( int kc, T alpha, const T *a, const T *b,
+                  T *c, int rs_c, int cs_c ){
+  T ab[ 4 * 4 ] = { 0 };
+  for( int k = 0; k < kc; k++ ){
+    for( int i = 0; i < 4; i++ ){
+      T ai = a[ i ];
+      for( int j = 0; j < 4; j++ ) ab[ i * 4 + j ] += ai * b[ j ];
+    }
+    a += 4;
+    b += 4;
+  }
+  for( int i = 0; i < 4; i++ ){
+    for( int j = 0; j < 4; j++ ) c[ i * rs_c + j * cs_c ] += alpha * ab[ i * 4 + j ];
+  }
+}
 
-  if( dst.empty() ) dst.resize( 3, std::vector< double >( 3 ) );
+#ifdef MY_USE_AVX2
+/**
+ * マイクロカーネル（AVX2 + FMA 版）
+ * - 6 x 8。アキュムレータ 12 本を ymm レジスタに置く。
+ */
+MY_TARGET_AVX2
+inline
+void
+MyGemmKernel_AVX2( int kc, double alpha, const double *a, const double *b,
+                   double *c, int rs_c, int cs_c ){
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+  __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+  for( int k = 0; k < kc; k++ ){
+    __m256d b0 = _mm256_loadu_pd( b );
+    __m256d b1 = _mm256_loadu_pd( b + 4 );
+    __m256d ai;
+    ai = _mm256_broadcast_sd( a + 0 ); c00 = _mm256_fmadd_pd( ai, b0, c00 ); c01 = _mm256_fmadd_pd( ai, b1, c01 );
+    ai = _mm256_broadcast_sd( a + 1 ); c10 = _mm256_fmadd_pd( ai, b0, c10 ); c11 = _mm256_fmadd_pd( ai, b1, c11 );
+    ai = _mm256_broadcast_sd( a + 2 ); c20 = _mm256_fmadd_pd( ai, b0, c20 ); c21 = _mm256_fmadd_pd( ai, b1, c21 );
+    ai = _mm256_broadcast_sd( a + 3 ); c30 = _mm256_fmadd_pd( ai, b0, c30 ); c31 = _mm256_fmadd_pd( ai, b1, c31 );
+    ai = _mm256_broadcast_sd( a + 4 ); c40 = _mm256_fmadd_pd( ai, b0, c40 ); c41 = _mm256_fmadd_pd( ai, b1, c41 );
+    ai = _mm256_broadcast_sd( a + 5 ); c50 = _mm256_fmadd_pd( ai, b0, c50 ); c51 = _mm256_fmadd_pd( ai, b1, c51 );
+    a += 6;
+    b += 8;
+  }
+  __m256d acc[ 12 ] = { c00, c01, c10, c11, c20, c21, c30, c31, c40, c41, c50, c51 };
+  __m256d va = _mm256_set1_pd( alpha );
+  if( cs_c == 1 ){
+    for( int i = 0; i < 6; i++ ){
+      double *ci = c + i * rs_c;
+      _mm256_storeu_pd( ci, _mm256_fmadd_pd( va, acc[ 2 * i ], _mm256_loadu_pd( ci ) ) );
+      _mm256_storeu_pd( ci + 4, _mm256_fmadd_pd( va, acc[ 2 * i + 1 ], _mm256_loadu_pd( ci + 4 ) ) );
+    }
+  }
   else{
-    assert( dst.size() == 3 );
-    assert( dst[ 0 ].size() == 3 );
+    double ab[ 6 * 8 ];
+    for( int i = 0; i < 6; i++ ){
+      _mm256_storeu_pd( ab + i * 8, acc[ 2 * i ] );
+      _mm256_storeu_pd( ab + i * 8 + 4, acc[ 2 * i + 1 ] );
+    }
+    for( int i = 0; i < 6; i++ ){
+      for( int j = 0; j < 8; j++ ) c[ i * rs_c + j * cs_c ] += alpha * ab[ i * 8 + j ];
+    }
   }
+}
+#endif
 
-  dst[0][0] = src[1][1] * src[2][2] - src[1][2] * src[2][1];
-  dst[0][1] = src[0][2] * src[2][1] - src[0][1] * src[2][2];
-  dst[0][2] = src[0][1] * src[1][2] - src[0][2] * src[1][1];
-  dst[1][0] = src[1][2] * src[2][0] - src[1][0] * src[2][2];
-  dst[1][1] = src[0][0] * src[2][2] - src[0][2] * src[2][0];
-  dst[1][2] = src[0][2] * src[1][0] - src[0][0] * src[1][2];
-  dst[2][0] = src[1][0] * src[2][1] - src[1][1] * src[2][0];
-  dst[2][1] = src[0][1] * src[2][0] - src[0][0] * src[2][1];
-  dst[2][2] = src[0][0] * src[1][1] - src[0][1] * src[1][0];
+#ifdef MY_USE_AVX2
+/**
+ * マイクロカーネル（AVX2 + FMA 版、float）
+ * - 6 x 16。ymm レジスタ１本に 8 要素入るので、double 版と同じレジスタ数で倍の列を計算する。
+ */
+MY_TARGET_AVX2
+inline
+void
+MyGemmKernel_AVX2f( int kc, float alpha, const float *a, const float *b,
+                    float *c, int rs_c, int cs_c ){
+  __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+  __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+  __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+  __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+  __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+  __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+  for( int k = 0; k < kc; k++ ){
+    __m256 b0 = _mm256_loadu_ps( b );
+    __m256 b1 = _mm256_loadu_ps( b + 8 );
+    __m256 ai;
+    ai = _mm256_broadcast_ss( a + 0 ); c00 = _mm256_fmadd_ps( ai, b0, c00 ); c01 = _mm256_fmadd_ps( ai, b1, c01 );
+    ai = _mm256_broadcast_ss( a + 1 ); c10 = _mm256_fmadd_ps( ai, b0, c10 ); c11 = _mm256_fmadd_ps( ai, b1, c11 );
+    ai = _mm256_broadcast_ss( a + 2 ); c20 = _mm256_fmadd_ps( ai, b0, c20 ); c21 = _mm256_fmadd_ps( ai, b1, c21 );
+    ai = _mm256_broadcast_ss( a + 3 ); c30 = _mm256_fmadd_ps( ai, b0, c30 ); c31 = _mm256_fmadd_ps( ai, b1, c31 );
+    ai = _mm256_broadcast_ss( a + 4 ); c40 = _mm256_fmadd_ps( ai, b0, c40 ); c41 = _mm256_fmadd_ps( ai, b1, c41 );
+    ai = _mm256_broadcast_ss( a + 5 ); c50 = _mm256_fmadd_ps( ai, b0, c50 ); c51 = _mm256_fmadd_ps( ai, b1, c51 );
+    a += 6;
+    b += 16;
+  }
+  __m256 acc[ 12 ] = { c00, c01, c10, c11, c20, c21, c30, c31, c40, c41, c50, c51 };
+  __m256 va = _mm256_set1_ps( alpha );
+  if( cs_c == 1 ){
+    for( int i = 0; i < 6; i++ ){
+      float *ci = c + i * rs_c;
+      _mm256_storeu_ps( ci, _mm256_fmadd_ps( va, acc[ 2 * i ], _mm256_loadu_ps( ci ) ) );
+      _mm256_storeu_ps( ci + 8, _mm256_fmadd_ps( va, acc[ 2 * i + 1 ], _mm256_loadu_ps( ci + 8 ) ) );
+    }
+  }
+  else{
+    float ab[ 6 * 16 ];
+    for( int i = 0; i < 6; i++ ){
+      _mm256_storeu_ps( ab + i * 16, acc[ 2 * i ] );
+      _mm256_storeu_ps( ab + i * 16 + 8, acc[ 2 * i + 1 ] );
+    }
+    for( int i = 0; i < 6; i++ ){
+      for( int j = 0; j < 16; j++ ) c[ i * rs_c + j * cs_c ] += alpha * ab[ i * 16 + j ];
+    }
+  }
+}
+#endif
 
-  for( int i = 0; i < 3; i++ ){
-    for( int j = 0; j < 3; j++ ){
-      dst[ i ][ j ] /= detA;
+#ifdef MY_USE_AVX512
+/**
+ * マイクロカーネル（AVX-512 版）
+ * - 8 x 16。アキュムレータ 16 本を zmm レジスタに置く。
+ */
+MY_TARGET_AVX512
+inline
+void
+MyGemmKernel_AVX512( int kc, double alpha, const double *a, const double *b,
+                     double *c, int rs_c, int cs_c ){
+  __m512d c00 = _mm512_setzero_pd(), c01 = _mm512_setzero_pd();
+  __m512d c10 = _mm512_setzero_pd(), c11 = _mm512_setzero_pd();
+  __m512d c20 = _mm512_setzero_pd(), c21 = _mm512_setzero_pd();
+  __m512d c30 = _mm512_setzero_pd(), c31 = _mm512_setzero_pd();
+  __m512d c40 = _mm512_setzero_pd(), c41 = _mm512_setzero_pd();
+  __m512d c50 = _mm512_setzero_pd(), c51 = _mm512_setzero_pd();
+  __m512d c60 = _mm512_setzero_pd(), c61 = _mm512_setzero_pd();
+  __m512d c70 = _mm512_setzero_pd(), c71 = _mm512_setzero_pd();
+  for( int k = 0; k < kc; k++ ){
+    __m512d b0 = _mm512_loadu_pd( b );
+    __m512d b1 = _mm512_loadu_pd( b + 8 );
+    __m512d ai;
+    ai = _mm512_set1_pd( a[ 0 ] ); c00 = _mm512_fmadd_pd( ai, b0, c00 ); c01 = _mm512_fmadd_pd( ai, b1, c01 );
+    ai = _mm512_set1_pd( a[ 1 ] ); c10 = _mm512_fmadd_pd( ai, b0, c10 ); c11 = _mm512_fmadd_pd( ai, b1, c11 );
+    ai = _mm512_set1_pd( a[ 2 ] ); c20 = _mm512_fmadd_pd( ai, b0, c20 ); c21 = _mm512_fmadd_pd( ai, b1, c21 );
+    ai = _mm512_set1_pd( a[ 3 ] ); c30 = _mm512_fmadd_pd( ai, b0, c30 ); c31 = _mm512_fmadd_pd( ai, b1, c31 );
+    ai = _mm512_set1_pd( a[ 4 ] ); c40 = _mm512_fmadd_pd( ai, b0, c40 ); c41 = _mm512_fmadd_pd( ai, b1, c41 );
+    ai = _mm512_set1_pd( a[ 5 ] ); c50 = _mm512_fmadd_pd( ai, b0, c50 ); c51 = _mm512_fmadd_pd( ai, b1, c51 );
+    ai = _mm512_set1_pd( a[ 6 ] ); c60 = _mm512_fmadd_pd( ai, b0, c60 ); c61 = _mm512_fmadd_pd( ai, b1, c61 );
+    ai = _mm512_set1_pd( a[ 7 ] ); c70 = _mm512_fmadd_pd( ai, b0, c70 ); c71 = _mm512_fmadd_pd( ai, b1, c71 );
+    a += 8;
+    b += 16;
+  }
+  __m512d acc[ 16 ] = { c00, c01, c10, c11, c20, c21, c30, c31, c40, c41, c50, c51, c60, c61, c70, c71 };
+  __m512d va = _mm512_set1_pd( alpha );
+  if( cs_c == 1 ){
+    for( int i = 0; i < 8; i++ ){
+      double *ci = c + i * rs_c;
+      _mm512_storeu_pd( ci, _mm512_fmadd_pd( va, acc[ 2 * i ], _mm512_loadu_pd( ci ) ) );
+      _mm512_storeu_pd( ci + 8, _mm512_fmadd_pd( va, acc[ 2 * i + 1 ], _mm512_loadu_pd( ci + 8 ) ) );
+    }
+  }
+  else{
+    double ab[ 8 * 16 ];
+    for( int i = 0; i < 8; i++ ){
+      _mm512_storeu_pd( ab + i * 16, acc[ 2 * i ] );
+      _mm512_storeu_pd( ab + i * 16 + 8, acc[ 2 * i + 1 ] );
+    }
+    for( int i = 0; i < 8; i++ ){
+      for( int j = 0; j < 16; j++ ) c[ i * rs_c + j * cs_c ] += alpha * ab[ i * 16 + j ];
+    }
+  }
+}
+#endif
+
+#ifdef MY_USE_AVX512
+/**
+ * マイクロカーネル（AVX-512 版、float）
+ * - 8 x 32。アキュムレータ 16 本を zmm レジスタに置く。
+ */
+MY_TARGET_AVX512
+inline
+void
+MyGemmKernel_AVX512f( int kc, float alpha, const float *a, const float *b,
+                      float *c, int rs_c, int cs_c ){
+  __m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+  __m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+  __m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+  __m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+  __m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+  __m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+  __m512 c60 = _mm512_setzero_ps(), c61 = _mm512_setzero_ps();
+  __m512 c70 = _mm512_setzero_ps(), c71 = _mm512_setzero_ps();
+  for( int k = 0; k < kc; k++ ){
+    __m512 b0 = _mm512_loadu_ps( b );
+    __m512 b1 = _mm512_loadu_ps( b + 16 );
+    __m512 ai;
+    ai = _mm512_set1_ps( a[ 0 ] ); c00 = _mm512_fmadd_ps( ai, b0, c00 ); c01 = _mm512_fmadd_ps( ai, b1, c01 );
+    ai = _mm512_set1_ps( a[ 1 ] ); c10 = _mm512_fmadd_ps( ai, b0, c10 ); c11 = _mm512_fmadd_ps( ai, b1, c11 );
+    ai = _mm512_set1_ps( a[ 2 ] ); c20 = _mm512_fmadd_ps( ai, b0, c20 ); c21 = _mm512_fmadd_ps( ai, b1, c21 );
+    ai = _mm512_set1_ps( a[ 3 ] ); c30 = _mm512_fmadd_ps( ai, b0, c30 ); c31 = _mm512_fmadd_ps( ai, b1, c31 );
+    ai = _mm512_set1_ps( a[ 4 ] ); c40 = _mm512_fmadd_ps( ai, b0, c40 ); c41 = _mm512_fmadd_ps( ai, b1, c41 );
+    ai = _mm512_set1_ps( a[ 5 ] ); c50 = _mm512_fmadd_ps( ai, b0, c50 ); c51 = _mm512_fmadd_ps( ai, b1, c51 );
+    ai = _mm512_set1_ps( a[ 6 ] ); c60 = _mm512_fmadd_ps( ai, b0, c60 ); c61 = _mm512_fmadd_ps( ai, b1, c61 );
+    ai = _mm512_set1_ps( a[ 7 ] ); c70 = _mm512_fmadd_ps( ai, b0, c70 ); c71 = _mm512_fmadd_ps( ai, b1, c71 );
+    a += 8;
+    b += 32;
+  }
+  __m512 acc[ 16 ] = { c00, c01, c10, c11, c20, c21, c30, c31, c40, c41, c50, c51, c60, c61, c70, c71 };
+  __m512 va = _mm512_set1_ps( alpha );
+  if( cs_c == 1 ){
+    for( int i = 0; i < 8; i++ ){
+      float *ci = c + i * rs_c;
+      _mm512_storeu_ps( ci, _mm512_fmadd_ps( va, acc[ 2 * i ], _mm512_loadu_ps( ci ) ) );
+      _mm512_storeu_ps( ci + 16, _mm512_fmadd_ps( va, acc[ 2 * i + 1 ], _mm512_loadu_ps( ci + 16 ) ) );
+    }
+  }
+  else{
+    float ab[ 8 * 32 ];
+    for( int i = 0; i < 8; i++ ){
+      _mm512_storeu_ps( ab + i * 32, acc[ 2 * i ] );
+      _mm512_storeu_ps( ab + i * 32 + 16, acc[ 2 * i + 1 ] );
+    }
+    for( int i = 0; i < 8; i++ ){
+      for( int j = 0; j < 32; j++ ) c[ i * rs_c + j * cs_c ] += alpha * ab[ i * 32 + j ];
+    }
+  }
+}
+#endif
+
+/**
+ * CPU が対応している中で一番速いマイクロカーネルを選ぶ
+ */
+inline
+MyGemmKernelInfo
+MyGemmSelectKernel(){
+  MyGemmKernelInfo info;
+  info.mr = 4;
+  info.nr = 4;
+  info.kernel = MyGemmKernel_Ref< double >;
+  info.name = "ref";
+  MySimdLevelType level = MySimdLevel();
+#ifdef MY_USE_AVX2
+  if( level >= MY_SIMD_AVX2 ){
+    info.mr = 6;
+    info.nr = 8;
+    info.kernel = MyGemmKernel_AVX2;
+    info.name = "avx2";
+  }
+#endif
+#ifdef MY_USE_AVX512
+  if( level >= MY_SIMD_AVX512 ){
+    info.mr = 8;
+    info.nr = 16;
+    info.kernel = MyGemmKernel_AVX512;
+    info.name = "avx512";
+  }
+#endif
+  (void)level;
+  return info;
+}
+
+/**
+ * CPU が対応している中で一番速いマイクロカーネルを選ぶ（float 版）
+ */
+inline
+MyGemmKernelInfoT< float >
+MyGemmSelectKernelf(){
+  MyGemmKernelInfoT< float > info;
+  info.mr = 4;
+  info.nr = 4;
+  info.kernel = MyGemmKernel_Ref< float >;
+  info.name = "ref";
+  MySimdLevelType level = MySimdLevel();
+#ifdef MY_USE_AVX2
+  if( level >= MY_SIMD_AVX2 ){
+    info.mr = 6;
+    info.nr = 16;
+    info.kernel = MyGemmKernel_AVX2f;
+    info.name = "avx2";
+  }
+#endif
+#ifdef MY_USE_AVX512
+  if( level >= MY_SIMD_AVX512 ){
+    info.mr = 8;
+    info.nr = 32;
+    info.kernel = MyGemmKernel_AVX512f;
+    info.name = "avx512";
+  }
+#endif
+  (void)level;
+  return info;
+}
+
+/**
+ * 使用中のマイクロカーネルの情報を返す（初回呼び出し時に選択）
+ */
+inline
+const MyGemmKernelInfo &
+MyGemmKernel(){
+  static const MyGemmKernelInfo info = MyGemmSelectKernel();
+  return info;
+}
+
+/**
+ * 使用中のマイクロカーネルの情報を返す（float 版）
+ */
+inline
+const MyGemmKernelInfoT< float > &
+MyGemmKernelf(){
+  static const MyGemmKernelInfoT< float > info = MyGemmSelectKernelf();
+  return info;
+}
+
+// 要素の型からカーネルを選ぶ（テンプレートの中で使う）
+inline const MyGemmKernelInfo & MyGemmKernelOf( double * ){ return MyGemmKernel(); }
+inline const MyGemmKernelInfoT< float > & MyGemmKernelOf( float * ){ return MyGemmKernelf(); }
+
+/**
+ * A のブロック（mc x kc）を MR 行ごとのパネルに詰める
+ * - パネル内は k の順に MR 個ずつ並ぶ。端数の行はゼロで埋める。
+ */
+template < class T >
+inline
+void
+MyGemmPackA( int mc, int kc, const T *A, int rs, int cs, int mr, T *Ap ){
+  for( int i0 = 0; i0 < mc; i0 += mr ){
+    int m = MyMin( mr, mc - i0 );
+    for( int k = 0; k < kc; k++ ){
+      const T *a = A + (size_t)i0 * rs + (size_t)k * cs;
+      int i = 0;
+      for( ; i < m; i++ ) Ap[ i ] = a[ (size_t)i * rs ];
+      for( ; i < mr; i++ ) Ap[ i ] = 0;
+      Ap += mr;
+    }
+  }
+}
+
+/**
+ * B のブロック（kc x nc）を NR 列ごとのパネルに詰める
+ * - パネル内は k の順に NR 個ずつ並ぶ。端数の列はゼロで埋める。
+ */
+template < class T >
+inline
+void
+MyGemmPackB( int kc, int nc, const T *B, int rs, int cs, int nr, T *Bp ){
+  for( int j0 = 0; j0 < nc; j0 += nr ){
+    int n = MyMin( nr, nc - j0 );
+    for( int k = 0; k < kc; k++ ){
+      const T *b = B + (size_t)k * rs + (size_t)j0 * cs;
+      int j = 0;
+      if( cs == 1 ) for( ; j < n; j++ ) Bp[ j ] = b[ j ];
+      else for( ; j < n; j++ ) Bp[ j ] = b[ (size_t)j * cs ];
+      for( ; j < nr; j++ ) Bp[ j ] = 0;
+      Bp += nr;
+    }
+  }
+}
+
+/**
+ * パッキング済みの A ブロック、B ブロックに対してマイクロカーネルを回す
+ * - C の mc x nc の領域に alpha * Ap * Bp を足し込む。
+ */
+template < class T >
+inline
+void
+MyGemmMacroKernel( int mc, int nc, int kc, T alpha, const T *Ap, const T *Bp,
+                   T *C, int rs_c, int cs_c, const MyGemmKernelInfoT< T > &ki ){
+  int mr = ki.mr, nr = ki.nr;
+  T ct[ MY_GEMM_MAX_MR * MY_GEMM_MAX_NR ];
+  for( int j0 = 0; j0 < nc; j0 += nr ){
+    int n = MyMin( nr, nc - j0 );
+    const T *b = Bp + (size_t)j0 * kc;
+    for( int i0 = 0; i0 < mc; i0 += mr ){
+      int m = MyMin( mr, mc - i0 );
+      const T *a = Ap + (size_t)i0 * kc;
+      T *c = C + (size_t)i0 * rs_c + (size_t)j0 * cs_c;
+      if( m == mr && n == nr ){
+        ki.kernel( kc, alpha, a, b, c, rs_c, cs_c );
+      }
+      else{
+        // 端のタイルは一旦作業領域で計算してから必要な部分だけ足す
+        std::fill( ct, ct + mr * nr, T( 0 ) );
+        ki.kernel( kc, alpha, a, b, ct, nr, 1 );
+        for( int i = 0; i < m; i++ ){
+          for( int j = 0; j < n; j++ ) c[ (size_t)i * rs_c + (size_t)j * cs_c ] += ct[ i * nr + j ];
+        }
+      }
+    }//i0
+  }//j0
+}
+
+/**
+ * C の１つのタイルを計算する
+ * - C の ic 行目から mc 行、jc 列目から nc 列の領域に、K 方向の k0 から k1 までの分を足し込む。
+ * - Ap, Bp は作業領域（それぞれ MC x KC、KC x nc をパネル単位に切り上げた大きさ）。
+ */
+template < class T >
+inline
+void
+MyGemmTile( T alpha, const MyMatViewT< T > &A, const MyMatViewT< T > &B, MyMatViewT< T > &C,
+            int ic, int mc, int jc, int nc, int k0, int k1,
+            const MyGemmKernelInfoT< T > &ki, T *Ap, T *Bp ){
+  for( int pc = k0; pc < k1; pc += MY_GEMM_KC ){
+    int kc = MyMin( MY_GEMM_KC, k1 - pc );
+    MyGemmPackB( kc, nc, B.ptr( pc, jc ), B.rowStride(), B.colStride(), ki.nr, Bp );
+    for( int i = 0; i < mc; i += MY_GEMM_MC ){
+      int m = MyMin( MY_GEMM_MC, mc - i );
+      MyGemmPackA( m, kc, A.ptr( ic + i, pc ), A.rowStride(), A.colStride(), ki.mr, Ap );
+      MyGemmMacroKernel( m, nc, kc, alpha, Ap, Bp,
+                         C.ptr( ic + i, jc ), C.rowStride(), C.colStride(), ki );
+    }//i
+  }//pc
+}
+
+#ifdef _OPENMP
+/**
+ * 行列積の並列版
+ * - C を MC 行 x（NR の倍数）列の２次元タイルに分け、タイル単位でスレッドに配る。
+ * - タイルの境界はシリアル版のマイクロタイルの境界と揃えてあり、K 方向の足し算の順番も同じなので、
+ *   この分け方ならシリアル版とビット単位で一致する。
+ * - 決定的モードでないときは、タイル数がスレッド数に足りなければ K 方向にも分け、
+ *   スレッドごとの部分和を最後に足し合わせる（結果の丸め誤差はシリアル版と変わる）。
+ */
+template < class T >
+inline
+void
+MyGemmParallel( T alpha, const MyMatViewT< T > &A, const MyMatViewT< T > &B, MyMatViewT< T > &C,
+                int nt, const MyGemmKernelInfoT< T > &ki ){
+  int M = A.rows(), K = A.cols(), N = B.cols();
+
+  // タイル数がスレッド数の数倍になるように列方向の分割数を決める
+  int mb = ( M + MY_GEMM_MC - 1 ) / MY_GEMM_MC;
+  int npanel = ( N + ki.nr - 1 ) / ki.nr;
+  int nb = MyMax( ( N + MY_GEMM_NC - 1 ) / MY_GEMM_NC, ( 4 * nt + mb - 1 ) / mb );
+  nb = MyMin( nb, npanel );
+  int nw = ( npanel + nb - 1 ) / nb * ki.nr;
+  nb = ( N + nw - 1 ) / nw;
+  int ntiles = mb * nb;
+
+  // K 方向の分割数
+  int kblocks = ( K + MY_GEMM_KC - 1 ) / MY_GEMM_KC;
+  int kb = 1;
+  if( ! MyParallel().deterministic && ntiles < nt ) kb = MyMin( nt / ntiles, kblocks );
+
+  // K 方向の部分和（kb - 1 枚の M x N 行列を作業領域に縦に並べる）
+  MyWorkspaceScope scope;
+  MyMatT< T > &P = scope.workspace().mat< T >( ( kb - 1 ) * M, N );
+  P.fill( 0 );
+
+  int kc_max = MyMin( MY_GEMM_KC, K );
+  int mc_max = MyMin( MY_GEMM_MC, mb * MY_GEMM_MC );
+#pragma omp parallel num_threads( nt )
+  {
+    // パッキング用の作業領域は各スレッドの作業領域から取る
+    MyWorkspaceScope tscope;
+    T *Ap = tscope.workspace().alloc< T >( (size_t)mc_max * kc_max );
+    T *Bp = tscope.workspace().alloc< T >( (size_t)kc_max * nw );
+#pragma omp for schedule( dynamic )
+    for( int t = 0; t < ntiles * kb; t++ ){
+      int q = t / ntiles, ib = ( t % ntiles ) / nb, jb = t % nb;
+      int ic = ib * MY_GEMM_MC, jc = jb * nw;
+      int k0 = MyMin( K, (int)( (long long)q * kblocks / kb ) * MY_GEMM_KC );
+      int k1 = MyMin( K, (int)( (long long)( q + 1 ) * kblocks / kb ) * MY_GEMM_KC );
+      MyMatViewT< T > Pq = ( q == 0 ) ? MyMatViewT< T >() : P.block( ( q - 1 ) * M, 0, M, N );
+      MyMatViewT< T > &D = ( q == 0 ) ? C : Pq;
+      MyGemmTile( alpha, A, B, D, ic, MyMin( MY_GEMM_MC, M - ic ), jc, MyMin( nw, N - jc ), k0, k1,
+                  ki, Ap, Bp );
+    }//t
+  }
+
+  // 部分和を順番に足す
+  if( kb > 1 ){
+#pragma omp parallel for num_threads( nt )
+    for( int i = 0; i < M; i++ ){
+      for( int q = 0; q < kb - 1; q++ ){
+        for( int j = 0; j < N; j++ ) C( i, j ) += P( q * M + i, j );
+      }
+    }//i
+  }
+}
+#endif
+
+/**
+ * 行列積 C = alpha * A * B + beta * C
+ * - A: M x K、B: K x N、C: M x N（確保済みであること）
+ * - A, B はストライド付きの MyMat でよい（転置して包んだものなど）。
+ * - 小さな行列では、ブロッキングせずにそのまま計算する。
+ * - 計算量が MySetParallelThreshold() のしきい値以上なら、複数のスレッドで計算する。
+ * - 要素の型は float でもよい（MyMatf）。float 用のマイクロカーネルは SIMD のレジスタ１本で倍の要素を扱う。
+ *   足し込みは float で行うが、K 方向は KC ごとのブロックに区切って C に足すので、１本の足し込みの長さは KC まで。
+ */
+template < class T >
+inline
+void
+MyGemm( double alpha, const MyMatViewT< T > &A, const MyMatViewT< T > &B, double beta, MyMatViewT< T > &C ){
+  int M = A.rows(), K = A.cols(), N = B.cols();
+  assert( B.rows() == K );
+  assert( C.rows() == M && C.cols() == N );
+
+  // beta 倍（beta == 0 のときは元の値を見ない）
+  if( beta != 1 ){
+    for( int i = 0; i < M; i++ ){
+      for( int j = 0; j < N; j++ ) C( i, j ) = ( beta == 0 ) ? 0 : (T)( beta * C( i, j ) );
+    }
+  }
+  if( M == 0 || N == 0 || K == 0 || alpha == 0 ) return;
+
+  // 小さな行列はパッキングの手間の方が大きいので、そのまま i-k-j の順で計算
+  if( (double)M * N * K <= 32.0 * 32 * 32 ){
+    for( int i = 0; i < M; i++ ){
+      for( int k = 0; k < K; k++ ){
+        T a = (T)alpha * A( i, k );
+        for( int j = 0; j < N; j++ ) C( i, j ) += a * B( k, j );
+      }
+    }
+    return;
+  }
+
+  const MyGemmKernelInfoT< T > &ki = MyGemmKernelOf( (T *)0 );
+#ifdef _OPENMP
+  int nt = MyNumThreadsFor( 2.0 * M * N * K );
+  if( nt > 1 ){
+    MyGemmParallel( (T)alpha, A, B, C, nt, ki );
+    return;
+  }
+#endif
+
+  int nc_max = MyMin( MY_GEMM_NC, ( N + ki.nr - 1 ) / ki.nr * ki.nr );
+  int kc_max = MyMin( MY_GEMM_KC, K );
+  int mc_max = MyMin( MY_GEMM_MC, ( M + ki.mr - 1 ) / ki.mr * ki.mr );
+
+  // パッキング用の作業領域（アライメント済み）
+  MyWorkspaceScope scope;
+  T *Ap = scope.workspace().alloc< T >( (size_t)mc_max * kc_max );
+  T *Bp = scope.workspace().alloc< T >( (size_t)kc_max * nc_max );
+
+  for( int jc = 0; jc < N; jc += MY_GEMM_NC ){
+    MyGemmTile( (T)alpha, A, B, C, 0, M, jc, MyMin( MY_GEMM_NC, N - jc ), 0, K, ki, Ap, Bp );
+  }//jc
+}
+
+/**
+ * 行列の掛け算 C = A * B
+ * - MyMat 版
+ * - MyGemm() で計算する。
+ * - C は A や B とメモリが重なっていないこと。
+ */
+template < class T >
+inline
+void
+MyMatMulInto( const MyMatViewT< T > &A, const MyMatViewT< T > &B, MyMatT< T > &C ){
+  assert( A.cols() == B.rows() );
+  if( C.empty() ) C.resize( A.rows(), B.cols() );
+  else assert( C.rows() == A.rows() && C.cols() == B.cols() );
+  assert( ! C.overlaps( A ) && ! C.overlaps( B ) );
+  MyGemm( 1, A, B, 0, C );
+}
+
+/**
+ * 行列の掛け算
+ * - MyMat 版
+ * - MyGemm() で計算する。
+ */
+template < class T >
+inline
+MyMatT< T >
+operator * ( const MyMatViewT< T > &A, const MyMatViewT< T > &B ){
+  assert( A.rows() > 0 && A.cols() > 0 );
+  assert( A.cols() == B.rows() && B.cols() > 0 );
+  MyMatT< T > C;
+  MyMatMulInto( A, B, C );
+  return C;
+}
+
+/**
+ * 行列のスカラー倍 C = k * A
+ * - MyMat 版
+ * - C は A と同じでもよい。
+ */
+template < class T >
+inline
+void
+MyMatScaleInto( double k, const MyMatViewT< T > &A, MyMatT< T > &C ){
+  if( C.empty() ) C.resize( A.rows(), A.cols() );
+  else assert( MyMatAreTheSameSize( A, C ) );
+  for( int i = 0; i < A.rows(); i++ ){
+    for( int j = 0; j < A.cols(); j++ ){
+      C( i, j ) = (T)k * A( i, j );
+    }
+  }
+}
+
+/**
+ * 行列のスカラー倍
+ * - MyMat 版
+ */
+template < class T >
+inline
+MyMatT< T >
+operator * ( double k, const MyMatViewT< T > &A ){
+  MyMatT< T > C;
+  MyMatScaleInto( k, A, C );
+  return C;
+}
+
+/**
+ * 行列のスカラー割
+ * - MyMat 版
+ */
+template < class T >
+inline
+MyMatT< T >
+operator / ( const MyMatViewT< T > &A, double k ){
+  assert( k != 0 );
+  MyMatT< T > C( A.rows(), A.cols() );
+  for( int i = 0; i < A.rows(); i++ ){
+    for( int j = 0; j < A.cols(); j++ ){
+      C( i, j ) = A( i, j ) / (T)k;
+    }
+  }
+  return C;
+}
+
+/**
+ * 行列とベクトルの掛け算 y = A * x（gemv）
+ * - MyMat 版
+ * - M x N * N x 1 => M x 1
+ * - y は x と同じベクトルでないこと。
+ * - 計算量が MySetParallelThreshold() のしきい値以上なら、行をブロックに分けて複数のスレッドで計算する。
+ *   行ごとの足し算の順番はシリアル版と同じなので、結果も同じになる。
+ * - 行数がスレッド数に比べて少ないときは（決定的モードを除いて）列方向に分けて部分和を足し合わせる。
+ * - 足し込みは Acc 型で行う（MyMatVecMulInto< double >( A, x, y ) で float の行列を double で足し込む）。
+ */
+template < class Acc, class T >
+inline
+void
+MyMatVecMulInto( const MyMatViewT< T > &A, const std::vector< T > &x, std::vector< T > &y ){
+  assert( A.rows() > 0 && A.cols() > 0 && A.cols() == (int)x.size() );
+  assert( &x != &y );
+  int M = A.rows(), N = A.cols(), cs = A.colStride();
+  if( y.empty() ) y.resize( M );
+  else assert( y.size() == M );
+  int nt = MyNumThreadsFor( 2.0 * M * N );
+  if( nt > 1 && M < 2 * nt && ! MyParallel().deterministic ){
+    // 横長の行列：列をスレッド数で分けて、部分和を順番に足す
+    MyWorkspaceScope scope;
+    Acc *part = scope.workspace().alloc< Acc >( (size_t)nt * M );
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt )
+#endif
+    for( int t = 0; t < nt; t++ ){
+      int j0 = (int)( (long long)t * N / nt ), j1 = (int)( (long long)( t + 1 ) * N / nt );
+      for( int i = 0; i < M; i++ ){
+        const T *a = A.ptr( i, 0 );
+        Acc sum = 0;
+        for( int j = j0; j < j1; j++ ) sum += (Acc)a[ (size_t)j * cs ] * x[ j ];
+        part[ (size_t)t * M + i ] = sum;
+      }
+    }//t
+    for( int i = 0; i < M; i++ ){
+      Acc sum = 0;
+      for( int t = 0; t < nt; t++ ) sum += part[ (size_t)t * M + i ];
+      y[ i ] = sum;
+    }
+    return;
+  }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+  for( int i = 0; i < M; i++ ){
+    const T *a = A.ptr( i, 0 );
+    Acc sum = 0;
+    for( int j = 0; j < N; j++ ){
+      sum += (Acc)a[ (size_t)j * cs ] * x[ j ];
+    }
+    y[ i ] = sum;
+  }//i
+}
+
+inline
+void
+MyMatVecMulInto( const MyMatView &A, const std::vector< double > &x, std::vector< double > &y ){
+  MyMatVecMulInto< double >( A, x, y );
+}
+
+inline
+void
+MyMatVecMulInto( const MyMatViewf &A, const std::vector< float > &x, std::vector< float > &y ){
+  MyMatVecMulInto< float >( A, x, y );
+}
+
+/**
+ * 行列とベクトルの掛け算
+ * - MyMat 版
+ * - M x N * N x 1 => M x 1
+ */
+template < class T >
+inline
+std::vector< T >
+operator * ( const MyMatViewT< T > &A, const std::vector< T > &x ){
+  std::vector< T > b;
+  MyMatVecMulInto( A, x, b );
+  return b;
+}
+
+/**
+ * 行列の転置 C = A^T
+ * - MyMat 版
+ * - C は A と同じ行列でもよい（正方行列の場合）。
+ */
+template < class T >
+inline
+void
+MyMatTransInto( const MyMatViewT< T > &A, MyMatT< T > &C ){
+  if( C.empty() ) C.resize( A.cols(), A.rows() );
+  else assert( C.rows() == A.cols() && C.cols() == A.rows() );
+  C = A.trans();
+}
+
+/**
+ * 行列の転置
+ * - MyMat 版
+ * - 転置した行列を新しく確保して返す。コピーが不要なら A.trans() でビューとして使うこと。
+ */
+template < class T >
+inline
+MyMatT< T >
+MyMatTrans( const MyMatViewT< T > &A ){
+  return MyMatT< T >( A.trans() );
+}
+
+/**
+ * 行列の表示
+ * - MyMat 版
+ */
+template < class T >
+inline
+std::ostream & operator << ( std::ostream &os, const MyMatViewT< T > &A ){
+  for( int i = 0; i < A.rows(); i++ ){
+    for( int j = 0; j < A.cols(); j++ ){
+      os << A( i, j ) << "\t";
+    }
+    os << std::endl;
+  }
+  return os;
+}
+
+/**
+ * 行列の等号
+ * - MyMat 版
+ */
+inline
+bool operator == ( const MyMatView &A, const MyMatView &B ){
+  if( ! MyMatAreTheSameSize( A, B ) ) return false;
+  for( int i = 0; i < A.rows(); i++ ){
+    for( int j = 0; j < A.cols(); j++ ){
+      if( A( i, j ) != B( i, j ) ) return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * 行列のノットイコール
+ * - MyMat 版
+ */
+inline
+bool operator != ( const MyMatView &A, const MyMatView &B ){
+  return !( A == B );
+}
+
+/**
+ * 行列から指定された位置の列ベクトルを取り出す
+ * - MyMat 版
+ */
+inline
+std::vector< double >
+MyGetColVector( const MyMatView &A, int col_index ){
+  assert( col_index >= 0 && col_index < A.cols() );
+  std::vector< double > col_vec( A.rows() );
+  for( int i = 0; i < A.rows(); i++ ) col_vec[ i ] = A( i, col_index );
+  return col_vec;
+}
+
+/**
+ * MyGetColVector() の別名
+ * - MyMat 版
+ */
+inline
+std::vector< double >
+MyMatColVec( const MyMatView &A, int col_index ){
+  return MyGetColVector( A, col_index );
+}
+
+/**
+ * 列ベクトルを行として並べた行列を返す。
+ * - MyMat 版。行列の転置と同じ
+ */
+inline
+MyMat
+MyGetColVectors( const MyMatView &A ){
+  return MyMat( A.trans() );
+}
+
+/**
+ * MyGetColVectors() の別名
+ * - MyMat 版
+ */
+inline
+MyMat
+MyMatColVecs( const MyMatView &A ){
+  return MyMat( A.trans() );
+}
+
+/**
+ * 行列の対角成分を返す。
+ * - MyMat 版
+ */
+inline
+std::vector< double >
+MyGetDiagVector( const MyMatView &A ){
+  int n = MyMin( A.rows(), A.cols() );
+  std::vector< double > diag_vec( n );
+  for( int i = 0; i < n; i++ ) diag_vec[ i ] = A( i, i );
+  return diag_vec;
+}
+
+/**
+ * MyGetDiagVector() の別名
+ * - MyMat 版
+ */
+inline
+std::vector< double >
+MyMatDiagVec( const MyMatView &A ){
+  return MyGetDiagVector( A );
+}
+
+/**
+ * 行列が対称行列かどうかのチェック
+ * - MyMat 版
+ */
+inline
+bool
+MyMatIsSymmetric( const MyMatView &A ){
+  if( ! MyMatIsSquare( A ) ) return false;
+  for( int i = 0; i < A.rows(); i++ ){
+    for( int j = i + 1; j < A.cols(); j++ ){
+      if( A( i, j ) != A( j, i ) ) return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * 行列の足し算 C = A + B
+ * - C が空ならリサイズする。空でなければサイズが合っていること。
+ * - C は A や B と同じでもよい。
+ */
+inline
+void
+MyMatAddInto( const std::vector< std::vector< double > > &A,
+              const std::vector< std::vector< double > > &B,
+              std::vector< std::vector< double > > &C ){
+  assert( A.size() > 0 && A[ 0 ].size() > 0 );
+  assert( A.size() == B.size() );
+  if( C.empty() ) C.resize( A.size(), std::vector< double >( A[ 0 ].size() ) );
+  else assert( C.size() == A.size() );
+  for( int i = 0; i < A.size(); i++ ){
+    assert( A[ i ].size() == B[ i ].size() && C[ i ].size() == A[ i ].size() );
+    for( int j = 0; j < A[ i ].size(); j++ ){
+      C[ i ][ j ] = A[ i ][ j ] + B[ i ][ j ];
+    }
+  }
+}
+
+/**
+ * 行列の足し算
+ */
+
+inline
+std::vector< std::vector< double > >
+operator + ( const std::vector< std::vector< double > > &A,
+             const std::vector< std::vector< double > > &B ){
+  std::vector< std::vector< double > > C;
+  MyMatAddInto( A, B, C );
+  return C;
+}
+
+/**
+ * 行列の引き算 C = A - B
+ * - C が空ならリサイズする。空でなければサイズが合っていること。
+ * - C は A や B と同じでもよい。
+ */
+inline
+void
+MyMatSubInto( const std::vector< std::vector< double > > &A,
+              const std::vector< std::vector< double > > &B,
+              std::vector< std::vector< double > > &C ){
+  assert( A.size() > 0 && A[ 0 ].size() > 0 );
+  assert( A.size() == B.size() );
+  if( C.empty() ) C.resize( A.size(), std::vector< double >( A[ 0 ].size() ) );
+  else assert( C.size() == A.size() );
+  for( int i = 0; i < A.size(); i++ ){
+    assert( A[ i ].size() == B[ i ].size() && C[ i ].size() == A[ i ].size() );
+    for( int j = 0; j < A[ i ].size(); j++ ){
+      C[ i ][ j ] = A[ i ][ j ] - B[ i ][ j ];
+    }
+  }
+}
+
+/**
+ * 行列の引き算
+ */
+
+inline
+std::vector< std::vector< double > >
+operator - ( const std::vector< std::vector< double > > &A,
+             const std::vector< std::vector< double > > &B ){
+  std::vector< std::vector< double > > C;
+  MyMatSubInto( A, B, C );
+  return C;
+}
+
+/**
+ * 行列の掛け算 C = A * B
+ * - C が空ならリサイズする。空でなければサイズが合っていること。
+ * - 作業領域の MyMat にコピーして MyGemm() で計算する。
+ */
+inline
+void
+MyMatMulInto( const std::vector< std::vector< double > > &A,
+              const std::vector< std::vector< double > > &B,
+              std::vector< std::vector< double > > &C ){
+  assert( A.size() > 0 && A[ 0 ].size() > 0 );
+  assert( A[ 0 ].size() == B.size() && B[ 0 ].size() > 0 );
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  MyMat &A2 = ws.mat( A.size(), A[ 0 ].size() );
+  MyMat &B2 = ws.mat( B.size(), B[ 0 ].size() );
+  MyMat &C2 = ws.mat( A.size(), B[ 0 ].size() );
+  A2.set( A );
+  B2.set( B );
+  MyGemm( 1, A2, B2, 0, C2 );
+  if( ! C.empty() ) assert( MyMatSize( C ) == MyMatSize( C2 ) );
+  C2.get( C );
+}
+
+/**
+ * 行列の掛け算
+ * - 内部では MyMat に変換して計算する。
+ */
+inline
+std::vector< std::vector< double > >
+operator * ( const std::vector< std::vector< double > > &A,
+             const std::vector< std::vector< double > > &B ){
+  std::vector< std::vector< double > > C;
+  MyMatMulInto( A, B, C );
+  return C;
+}
+
+/**
+ * 行列のスカラー倍 C = k * A
+ * - C が空ならリサイズする。空でなければサイズが合っていること。
+ * - C は A と同じでもよい。
+ */
+inline
+void
+MyMatScaleInto( double k,
+                const std::vector< std::vector< double > > &A,
+                std::vector< std::vector< double > > &C ){
+  assert( A.size() > 0 && A[ 0 ].size() > 0 );
+  if( C.empty() ) C.resize( A.size(), std::vector< double >( A[ 0 ].size() ) );
+  else assert( C.size() == A.size() );
+  for( int i = 0; i < A.size(); i++ ){
+    assert( C[ i ].size() == A[ i ].size() );
+    for( int j = 0; j < A[ i ].size(); j++ ){
+      C[ i ][ j ] = k * A[ i ][ j ];
+    }
+  }
+}
+
+/**
+ * 行列のスカラー倍
+ */
+
+inline
+std::vector< std::vector< double > >
+operator * ( double k,
+             const std::vector< std::vector< double > > &A ){
+  std::vector< std::vector< double > > C;
+  MyMatScaleInto( k, A, C );
+  return C;
+}
+
+/**
+ * 行列のスカラー割
+ */
+
+inline
+std::vector< std::vector< double > >
+operator / ( const std::vector< std::vector< double > > &A,
+             double k ){
+  assert( A.size() > 0 && A[ 0 ].size() > 0 && k != 0 );
+  std::vector< std::vector< double > > C( A.size(), std::vector< double >( A[ 0 ].size() ) );
+  for( int i = 0; i < A.size(); i++ ){
+    for( int j = 0; j < A[ i ].size(); j++ ){
+      C[ i ][ j ] = A[ i ][ j ] / k;
+    }
+  }
+  return C;
+}
+
+/**
+ * 行列の転置 C = A^T
+ * - C が空ならリサイズする。空でなければサイズが合っていること。
+ * - C は A と別の行列であること。
+ */
+inline
+void
+MyMatTransInto( const std::vector< std::vector< double > > &A,
+                std::vector< std::vector< double > > &C ){
+  assert( A.size() > 0 && A[ 0 ].size() > 0 );
+  assert( &A != &C );
+  if( C.empty() ) C.resize( A[ 0 ].size(), std::vector< double >( A.size() ) );
+  else assert( C.size() == A[ 0 ].size() );
+  for( int i = 0; i < C.size(); i++ ){
+    assert( C[ i ].size() == A.size() );
+    for( int j = 0; j < C[ i ].size(); j++ ){
+      C[ i ][ j ] = A[ j ][ i ];
+    }
+  }
+}
+
+/** 
+ * 行列の転置
+ */
+
+inline
+std::vector< std::vector< double > >
+MyMatTrans( const std::vector< std::vector< double > > &A ){
+  std::vector< std::vector< double > > C;
+  MyMatTransInto( A, C );
+  return C;
+}
+
+/**
+ * 行列の表示
+ */
+
+inline
+std::ostream & operator << ( std::ostream &os,
+                             const std::vector< std::vector< double > > &A)
+{
+  for( int i = 0; i < A.size(); i++ ){
+    for( int j = 0; j < A[ 0 ].size(); j++ ){
+      os << A[ i ][ j ] << "\t";
+    }
+    os << std::endl;
+  }
+  return os;
+}
+
+/**
+ * 行列の等号
+ */
+inline
+bool operator == ( const std::vector< std::vector< double > > &A,
+                   const std::vector< std::vector< double > > &B ){
+  if( A.size() != B.size() ) return false;
+  for( int i = 0; i < A.size(); i++ ){
+    if( A[ i ].size() != B[ i ].size() ) return false;
+    for( int j = 0; j < A[ i ].size(); j++ ){
+      if( A[ i ][ j ] != B[ i ][ j ] ) return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * 行列のノットイコール
+ */
+inline
+bool operator != ( const std::vector< std::vector< double > > &A,
+                   const std::vector< std::vector< double > > &B ){
+  return !( A == B );
+}
+
+/**
+ * ベクトルの等号
+ */
+inline
+bool operator == ( const std::vector< double > &A,
+                   const std::vector< double > &B ){
+  if( A.size() != B.size() ) return false;
+  for( int i = 0; i < A.size(); i++ ){
+    if( A[ i ] != B[ i ] ) return false;
+  }
+  return true;
+}
+
+/**
+ * ベクトルのノットイコール
+ */
+inline
+bool operator != ( const std::vector< double > &A,
+                   const std::vector< double > &B ){
+  return !( A == B );
+}
+
+/**
+ * 行列とベクトルの掛け算 y = A * x（gemv）
+ * - M x N * N x 1 => M x 1
+ * - y が空ならリサイズする。空でなければサイズが合っていること。
+ * - y は x と同じベクトルでないこと。
+ * - 計算量が MySetParallelThreshold() のしきい値以上なら、行ごとに複数のスレッドで計算する。
+ */
+inline
+void
+MyMatVecMulInto( const std::vector< std::vector< double > > &A,
+                 const std::vector< double > &x,
+                 std::vector< double > &y ){
+  assert( A.size() > 0 && A[ 0 ].size() > 0 && A[ 0 ].size() == x.size() );
+  assert( &x != &y );
+  if( y.empty() ) y.resize( A.size() );
+  else assert( y.size() == A.size() );
+#ifdef _OPENMP
+  int nt = MyNumThreadsFor( 2.0 * A.size() * x.size() );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+  for( int i = 0; i < (int)A.size(); i++ ){
+    y[ i ] = 0;
+    for( int j = 0; j < A[ i ].size(); j++ ){
+      y[ i ] += A[ i ][ j ] * x[ j ];
+    }
+  }
+}
+
+/**
+ * 行列とベクトルの掛け算
+ * - ベクトルになる
+ * - M x N * N x 1 => M x 1
+ */
+inline
+std::vector< double >
+operator * ( const std::vector< std::vector< double > > &A,
+             const std::vector< double > &x
+             ){
+  std::vector< double > b;
+  MyMatVecMulInto( A, x, b );
+  return b;
+}
+
+/**
+ * ベクトルの転置
+ * - 横１列の行列になる
+ * - N x 1 ベクトル => 1 x N 行列
+ */
+inline
+std::vector< std::vector< double > >
+MyVecTrans( const std::vector< double > &x ){
+  assert( x.size() > 0 );
+  std::vector< std::vector< double > > A( 1, std::vector< double >( x.size() ) );
+  for( int i = 0; i < x.size(); i++ ){
+    A[ 0 ][ i ] = x[ i ];
+  }
+  return A;
+}
+
+/**
+ * ベクトルの行列化
+ * - 縦１列の行列になる
+ */
+inline
+std::vector< std::vector< double > >
+MyVec2Mat( const std::vector< double > &x ){
+  using namespace std;
+  assert( x.size() > 0 );
+  std::vector< std::vector< double > > A( x.size(), vector< double >( 1 ) );
+  for( int i = 0; i < x.size(); i++ ){
+    A[ i ][ 0 ] = x[ i ];
+  }
+  return A;
+}
+
+/**
+ * ゼロベクトルを返す
+ */
+inline
+std::vector< double >
+MyVecZero( int n ){
+  return std::vector< double >( n, 0 );
+}
+
+/**
+ * ゼロ行列を返す
+ */
+inline
+std::vector< std::vector< double > >
+MyMatZero( int n ){
+  return std::vector< std::vector< double > >( n, std::vector< double >( n, 0 ) );
+}
+
+/**
+ * 単位行列を返す
+ */
+inline
+std::vector< std::vector< double > >
+MyMatIdentity( int n ){
+  std::vector< std::vector< double > > A( n, std::vector< double >( n, 0 ) );
+  for( int i = 0; i < n; i++ ) A[ i ][ i ] = 1;
+  return A;
+}
+
+/**
+ * 行列から指定された位置の列ベクトルを取り出す
+ */
+inline
+std::vector< double >
+MyGetColVector( const std::vector< std::vector< double > > &A,
+                int col_index ){
+  assert( A.size() > 0 );
+  assert( MyMatIsRect( A ) );
+  assert( col_index >= 0 && col_index < A[ 0 ].size() );
+  std::vector< double > col_vec( A.size() );
+  for( int i = 0; i < A.size(); i++ ){
+    col_vec[ i ] = A[ i ][ col_index ];
+  }
+  return col_vec;
+}
+
+/**
+ * MyGetColVector() の別名
+ */
+inline
+std::vector< double >
+MyMatColVec( const std::vector< std::vector< double > > &A,
+             int col_index ){
+  return MyGetColVector( A, col_index );
+}
+
+/**
+ * 列ベクトルの配列を返す。
+ *
+ * 行列の転置と同じ
+ */
+inline
+std::vector< std::vector< double > >
+MyGetColVectors( const std::vector< std::vector< double > > &A ){
+  return MyMatTrans( A );
+}
+
+/**
+ * MyGetColVectors() の別名
+ */
+inline
+std::vector< std::vector< double > >
+MyMatColVecs( const std::vector< std::vector< double > > &A ){
+  return MyMatTrans( A );
+}
+
+/**
+ * 行列の対角成分を返す。
+ */
+inline
+std::vector< double >
+MyGetDiagVector( const std::vector< std::vector< double > > &A ){
+  assert( MyMatIsRect( A ) );
+  int n = A.size();
+  std::vector< double > diag_vec( n );
+  for( int i = 0; i < n; i++ ){
+    diag_vec[ i ] = A[ i ][ i ];
+  }
+  return diag_vec;
+}
+
+/**
+ * MyGetDiagVector() の別名
+ */
+inline
+std::vector< double >
+MyMatDiagVec( const std::vector< std::vector< double > > &A ){
+  return MyGetDiagVector( A );
+}
+
+/**
+ * 行列が対称行列かどうかのチェック
+ * - 転置行列は作らずに (i,j) と (j,i) を直接比べ、最初の不一致で抜ける。
+ */
+inline
+bool
+MyMatIsSymmetric( const std::vector< std::vector< double > > &A ){
+  if( ! MyMatIsSquare( A ) ) return false;
+  for( int i = 0; i < (int)A.size(); i++ ){
+    for( int j = i + 1; j < (int)A.size(); j++ ){
+      if( A[ i ][ j ] != A[ j ][ i ] ) return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * 与えられたベクトルの要素を対角要素とする行列を返す
+ */
+inline
+std::vector< std::vector< double > >
+MyMatDiag( const std::vector< double > &V ){
+  assert( V.size() > 0 );
+  std::vector< std::vector< double > > A( V.size(), std::vector< double >( V.size(), 0 ) );
+  for( int i = 0; i < V.size(); i++ ){
+    A[ i ][ i ] = V[ i ];
+  }
+  return A;
+}
+
+//#########################################################################################
+// 数学
+//#########################################################################################
+
+/**
+ * １変数関数の数値微分を計算
+ * - double fx( double x ) な関数
+ * - 中心差分
+ * @param fx 関数へのポインタ
+ * @param x この値での微分値を計算
+ * @param[out] out 出力値
+ * @param h 微分計算時に用いる微小変化量。デフォルトは、1E-6
+ */
+inline
+int MyCalcGrad( double (*fx)( double ), double x, double *out, double h = 1E-06 ){
+
+  // h が 0 だとゼロ割になってしまうのでダメ
+  assert( h != 0 );
+
+  // 両隣の関数値の変化から微分値を計算（中心差分方式）   
+  *out = ( fx( x + h ) - fx( x - h ) ) / ( 2 * h );
+
+  return 0;
+}
+
+/**
+ * １変数関数の数値微分を計算
+ * - 値を返す版
+ */
+inline
+double MyCalcGrad( double (*fx)( double ), double x, double h = 1E-06 ){
+  double out;
+  MyCalcGrad( fx, x, &out, h );
+  return out;
+}
+
+/**
+ * 多変数関数の勾配（ナブラ）を返す
+ * - vector< double > fx( const vector< double > &x ) な関数
+ * - 数値微分（中心差分）
+ * @param fx 多変数関数へのポインタ
+ * @param x この位置での勾配を計算
+ * @param [out] 出力値
+ * @param h 数値微分に用いる微小変化値。デフォルトは、1E-6
+ */
+inline
+int
+MyVecGrad( double (*fx)( const std::vector< double > & ),
+           const std::vector< double > &x,
+           std::vector< double > &out,
+           double h = 1E-06
+           ){
+  using namespace std;
+
+  // h が 0 だとゼロ割になってしまうのでダメ
+  assert( h != 0 );
+
+  // ベクトルの次元数
+  int n = x.size();
+
+  // もし出力ベクトルがからだったらリサイズ
+  if( out.empty() ) out.resize( n );
+
+  // そうでなければ、ベクトルのサイズはあらかじめ確保されているものとする
+  else assert( out.size() == n );
+
+  // 評価位置のベクトル（作業領域から借りて、成分を１つずつずらしては戻して使う）
+  MyWorkspaceScope scope;
+  vector< double > &xh = scope.workspace().vec( n );
+  std::copy( x.begin(), x.end(), xh.begin() );
+
+  // 各成分ごとに
+  for( int i = 0; i < n; i++ ){
+
+    // その成分だけを少し動かして、両隣の関数値の変化から微分値を計算（中心差分方式）
+    xh[ i ] = x[ i ] + h;
+    double f1 = fx( xh );
+    xh[ i ] = x[ i ] - h;
+    double f2 = fx( xh );
+    xh[ i ] = x[ i ];
+    out[ i ] = ( f1 - f2 ) / ( 2 * h );
+  }
+  
+  return 0;
+}
+
+/**
+ * 勾配ベクトルを返り値として返すパターン
+ */
+inline std::vector< double >
+MyVecGrad( double (*fx)( const std::vector< double > & ),
+           const std::vector< double > &x, double h = 1E-06 ){
+  std::vector< double > out;
+  MyVecGrad( fx, x, out, h );
+  return out;
+}
+
+/**
+ * 数値微分（微小差分）でヘッセを計算する
+ * - d2f/dxdy = ( f(x+h,y+h) - f(x-h,y+h) - f(x+h,y-h) + f(x-h,y-h) ) / (4*h*h)
+ * @param h 差分計算時の微小変化量。二乗されることに注意。小さくしすぎると値がおかしくなる。
+ */
+inline
+int
+MyMatHessian( double (*fx)( const std::vector< double > & ),
+              const std::vector< double > &x,
+              std::vector< std::vector< double > > &out,
+              double h = 1E-3 ){
+  using namespace std;
+
+  // 入力チェック
+  assert( h != 0 );
+  
+  // 次元
+  int N = x.size();
+
+  // 出力バッファ
+  if( out.empty() ) out.resize( N, vector< double >( N ) );
+  else assert( MyMatSize( out ) == MyPoint2i( N, N ) );
+  
+  // 評価位置のベクトル（作業領域から借りて、i, j 成分だけ毎回 x から作り直す）
+  MyWorkspaceScope scope;
+  vector< double > &xh = scope.workspace().vec( N );
+  std::copy( x.begin(), x.end(), xh.begin() );
+
+  for( int i = 0; i < N; i++ ){
+    for( int j = i; j < N; j++ ){
+      xh[ i ] = x[ i ]; xh[ j ] = x[ j ];
+      xh[ i ] += h; xh[ j ] += h;
+      double f1 = fx( xh );
+      xh[ i ] = x[ i ]; xh[ j ] = x[ j ];
+      xh[ i ] -= h; xh[ j ] += h;
+      double f2 = fx( xh );
+      xh[ i ] = x[ i ]; xh[ j ] = x[ j ];
+      xh[ i ] += h; xh[ j ] -= h;
+      double f3 = fx( xh );
+      xh[ i ] = x[ i ]; xh[ j ] = x[ j ];
+      xh[ i ] -= h; xh[ j ] -= h;
+      double f4 = fx( xh );
+      xh[ i ] = x[ i ]; xh[ j ] = x[ j ];
+      out[ i ][ j ] = ( f1 - f2 - f3 + f4 ) / ( 4 * h * h );
+      out[ j ][ i ] = out[ i ][ j ];
+    }//j
+  }//i
+  
+  return 0;
+}
+
+/**
+ * 数値微分（微小差分）でヘッセを計算する
+ * - MyMat 版
+ * - 評価位置のベクトルは１本だけ用意して、ずらしては戻して使う。
+ */
+inline
+int
+MyMatHessian( double (*fx)( const std::vector< double > & ),
+              const std::vector< double > &x,
+              MyMat &out,
+              double h = 1E-3 ){
+  using namespace std;
+
+  // 入力チェック
+  assert( h != 0 );
+
+  // 次元
+  int N = x.size();
+
+  // 出力バッファ
+  if( out.empty() ) out.resize( N, N );
+  else assert( MyMatSize( out ) == MyPoint2i( N, N ) );
+
+  MyWorkspaceScope scope;
+  vector< double > &xh = scope.workspace().vec( N );
+  std::copy( x.begin(), x.end(), xh.begin() );
+  for( int i = 0; i < N; i++ ){
+    for( int j = i; j < N; j++ ){
+      xh[ i ] += h; xh[ j ] += h;
+      double f1 = fx( xh );
+      xh[ i ] -= 2 * h;
+      double f2 = fx( xh );
+      xh[ j ] -= 2 * h;
+      double f4 = fx( xh );
+      xh[ i ] += 2 * h;
+      double f3 = fx( xh );
+      xh[ i ] = x[ i ];
+      xh[ j ] = x[ j ];
+      out( i, j ) = ( f1 - f2 - f3 + f4 ) / ( 4 * h * h );
+      out( j, i ) = out( i, j );
+    }//j
+  }//i
+
+  return 0;
+}
+
+/**
+ * ３x３の逆行列の計算部分
+ * - vector< vector< double > > と MyMat のどちらでも使えるように、[ i ][ j ] でアクセスするテンプレートにしてある。
+ * - dst はサイズ確保済みであること。
+ */
+template < class M1, class M2 >
+inline
+double
+MyMatInv3x3Core( const M1 &src, M2 &dst )
+{
+  double detA =
+      src[0][0] * src[1][1] * src[2][2] +
+      src[1][0] * src[2][1] * src[0][2] +
+      src[2][0] * src[0][1] * src[1][2] -
+      src[0][0] * src[2][1] * src[1][2] -
+      src[2][0] * src[1][1] * src[0][2] -
+      src[1][0] * src[0][1] * src[2][2];
+
+  assert( detA != 0 );
+
+  dst[0][0] = src[1][1] * src[2][2] - src[1][2] * src[2][1];
+  dst[0][1] = src[0][2] * src[2][1] - src[0][1] * src[2][2];
+  dst[0][2] = src[0][1] * src[1][2] - src[0][2] * src[1][1];
+  dst[1][0] = src[1][2] * src[2][0] - src[1][0] * src[2][2];
+  dst[1][1] = src[0][0] * src[2][2] - src[0][2] * src[2][0];
+  dst[1][2] = src[0][2] * src[1][0] - src[0][0] * src[1][2];
+  dst[2][0] = src[1][0] * src[2][1] - src[1][1] * src[2][0];
+  dst[2][1] = src[0][1] * src[2][0] - src[0][0] * src[2][1];
+  dst[2][2] = src[0][0] * src[1][1] - src[0][1] * src[1][0];
+
+  for( int i = 0; i < 3; i++ ){
+    for( int j = 0; j < 3; j++ ){
+      dst[ i ][ j ] /= detA;
+    }
+  }
+
+  return detA;
+}
+
+/**
+ * ３x３の逆行列
+ * - 解析解
+ * @param [in] src 計算対象の行列。
+ * @param [out] dst メモリが確保済みでなければ内部で確保。src と同じサイズの確保済みを渡しても OK 。
+ * @return 行列式の値を返す。行列式がゼロの場合はエラー。
+ */
+inline
+double
+MyMatInv3x3( const std::vector< std::vector< double > > &src,
+             std::vector< std::vector< double > > &dst )
+{
+  // assert( src.size() == 3 );
+  // assert( src[ 0 ].size() == 3 );
+  assert( MyMatSize( src ) == MyPoint2i( 3, 3 ) );
+
+  if( dst.empty() ) dst.resize( 3, std::vector< double >( 3 ) );
+  else{
+    assert( dst.size() == 3 );
+    assert( dst[ 0 ].size() == 3 );
+  }
+
+  return MyMatInv3x3Core( src, dst );
+}
+
+/**
+ * ３x３の逆行列
+ * - MyMat 版
+ */
+inline
+double
+MyMatInv3x3( const MyMatView &src,
+             MyMat &dst )
+{
+  assert( MyMatSize( src ) == MyPoint2i( 3, 3 ) );
+  if( dst.empty() ) dst.resize( 3, 3 );
+  else assert( MyMatSize( dst ) == MyPoint2i( 3, 3 ) );
+  // ストライドによらず [ i ][ j ] でアクセスできるように、スタック上の配列にコピーしてから計算
+  double s[ 3 ][ 3 ];
+  for( int i = 0; i < 3; i++ ){
+    for( int j = 0; j < 3; j++ ) s[ i ][ j ] = src( i, j );
+  }
+  return MyMatInv3x3Core( s, dst );
+}
+
+/**
+ * ４x４の逆行列の計算部分
+ * - vector< vector< double > > と MyMat のどちらでも使えるように、[ i ][ j ] でアクセスするテンプレートにしてある。
+ * - dst はサイズ確保済みであること。
+ */
+template < class M1, class M2 >
+inline
+double
+MyMatInv4x4Core( const M1 &src, M2 &dst )
+{
+  double detA =
+      src[0][0]*src[1][1]*src[2][2]*src[3][3] + src[0][0]*src[1][2]*src[2][3]*src[3][1] + src[0][0]*src[1][3]*src[2][1]*src[3][2] +
+      src[0][1]*src[1][0]*src[2][3]*src[3][2] + src[0][1]*src[1][2]*src[2][0]*src[3][3] + src[0][1]*src[1][3]*src[2][2]*src[3][0] +
+      src[0][2]*src[1][0]*src[2][1]*src[3][3] + src[0][2]*src[1][1]*src[2][3]*src[3][0] + src[0][2]*src[1][3]*src[2][0]*src[3][1] +
+      src[0][3]*src[1][0]*src[2][2]*src[3][1] + src[0][3]*src[1][1]*src[2][0]*src[3][2] + src[0][3]*src[1][2]*src[2][1]*src[3][0] -
+      src[0][0]*src[1][1]*src[2][3]*src[3][2] - src[0][0]*src[1][2]*src[2][1]*src[3][3] - src[0][0]*src[1][3]*src[2][2]*src[3][1] -
+      src[0][1]*src[1][0]*src[2][2]*src[3][3] - src[0][1]*src[1][2]*src[2][3]*src[3][0] - src[0][1]*src[1][3]*src[2][0]*src[3][2] -
+      src[0][2]*src[1][0]*src[2][3]*src[3][1] - src[0][2]*src[1][1]*src[2][0]*src[3][3] - src[0][2]*src[1][3]*src[2][1]*src[3][0] -
+      src[0][3]*src[1][0]*src[2][1]*src[3][2] - src[0][3]*src[1][1]*src[2][2]*src[3][0] - src[0][3]*src[1][2]*src[2][0]*src[3][1];
+
+  assert( detA != 0 );
+
+  dst[0][0] = src[1][1]*src[2][2]*src[3][3]+src[1][2]*src[2][3]*src[3][1]+src[1][3]*src[2][1]*src[3][2]-src[1][1]*src[2][3]*src[3][2]-src[1][2]*src[2][1]*src[3][3]-src[1][3]*src[2][2]*src[3][1];
+  dst[0][1] = src[0][1]*src[2][3]*src[3][2]+src[0][2]*src[2][1]*src[3][3]+src[0][3]*src[2][2]*src[3][1]-src[0][1]*src[2][2]*src[3][3]-src[0][2]*src[2][3]*src[3][1]-src[0][3]*src[2][1]*src[3][2];
+  dst[0][2] = src[0][1]*src[1][2]*src[3][3]+src[0][2]*src[1][3]*src[3][1]+src[0][3]*src[1][1]*src[3][2]-src[0][1]*src[1][3]*src[3][2]-src[0][2]*src[1][1]*src[3][3]-src[0][3]*src[1][2]*src[3][1];
+  dst[0][3] = src[0][1]*src[1][3]*src[2][2]+src[0][2]*src[1][1]*src[2][3]+src[0][3]*src[1][2]*src[2][1]-src[0][1]*src[1][2]*src[2][3]-src[0][2]*src[1][3]*src[2][1]-src[0][3]*src[1][1]*src[2][2];
+  dst[1][0] = src[1][0]*src[2][3]*src[3][2]+src[1][2]*src[2][0]*src[3][3]+src[1][3]*src[2][2]*src[3][0]-src[1][0]*src[2][2]*src[3][3]-src[1][2]*src[2][3]*src[3][0]-src[1][3]*src[2][0]*src[3][2];
+  dst[1][1] = src[0][0]*src[2][2]*src[3][3]+src[0][2]*src[2][3]*src[3][0]+src[0][3]*src[2][0]*src[3][2]-src[0][0]*src[2][3]*src[3][2]-src[0][2]*src[2][0]*src[3][3]-src[0][3]*src[2][2]*src[3][0];
+  dst[1][2] = src[0][0]*src[1][3]*src[3][2]+src[0][2]*src[1][0]*src[3][3]+src[0][3]*src[1][2]*src[3][0]-src[0][0]*src[1][2]*src[3][3]-src[0][2]*src[1][3]*src[3][0]-src[0][3]*src[1][0]*src[3][2];
+  dst[1][3] = src[0][0]*src[1][2]*src[2][3]+src[0][2]*src[1][3]*src[2][0]+src[0][3]*src[1][0]*src[2][2]-src[0][0]*src[1][3]*src[2][2]-src[0][2]*src[1][0]*src[2][3]-src[0][3]*src[1][2]*src[2][0];
+  dst[2][0] = src[1][0]*src[2][1]*src[3][3]+src[1][1]*src[2][3]*src[3][0]+src[1][3]*src[2][0]*src[3][1]-src[1][0]*src[2][3]*src[3][1]-src[1][1]*src[2][0]*src[3][3]-src[1][3]*src[2][1]*src[3][0];
+  dst[2][1] = src[0][0]*src[2][3]*src[3][1]+src[0][1]*src[2][0]*src[3][3]+src[0][3]*src[2][1]*src[3][0]-src[0][0]*src[2][1]*src[3][3]-src[0][1]*src[2][3]*src[3][0]-src[0][3]*src[2][0]*src[3][1];
+  dst[2][2] = src[0][0]*src[1][1]*src[3][3]+src[0][1]*src[1][3]*src[3][0]+src[0][3]*src[1][0]*src[3][1]-src[0][0]*src[1][3]*src[3][1]-src[0][1]*src[1][0]*src[3][3]-src[0][3]*src[1][1]*src[3][0];
+  dst[2][3] = src[0][0]*src[1][3]*src[2][1]+src[0][1]*src[1][0]*src[2][3]+src[0][3]*src[1][1]*src[2][0]-src[0][0]*src[1][1]*src[2][3]-src[0][1]*src[1][3]*src[2][0]-src[0][3]*src[1][0]*src[2][1];
+  dst[3][0] = src[1][0]*src[2][2]*src[3][1]+src[1][1]*src[2][0]*src[3][2]+src[1][2]*src[2][1]*src[3][0]-src[1][0]*src[2][1]*src[3][2]-src[1][1]*src[2][2]*src[3][0]-src[1][2]*src[2][0]*src[3][1];
+  dst[3][1] = src[0][0]*src[2][1]*src[3][2]+src[0][1]*src[2][2]*src[3][0]+src[0][2]*src[2][0]*src[3][1]-src[0][0]*src[2][2]*src[3][1]-src[0][1]*src[2][0]*src[3][2]-src[0][2]*src[2][1]*src[3][0];
+  dst[3][2] = src[0][0]*src[1][2]*src[3][1]+src[0][1]*src[1][0]*src[3][2]+src[0][2]*src[1][1]*src[3][0]-src[0][0]*src[1][1]*src[3][2]-src[0][1]*src[1][2]*src[3][0]-src[0][2]*src[1][0]*src[3][1];
+  dst[3][3] = src[0][0]*src[1][1]*src[2][2]+src[0][1]*src[1][2]*src[2][0]+src[0][2]*src[1][0]*src[2][1]-src[0][0]*src[1][2]*src[2][1]-src[0][1]*src[1][0]*src[2][2]-src[0][2]*src[1][1]*src[2][0];
+  
+  for( int j = 0; j < 4; j++ ){
+    for( int i = 0; i < 4; i++ ){
+      dst[ i ][ j ] /= detA;
+    }//i
+  }//j
+
+  return detA;
+}
+
+/**
+ * ４x４の逆行列
+ * - 解析解
+ * @param [in] src 計算対象の行列。
+ * @param [out] dst メモリが確保済みでなければ内部で確保。src と同じサイズの確保済みを渡しても OK 。
+ * @return 行列式の値を返す。行列式がゼロの場合はエラー。
+ */
+inline
+double
+MyMatInv4x4( const std::vector< std::vector< double > > &src,
+             std::vector< std::vector< double > > &dst )
+{
+  // assert( src.size() == 4 );
+  // assert( src[ 0 ].size() == 4 );
+  assert( MyMatSize( src ) == MyPoint2i( 4, 4 ) );
+
+  if( dst.empty() ) dst.resize( 4, std::vector< double >( 4 ) );
+  else{
+    assert( dst.size() == 4 );
+    assert( dst[ 0 ].size() == 4 );
+  }
+
+  return MyMatInv4x4Core( src, dst );
+}
+
+/**
+ * ４x４の逆行列
+ * - MyMat 版
+ */
+inline
+double
+MyMatInv4x4( const MyMatView &src,
+             MyMat &dst )
+{
+  assert( MyMatSize( src ) == MyPoint2i( 4, 4 ) );
+  if( dst.empty() ) dst.resize( 4, 4 );
+  else assert( MyMatSize( dst ) == MyPoint2i( 4, 4 ) );
+  // ストライドによらず [ i ][ j ] でアクセスできるように、スタック上の配列にコピーしてから計算
+  double s[ 4 ][ 4 ];
+  for( int i = 0; i < 4; i++ ){
+    for( int j = 0; j < 4; j++ ) s[ i ][ j ] = src( i, j );
+  }
+  return MyMatInv4x4Core( s, dst );
+}
+
+/*
+ * --- 固定サイズの行列、ベクトル ---
+ * - 2x2 から 6x6 程度の小さな行列を、ヒープを使わずにスタック上の配列で持つ。
+ * - サイズはテンプレート引数（コンパイル時定数）なので、ループはコンパイラが展開できる。
+ * - フィッティングなど、小さな連立方程式を大量に解く処理で使う。
+ */
+
+// ループ展開の指示
+#if defined( __clang__ )
+#define MY_UNROLL _Pragma( "unroll" )
+#elif defined( __GNUC__ ) && __GNUC__ >= 8
+#define MY_UNROLL _Pragma( "GCC unroll 8" )
+#else
+#define MY_UNROLL
+#endif
+
+/**
+ * 固定サイズのベクトル
+ * - N: 次元数
+ */
+template < int N, typename T = double >
+struct MyVecN {
+  enum { Size = N }; //!< 次元数
+  T v[ N ];
+  MyVecN(){ MY_UNROLL for( int i = 0; i < N; i++ ) v[ i ] = 0; }
+  explicit MyVecN( T val ){ MY_UNROLL for( int i = 0; i < N; i++ ) v[ i ] = val; }
+  explicit MyVecN( const std::vector< T > &a ){
+    assert( a.size() == N );
+    for( int i = 0; i < N; i++ ) v[ i ] = a[ i ];
+  }
+  static int size(){ return N; }
+  T & operator [] ( int i ){ return v[ i ]; }
+  const T & operator [] ( int i ) const { return v[ i ]; }
+  /** vector に書き出す */
+  void get( std::vector< T > &a ) const { a.assign( v, v + N ); }
+};
+
+/**
+ * 固定サイズの行列
+ * - R: 行数、C: 列数
+ * - A[ i ][ j ] でも A( i, j ) でもアクセスできる。
+ */
+template < int R, int C, typename T = double >
+struct MyMatN {
+  enum { Rows = R, Cols = C }; //!< 行数、列数
+  T m[ R ][ C ];
+  MyMatN(){ fill( 0 ); }
+  explicit MyMatN( T val ){ fill( val ); }
+  explicit MyMatN( const std::vector< std::vector< T > > &A ){
+    assert( A.size() == R );
+    for( int i = 0; i < R; i++ ){
+      assert( A[ i ].size() == C );
+      for( int j = 0; j < C; j++ ) m[ i ][ j ] = A[ i ][ j ];
+    }
+  }
+  static int rows(){ return R; }
+  static int cols(){ return C; }
+  void fill( T val ){
+    MY_UNROLL for( int i = 0; i < R; i++ ){
+      MY_UNROLL for( int j = 0; j < C; j++ ) m[ i ][ j ] = val;
+    }
+  }
+  T * operator [] ( int i ){ return m[ i ]; }
+  const T * operator [] ( int i ) const { return m[ i ]; }
+  T & operator () ( int i, int j ){ return m[ i ][ j ]; }
+  T operator () ( int i, int j ) const { return m[ i ][ j ]; }
+  /** vector< vector > に書き出す */
+  void get( std::vector< std::vector< T > > &A ) const {
+    A.resize( R );
+    for( int i = 0; i < R; i++ ) A[ i ].assign( m[ i ], m[ i ] + C );
+  }
+  /** 単位行列 */
+  static MyMatN identity(){
+    MyMatN I;
+    MY_UNROLL for( int i = 0; i < ( R < C ? R : C ); i++ ) I.m[ i ][ i ] = 1;
+    return I;
+  }
+};
+
+typedef MyVecN< 2 > MyVec2d;
+typedef MyVecN< 3 > MyVec3d;
+typedef MyVecN< 4 > MyVec4d;
+typedef MyVecN< 5 > MyVec5d;
+typedef MyVecN< 6 > MyVec6d;
+typedef MyMatN< 2, 2 > MyMat2d;
+typedef MyMatN< 3, 3 > MyMat3d;
+typedef MyMatN< 4, 4 > MyMat4d;
+typedef MyMatN< 5, 5 > MyMat5d;
+typedef MyMatN< 6, 6 > MyMat6d;
+
+/**
+ * 固定サイズの行列の掛け算
+ * - R x K * K x C => R x C
+ */
+template < int R, int K, int C, typename T >
+inline
+MyMatN< R, C, T >
+operator * ( const MyMatN< R, K, T > &A, const MyMatN< K, C, T > &B ){
+  MyMatN< R, C, T > D;
+  MY_UNROLL for( int i = 0; i < R; i++ ){
+    MY_UNROLL for( int j = 0; j < C; j++ ){
+      T sum = 0;
+      MY_UNROLL for( int k = 0; k < K; k++ ) sum += A.m[ i ][ k ] * B.m[ k ][ j ];
+      D.m[ i ][ j ] = sum;
+    }//j
+  }//i
+  return D;
+}
+
+/**
+ * 固定サイズの行列とベクトルの掛け算
+ */
+template < int R, int C, typename T >
+inline
+MyVecN< R, T >
+operator * ( const MyMatN< R, C, T > &A, const MyVecN< C, T > &x ){
+  MyVecN< R, T > b;
+  MY_UNROLL for( int i = 0; i < R; i++ ){
+    T sum = 0;
+    MY_UNROLL for( int j = 0; j < C; j++ ) sum += A.m[ i ][ j ] * x.v[ j ];
+    b.v[ i ] = sum;
+  }//i
+  return b;
+}
+
+/**
+ * 固定サイズの行列の足し算
+ */
+template < int R, int C, typename T >
+inline
+MyMatN< R, C, T >
+operator + ( const MyMatN< R, C, T > &A, const MyMatN< R, C, T > &B ){
+  MyMatN< R, C, T > D;
+  MY_UNROLL for( int i = 0; i < R; i++ ){
+    MY_UNROLL for( int j = 0; j < C; j++ ) D.m[ i ][ j ] = A.m[ i ][ j ] + B.m[ i ][ j ];
+  }
+  return D;
+}
+
+/**
+ * 固定サイズの行列の引き算
+ */
+template < int R, int C, typename T >
+inline
+MyMatN< R, C, T >
+operator - ( const MyMatN< R, C, T > &A, const MyMatN< R, C, T > &B ){
+  MyMatN< R, C, T > D;
+  MY_UNROLL for( int i = 0; i < R; i++ ){
+    MY_UNROLL for( int j = 0; j < C; j++ ) D.m[ i ][ j ] = A.m[ i ][ j ] - B.m[ i ][ j ];
+  }
+  return D;
+}
+
+/**
+ * 固定サイズの行列のスカラー倍
+ */
+template < int R, int C, typename T >
+inline
+MyMatN< R, C, T >
+operator * ( T k, const MyMatN< R, C, T > &A ){
+  MyMatN< R, C, T > D;
+  MY_UNROLL for( int i = 0; i < R; i++ ){
+    MY_UNROLL for( int j = 0; j < C; j++ ) D.m[ i ][ j ] = k * A.m[ i ][ j ];
+  }
+  return D;
+}
+
+/**
+ * 固定サイズの行列の転置
+ */
+template < int R, int C, typename T >
+inline
+MyMatN< C, R, T >
+MyMatTrans( const MyMatN< R, C, T > &A ){
+  MyMatN< C, R, T > D;
+  MY_UNROLL for( int i = 0; i < R; i++ ){
+    MY_UNROLL for( int j = 0; j < C; j++ ) D.m[ j ][ i ] = A.m[ i ][ j ];
+  }
+  return D;
+}
+
+/**
+ * 固定サイズの行列の表示
+ */
+template < int R, int C, typename T >
+inline
+std::ostream & operator << ( std::ostream &os, const MyMatN< R, C, T > &A ){
+  for( int i = 0; i < R; i++ ){
+    for( int j = 0; j < C; j++ ) os << A.m[ i ][ j ] << "\t";
+    os << std::endl;
+  }
+  return os;
+}
+
+/**
+ * 固定サイズのベクトルの表示
+ */
+template < int N, typename T >
+inline
+std::ostream & operator << ( std::ostream &os, const MyVecN< N, T > &a ){
+  for( int i = 0; i < N; i++ ) os << a.v[ i ] << "\t";
+  return os;
+}
+
+/**
+ * 固定サイズのベクトルの内積
+ */
+template < int N, typename T >
+inline
+T
+MyVecDot( const MyVecN< N, T > &a, const MyVecN< N, T > &b ){
+  T sum = 0;
+  MY_UNROLL for( int i = 0; i < N; i++ ) sum += a.v[ i ] * b.v[ i ];
+  return sum;
+}
+
+/**
+ * 固定サイズの正方行列の LU 分解（部分ピボット選択つき）
+ * - A は L と U で上書きされる（L の対角成分 1 は持たない）。
+ * - perm には、分解後の i 行目が元の何行目だったかが入る。
+ * @return 置換の符号（+1 or -1）。特異なら 0 。
+ */
+template < int N, typename T >
+inline
+int
+MyLUDecompN( MyMatN< N, N, T > &A, int perm[ N ] ){
+  int sign = 1;
+  MY_UNROLL for( int i = 0; i < N; i++ ) perm[ i ] = i;
+  MY_UNROLL for( int k = 0; k < N; k++ ){
+    // ピボット選択
+    int p = k;
+    T amax = MyAbs( A.m[ k ][ k ] );
+    for( int i = k + 1; i < N; i++ ){
+      if( MyAbs( A.m[ i ][ k ] ) > amax ){
+        amax = MyAbs( A.m[ i ][ k ] );
+        p = i;
+      }
+    }
+    if( amax == 0 ) return 0;
+    if( p != k ){
+      MY_UNROLL for( int j = 0; j < N; j++ ) std::swap( A.m[ k ][ j ], A.m[ p ][ j ] );
+      std::swap( perm[ k ], perm[ p ] );
+      sign = -sign;
+    }
+    // 消去
+    T inv = 1 / A.m[ k ][ k ];
+    for( int i = k + 1; i < N; i++ ){
+      T l = A.m[ i ][ k ] * inv;
+      A.m[ i ][ k ] = l;
+      for( int j = k + 1; j < N; j++ ) A.m[ i ][ j ] -= l * A.m[ k ][ j ];
+    }//i
+  }//k
+  return sign;
+}
+
+/**
+ * 固定サイズの正方行列の行列式
+ * - 2x2, 3x3 は解析解、それより大きいものは LU 分解で計算する。
+ */
+template < int N, typename T >
+inline
+T
+MyMatDet( const MyMatN< N, N, T > &A ){
+  MyMatN< N, N, T > LU = A;
+  int perm[ N ];
+  int sign = MyLUDecompN( LU, perm );
+  if( sign == 0 ) return 0;
+  T det = sign;
+  MY_UNROLL for( int i = 0; i < N; i++ ) det *= LU.m[ i ][ i ];
+  return det;
+}
+
+template < typename T >
+inline
+T
+MyMatDet( const MyMatN< 2, 2, T > &A ){
+  return A.m[0][0] * A.m[1][1] - A.m[0][1] * A.m[1][0];
+}
+
+template < typename T >
+inline
+T
+MyMatDet( const MyMatN< 3, 3, T > &A ){
+  return
+      A.m[0][0] * A.m[1][1] * A.m[2][2] +
+      A.m[1][0] * A.m[2][1] * A.m[0][2] +
+      A.m[2][0] * A.m[0][1] * A.m[1][2] -
+      A.m[0][0] * A.m[2][1] * A.m[1][2] -
+      A.m[2][0] * A.m[1][1] * A.m[0][2] -
+      A.m[1][0] * A.m[0][1] * A.m[2][2];
+}
+
+/**
+ * 固定サイズの連立一次方程式 Ax = b を解く
+ * - 部分ピボット選択つきの LU 分解。A は値渡し（スタック上でコピー）なので壊れない。
+ * @return 0:成功、0以外:失敗（特異行列）
+ */
+template < int N, typename T >
+inline
+int
+MyAxbSolve_LU( MyMatN< N, N, T > A, MyVecN< N, T > &x, const MyVecN< N, T > &b ){
+  int perm[ N ];
+  if( MyLUDecompN( A, perm ) == 0 ) return -1;
+  // 前進代入 Ly = Pb
+  MY_UNROLL for( int i = 0; i < N; i++ ){
+    T sum = b.v[ perm[ i ] ];
+    for( int j = 0; j < i; j++ ) sum -= A.m[ i ][ j ] * x.v[ j ];
+    x.v[ i ] = sum;
+  }
+  // 後退代入 Ux = y
+  MY_UNROLL for( int i = N - 1; i >= 0; i-- ){
+    T sum = x.v[ i ];
+    for( int j = i + 1; j < N; j++ ) sum -= A.m[ i ][ j ] * x.v[ j ];
+    x.v[ i ] = sum / A.m[ i ][ i ];
+  }
+  return 0;
+}
+
+/**
+ * 固定サイズの対称正定値行列のコレスキー分解 A = L L^T
+ * - A の対角から下だけを参照し、そこに L を上書きする。
+ * @return 0:成功、0以外:失敗（正定値でない）
+ */
+template < int N, typename T >
+inline
+int
+MyCholDecompN( MyMatN< N, N, T > &A ){
+  MY_UNROLL for( int j = 0; j < N; j++ ){
+    T s = A.m[ j ][ j ];
+    for( int k = 0; k < j; k++ ) s -= A.m[ j ][ k ] * A.m[ j ][ k ];
+    if( ! ( s > 0 ) ) return -1;
+    T d = std::sqrt( s );
+    A.m[ j ][ j ] = d;
+    for( int i = j + 1; i < N; i++ ){
+      T t = A.m[ i ][ j ];
+      for( int k = 0; k < j; k++ ) t -= A.m[ i ][ k ] * A.m[ j ][ k ];
+      A.m[ i ][ j ] = t / d;
+    }//i
+  }//j
+  return 0;
+}
+
+/**
+ * 固定サイズの連立一次方程式 Ax = b を解く（対称正定値行列用）
+ * - コレスキー分解。計算量は LU 分解の半分で、枢軸選択もいらない。
+ * - 正規方程式などで使う。正定値でなければ失敗を返すので、その場合は MyAxbSolve_LU() で解き直すこと。
+ * - A は値渡し（スタック上でコピー）なので壊れない。
+ * @return 0:成功、0以外:失敗（正定値でない）
+ */
+template < int N, typename T >
+inline
+int
+MyAxbSolve_Chol( MyMatN< N, N, T > A, MyVecN< N, T > &x, const MyVecN< N, T > &b ){
+  if( MyCholDecompN( A ) ) return -1;
+  // 前進代入 Ly = b
+  MY_UNROLL for( int i = 0; i < N; i++ ){
+    T sum = b.v[ i ];
+    for( int j = 0; j < i; j++ ) sum -= A.m[ i ][ j ] * x.v[ j ];
+    x.v[ i ] = sum / A.m[ i ][ i ];
+  }
+  // 後退代入 L^T x = y
+  MY_UNROLL for( int i = N - 1; i >= 0; i-- ){
+    T sum = x.v[ i ];
+    for( int j = i + 1; j < N; j++ ) sum -= A.m[ j ][ i ] * x.v[ j ];
+    x.v[ i ] = sum / A.m[ i ][ i ];
+  }
+  return 0;
+}
+
+/**
+ * 固定サイズの正方行列の逆行列
+ * - 2x2 は解析解、3x3, 4x4 は MyMatInv3x3Core, MyMatInv4x4Core、それより大きいものは LU 分解で計算する。
+ * @return 行列式の値を返す。行列式がゼロの場合はエラー。
+ */
+template < int N, typename T >
+inline
+T
+MyMatInv( const MyMatN< N, N, T > &src, MyMatN< N, N, T > &dst ){
+  MyMatN< N, N, T > LU = src;
+  int perm[ N ];
+  int sign = MyLUDecompN( LU, perm );
+  assert( sign != 0 );
+  T det = sign;
+  MY_UNROLL for( int i = 0; i < N; i++ ) det *= LU.m[ i ][ i ];
+  // 単位行列の各列について解く
+  for( int c = 0; c < N; c++ ){
+    T y[ N ];
+    for( int i = 0; i < N; i++ ){
+      T sum = ( perm[ i ] == c ) ? 1 : 0;
+      for( int j = 0; j < i; j++ ) sum -= LU.m[ i ][ j ] * y[ j ];
+      y[ i ] = sum;
+    }
+    for( int i = N - 1; i >= 0; i-- ){
+      T sum = y[ i ];
+      for( int j = i + 1; j < N; j++ ) sum -= LU.m[ i ][ j ] * y[ j ];
+      y[ i ] = sum / LU.m[ i ][ i ];
+    }
+    for( int i = 0; i < N; i++ ) dst.m[ i ][ c ] = y[ i ];
+  }//c
+  return det;
+}
+
+template < typename T >
+inline
+T
+MyMatInv( const MyMatN< 2, 2, T > &src, MyMatN< 2, 2, T > &dst ){
+  T detA = MyMatDet( src );
+  assert( detA != 0 );
+  dst.m[0][0] =  src.m[1][1] / detA;
+  dst.m[0][1] = -src.m[0][1] / detA;
+  dst.m[1][0] = -src.m[1][0] / detA;
+  dst.m[1][1] =  src.m[0][0] / detA;
+  return detA;
+}
+
+template < typename T >
+inline
+T
+MyMatInv( const MyMatN< 3, 3, T > &src, MyMatN< 3, 3, T > &dst ){
+  return MyMatInv3x3Core( src, dst );
+}
+
+template < typename T >
+inline
+T
+MyMatInv( const MyMatN< 4, 4, T > &src, MyMatN< 4, 4, T > &dst ){
+  return MyMatInv4x4Core( src, dst );
+}
+
+/**
+ * ３x３の逆行列
+ * - 固定サイズ版（メモリ確保なし）
+ */
+inline
+double
+MyMatInv3x3( const MyMat3d &src,
+             MyMat3d &dst )
+{
+  return MyMatInv3x3Core( src, dst );
+}
+
+/**
+ * ４x４の逆行列
+ * - 固定サイズ版（メモリ確保なし）
+ */
+inline
+double
+MyMatInv4x4( const MyMat4d &src,
+             MyMat4d &dst )
+{
+  return MyMatInv4x4Core( src, dst );
+}
+
+/*
+ * --- 小さな行列のバッチ計算 ---
+ * - 3x3, 4x4 の行列を何千、何百万個とまとめて、逆行列、行列式、連立一次方程式の解を計算する。
+ * - 行列は配列の構造体（SoA）形式で持つ（MyMatBatchN）。要素 (i,j) ごとに n 個の行列の値が連続して並ぶので、
+ *   隣り合う行列を SIMD のレーンに載せて同時に計算できる（AVX-512 なら 8 個、AVX2 なら 4 個ずつ）。
+ * - 行列式がゼロ（の近く）の行列があっても止まらない。行列ごとのフラグ（singular）に記録して、結果はゼロにする。
+ * - 計算式は MyMatInv3x3(), MyMatInv4x4() と同じ余因子展開。ただし行列式の逆数を掛けるので、丸め誤差の分だけ結果が異なることがある。
+ * - 個数が多ければ（計算量が MySetParallelThreshold() のしきい値以上なら）、複数のスレッドで分担する。
+ */
+
+/**
+ * 固定サイズの小さな行列を n 個まとめて持つバッチ
+ * - 配列の構造体（SoA）形式。k 番目の行列の (i,j) 要素は plane( i, j )[ k ] 。
+ * - 中身は (R*C) x n の MyMat で、行 i*C+j が要素 (i,j) の面になっている。
+ * - R x 1 にすればベクトルのバッチ（MyVec3dBatch など）。
+ */
+template < int R, int C >
+class MyMatBatchN
+{
+  MyMat _d; //!< 要素ごとの面を行として並べた (R*C) x n の行列
+
+ public:
+  enum { Rows = R, Cols = C }; //!< 行数、列数
+
+  MyMatBatchN(){ }
+
+  /**
+   * n 個のゼロ行列
+   */
+  explicit MyMatBatchN( int n ) : _d( R * C, n, 0 ) { }
+
+  /**
+   * 個数の変更。個数が変わる場合、中身はゼロで初期化される。
+   */
+  void resize( int n ){ _d.resize( R * C, n ); }
+
+  // アクセサ
+  int size() const { return _d.cols(); }
+  double *plane( int i, int j ){ return _d[ i * C + j ]; }
+  const double *plane( int i, int j ) const { return _d[ i * C + j ]; }
+  double & operator () ( int k, int i, int j ){ return _d( i * C + j, k ); }
+  double operator () ( int k, int i, int j ) const { return _d( i * C + j, k ); }
+
+  /**
+   * k 番目の行列を取り出す
+   */
+  MyMatN< R, C > get( int k ) const {
+    MyMatN< R, C > A;
+    for( int i = 0; i < R; i++ ){
+      for( int j = 0; j < C; j++ ) A.m[ i ][ j ] = (*this)( k, i, j );
+    }
+    return A;
+  }
+
+  /**
+   * k 番目の行列をセットする
+   */
+  void set( int k, const MyMatN< R, C > &A ){
+    for( int i = 0; i < R; i++ ){
+      for( int j = 0; j < C; j++ ) (*this)( k, i, j ) = A.m[ i ][ j ];
+    }
+  }
+};
+
+typedef MyMatBatchN< 3, 3 > MyMat3dBatch;
+typedef MyMatBatchN< 4, 4 > MyMat4dBatch;
+typedef MyMatBatchN< 3, 1 > MyVec3dBatch;
+typedef MyMatBatchN< 4, 1 > MyVec4dBatch;
+
+/*
+ * バッチ計算のカーネル
+ * - NI 個の入力から NO 個の出力を計算する run() を持つ構造体。
+ * - run() は double でも SIMD のベクトル型（__m256d など、GCC/clang では四則演算がそのまま書ける）でも
+ *   同じ式で計算できるテンプレートにしてある。
+ * - FLOPS は１個あたりのおおよその浮動小数点演算の回数（並列化の判定用）。
+ */
+
+/**
+ * 特異かどうかの判定に使う行列の大きさ（行ごとの絶対値の最大の積。MyBatchMarkSingular() を参照）
+ * - D x D の行列（行優先）。
+ */
+template < int D, class V >
+MY_ALWAYS_INLINE
+void
+MyBatchRowScale( const V *a, V &scale ){
+  for( int i = 0; i < D; i++ ){
+    V m = a[ i * D ];
+    m = ( m > -m ) ? m : -m;
+    for( int j = 1; j < D; j++ ){
+      V x = a[ i * D + j ];
+      x = ( x > -x ) ? x : -x;
+      m = ( x > m ) ? x : m;
+    }//j
+    if( i == 0 ) scale = m;
+    else scale = scale * m;
+  }//i
+}
+
+/**
+ * ３x３の逆行列と行列式
+ * - 入力：A の９要素（行優先）、出力：逆行列の９要素（行優先）、行列式、行列の大きさ（MyBatchRowScale()）
+ */
+struct MyBatchKernelInv3x3 {
+  enum { NI = 9, NO = 11, FLOPS = 60 };
+  template < class V >
+  static MY_ALWAYS_INLINE void run( const V *a, V *r ){
+    V det =
+        a[0] * a[4] * a[8] +
+        a[3] * a[7] * a[2] +
+        a[6] * a[1] * a[5] -
+        a[0] * a[7] * a[5] -
+        a[6] * a[4] * a[2] -
+        a[3] * a[1] * a[8];
+    V s = 1.0 / det;
+    r[0] = ( a[4] * a[8] - a[5] * a[7] ) * s;
+    r[1] = ( a[2] * a[7] - a[1] * a[8] ) * s;
+    r[2] = ( a[1] * a[5] - a[2] * a[4] ) * s;
+    r[3] = ( a[5] * a[6] - a[3] * a[8] ) * s;
+    r[4] = ( a[0] * a[8] - a[2] * a[6] ) * s;
+    r[5] = ( a[2] * a[3] - a[0] * a[5] ) * s;
+    r[6] = ( a[3] * a[7] - a[4] * a[6] ) * s;
+    r[7] = ( a[1] * a[6] - a[0] * a[7] ) * s;
+    r[8] = ( a[0] * a[4] - a[1] * a[3] ) * s;
+    r[9] = det;
+    MyBatchRowScale< 3 >( a, r[10] );
+  }
+};
+
+/**
+ * ３x３の行列式
+ */
+struct MyBatchKernelDet3x3 {
+  enum { NI = 9, NO = 1, FLOPS = 17 };
+  template < class V >
+  static MY_ALWAYS_INLINE void run( const V *a, V *r ){
+    r[0] =
+        a[0] * a[4] * a[8] +
+        a[3] * a[7] * a[2] +
+        a[6] * a[1] * a[5] -
+        a[0] * a[7] * a[5] -
+        a[6] * a[4] * a[2] -
+        a[3] * a[1] * a[8];
+  }
+};
+
+/**
+ * ３x３の連立一次方程式 Ax = b
+ * - 入力：A の９要素（行優先）、b の３要素、出力：x の３要素、A の行列式、A の大きさ（MyBatchRowScale()）
+ * - x = adj(A) b / det(A)
+ */
+struct MyBatchKernelSolve3x3 {
+  enum { NI = 12, NO = 5, FLOPS = 70 };
+  template < class V >
+  static MY_ALWAYS_INLINE void run( const V *a, V *r ){
+    const V *b = a + 9;
+    V c00 = a[4] * a[8] - a[5] * a[7];
+    V c01 = a[2] * a[7] - a[1] * a[8];
+    V c02 = a[1] * a[5] - a[2] * a[4];
+    V det = a[0] * c00 + a[3] * c01 + a[6] * c02;
+    V s = 1.0 / det;
+    r[0] = ( c00 * b[0] + c01 * b[1] + c02 * b[2] ) * s;
+    r[1] = ( ( a[5] * a[6] - a[3] * a[8] ) * b[0] +
+             ( a[0] * a[8] - a[2] * a[6] ) * b[1] +
+             ( a[2] * a[3] - a[0] * a[5] ) * b[2] ) * s;
+    r[2] = ( ( a[3] * a[7] - a[4] * a[6] ) * b[0] +
+             ( a[1] * a[6] - a[0] * a[7] ) * b[1] +
+             ( a[0] * a[4] - a[1] * a[3] ) * b[2] ) * s;
+    r[3] = det;
+    MyBatchRowScale< 3 >( a, r[4] );
+  }
+};
+
+/**
+ * ４x４の余因子行列（の転置＝随伴行列）と行列式の計算部分
+ * - ２x２の小行列式（上２行から６個、下２行から６個）を使い回して計算する。
+ */
+template < class V >
+MY_ALWAYS_INLINE
+void
+MyBatchAdj4x4( const V *a, V *adj, V &det ){
+  V s0 = a[0] * a[5] - a[4] * a[1];
+  V s1 = a[0] * a[6] - a[4] * a[2];
+  V s2 = a[0] * a[7] - a[4] * a[3];
+  V s3 = a[1] * a[6] - a[5] * a[2];
+  V s4 = a[1] * a[7] - a[5] * a[3];
+  V s5 = a[2] * a[7] - a[6] * a[3];
+  V c5 = a[10] * a[15] - a[14] * a[11];
+  V c4 = a[9] * a[15] - a[13] * a[11];
+  V c3 = a[9] * a[14] - a[13] * a[10];
+  V c2 = a[8] * a[15] - a[12] * a[11];
+  V c1 = a[8] * a[14] - a[12] * a[10];
+  V c0 = a[8] * a[13] - a[12] * a[9];
+  det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  adj[0]  =  a[5] * c5 - a[6] * c4 + a[7] * c3;
+  adj[1]  = -a[1] * c5 + a[2] * c4 - a[3] * c3;
+  adj[2]  =  a[13] * s5 - a[14] * s4 + a[15] * s3;
+  adj[3]  = -a[9] * s5 + a[10] * s4 - a[11] * s3;
+  adj[4]  = -a[4] * c5 + a[6] * c2 - a[7] * c1;
+  adj[5]  =  a[0] * c5 - a[2] * c2 + a[3] * c1;
+  adj[6]  = -a[12] * s5 + a[14] * s2 - a[15] * s1;
+  adj[7]  =  a[8] * s5 - a[10] * s2 + a[11] * s1;
+  adj[8]  =  a[4] * c4 - a[5] * c2 + a[7] * c0;
+  adj[9]  = -a[0] * c4 + a[1] * c2 - a[3] * c0;
+  adj[10] =  a[12] * s4 - a[13] * s2 + a[15] * s0;
+  adj[11] = -a[8] * s4 + a[9] * s2 - a[11] * s0;
+  adj[12] = -a[4] * c3 + a[5] * c1 - a[6] * c0;
+  adj[13] =  a[0] * c3 - a[1] * c1 + a[2] * c0;
+  adj[14] = -a[12] * s3 + a[13] * s1 - a[14] * s0;
+  adj[15] =  a[8] * s3 - a[9] * s1 + a[10] * s0;
+}
+
+/**
+ * ４x４の逆行列と行列式
+ * - 入力：A の１６要素（行優先）、出力：逆行列の１６要素（行優先）、行列式、行列の大きさ（MyBatchRowScale()）
+ */
+struct MyBatchKernelInv4x4 {
+  enum { NI = 16, NO = 18, FLOPS = 140 };
+  template < class V >
+  static MY_ALWAYS_INLINE void run( const V *a, V *r ){
+    V det;
+    MyBatchAdj4x4( a, r, det );
+    V s = 1.0 / det;
+    for( int i = 0; i < 16; i++ ) r[ i ] = r[ i ] * s;
+    r[16] = det;
+    MyBatchRowScale< 4 >( a, r[17] );
+  }
+};
+
+/**
+ * ４x４の行列式
+ */
+struct MyBatchKernelDet4x4 {
+  enum { NI = 16, NO = 1, FLOPS = 40 };
+  template < class V >
+  static MY_ALWAYS_INLINE void run( const V *a, V *r ){
+    V s0 = a[0] * a[5] - a[4] * a[1];
+    V s1 = a[0] * a[6] - a[4] * a[2];
+    V s2 = a[0] * a[7] - a[4] * a[3];
+    V s3 = a[1] * a[6] - a[5] * a[2];
+    V s4 = a[1] * a[7] - a[5] * a[3];
+    V s5 = a[2] * a[7] - a[6] * a[3];
+    V c5 = a[10] * a[15] - a[14] * a[11];
+    V c4 = a[9] * a[15] - a[13] * a[11];
+    V c3 = a[9] * a[14] - a[13] * a[10];
+    V c2 = a[8] * a[15] - a[12] * a[11];
+    V c1 = a[8] * a[14] - a[12] * a[10];
+    V c0 = a[8] * a[13] - a[12] * a[9];
+    r[0] = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  }
+};
+
+/**
+ * ４x４の連立一次方程式 Ax = b
+ * - 入力：A の１６要素（行優先）、b の４要素、出力：x の４要素、A の行列式、A の大きさ（MyBatchRowScale()）
+ */
+struct MyBatchKernelSolve4x4 {
+  enum { NI = 20, NO = 6, FLOPS = 150 };
+  template < class V >
+  static MY_ALWAYS_INLINE void run( const V *a, V *r ){
+    const V *b = a + 16;
+    V adj[ 16 ], det;
+    MyBatchAdj4x4( a, adj, det );
+    V s = 1.0 / det;
+    for( int i = 0; i < 4; i++ ){
+      r[ i ] = ( adj[ 4 * i ] * b[0] + adj[ 4 * i + 1 ] * b[1] + adj[ 4 * i + 2 ] * b[2] + adj[ 4 * i + 3 ] * b[3] ) * s;
+    }
+    r[4] = det;
+    MyBatchRowScale< 4 >( a, r[5] );
+  }
+};
+
+/**
+ * バッチ計算の駆動部分
+ * - ポータブル版。k0 番目から k1 番目の手前までを１個ずつ計算する。
+ * @param in 入力の面（K::NI 個）
+ * @param out 出力の面（K::NO 個）
+ */
+template < class K >
+inline
+void
+MyBatchRun_Ref( const double *const *in, double *const *out, int k0, int k1 ){
+  for( int k = k0; k < k1; k++ ){
+    double a[ K::NI ], r[ K::NO ];
+    for( int p = 0; p < K::NI; p++ ) a[ p ] = in[ p ][ k ];
+    K::run( a, r );
+    for( int p = 0; p < K::NO; p++ ) out[ p ][ k ] = r[ p ];
+  }//k
+}
+
+#if defined( MY_USE_AVX2 ) && defined( __GNUC__ )
+/**
+ * バッチ計算の駆動部分
+ * - AVX2 版。４個ずつ計算する。端数はポータブル版で計算する。
+ */
+template < class K >
+MY_TARGET_AVX2
+void
+MyBatchRun_AVX2( const double *const *in, double *const *out, int k0, int k1 ){
+  int k = k0;
+  for( ; k + 4 <= k1; k += 4 ){
+    __m256d a[ K::NI ], r[ K::NO ];
+    for( int p = 0; p < K::NI; p++ ) a[ p ] = _mm256_loadu_pd( in[ p ] + k );
+    K::run( a, r );
+    for( int p = 0; p < K::NO; p++ ) _mm256_storeu_pd( out[ p ] + k, r[ p ] );
+  }//k
+  MyBatchRun_Ref< K >( in, out, k, k1 );
+}
+#endif
+
+#if defined( MY_USE_AVX512 ) && defined( __GNUC__ )
+/**
+ * バッチ計算の駆動部分
+ * - AVX-512 版。８個ずつ計算する。端数はポータブル版で計算する。
+ */
+template < class K >
+MY_TARGET_AVX512
+void
+MyBatchRun_AVX512( const double *const *in, double *const *out, int k0, int k1 ){
+  int k = k0;
+  for( ; k + 8 <= k1; k += 8 ){
+    __m512d a[ K::NI ], r[ K::NO ];
+    for( int p = 0; p < K::NI; p++ ) a[ p ] = _mm512_loadu_pd( in[ p ] + k );
+    K::run( a, r );
+    for( int p = 0; p < K::NO; p++ ) _mm512_storeu_pd( out[ p ] + k, r[ p ] );
+  }//k
+  MyBatchRun_Ref< K >( in, out, k, k1 );
+}
+#endif
+
+/**
+ * バッチ計算の駆動部分
+ * - n 個を、使える SIMD 命令セットの版で計算する。
+ * - 計算量がしきい値以上なら、８個単位の区間に分けて複数のスレッドで計算する。
+ */
+template < class K >
+inline
+void
+MyBatchRun( const double *const *in, double *const *out, int n ){
+  MySimdLevelType level = MySimdLevel();
+  int nt = MyNumThreadsFor( (double)K::FLOPS * n );
+  int nb = ( n + 7 ) / 8;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+  for( int t = 0; t < nt; t++ ){
+    int k0 = MyMin( n, (int)( (long long)t * nb / nt ) * 8 );
+    int k1 = MyMin( n, (int)( (long long)( t + 1 ) * nb / nt ) * 8 );
+#if defined( MY_USE_AVX512 ) && defined( __GNUC__ )
+    if( level >= MY_SIMD_AVX512 ){ MyBatchRun_AVX512< K >( in, out, k0, k1 ); continue; }
+#endif
+#if defined( MY_USE_AVX2 ) && defined( __GNUC__ )
+    if( level >= MY_SIMD_AVX2 ){ MyBatchRun_AVX2< K >( in, out, k0, k1 ); continue; }
+#endif
+    MyBatchRun_Ref< K >( in, out, k0, k1 );
+  }//t
+  (void)level;
+}
+
+// 特異とみなす行列式の相対的な大きさの既定値（MyBatchMarkSingular() を参照）
+#ifndef MY_BATCH_SINGULAR_EPS
+#define MY_BATCH_SINGULAR_EPS 1E-12
+#endif
+
+/**
+ * 行列式から特異かどうかのフラグを立て、特異なものの出力をゼロにする
+ * - 行列の大きさで正規化して判定する：|det| <= eps * scale なら特異。
+ *   scale はカーネルが MyBatchRowScale() で求めた行ごとの絶対値の最大の積（|det| の上限の目安）なので、
+ *   行列を定数倍しても、行ごとに単位を変えても判定は変わらない。
+ * @param det 行列式（n 個）
+ * @param scale 行列の大きさ（n 個）
+ * @param out ゼロにする出力の面（nout 個）
+ * @param eps 相対的なしきい値
+ * @return 特異だった個数
+ */
+inline
+int
+MyBatchMarkSingular( const double *det, const double *scale, int n,
+                     double *const *out, int nout, double eps,
+                     std::vector< unsigned char > &singular ){
+  if( singular.empty() ) singular.resize( n );
+  else assert( singular.size() == n );
+  int count = 0;
+  for( int k = 0; k < n; k++ ){
+    // NaN も特異として扱う（比較が偽になる）
+    bool s = !( MyAbs( det[ k ] ) > eps * scale[ k ] );
+    singular[ k ] = s;
+    if( s ){
+      count++;
+      for( int p = 0; p < nout; p++ ) out[ p ][ k ] = 0;
+    }
+  }//k
+  return count;
+}
+
+/**
+ * 行列式のバッチ計算
+ * - 3x3 版
+ * @param[out] det n 個の行列式。空ならリサイズする。
+ */
+inline
+void
+MyMatDetBatch( const MyMat3dBatch &A, std::vector< double > &det ){
+  int n = A.size();
+  if( det.empty() ) det.resize( n );
+  else assert( det.size() == n );
+  if( n == 0 ) return;
+  const double *in[ 9 ];
+  for( int p = 0; p < 9; p++ ) in[ p ] = A.plane( p / 3, p % 3 );
+  double *out[ 1 ] = { &det[ 0 ] };
+  MyBatchRun< MyBatchKernelDet3x3 >( in, out, n );
+}
+
+/**
+ * 行列式のバッチ計算
+ * - 4x4 版
+ * @param[out] det n 個の行列式。空ならリサイズする。
+ */
+inline
+void
+MyMatDetBatch( const MyMat4dBatch &A, std::vector< double > &det ){
+  int n = A.size();
+  if( det.empty() ) det.resize( n );
+  else assert( det.size() == n );
+  if( n == 0 ) return;
+  const double *in[ 16 ];
+  for( int p = 0; p < 16; p++ ) in[ p ] = A.plane( p / 4, p % 4 );
+  double *out[ 1 ] = { &det[ 0 ] };
+  MyBatchRun< MyBatchKernelDet4x4 >( in, out, n );
+}
+
+/**
+ * 逆行列のバッチ計算
+ * - 3x3 版
+ * - 特異な（行列式が行列の大きさに比べて小さい。MyBatchMarkSingular() を参照）行列があっても止まらない。singular にフラグを立て、その逆行列はゼロにする。
+ * @param[out] dst n 個の逆行列。空ならリサイズする。
+ * @param[out] det n 個の行列式。空ならリサイズする。
+ * @param[out] singular 行列ごとの特異フラグ（1:特異）。空ならリサイズする。
+ * @return 特異だった行列の個数（0 なら全部成功）
+ */
+inline
+int
+MyMatInvBatch( const MyMat3dBatch &A, MyMat3dBatch &dst,
+               std::vector< double > &det, std::vector< unsigned char > &singular,
+               double eps = MY_BATCH_SINGULAR_EPS ){
+  int n = A.size();
+  if( dst.size() == 0 ) dst.resize( n );
+  else assert( dst.size() == n );
+  if( det.empty() ) det.resize( n );
+  else assert( det.size() == n );
+  if( n == 0 ){ singular.clear(); return 0; }
+  MyWorkspaceScope scope;
+  double *scale = scope.workspace().alloc( n );
+  const double *in[ 9 ];
+  double *out[ 11 ];
+  for( int p = 0; p < 9; p++ ){
+    in[ p ] = A.plane( p / 3, p % 3 );
+    out[ p ] = dst.plane( p / 3, p % 3 );
+  }
+  out[ 9 ] = &det[ 0 ];
+  out[ 10 ] = scale;
+  MyBatchRun< MyBatchKernelInv3x3 >( in, out, n );
+  return MyBatchMarkSingular( &det[ 0 ], scale, n, out, 9, eps, singular );
+}
+
+/**
+ * 逆行列のバッチ計算
+ * - 4x4 版
+ * - 特異な（行列式が行列の大きさに比べて小さい。MyBatchMarkSingular() を参照）行列があっても止まらない。singular にフラグを立て、その逆行列はゼロにする。
+ * @return 特異だった行列の個数（0 なら全部成功）
+ */
+inline
+int
+MyMatInvBatch( const MyMat4dBatch &A, MyMat4dBatch &dst,
+               std::vector< double > &det, std::vector< unsigned char > &singular,
+               double eps = MY_BATCH_SINGULAR_EPS ){
+  int n = A.size();
+  if( dst.size() == 0 ) dst.resize( n );
+  else assert( dst.size() == n );
+  if( det.empty() ) det.resize( n );
+  else assert( det.size() == n );
+  if( n == 0 ){ singular.clear(); return 0; }
+  MyWorkspaceScope scope;
+  double *scale = scope.workspace().alloc( n );
+  const double *in[ 16 ];
+  double *out[ 18 ];
+  for( int p = 0; p < 16; p++ ){
+    in[ p ] = A.plane( p / 4, p % 4 );
+    out[ p ] = dst.plane( p / 4, p % 4 );
+  }
+  out[ 16 ] = &det[ 0 ];
+  out[ 17 ] = scale;
+  MyBatchRun< MyBatchKernelInv4x4 >( in, out, n );
+  return MyBatchMarkSingular( &det[ 0 ], scale, n, out, 16, eps, singular );
+}
+
+/**
+ * 連立一次方程式 Ax = b のバッチ計算
+ * - 3x3 版
+ * - 特異な（行列式が行列の大きさに比べて小さい。MyBatchMarkSingular() を参照）行列があっても止まらない。singular にフラグを立て、その解はゼロにする。
+ * @param[out] x n 個の解。空ならリサイズする。
+ * @param[out] singular 行列ごとの特異フラグ（1:特異）。空ならリサイズする。
+ * @return 特異だった行列の個数（0 なら全部成功）
+ */
+inline
+int
+MyAxbSolveBatch( const MyMat3dBatch &A, MyVec3dBatch &x, const MyVec3dBatch &b,
+                 std::vector< unsigned char > &singular, double eps = MY_BATCH_SINGULAR_EPS ){
+  int n = A.size();
+  assert( b.size() == n );
+  if( x.size() == 0 ) x.resize( n );
+  else assert( x.size() == n );
+  if( n == 0 ){ singular.clear(); return 0; }
+  MyWorkspaceScope scope;
+  double *det = scope.workspace().alloc( n ), *scale = scope.workspace().alloc( n );
+  const double *in[ 12 ];
+  double *out[ 5 ];
+  for( int p = 0; p < 9; p++ ) in[ p ] = A.plane( p / 3, p % 3 );
+  for( int p = 0; p < 3; p++ ){
+    in[ 9 + p ] = b.plane( p, 0 );
+    out[ p ] = x.plane( p, 0 );
+  }
+  out[ 3 ] = det;
+  out[ 4 ] = scale;
+  MyBatchRun< MyBatchKernelSolve3x3 >( in, out, n );
+  return MyBatchMarkSingular( det, scale, n, out, 3, eps, singular );
+}
+
+/**
+ * 連立一次方程式 Ax = b のバッチ計算
+ * - 4x4 版
+ * - 特異な（行列式が行列の大きさに比べて小さい。MyBatchMarkSingular() を参照）行列があっても止まらない。singular にフラグを立て、その解はゼロにする。
+ * @return 特異だった行列の個数（0 なら全部成功）
+ */
+inline
+int
+MyAxbSolveBatch( const MyMat4dBatch &A, MyVec4dBatch &x, const MyVec4dBatch &b,
+                 std::vector< unsigned char > &singular, double eps = MY_BATCH_SINGULAR_EPS ){
+  int n = A.size();
+  assert( b.size() == n );
+  if( x.size() == 0 ) x.resize( n );
+  else assert( x.size() == n );
+  if( n == 0 ){ singular.clear(); return 0; }
+  MyWorkspaceScope scope;
+  double *det = scope.workspace().alloc( n ), *scale = scope.workspace().alloc( n );
+  const double *in[ 20 ];
+  double *out[ 6 ];
+  for( int p = 0; p < 16; p++ ) in[ p ] = A.plane( p / 4, p % 4 );
+  for( int p = 0; p < 4; p++ ){
+    in[ 16 + p ] = b.plane( p, 0 );
+    out[ p ] = x.plane( p, 0 );
+  }
+  out[ 4 ] = det;
+  out[ 5 ] = scale;
+  MyBatchRun< MyBatchKernelSolve4x4 >( in, out, n );
+  return MyBatchMarkSingular( det, scale, n, out, 4, eps, singular );
+}
+
+/**
+//  * 乱数生成
+//  * - 平均 mu、分散 sg2 の正規分布で分布する乱数を発生する。 
+//  */
+// double MyRandGauss( double mu, double sg2 ){
+//   using namespace std;
+//   // Box-Muller's Method
+//   double X = rand() / (double)RAND_MAX;
+//   double Y = rand() / (double)RAND_MAX;
+//   double Z1 = sqrt( sg2 ) * sqrt( -2 * log( X ) ) * cos( 2 * M_PI * Y ) + mu;
+//   //double Z2 = sqrt( sg2 ) * sqrt( -2 * log( X ) ) * sin( 2 * M_PI * Y ) + mu;
+//   return Z1;
+// }
+
+/**
+ * 乱数生成
+ * - 平均 mu、標準偏差 sg の正規分布で分布する乱数を発生する。 
+ */
+double MyRandGauss( double mu, double sg ){
+  using namespace std;
+  // Box-Muller's Method
+  double X = rand() / (double)RAND_MAX;
+  double Y = rand() / (double)RAND_MAX;
+  double Z1 = sg * sqrt( -2 * log( X ) ) * cos( 2 * M_PI * Y ) + mu;
+  return Z1;
+}
+
+/**
+ * 乱数生成
+ * - ポアソン分布に従う乱数を発生する。
+ * - ただし、lambda が大きいと exp( -lambda ) が 0 になり、返ってこないので注意。
+ */
+int MyRandPoisson( double lambda ){
+  using namespace std;
+  assert( lambda > 0 );
+  double x = rand() / (double)RAND_MAX;
+  int k = 0;
+  double a = exp( -lambda );
+  while( x >= a ){
+    x = x * rand() / (double)RAND_MAX;
+    k = k + 1;
+  }
+  return k;
+}
+
+/** 
+ * 行列の LU 分解
+ * - MyMat 版
+ * - 枢軸選択（ピボッティング）は実装していない。なので計算に失敗する場合もあり。
+ *   枢軸選択つきのブロック版は、並べ替えを受け取る MyLUDecomp( A, perm ) の方。
+ * - 要素の型は float でもよい（MyMatf）。
+ * @param[in,out] A 対象となる行列。LU 分解した結果で上書きされる。
+ * @return 0:成功、0以外:失敗
+ */
+template < class T >
+inline
+int
+MyLUDecomp( MyMatT< T > &A ){
+  int N = A.rows();
+  assert( N > 0 );
+  assert( A.cols() == N );
+  for( int i = 0; i < N - 1; i++ ){
+    if( A( i, i ) == 0 ) return -1;
+    for( int j = i + 1; j < N; j++ ){
+      A( j, i ) = A( j, i ) / A( i, i );
+      T l = A( j, i );
+      for( int k = i + 1; k < N; k++ ){
+        A( j, k ) = A( j, k ) - l * A( i, k );
+      }
+    }
+  }
+  return 0;
+}
+
+// ブロック版 LU 分解のパネルの列数
+#ifndef MY_LU_NB
+#define MY_LU_NB 64
+#endif
+
+/**
+ * 行列の LU 分解（部分ピボット選択つき、ブロック版）
+ * - PA = LU となる L（単位下三角。対角の 1 は持たない）と U を A に上書きする。
+ * - perm[ i ] は、分解後の i 行目が元の A の何行目だったか（(PA)( i, : ) = A( perm[ i ], : )）。
+ * - 各列で絶対値が最大の要素を枢軸に選ぶので、対角成分にゼロがあっても正則なら分解できる。
+ * - MY_LU_NB 列ずつのパネルに分けて、
+ *   1. パネル（対角から下の部分）を１列ずつ分解する。枢軸選択と行の入れ替えもここで行う。
+ *   2. パネルの右側の U のブロック行を、L の対角ブロックで解く。
+ *   3. 右下の残りの部分を A22 -= A21 * A12 で更新する（MyGemm。大きければ複数のスレッドで計算）。
+ *   と進める。計算量のほとんどは 3 の行列積なので、キャッシュ効率がよい。
+ * - 要素の型は float でもよい。
+ * @param[in,out] A 正方行列。LU 分解した結果で上書きされる。
+ * @param[out] perm 行の並べ替え（N 要素の領域）
+ * @return 0:成功、0以外:失敗（枢軸がゼロ＝特異）
+ */
+template < class T >
+inline
+int
+MyLUDecomp( MyMatViewT< T > &A, int *perm ){
+  int N = A.rows();
+  assert( N > 0 );
+  assert( A.cols() == N );
+  for( int i = 0; i < N; i++ ) perm[ i ] = i;
+
+  for( int k = 0; k < N; k += MY_LU_NB ){
+    int nb = MyMin( MY_LU_NB, N - k );
+
+    // 1. パネルの分解
+    for( int j = k; j < k + nb; j++ ){
+      // 枢軸選択：j 列目の対角から下で絶対値が最大の行
+      int p = j;
+      T amax = MyAbs( A( j, j ) );
+      for( int i = j + 1; i < N; i++ ){
+        T a = MyAbs( A( i, j ) );
+        if( a > amax ){
+          amax = a;
+          p = i;
+        }
+      }//i
+      if( amax == 0 ) return -1;
+
+      // 行全体を入れ替える（左側の L の部分、右側の未処理の部分も一緒に）
+      if( p != j ){
+        for( int c = 0; c < N; c++ ) std::swap( A( j, c ), A( p, c ) );
+        std::swap( perm[ j ], perm[ p ] );
+      }
+
+      // L の列を求めて、パネル内の残りの列を更新
+      T d = A( j, j );
+#ifdef _OPENMP
+      int nt = MyNumThreadsFor( 2.0 * ( N - j - 1 ) * ( k + nb - j - 1 ) );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+      for( int i = j + 1; i < N; i++ ){
+        A( i, j ) = A( i, j ) / d;
+        T l = A( i, j );
+        for( int c = j + 1; c < k + nb; c++ ) A( i, c ) -= l * A( j, c );
+      }//i
+    }//j
+    if( k + nb == N ) break;
+    int n2 = N - k - nb;
+
+    // 2. A12 <- L11^-1 * A12（単位下三角の前進代入）
+    MyMatViewT< T > A12 = A.block( k, k + nb, nb, n2 );
+    for( int i = 1; i < nb; i++ ){
+      for( int r = 0; r < i; r++ ){
+        T l = A( k + i, k + r );
+        if( l == 0 ) continue;
+        for( int c = 0; c < n2; c++ ) A12( i, c ) -= l * A12( r, c );
+      }//r
+    }//i
+
+    // 3. A22 <- A22 - A21 * A12
+    MyMatViewT< T > A22 = A.block( k + nb, k + nb, n2, n2 );
+    MyGemm( -1.0, A.block( k + nb, k, n2, nb ), A12, 1.0, A22 );
+  }//k
+
+  return 0;
+}
+
+/**
+ * 行列の LU 分解（部分ピボット選択つき、ブロック版）
+ * - 並べ替えを vector で受け取るバージョン。
+ */
+template < class T >
+inline
+int
+MyLUDecomp( MyMatViewT< T > &A, std::vector< int > &perm ){
+  perm.resize( A.rows() );
+  return MyLUDecomp( A, &perm[ 0 ] );
+}
+
+/** 
+ * 行列の LU 分解
+ * - 枢軸選択（ピボッティング）は実装していない。なので計算に失敗する場合もあり。
+ * - 内部では作業領域の MyMat にコピーして計算する。
+ * @param[in,out] A 対象となる行列。LU 分解した結果で上書きされる。
+ * @return 0:成功、0以外:失敗
+ */
+int
+MyLUDecomp( std::vector< std::vector< double > > &A ){
+  int N = A.size();
+  assert( N > 0 );
+  assert( A[ 0 ].size() == N );
+  MyWorkspaceScope scope;
+  MyMat &B = scope.workspace().mat( N, N );
+  B.set( A );
+  int ret = MyLUDecomp( B );
+  B.get( A );
+  return ret;
+}
+
+/**
+ * LU 分解による連立一次方程式の計算
+ * - MyMat 版
+ * - 計算量は、係数行列のサイズ n に対して、O(n^3)
+ * - 部分ピボット選択つきのブロック版 LU 分解（MyLUDecomp( A, perm )）を使う。
+ * - 代入の足し込みは Acc 型で行う（MyAxbSolve_LU< double >( A, x, b ) で float の行列を double で足し込む）。
+ * - A をその場で分解する（コピーしない）。並べ替えは返さないので、分解を使い回したい場合は MyLUFactor を使うこと。
+ * @param[in,out] A 正方行列。作業領域として使われ、呼び出し後は行を並べ替えた PA の LU 分解の結果が入る（並べ替えなしでは使えない）。
+ * @param[in,out] x 解。初期値は不要。メモリは確保済みでも確保済みでなくても可。
+ * @param[in] b 定数ベクトル。
+ * @return 0:成功、0以外:失敗（特異）
+ */
+template < class Acc, class T >
+inline
+int
+MyAxbSolve_LU( MyMatT< T > &A,
+               std::vector< T > &x,
+               std::vector< T > &b
+               ){
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N );
+  else assert( x.size() == N );
+  assert( &x != &b );
+
+  // LU 分解をする
+  MyWorkspaceScope scope;
+  int *perm = scope.workspace().alloc< int >( N );
+  if( MyLUDecomp( A, perm ) ) return -1;
+
+  // 並べ替えと前進代入
+  for( int i = 0; i < N; i++ ){
+    Acc s = b[ perm[ i ] ];
+    for( int j = 0; j < i; j++ ){
+      s -= (Acc)A( i, j ) * x[ j ];
+    }
+    x[ i ] = s;
+  }
+
+  // 後退代入
+  for( int i = N - 1; i >= 0; i-- ){
+    Acc s = x[ i ];
+    for( int j = i + 1; j < N; j++ ){
+      s -= (Acc)A( i, j ) * x[ j ];
+    }
+    assert( A( i, i ) != 0 );
+    x[ i ] = s / A( i, i );
+  }
+
+  return 0;
+}
+
+inline
+int
+MyAxbSolve_LU( MyMat &A, std::vector< double > &x, std::vector< double > &b ){
+  return MyAxbSolve_LU< double >( A, x, b );
+}
+
+inline
+int
+MyAxbSolve_LU( MyMatf &A, std::vector< float > &x, std::vector< float > &b ){
+  return MyAxbSolve_LU< float >( A, x, b );
+}
+
+/**
+ * LU 分解による連立一次方程式の計算
+ * - 計算量は、係数行列のサイズ n に対して、O(n^3)
+ * - 内部では作業領域の MyMat にコピーして計算する。
+ * - 部分ピボット選択つきのブロック版 LU 分解（MyLUDecomp( A, perm )）を使う。
+ * - A は書き換えない。分解を使い回したい場合は MyLUFactor を使うこと（MyLUSet と MyAxbSolve_LU( L, U, x, b ) は並べ替えを扱わない）。
+ * @param[in] A 正方行列。
+ * @param[in,out] x 解。初期値は不要。メモリは確保済みでも確保済みでなくても可。
+ * @param[in] b 定数ベクトル。
+ * @return 0:成功、0以外:失敗（特異）
+ */
+int
+MyAxbSolve_LU( std::vector< std::vector< double > > &A,
+               std::vector< double > &x,
+               std::vector< double > &b
+               ){
+  // 入力チェック
+  assert( A.size() > 0 );
+  assert( A[ 0 ].size() == A.size() );
+
+  MyWorkspaceScope scope;
+  MyMat &B = scope.workspace().mat( A.size(), A.size() );
+  B.set( A );
+  return MyAxbSolve_LU( B, x, b );
+}
+
+/**
+ * LU 分解による連立一次方程式の計算
+ * - 事前に LU 分解済みの行列を渡す。
+ * - 定数ベクトル b を次々変えて方程式を解きたい用。
+ * - 計算量は、係数行列のサイズ n に対して、O(n^2)
+ * @param[in] L 下半分行列。
+ * @param[in] U 上半分行列。
+ * @param[in,out] x 解。初期値は不要。メモリは確保済みでも確保済みでなくても可。
+ * @param[in,out] b 定数ベクトル。内部で変数として利用されるため、呼び出し後、中身は変更されている。
+ */
+int
+MyAxbSolve_LU( const std::vector< std::vector< double > > &L,
+               const std::vector< std::vector< double > > &U,
+               std::vector< double > &x,
+               std::vector< double > &b
+               ){
+  // 入力チェック
+  assert( MyMatIsSquare( L ) && MyMatIsSquare( U ) );
+  assert( MyMatSize( L ) == MyMatSize( U ) );
+  int N = L.size();
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N );
+  else assert( x.size() == N );
+
+  // 前進代入
+  for( int i = 0; i < N; i++ ){
+    b[ i ] = b[ i ];
+    for( int j = 0; j < i; j++ ){
+      b[ i ] -= L[ i ][ j ] * b[ j ];
+    }
+  }
+
+  // 後退代入
+  for( int i = N - 1; i >= 0; i-- ){
+    x[ i ] = b[ i ];
+    for( int j = i + 1; j < N; j++ ){
+      x[ i ] -= U[ i ][ j ] * x[ j ];
+    }
+    assert( U[ i ][ i ] != 0 );
+    x[ i ] /= U[ i ][ i ];
+  }
+  
+  return 0;
+}
+
+/**
+ * LU 分解された結果が一緒になった行列 A から、下半分行列 L、上半分行列 U を抽出する。
+ * @param[in] A MyLUDecomp() で LU 分解済みの行列を渡すこと
+ * @param[out] L 下半分行列。メモリは確保済み or 未確保でも良い。
+ * @param[out] U 上半分行列。メモリは確保済み or 未確保でも良い。
+ */
+int
+MyLUSet( const std::vector< std::vector< double > > &A,
+         std::vector< std::vector< double > > &L,
+         std::vector< std::vector< double > > &U ){
+  using namespace std;
+
+  assert( MyMatIsSquare( A ) );
+  int N = A.size();
+  if( L.empty() ) L.resize( N, vector< double >( N ) );
+  else assert( MyMatAreTheSameSize( L, A ) );
+  if( U.empty() ) U.resize( N, vector< double >( N ) );
+  else assert( MyMatAreTheSameSize( U, A ) );
+
+  for( int i = 0; i < N; i++ ){
+    for( int j = i; j < N; j++ ){
+      U[ i ][ j ] = A[ i ][ j ];
+    }
+    for( int j = 0; j < i; j++ ){
+      L[ i ][ j ] = A[ i ][ j ];
+    }
+    L[ i ][ i ] = 1;
+  }
+  return 0;
+}
+
+/**
+ * LU 分解による連立一次方程式の計算
+ * - MyMat 版
+ * - 事前に LU 分解済みの行列を渡す。
+ * - 代入の足し込みは Acc 型で行う（MyAxbSolve_LU< double >( L, U, x, b ) で float の行列を double で足し込む）。
+ * - 同じ行列で何度も解く場合は MyLUFactor を使う方がよい（L と U に展開せず、b も書き換えず、右辺をまとめて解ける）。
+ * @param[in] L 下半分行列。
+ * @param[in] U 上半分行列。
+ * @param[in,out] x 解。初期値は不要。メモリは確保済みでも確保済みでなくても可。
+ * @param[in,out] b 定数ベクトル。内部で変数として利用されるため、呼び出し後、中身は変更されている。
+ */
+template < class Acc, class T >
+inline
+int
+MyAxbSolve_LU( const MyMatViewT< T > &L,
+               const MyMatViewT< T > &U,
+               std::vector< T > &x,
+               std::vector< T > &b
+               ){
+  // 入力チェック
+  assert( MyMatIsSquare( L ) && MyMatIsSquare( U ) );
+  assert( MyMatSize( L ) == MyMatSize( U ) );
+  int N = L.rows();
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N );
+  else assert( x.size() == N );
+
+  // 前進代入
+  for( int i = 0; i < N; i++ ){
+    Acc s = b[ i ];
+    for( int j = 0; j < i; j++ ){
+      s -= (Acc)L( i, j ) * b[ j ];
+    }
+    b[ i ] = s;
+  }
+
+  // 後退代入
+  for( int i = N - 1; i >= 0; i-- ){
+    Acc s = b[ i ];
+    for( int j = i + 1; j < N; j++ ){
+      s -= (Acc)U( i, j ) * x[ j ];
+    }
+    assert( U( i, i ) != 0 );
+    x[ i ] = s / U( i, i );
+  }
+
+  return 0;
+}
+
+inline
+int
+MyAxbSolve_LU( const MyMatView &L, const MyMatView &U,
+               std::vector< double > &x, std::vector< double > &b ){
+  return MyAxbSolve_LU< double >( L, U, x, b );
+}
+
+inline
+int
+MyAxbSolve_LU( const MyMatViewf &L, const MyMatViewf &U,
+               std::vector< float > &x, std::vector< float > &b ){
+  return MyAxbSolve_LU< float >( L, U, x, b );
+}
+
+/**
+ * LU 分解された結果が一緒になった行列 A から、下半分行列 L、上半分行列 U を抽出する。
+ * - MyMat 版
+ */
+inline
+int
+MyLUSet( const MyMatView &A,
+         MyMat &L,
+         MyMat &U ){
+  assert( MyMatIsSquare( A ) );
+  int N = A.rows();
+  if( L.empty() ) L.resize( N, N );
+  else assert( MyMatAreTheSameSize( L, A ) );
+  if( U.empty() ) U.resize( N, N );
+  else assert( MyMatAreTheSameSize( U, A ) );
+
+  for( int i = 0; i < N; i++ ){
+    for( int j = i; j < N; j++ ){
+      U( i, j ) = A( i, j );
+    }
+    for( int j = 0; j < i; j++ ){
+      L( i, j ) = A( i, j );
+    }
+    L( i, i ) = 1;
+  }
+  return 0;
+}
+
+/*
+ * --- 分解オブジェクト ---
+ * - 行列の分解（LU、コレスキー、LDL^T、QR）の結果を持っておき、右辺を変えて何度でも解けるようにしたクラス。
+ * - 右辺は N x K の行列でまとめて渡せる。三角行列の代入は MyTrsmLower/Upper（ブロックに分けて MyGemm を使う）。
+ */
+
+/**
+ * 下三角行列の連立方程式を、右辺の複数の列について解く（X <- L^-1 X）
+ * - L の対角から下だけを参照する（unit なら対角は 1 とみなし、狭義下三角だけ）。上の部分には何が入っていてもよい。
+ * - 右辺の列が多い場合は MY_LU_NB 行ずつのブロックに分け、ブロックより左の寄与を MyGemm でまとめて引いてから、
+ *   対角ブロックの中を代入で解く。L を何度も読み直さないので、右辺が多いほど１列ずつ解くより速い。
+ * @param[in] L N x N の下三角行列（ビューでよい。転置したビューも可）
+ * @param[in,out] X N x K の右辺。解で上書きされる。
+ * @param[in] unit 対角を 1 とみなすかどうか
+ */
+template < class T >
+inline
+void
+MyTrsmLower( const MyMatViewT< T > &L, MyMatViewT< T > &X, bool unit ){
+  int N = L.rows(), K = X.cols();
+  assert( L.cols() == N && X.rows() == N );
+  // 右辺が少ないときは行列積にしても速くならないので、ブロックに分けない
+  int nb = ( K < 4 ) ? MyMax( N, 1 ) : MY_LU_NB;
+  for( int i0 = 0; i0 < N; i0 += nb ){
+    int m = MyMin( nb, N - i0 );
+    MyMatViewT< T > Xi = X.block( i0, 0, m, K );
+    if( i0 > 0 ) MyGemm( -1.0, L.block( i0, 0, m, i0 ), X.block( 0, 0, i0, K ), 1.0, Xi );
+    if( K < 4 ){
+      // 右辺が少ないときは内積の形で（足し込みをレジスタに置ける）
+      for( int c = 0; c < K; c++ ){
+        for( int i = 0; i < m; i++ ){
+          T s = Xi( i, c );
+          for( int r = 0; r < i; r++ ) s -= L( i0 + i, i0 + r ) * Xi( r, c );
+          Xi( i, c ) = unit ? s : s / L( i0 + i, i0 + i );
+        }//i
+      }//c
+      continue;
+    }
+    for( int i = 0; i < m; i++ ){
+      for( int r = 0; r < i; r++ ){
+        T l = L( i0 + i, i0 + r );
+        if( l == 0 ) continue;
+        for( int c = 0; c < K; c++ ) Xi( i, c ) -= l * Xi( r, c );
+      }//r
+      if( ! unit ){
+        T d = L( i0 + i, i0 + i );
+        for( int c = 0; c < K; c++ ) Xi( i, c ) /= d;
+      }
+    }//i
+  }//i0
+}
+
+/**
+ * 上三角行列の連立方程式を、右辺の複数の列について解く（X <- U^-1 X）
+ * - U の対角から上だけを参照する（unit なら対角は 1 とみなし、狭義上三角だけ）。下の部分には何が入っていてもよい。
+ * - ブロックの分け方は MyTrsmLower と同じ（下のブロックから順に解く）。
+ * @param[in] U N x N の上三角行列（ビューでよい。転置したビューも可）
+ * @param[in,out] X N x K の右辺。解で上書きされる。
+ * @param[in] unit 対角を 1 とみなすかどうか
+ */
+template < class T >
+inline
+void
+MyTrsmUpper( const MyMatViewT< T > &U, MyMatViewT< T > &X, bool unit ){
+  int N = U.rows(), K = X.cols();
+  assert( U.cols() == N && X.rows() == N );
+  if( N == 0 ) return;
+  int nb = ( K < 4 ) ? N : MY_LU_NB;
+  for( int i0 = ( ( N - 1 ) / nb ) * nb; i0 >= 0; i0 -= nb ){
+    int m = MyMin( nb, N - i0 );
+    int e = i0 + m;
+    MyMatViewT< T > Xi = X.block( i0, 0, m, K );
+    if( e < N ) MyGemm( -1.0, U.block( i0, e, m, N - e ), X.block( e, 0, N - e, K ), 1.0, Xi );
+    if( K < 4 ){
+      for( int c = 0; c < K; c++ ){
+        for( int i = m - 1; i >= 0; i-- ){
+          T s = Xi( i, c );
+          for( int r = i + 1; r < m; r++ ) s -= U( i0 + i, i0 + r ) * Xi( r, c );
+          Xi( i, c ) = unit ? s : s / U( i0 + i, i0 + i );
+        }//i
+      }//c
+      continue;
+    }
+    for( int i = m - 1; i >= 0; i-- ){
+      for( int r = i + 1; r < m; r++ ){
+        T u = U( i0 + i, i0 + r );
+        if( u == 0 ) continue;
+        for( int c = 0; c < K; c++ ) Xi( i, c ) -= u * Xi( r, c );
+      }//r
+      if( ! unit ){
+        T d = U( i0 + i, i0 + i );
+        for( int c = 0; c < K; c++ ) Xi( i, c ) /= d;
+      }
+    }//i
+  }//i0
+}
+
+// ブロック版コレスキー分解、LDL^T 分解のブロックの列数
+#ifndef MY_CHOL_NB
+#define MY_CHOL_NB 64
+#endif
+
+/**
+ * 対称正定値行列のコレスキー分解 A = L L^T（ブロック版）
+ * - A の対角から下だけを参照し、そこに L を上書きする。
+ * - 対角より上の部分は、計算の途中の値で壊れる（L として使う場合はゼロにすること）。
+ * - MY_CHOL_NB 列ずつのブロックに分けて、
+ *   1. 対角ブロックを分解する。
+ *   2. その下のブロック列を L21 <- A21 L11^-T で求める（行ごとに複数のスレッドで計算）。
+ *   3. 右下の残りの部分の下三角を A22 -= L21 L21^T で更新する（ブロック列ごとに MyGemm）。
+ *   と進める。対称性を使うので、計算量は LU 分解の半分（n^3 / 3）。
+ * - 要素の型は float でもよい。
+ * @param[in,out] A 対称正定値行列
+ * @return 0:成功、0以外:失敗（正定値でない）
+ */
+template < class T >
+inline
+int
+MyCholDecomp( MyMatViewT< T > &A ){
+  int N = A.rows();
+  assert( N > 0 );
+  assert( A.cols() == N );
+  for( int k = 0; k < N; k += MY_CHOL_NB ){
+    int nb = MyMin( MY_CHOL_NB, N - k );
+    int n2 = N - k - nb;
+
+    // 1. 対角ブロックの分解
+    for( int j = k; j < k + nb; j++ ){
+      T s = A( j, j );
+      for( int c = k; c < j; c++ ) s -= A( j, c ) * A( j, c );
+      if( ! ( s > 0 ) ) return -1;
+      T d = std::sqrt( s );
+      A( j, j ) = d;
+      for( int i = j + 1; i < k + nb; i++ ){
+        T t = A( i, j );
+        for( int c = k; c < j; c++ ) t -= A( i, c ) * A( j, c );
+        A( i, j ) = t / d;
+      }//i
+    }//j
+    if( n2 == 0 ) break;
+
+    // 2. L21 <- A21 L11^-T
+#ifdef _OPENMP
+    int nt = MyNumThreadsFor( 1.0 * n2 * nb * nb );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = k + nb; i < N; i++ ){
+      for( int j = k; j < k + nb; j++ ){
+        T t = A( i, j );
+        for( int c = k; c < j; c++ ) t -= A( i, c ) * A( j, c );
+        A( i, j ) = t / A( j, j );
+      }//j
+    }//i
+
+    // 3. A22 <- A22 - L21 L21^T（下三角を含むブロック列だけ）
+    for( int j0 = 0; j0 < n2; j0 += nb ){
+      int w = MyMin( nb, n2 - j0 );
+      MyMatViewT< T > C = A.block( k + nb + j0, k + nb + j0, n2 - j0, w );
+      MyGemm( -1.0, A.block( k + nb + j0, k, n2 - j0, nb ), A.block( k + nb + j0, k, w, nb ).trans(), 1.0, C );
+    }//j0
+  }//k
+  return 0;
+}
+
+/**
+ * 対称行列の LDL^T 分解 A = L D L^T（ブロック版）
+ * - L は単位下三角、D は対角行列。平方根を使わないので、正定値でない対称行列（対角に負の値が出るもの）も分解できる。
+ * - 枢軸選択はしないので、D にゼロが出ると失敗する。対称不定値で条件の悪い行列には向かない（その場合は LU 分解）。
+ * - A の対角から下だけを参照し、狭義下三角に L（対角の 1 は持たない）、対角に D を上書きする。
+ *   対角より上の部分は、計算の途中の値で壊れる。
+ * - ブロックの進め方は MyCholDecomp() と同じ。右下の更新は A22 -= (L21 D1) L21^T 。
+ * - 要素の型は float でもよい。
+ * @param[in,out] A 対称行列
+ * @return 0:成功、0以外:失敗（D にゼロが出た）
+ */
+template < class T >
+inline
+int
+MyLDLDecomp( MyMatViewT< T > &A ){
+  int N = A.rows();
+  assert( N > 0 );
+  assert( A.cols() == N );
+  MyWorkspaceScope scope;
+  MyMatT< T > &W = scope.workspace().mat< T >( N, MyMin( MY_CHOL_NB, N ) );
+  for( int k = 0; k < N; k += MY_CHOL_NB ){
+    int nb = MyMin( MY_CHOL_NB, N - k );
+    int n2 = N - k - nb;
+
+    // 1. 対角ブロックの分解
+    for( int j = k; j < k + nb; j++ ){
+      T s = A( j, j );
+      for( int c = k; c < j; c++ ) s -= A( j, c ) * A( j, c ) * A( c, c );
+      if( s == 0 ) return -1;
+      A( j, j ) = s;
+      for( int i = j + 1; i < k + nb; i++ ){
+        T t = A( i, j );
+        for( int c = k; c < j; c++ ) t -= A( i, c ) * A( j, c ) * A( c, c );
+        A( i, j ) = t / s;
+      }//i
+    }//j
+    if( n2 == 0 ) break;
+
+    // 2. L21 <- A21 L11^-T D1^-1 、W = L21 D1
+#ifdef _OPENMP
+    int nt = MyNumThreadsFor( 1.0 * n2 * nb * nb );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = k + nb; i < N; i++ ){
+      for( int j = k; j < k + nb; j++ ){
+        T t = A( i, j );
+        for( int c = k; c < j; c++ ) t -= W( i - k - nb, c - k ) * A( j, c );
+        W( i - k - nb, j - k ) = t;
+        A( i, j ) = t / A( j, j );
+      }//j
+    }//i
+
+    // 3. A22 <- A22 - W L21^T（下三角を含むブロック列だけ）
+    for( int j0 = 0; j0 < n2; j0 += nb ){
+      int w = MyMin( nb, n2 - j0 );
+      MyMatViewT< T > C = A.block( k + nb + j0, k + nb + j0, n2 - j0, w );
+      MyGemm( -1.0, W.block( j0, 0, n2 - j0, nb ), A.block( k + nb + j0, k, w, nb ).trans(), 1.0, C );
+    }//j0
+  }//k
+  return 0;
+}
+
+/**
+ * コレスキー分解による連立一次方程式の計算
+ * - MyMat 版
+ * - 対称正定値行列用。計算量は LU 分解の半分。
+ * - A の対角から下だけを参照する。A も b も変更しない（作業領域にコピーして分解する）。
+ * - 正定値でなければ失敗を返すので、その場合は LU 分解で解き直すこと。
+ *     if( MyAxbSolve_Chol( A, x, b ) ) MyAxbSolve_LU( ... );
+ * @param[in] A 対称正定値行列
+ * @param[in,out] x 解。初期値は不要。メモリは確保済みでも確保済みでなくても可。
+ * @param[in] b 定数ベクトル。
+ * @return 0:成功、0以外:失敗（正定値でない）
+ */
+template < class T >
+inline
+int
+MyAxbSolve_Chol( const MyMatViewT< T > &A,
+                 std::vector< T > &x,
+                 const std::vector< T > &b
+                 ){
+  int N = A.rows();
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N );
+  else assert( x.size() == N );
+
+  MyWorkspaceScope scope;
+  MyMatT< T > &L = scope.workspace().mat< T >( N, N );
+  L = A;
+  if( MyCholDecomp( L ) ) return -1;
+  if( &x != &b ) x = b;
+  MyMatT< T > X( x, N, 1 );
+  MyTrsmLower( L, X, false );
+  MyTrsmUpper( L.trans(), X, false );
+  return 0;
+}
+
+/**
+ * コレスキー分解による連立一次方程式の計算
+ * - 対称正定値行列用。A も b も変更しない。
+ * - 内部では作業領域の MyMat にコピーして計算する。
+ * @return 0:成功、0以外:失敗（正定値でない）
+ */
+inline
+int
+MyAxbSolve_Chol( const std::vector< std::vector< double > > &A,
+                 std::vector< double > &x,
+                 const std::vector< double > &b
+                 ){
+  assert( A.size() > 0 );
+  assert( A[ 0 ].size() == A.size() );
+  MyWorkspaceScope scope;
+  MyMat &B = scope.workspace().mat( A.size(), A.size() );
+  B.set( A );
+  return MyAxbSolve_Chol( B, x, b );
+}
+
+/**
+ * LU 分解のオブジェクト
+ * - 部分ピボット選択つきのブロック版 LU 分解（MyLUDecomp( A, perm )）の結果を、L と U をまとめた形のまま持つ。
+ *   MyLUSet() で L と U に展開しないので、メモリは元の行列１つ分で済む。
+ * - 一度分解しておけば、solve() で何度でも解ける。右辺は N x K の行列でまとめて渡すのがよい（MyTrsmLower/Upper）。
+ * - 元の行列も右辺も書き換えない。
+ * - 使い方：
+ *     MyLUFactor lu( A );
+ *     if( ! lu.ok() ) ... // 特異
+ *     lu.solve( B, X );   // A X = B
+ * - T は要素の型。MyLUFactor（double）、MyLUFactorf（float）を使う。
+ */
+template < class T >
+class MyLUFactorT
+{
+  MyMatT< T > _lu;           //!< LU 分解の結果（L の対角の 1 は持たない）
+  std::vector< int > _perm;  //!< 行の並べ替え（(PA)( i, : ) = A( perm[ i ], : )）
+  int _info;                 //!< 0:分解済み、0以外:未分解または失敗
+
+ public:
+  MyLUFactorT() : _info( -1 ) { }
+
+  /**
+   * 正方行列 A を分解する
+   */
+  explicit MyLUFactorT( const MyMatViewT< T > &A ) : _info( -1 ) {
+    compute( A );
+  }
+
+  /**
+   * 正方行列 A を分解する（A は変更しない）
+   * @return 0:成功、0以外:失敗（特異）
+   */
+  int compute( const MyMatViewT< T > &A ){
+    assert( MyMatIsSquare( A ) );
+    _lu = A;
+    _info = MyLUDecomp( _lu, _perm );
+    return _info;
+  }
+
+  // アクセサ
+  bool ok() const { return _info == 0; }
+  int size() const { return _lu.rows(); }
+  const MyMatT< T > &lu() const { return _lu; }
+  const std::vector< int > &perm() const { return _perm; }
+
+  /**
+   * A X = B を解く
+   * - X と B は同じ行列でもよい。
+   * @param[in] B N x K の右辺
+   * @param[out] X 解。空なら確保する。
+   * @return 0:成功、0以外:失敗（分解できていない）
+   */
+  int solve( const MyMatViewT< T > &B, MyMatT< T > &X ) const {
+    if( _info ) return -1;
+    int N = _lu.rows(), K = B.cols();
+    assert( B.rows() == N );
+    if( X.empty() ) X.resize( N, K );
+    else assert( X.rows() == N && X.cols() == K );
+
+    // 行の並べ替え（X と B が重なっている場合は、一旦作業領域にコピーする）
+    MyWorkspaceScope scope;
+    const MyMatViewT< T > *S = &B;
+    if( X.overlaps( B ) ){
+      MyMatT< T > &W = scope.workspace().mat< T >( N, K );
+      W = B;
+      S = &W;
+    }
+    for( int i = 0; i < N; i++ ){
+      for( int c = 0; c < K; c++ ) X( i, c ) = (*S)( _perm[ i ], c );
+    }
+
+    // 前進代入と後退代入
+    MyTrsmLower( _lu, X, true );
+    MyTrsmUpper( _lu, X, false );
+    return 0;
+  }
+
+  /**
+   * A x = b を解く
+   * - x と b は同じベクトルでもよい。
+   */
+  int solve( const std::vector< T > &b, std::vector< T > &x ) const {
+    int N = _lu.rows();
+    assert( b.size() == N );
+    if( x.empty() ) x.resize( N );
+    else assert( x.size() == N );
+    MyMatViewT< T > Bv( const_cast< T * >( &b[ 0 ] ), N, 1, 1 );
+    MyMatT< T > Xv( x, N, 1 );
+    return solve( Bv, Xv );
+  }
+
+  /**
+   * 行列式
+   */
+  T det() const {
+    if( _info ) return 0;
+    int N = _lu.rows();
+    T d = 1;
+    for( int i = 0; i < N; i++ ) d *= _lu( i, i );
+    // 並べ替えの符号（巡回置換の長さから偶奇を数える）
+    std::vector< char > done( N, 0 );
+    for( int i = 0; i < N; i++ ){
+      if( done[ i ] ) continue;
+      int len = 0;
+      for( int j = i; ! done[ j ]; j = _perm[ j ] ){
+        done[ j ] = 1;
+        len++;
+      }
+      if( len % 2 == 0 ) d = -d;
+    }//i
+    return d;
+  }
+};
+
+typedef MyLUFactorT< double > MyLUFactor;
+typedef MyLUFactorT< float > MyLUFactorf;
+
+/**
+ * 混合精度の LU 分解のオブジェクト（float で分解して、double の反復改良で解を仕上げる）
+ * - 分解（O(n^3)）は float の MyLUFactorf で行う。float の行列積（MyGemm()）は SIMD のレジスタ１本で倍の要素を扱い、メモリも半分なので、
+ *   double のほぼ倍の速さになる。ただし、パネルの分解や行の入れ替えは float でも速くならず、元の行列のコピーや反復改良の分もかかるので、
+ *   MyLUFactor で解くのと比べて n = 4000 で 1.45 倍、n = 2000 で 1.2 倍くらいの速さで、n = 1000 以下では変わらない（１スレッドで計測）。
+ * - solve() は、float の分解で解いたあと、残差 r = b - A x を double で計算し（MyGemm()）、
+ *   A d = r を float の分解で解いて x += d とすることを繰り返す（反復改良）。
+ *   条件数が 1 / float の精度（1E+7 くらい）より十分小さければ、数回で double の精度の解になる。
+ * - 残差が || x || || A || ε sqrt( n )（ε は double の精度、ノルムは最大値ノルム）を下回ったら収束。
+ *   残差が前回の半分より小さくならない（反復改良が効かない）か、max_itr 回で収束しなければ、
+ *   その solve() の中で double で分解し直して（MyLUFactor）解く。solve() は const で複数のスレッドから呼べるように、
+ *   この分解は持っておかない（毎回そうなるほど条件数が悪い行列なら、初めから MyLUFactor を使うこと）。
+ * - float に収まらない要素がある場合や、float で特異になった場合は、compute() で double で分解する（fallback()）。
+ * - 残差を計算するために、元の行列を double のまま持つ（メモリは元の行列１つ分と、その半分）。
+ * - 使い方は MyLUFactor と同じ。
+ *     MyLUFactorMixed lu( A );
+ *     if( ! lu.ok() ) ... // 特異
+ *     lu.solve( B, X );   // A X = B
+ */
+class MyLUFactorMixed
+{
+  MyMat _a;                 //!< 元の行列（残差の計算用）
+  MyLUFactorf _lu32;        //!< float の分解
+  MyLUFactor _lu64;         //!< double の分解（float で分解できなかったときに作る）
+  double _anorm;            //!< || A ||（最大値ノルム）
+  int _max_itr;             //!< 反復改良の最大回数
+  int _info;                //!< 0:分解済み、0以外:未分解または失敗
+
+ public:
+  MyLUFactorMixed() : _anorm( 0 ), _max_itr( 10 ), _info( -1 ) { }
+
+  /**
+   * 正方行列 A を分解する
+   */
+  explicit MyLUFactorMixed( const MyMatView &A, int max_itr = 10 ) : _anorm( 0 ), _max_itr( max_itr ), _info( -1 ) {
+    compute( A );
+  }
+
+  /**
+   * 正方行列 A を分解する（A は変更しない）
+   * @return 0:成功、0以外:失敗（特異）
+   */
+  int compute( const MyMatView &A ){
+    assert( MyMatIsSquare( A ) );
+    int N = A.rows();
+    _a = A;
+    _lu64 = MyLUFactor();
+    _anorm = 0;
+    bool fits = true;
+    for( int i = 0; i < N; i++ ){
+      double s = 0;
+      for( int j = 0; j < N; j++ ){
+        double a = MyAbs( _a( i, j ) );
+        s += a;
+        if( a > std::numeric_limits< float >::max() ) fits = false;
+      }//j
+      _anorm = MyMax( _anorm, s );
+    }//i
+
+    // float で分解する。できなければ double で
+    _info = -1;
+    if( fits ){
+      MyWorkspaceScope scope;
+      MyMatf &Af = scope.workspace().mat< float >( N, N );
+      MyMatConvertInto( _a, Af );
+      _info = _lu32.compute( Af );
+    }
+    if( _info ) _info = _lu64.compute( _a );
+    return _info;
+  }
+
+  // アクセサ
+  bool ok() const { return _info == 0; }
+  int size() const { return _a.rows(); }
+  /** float で分解できずに double で分解したかどうか */
+  bool fallback() const { return _lu64.ok(); }
+
+  /**
+   * A X = B を解く
+   * - X と B は同じ行列でもよい。
+   * @param[in] B N x K の右辺
+   * @param[out] X 解。空なら確保する。
+   * @param[out] itr 反復改良の回数（double の分解で解いた場合は -1）。不要なら 0 。
+   * @return 0:成功、0以外:失敗（分解できていない）
+   */
+  int solve( const MyMatView &B, MyMat &X, int *itr = 0 ) const {
+    if( itr ) *itr = -1;
+    if( _info ) return -1;
+    if( _lu64.ok() ) return _lu64.solve( B, X );
+    int N = _a.rows(), K = B.cols();
+    assert( B.rows() == N );
+    if( X.empty() ) X.resize( N, K );
+    else assert( X.rows() == N && X.cols() == K );
+
+    MyWorkspaceScope scope;
+    MyWorkspace &ws = scope.workspace();
+    MyMat &Bc = ws.mat( N, K ), &R = ws.mat( N, K );
+    MyMatf &Rf = ws.mat< float >( N, K ), &Df = ws.mat< float >( N, K );
+    std::vector< double > &scale = ws.vec( K );
+    Bc = B;
+
+    // 最初の解：float の分解で解く
+    MyMatConvertInto( Bc, Rf );
+    _lu32.solve( Rf, Df );
+    MyMatConvertInto( Df, X );
+
+    const double cte = _anorm * std::numeric_limits< double >::epsilon() * std::sqrt( (double)N );
+    double prev = 0;
+    for( int k = 0; k <= _max_itr; k++ ){
+      // r = b - A x（double）
+      R = Bc;
+      MyGemm( -1, _a, X, 1, R );
+
+      // 収束判定（列ごと）。残差を最大値で割って float に移す（float の範囲を外れないように）
+      bool done = true;
+      double rel = 0;
+      for( int c = 0; c < K; c++ ){
+        double rn = 0, xn = 0;
+        for( int i = 0; i < N; i++ ){
+          rn = MyMax( rn, MyAbs( R( i, c ) ) );
+          xn = MyMax( xn, MyAbs( X( i, c ) ) );
+        }//i
+        if( rn > xn * cte ) done = false;
+        rel = MyMax( rel, ( xn > 0 ) ? rn / xn : rn );
+        scale[ c ] = rn;
+      }//c
+      if( done ){
+        if( itr ) *itr = k;
+        return 0;
+      }
+      if( k == _max_itr || ( k > 0 && rel > 0.5 * prev ) ) break;
+      prev = rel;
+
+      // A d = r を float の分解で解いて、x += d
+      for( int i = 0; i < N; i++ ){
+        for( int c = 0; c < K; c++ ) Rf( i, c ) = ( scale[ c ] > 0 ) ? (float)( R( i, c ) / scale[ c ] ) : 0.0f;
+      }//i
+      _lu32.solve( Rf, Df );
+      for( int i = 0; i < N; i++ ){
+        for( int c = 0; c < K; c++ ) X( i, c ) += scale[ c ] * Df( i, c );
+      }//i
+    }//k
+
+    // 反復改良が効かない（条件数が大きい）ので、double で分解し直して解く（分解はこの呼び出しの中だけで使う）
+    MyLUFactor lu64( _a );
+    if( ! lu64.ok() ) return -1;
+    return lu64.solve( Bc, X );
+  }
+
+  /**
+   * A x = b を解く
+   * - x と b は同じベクトルでもよい。
+   */
+  int solve( const std::vector< double > &b, std::vector< double > &x, int *itr = 0 ) const {
+    int N = _a.rows();
+    assert( b.size() == N );
+    if( x.empty() ) x.resize( N );
+    else assert( x.size() == N );
+    MyMatView Bv( const_cast< double * >( &b[ 0 ] ), N, 1, 1 );
+    MyMat Xv( x, N, 1 );
+    return solve( Bv, Xv, itr );
+  }
+};
+
+/**
+ * 混合精度の LU 分解による連立一次方程式の計算（MyLUFactorMixed）
+ * - float で分解して、double の反復改良で double の精度の解を求める。反復改良が効かなければ double で解き直す。
+ * - MyAxbSolve_LU() と違って、A は書き換えない。
+ * @param[in] A 正方行列。
+ * @param[in,out] x 解。初期値は不要。メモリは確保済みでも確保済みでなくても可。
+ * @param[in] b 定数ベクトル。
+ * @return 0:成功、0以外:失敗（特異）
+ */
+inline
+int
+MyAxbSolve_LUMixed( const MyMatView &A,
+                    std::vector< double > &x,
+                    const std::vector< double > &b ){
+  MyLUFactorMixed lu( A );
+  if( ! lu.ok() ) return -1;
+  return lu.solve( b, x );
+}
+
+inline
+int
+MyAxbSolve_LUMixed( const std::vector< std::vector< double > > &A,
+                    std::vector< double > &x,
+                    const std::vector< double > &b ){
+  assert( A.size() > 0 );
+  assert( A[ 0 ].size() == A.size() );
+  MyWorkspaceScope scope;
+  MyMat &B = scope.workspace().mat( A.size(), A.size() );
+  B.set( A );
+  return MyAxbSolve_LUMixed( B, x, b );
+}
+
+/**
+ * コレスキー分解のオブジェクト
+ * - 対称正定値行列を A = L L^T と分解して（MyCholDecomp()）、L を持つ（上の部分はゼロ）。
+ * - A の対角から下だけを参照する。
+ * - solve() は MyLUFactorT と同じく、N x K の右辺をまとめて解ける。元の行列も右辺も書き換えない。
+ * - logdet() で log det A が求まる（ガウス分布の尤度などに使う。det A そのものはすぐに桁あふれする）。
+ * - T は要素の型。MyCholFactor（double）、MyCholFactorf（float）を使う。
+ */
+template < class T >
+class MyCholFactorT
+{
+  MyMatT< T > _l;  //!< 下三角行列 L
+  int _info;       //!< 0:分解済み、0以外:未分解または失敗
+
+ public:
+  MyCholFactorT() : _info( -1 ) { }
+
+  /**
+   * 対称正定値行列 A を分解する
+   */
+  explicit MyCholFactorT( const MyMatViewT< T > &A ) : _info( -1 ) {
+    compute( A );
+  }
+
+  /**
+   * 対称正定値行列 A を分解する（A は変更しない）
+   * @return 0:成功、0以外:失敗（正定値でない）
+   */
+  int compute( const MyMatViewT< T > &A ){
+    assert( MyMatIsSquare( A ) );
+    int N = A.rows();
+    _l = A;
+    _info = MyCholDecomp( _l );
+    for( int i = 0; i < N; i++ ){
+      for( int j = i + 1; j < N; j++ ) _l( i, j ) = 0;
+    }
+    return _info;
+  }
+
+  // アクセサ
+  bool ok() const { return _info == 0; }
+  int size() const { return _l.rows(); }
+  const MyMatT< T > &L() const { return _l; }
+
+  /**
+   * log det A = 2 Σ log L( i, i )
+   */
+  double logdet() const {
+    assert( _info == 0 );
+    double s = 0;
+    for( int i = 0; i < _l.rows(); i++ ) s += std::log( (double)_l( i, i ) );
+    return 2 * s;
+  }
+
+  /**
+   * A X = B を解く
+   * - X と B は同じ行列でもよい。
+   * @param[in] B N x K の右辺
+   * @param[out] X 解。空なら確保する。
+   * @return 0:成功、0以外:失敗（分解できていない）
+   */
+  int solve( const MyMatViewT< T > &B, MyMatT< T > &X ) const {
+    if( _info ) return -1;
+    int N = _l.rows(), K = B.cols();
+    assert( B.rows() == N );
+    if( X.empty() ) X.resize( N, K );
+    else assert( X.rows() == N && X.cols() == K );
+    X = B;
+    MyTrsmLower( _l, X, false );
+    MyTrsmUpper( _l.trans(), X, false );
+    return 0;
+  }
+
+  /**
+   * A x = b を解く
+   * - x と b は同じベクトルでもよい。
+   */
+  int solve( const std::vector< T > &b, std::vector< T > &x ) const {
+    int N = _l.rows();
+    assert( b.size() == N );
+    if( x.empty() ) x.resize( N );
+    else assert( x.size() == N );
+    MyMatViewT< T > Bv( const_cast< T * >( &b[ 0 ] ), N, 1, 1 );
+    MyMatT< T > Xv( x, N, 1 );
+    return solve( Bv, Xv );
+  }
+};
+
+typedef MyCholFactorT< double > MyCholFactor;
+typedef MyCholFactorT< float > MyCholFactorf;
+
+/**
+ * LDL^T 分解のオブジェクト
+ * - 対称行列を A = L D L^T と分解して（MyLDLDecomp()）、L と D を１つの行列にまとめて持つ（対角が D、上の部分はゼロ）。
+ * - 平方根を使わないので、正定値でない対称行列（鞍点問題など）も、D にゼロが出なければ解ける。
+ * - A の対角から下だけを参照する。元の行列も右辺も書き換えない。
+ * - T は要素の型。MyLDLFactor（double）、MyLDLFactorf（float）を使う。
+ */
+template < class T >
+class MyLDLFactorT
+{
+  MyMatT< T > _ld;  //!< 狭義下三角に L、対角に D
+  int _info;        //!< 0:分解済み、0以外:未分解または失敗
+
+ public:
+  MyLDLFactorT() : _info( -1 ) { }
+
+  /**
+   * 対称行列 A を分解する
+   */
+  explicit MyLDLFactorT( const MyMatViewT< T > &A ) : _info( -1 ) {
+    compute( A );
+  }
+
+  /**
+   * 対称行列 A を分解する（A は変更しない）
+   * @return 0:成功、0以外:失敗（D にゼロが出た）
+   */
+  int compute( const MyMatViewT< T > &A ){
+    assert( MyMatIsSquare( A ) );
+    int N = A.rows();
+    _ld = A;
+    _info = MyLDLDecomp( _ld );
+    for( int i = 0; i < N; i++ ){
+      for( int j = i + 1; j < N; j++ ) _ld( i, j ) = 0;
+    }
+    return _info;
+  }
+
+  // アクセサ
+  bool ok() const { return _info == 0; }
+  int size() const { return _ld.rows(); }
+  const MyMatT< T > &LD() const { return _ld; }
+
+  /**
+   * 正の固有値の個数（D の正の要素の個数と同じ。シルベスターの慣性法則）
+   */
+  int numPositive() const {
+    assert( _info == 0 );
+    int n = 0;
+    for( int i = 0; i < _ld.rows(); i++ ) if( _ld( i, i ) > 0 ) n++;
+    return n;
+  }
+
+  /**
+   * log |det A| = Σ log |D( i )|
+   * @param[out] sign det A の符号（不要なら 0）
+   */
+  double logdet( int *sign = 0 ) const {
+    assert( _info == 0 );
+    double s = 0;
+    int sg = 1;
+    for( int i = 0; i < _ld.rows(); i++ ){
+      T d = _ld( i, i );
+      if( d < 0 ) sg = -sg;
+      s += std::log( (double)MyAbs( d ) );
+    }
+    if( sign ) *sign = sg;
+    return s;
+  }
+
+  /**
+   * A X = B を解く
+   * - X と B は同じ行列でもよい。
+   * @param[in] B N x K の右辺
+   * @param[out] X 解。空なら確保する。
+   * @return 0:成功、0以外:失敗（分解できていない）
+   */
+  int solve( const MyMatViewT< T > &B, MyMatT< T > &X ) const {
+    if( _info ) return -1;
+    int N = _ld.rows(), K = B.cols();
+    assert( B.rows() == N );
+    if( X.empty() ) X.resize( N, K );
+    else assert( X.rows() == N && X.cols() == K );
+    X = B;
+    MyTrsmLower( _ld, X, true );
+    for( int i = 0; i < N; i++ ){
+      T d = _ld( i, i );
+      for( int c = 0; c < K; c++ ) X( i, c ) /= d;
+    }
+    MyTrsmUpper( _ld.trans(), X, true );
+    return 0;
+  }
+
+  /**
+   * A x = b を解く
+   * - x と b は同じベクトルでもよい。
+   */
+  int solve( const std::vector< T > &b, std::vector< T > &x ) const {
+    int N = _ld.rows();
+    assert( b.size() == N );
+    if( x.empty() ) x.resize( N );
+    else assert( x.size() == N );
+    MyMatViewT< T > Bv( const_cast< T * >( &b[ 0 ] ), N, 1, 1 );
+    MyMatT< T > Xv( x, N, 1 );
+    return solve( Bv, Xv );
+  }
+};
+
+typedef MyLDLFactorT< double > MyLDLFactor;
+typedef MyLDLFactorT< float > MyLDLFactorf;
+
+// ブロック版 QR 分解のパネルの列数
+#ifndef MY_QR_NB
+#define MY_QR_NB 32
+#endif
+
+/**
+ * QR 分解の R の対角から、ランク落ちしているかを判定する
+ * - | R( i, i ) | <= eps * max( M, N ) * max | R( i, j ) | となる対角があればランク落ちとする。
+ *   一次従属な列があっても、丸め誤差で R の対角がちょうどゼロになるとは限らないので、相対的な閾値で見る。
+ *   基準は R の対角だけでなく上三角全体の最大値にする（x^3 のように大きい列があると、丸め誤差はその列の大きさで決まる）。
+ * @param R M x N の行列の QR 分解（対角から上に R を持つ）
+ * @return true:ランク落ち
+ */
+template < class T >
+inline
+bool
+MyQRRankDeficient( const MyMatViewT< T > &R ){
+  int M = R.rows(), N = R.cols(), K = MyMin( M, N );
+  T rmax = 0;
+  for( int i = 0; i < K; i++ ){
+    for( int j = i; j < N; j++ ) rmax = MyMax( rmax, MyAbs( R( i, j ) ) );
+  }//i
+  T tol = std::numeric_limits< T >::epsilon() * MyMax( M, N ) * rmax;
+  for( int i = 0; i < K; i++ ){
+    if( !( MyAbs( R( i, i ) ) > tol ) ) return true;
+  }
+  return false;
+}
+
+/**
+ * QR 分解のオブジェクト
+ * - M x N の行列をハウスホルダー変換で A = QR と分解する（M < N でもよい。ハウスホルダー変換は K = min( M, N ) 個）。
+ * - R は対角から上に、ハウスホルダーベクトル（先頭の 1 は持たない）は対角より下に、まとめて持つ（LAPACK と同じ形）。
+ *   Q は作らずに、applyQt() で Q^T を、applyQ() で Q を掛ける。Q や R が必要なら getQ()、getR() で取り出す。
+ * - ブロック版：MY_QR_NB 列ずつのパネルに分けて、パネルの中はハウスホルダー変換を１本ずつ作り、
+ *   パネルの nb 本の変換をまとめて H_1 ... H_nb = I - V T V^T（compact WY 形式、T は nb x nb の上三角）の形にして、
+ *   右側の残りの列を MyGemm() で一度に更新する（計算のほとんどが行列積になり、複数のスレッドで計算される）。
+ *   T はパネルごとに持っておき、applyQt()、applyQ() も同じ形で行列積で掛ける。
+ * - solve() は、M > N なら最小二乗解（|| A X - B || を最小にする X）を求める。
+ *   正規方程式 A^T A X = A^T B を解くより、条件数が悪い場合に精度がよい。MyLeastSquares() も参照。
+ * - MyQRDecomp() もこれで計算する。
+ * - T は要素の型。MyQRFactor（double）、MyQRFactorf（float）を使う。
+ */
+template < class T >
+class MyQRFactorT
+{
+  MyMatT< T > _qr;          //!< R とハウスホルダーベクトル
+  std::vector< T > _tau;    //!< ハウスホルダー変換 H = I - tau v v^T の係数
+  MyMatT< T > _t;           //!< パネルごとの compact WY 形式の T（k 列目から始まるパネルの T は _t の k 列目から nb 列）
+  int _info;                //!< 0:分解済み、0以外:未分解
+
+  // k 列目から nb 本のハウスホルダーベクトルを、単位下台形の行列 V（( M - k ) x nb）として書き出す
+  void getV( int k, int nb, MyMatViewT< T > &V ) const {
+    int M = _qr.rows();
+    for( int i = 0; i < M - k; i++ ){
+      for( int j = 0; j < nb; j++ ) V( i, j ) = ( i > j ) ? _qr( k + i, k + j ) : ( i == j ) ? 1 : 0;
+    }//i
+  }
+
+  // k 列目から nb 本の変換を、B（M x K）の k 行目から下に掛ける。trans なら H_nb ... H_1 = I - V T^T V^T 、でなければ I - V T V^T
+  void applyBlock( int k, int nb, MyMatViewT< T > &B, bool trans ) const {
+    int M = _qr.rows(), K = B.cols();
+    MyWorkspaceScope scope;
+    MyMatT< T > &V = scope.workspace().mat< T >( M - k, nb );
+    MyMatT< T > &W = scope.workspace().mat< T >( nb, K );
+    MyMatT< T > &W2 = scope.workspace().mat< T >( nb, K );
+    getV( k, nb, V );
+    MyMatViewT< T > Bk = B.block( k, 0, M - k, K );
+    MyMatViewT< T > Tk = _t.block( 0, k, nb, nb );
+    MyGemm( 1, V.trans(), Bk, 0, W );
+    if( trans ) MyGemm( 1, Tk.trans(), W, 0, W2 );
+    else MyGemm( 1, Tk, W, 0, W2 );
+    MyGemm( -1, V, W2, 1, Bk );
+  }
+
+ public:
+  MyQRFactorT() : _info( -1 ) { }
+
+  /**
+   * M x N の行列 A を分解する
+   */
+  explicit MyQRFactorT( const MyMatViewT< T > &A ) : _info( -1 ) {
+    compute( A );
+  }
+
+  /**
+   * M x N の行列 A を分解する（A は変更しない）
+   * - ランク落ちしていても分解はできる（R の対角にゼロか、ほぼゼロが出る）。その場合は solve() が失敗する（MyQRRankDeficient()）。
+   * @return 0:成功
+   */
+  int compute( const MyMatViewT< T > &A ){
+    int M = A.rows(), N = A.cols(), K = MyMin( M, N );
+    assert( M > 0 && N > 0 );
+    _qr = A;
+    _tau.assign( K, 0 );
+    _t.resize( MyMin( MY_QR_NB, K ), K );
+    _t.fill( 0 );
+    MyWorkspaceScope scope;
+    T *w = scope.workspace().alloc< T >( MY_QR_NB );
+    for( int k0 = 0; k0 < K; k0 += MY_QR_NB ){
+      int nb = MyMin( MY_QR_NB, K - k0 );
+
+      // パネル（k0 行 k0 列目から ( M - k0 ) x nb）を連続領域にコピーして計算する
+      // （元の行列のままだと、行ごとに N 要素離れたところを読むので、縦長の行列ではキャッシュが効かない）
+      int mp = M - k0;
+      MyWorkspaceScope pscope;
+      MyMatT< T > &P = pscope.workspace().mat< T >( mp, nb );
+      P = _qr.block( k0, k0, mp, nb );
+
+      // (1) パネルの中を、ハウスホルダー変換１本ずつで分解する
+      for( int c = 0; c < nb; c++ ){
+        int k = k0 + c;
+        // c 列目の対角から下を ( beta, 0, ..., 0 ) に移すハウスホルダーベクトル
+        T s = 0;
+        for( int i = c; i < mp; i++ ) s += P( i, c ) * P( i, c );
+        if( s == 0 ) continue;
+        T nrm = std::sqrt( s );
+        T x0 = P( c, c );
+        T beta = ( x0 >= 0 ) ? -nrm : nrm;
+        T scale = 1 / ( x0 - beta );
+        for( int i = c + 1; i < mp; i++ ) P( i, c ) *= scale;
+        _tau[ k ] = ( beta - x0 ) / beta;
+        P( c, c ) = beta;
+
+        // パネルの右側の列に H を掛ける：w = v^T A、A -= tau v w
+        int n2 = nb - c - 1;
+        if( n2 == 0 ) continue;
+        for( int j = 0; j < n2; j++ ) w[ j ] = P( c, c + 1 + j );
+        for( int i = c + 1; i < mp; i++ ){
+          const T *pi = P[ i ];
+          T v = pi[ c ];
+          for( int j = 0; j < n2; j++ ) w[ j ] += v * pi[ c + 1 + j ];
+        }//i
+        T tau = _tau[ k ];
+        for( int j = 0; j < n2; j++ ) P( c, c + 1 + j ) -= tau * w[ j ];
+#ifdef _OPENMP
+        int nt = MyNumThreadsFor( 2.0 * ( mp - c - 1 ) * n2 );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+        for( int i = c + 1; i < mp; i++ ){
+          T *pi = P[ i ];
+          T tv = tau * pi[ c ];
+          for( int j = 0; j < n2; j++ ) pi[ c + 1 + j ] -= tv * w[ j ];
+        }//i
+      }//c
+
+      // (2) T を作る：T( 0:j, j ) = - tau_j T( 0:j, 0:j ) V( :, 0:j )^T v_j 、T( j, j ) = tau_j
+      for( int j = 0; j < nb; j++ ){
+        int kj = k0 + j;
+        T tau = _tau[ kj ];
+        _t( j, kj ) = tau;
+        if( tau == 0 || j == 0 ) continue;
+        // w = V( :, 0:j )^T v_j（v_j は j 行目が 1、それより上は 0）
+        for( int c = 0; c < j; c++ ) w[ c ] = P( j, c );
+        for( int i = j + 1; i < mp; i++ ){
+          const T *pi = P[ i ];
+          T vj = pi[ j ];
+          for( int c = 0; c < j; c++ ) w[ c ] += pi[ c ] * vj;
+        }//i
+        for( int r = 0; r < j; r++ ){
+          T z = 0;
+          for( int c = r; c < j; c++ ) z += _t( r, k0 + c ) * w[ c ];
+          _t( r, kj ) = - tau * z;
+        }//r
+      }//j
+      MyMatViewT< T > Ap = _qr.block( k0, k0, mp, nb );
+      Ap = P;
+
+      // (3) 右側の残りの列を、まとめて更新する：A2 <- ( I - V T^T V^T ) A2
+      if( k0 + nb < N ){
+        MyMatViewT< T > A2 = _qr.block( 0, k0 + nb, M, N - k0 - nb );
+        applyBlock( k0, nb, A2, true );
+      }
+    }//k0
+    _info = 0;
+    return _info;
+  }
+
+  // アクセサ
+  bool ok() const { return _info == 0; }
+  int rows() const { return _qr.rows(); }
+  int cols() const { return _qr.cols(); }
+  const MyMatT< T > &qr() const { return _qr; }
+  const std::vector< T > &tau() const { return _tau; }
+
+  /**
+   * B <- Q^T B
+   * @param[in,out] B M x K の行列
+   */
+  void applyQt( MyMatViewT< T > &B ) const {
+    int M = _qr.rows(), K = _tau.size();
+    assert( B.rows() == M );
+    for( int k0 = 0; k0 < K; k0 += MY_QR_NB ) applyBlock( k0, MyMin( MY_QR_NB, K - k0 ), B, true );
+  }
+
+  /**
+   * B <- Q B
+   * @param[in,out] B M x K の行列
+   */
+  void applyQ( MyMatViewT< T > &B ) const {
+    int M = _qr.rows(), K = _tau.size();
+    assert( B.rows() == M );
+    for( int k0 = ( K - 1 ) / MY_QR_NB * MY_QR_NB; k0 >= 0; k0 -= MY_QR_NB ) applyBlock( k0, MyMin( MY_QR_NB, K - k0 ), B, false );
+  }
+
+  /**
+   * Q の最初の K = min( M, N ) 列（M x K）を取り出す
+   */
+  void getQ( MyMatT< T > &Q ) const {
+    int M = _qr.rows(), K = _tau.size();
+    Q.resize( M, K );
+    Q.fill( 0 );
+    for( int i = 0; i < K; i++ ) Q( i, i ) = 1;
+    applyQ( Q );
+  }
+
+  /**
+   * R（K x N の上台形、K = min( M, N )）を取り出す
+   */
+  void getR( MyMatT< T > &R ) const {
+    int N = _qr.cols(), K = _tau.size();
+    R.resize( K, N );
+    for( int i = 0; i < K; i++ ){
+      for( int j = 0; j < N; j++ ) R( i, j ) = ( j >= i ) ? _qr( i, j ) : 0;
+    }//i
+  }
+
+  /**
+   * A X = B を解く（M > N なら最小二乗解）
+   * - M >= N であること。
+   * @param[in] B M x K の右辺
+   * @param[out] X N x K の解。空なら確保する。
+   * @return 0:成功、0以外:失敗（分解できていない、またはランク落ち）
+   */
+  int solve( const MyMatViewT< T > &B, MyMatT< T > &X ) const {
+    if( _info ) return -1;
+    int M = _qr.rows(), N = _qr.cols(), K = B.cols();
+    assert( B.rows() == M );
+    if( M < N ) return -1;
+    if( MyQRRankDeficient( _qr ) ) return -1;
+    if( X.empty() ) X.resize( N, K );
+    else assert( X.rows() == N && X.cols() == K );
+
+    MyWorkspaceScope scope;
+    MyMatT< T > &Y = scope.workspace().mat< T >( M, K );
+    Y = B;
+    applyQt( Y );
+    X = Y.block( 0, 0, N, K );
+    MyTrsmUpper( _qr.block( 0, 0, N, N ), X, false );
+    return 0;
+  }
+
+  /**
+   * A x = b を解く（M > N なら最小二乗解）
+   */
+  int solve( const std::vector< T > &b, std::vector< T > &x ) const {
+    int M = _qr.rows(), N = _qr.cols();
+    assert( b.size() == M );
+    if( x.empty() ) x.resize( N );
+    else assert( x.size() == N );
+    MyMatViewT< T > Bv( const_cast< T * >( &b[ 0 ] ), M, 1, 1 );
+    MyMatT< T > Xv( x, N, 1 );
+    return solve( Bv, Xv );
+  }
+};
+
+typedef MyQRFactorT< double > MyQRFactor;
+typedef MyQRFactorT< float > MyQRFactorf;
+
+/**
+ * 最小二乗法で連立一次方程式を解く
+ * - M x N（M >= N）の A に対して、|| A x - b || を最小にする x を求める。
+ * - ハウスホルダー変換の QR 分解（MyQRFactor）で解くので、正規方程式 A^T A x = A^T b を作らない。
+ *   正規方程式だと条件数が２乗になって、桁の大きく違う列（多項式の高次の項など）があると精度が落ちる。
+ * - A と b は変更しない。
+ * @return 0:成功、0以外:失敗（A の列が一次従属、または M < N）
+ */
+template < class T >
+inline
+int
+MyLeastSquares( const MyMatViewT< T > &A,
+                std::vector< T > &x,
+                const std::vector< T > &b ){
+  if( A.rows() < A.cols() ) return -1;
+  MyQRFactorT< T > qr( A );
+  return qr.solve( b, x );
+}
+
+/**
+ * 最小二乗法で連立一次方程式を解く
+ * - 右辺が複数（B の列ごと）の場合。X は N x K 。
+ */
+template < class T >
+inline
+int
+MyLeastSquares( const MyMatViewT< T > &A,
+                MyMatT< T > &X,
+                const MyMatViewT< T > &B ){
+  if( A.rows() < A.cols() ) return -1;
+  MyQRFactorT< T > qr( A );
+  return qr.solve( B, X );
+}
+
+/**
+ * 最小二乗法で連立一次方程式を解く
+ * - 内部では作業領域の MyMat にコピーして計算する。
+ */
+inline
+int
+MyLeastSquares( const std::vector< std::vector< double > > &A,
+                std::vector< double > &x,
+                const std::vector< double > &b ){
+  assert( A.size() > 0 );
+  MyWorkspaceScope scope;
+  MyMat &B = scope.workspace().mat( A.size(), A[ 0 ].size() );
+  B.set( A );
+  return MyLeastSquares( B, x, b );
+}
+
+/**
+ * 最小二乗法で連立一次方程式を解く（列の少ない行列向け）
+ * - M x N（M >= N）の A に対して、|| A x - b || を最小にする x を求める。
+ * - A と b をその場で書き換えて、ブロック化しないハウスホルダー変換の QR 分解で解く
+ *  （A は R とハウスホルダーベクトルに、b は Q^T b になる）。
+ * - メモリを確保しないので、作業領域に置いた行列で解けばヒープのメモリ確保はない。フィッティングの計画行列などに使う。
+ *   列が多い場合はブロック版の MyLeastSquares() の方が速い。
+ * @param[out] x N 要素
+ * @return 0:成功、0以外:失敗（A の列が一次従属、または M < N）
+ */
+template < class T >
+inline
+int
+MyLeastSquaresInPlace( MyMatViewT< T > &A,
+                       T *x,
+                       T *b ){
+  int M = A.rows(), N = A.cols();
+  if( M < N ) return -1;
+  for( int k = 0; k < N; k++ ){
+    // k 列目の対角から下を ( beta, 0, ..., 0 ) に移すハウスホルダーベクトル
+    T s = 0;
+    for( int i = k; i < M; i++ ) s += A( i, k ) * A( i, k );
+    if( s == 0 ) continue;
+    T nrm = std::sqrt( s );
+    T x0 = A( k, k );
+    T beta = ( x0 >= 0 ) ? -nrm : nrm;
+    T scale = 1 / ( x0 - beta );
+    for( int i = k + 1; i < M; i++ ) A( i, k ) *= scale;
+    T tau = ( beta - x0 ) / beta;
+    A( k, k ) = beta;
+
+    // 右側の列と b に H = I - tau v v^T を掛ける（v は k 行目が 1）
+    for( int j = k + 1; j < N; j++ ){
+      T w = A( k, j );
+      for( int i = k + 1; i < M; i++ ) w += A( i, k ) * A( i, j );
+      w *= tau;
+      A( k, j ) -= w;
+      for( int i = k + 1; i < M; i++ ) A( i, j ) -= w * A( i, k );
+    }//j
+    T w = b[ k ];
+    for( int i = k + 1; i < M; i++ ) w += A( i, k ) * b[ i ];
+    w *= tau;
+    b[ k ] -= w;
+    for( int i = k + 1; i < M; i++ ) b[ i ] -= w * A( i, k );
+  }//k
+  if( MyQRRankDeficient( A ) ) return -1;
+
+  // R x = Q^T b を後退代入で解く
+  for( int i = N - 1; i >= 0; i-- ){
+    T s = b[ i ];
+    for( int j = i + 1; j < N; j++ ) s -= A( i, j ) * x[ j ];
+    x[ i ] = s / A( i, i );
+  }//i
+  return 0;
+}
+
+/**
+ * 行列が対角優位かどうかのチェック
+ * - 対角優位：係数行列の各行について、対角成分の絶対値が非対角成分の絶対値の総和よりも大きいこと
+ * @return 対角優位:true, そうでない場合:false
+ */
+bool
+MyMatIsDiagDominant( const std::vector< std::vector< double > > &A ){
+  int N = A.size();
+  for( int i = 0; i < N; i++ ){
+    double sum = 0;
+    for( int j = 0; j < N; j++ ){
+      if( i != j ) sum += MyAbs( A[ i ][ j ] );
+    }
+    if( sum > MyAbs( A[ i ][ i ] ) ) return false;
+  }
+  return true;
+}
+
+/**
+ * 行列が対角優位かどうかのチェック
+ * - MyMat 版
+ */
+inline
+bool
+MyMatIsDiagDominant( const MyMatView &A ){
+  int N = A.rows();
+  for( int i = 0; i < N; i++ ){
+    double sum = 0;
+    for( int j = 0; j < N; j++ ){
+      if( i != j ) sum += MyAbs( A( i, j ) );
+    }
+    if( sum > MyAbs( A( i, i ) ) ) return false;
+  }
+  return true;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - Ax = b
+ * - ヤコビ反復法
+ * - 係数行列が以下のいずれかの条件を満たさないと収束しない
+ *   - 対角優位（係数行列の各行について対角成分の絶対値が非対角成分の絶対値の総和よりも大きい）
+ *   - 対称行列＆正値（固有値が全て正）
+ * - 計算量は、係数行列のサイズ n に対して、O(n^2)
+ * - 各行の計算は独立なので、行を分けて複数のスレッドで計算する。
+ *   x と作業ベクトルを交互に新しい値の書き込み先にする（ダブルバッファ）ので、反復ごとのコピーはない。
+ * @param A 係数行列。n x n の正方行列。
+ * @param[in,out] x 解ベクトル。初期値を入れておく or 初期値なしの空ベクトル。空の場合は初期値 0 。最後の反復の値が返る。
+ * @param thres 収束条件：解の変化量（ノルム）がこの値を下回ったら計算終了
+ * @param max_itr_num 収束条件：繰り返し計算の最大繰り返し回数。
+ * @param dout デバッグ情報の表示
+ */
+int
+MyAxbSolve_Jacobi( const std::vector< std::vector< double > > &A,
+                   std::vector< double > &x,
+                   const std::vector< double > &b,
+                   double thres = 1E-06,
+                   int max_itr_num = 100,
+                   std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.size();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A[ 0 ].size() == N );
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  // 収束するかどうかのチェック
+  // if( ! MyMatIsDiagDominant( A ) ) return -1;
+  
+  // 一時変数（作業領域から借りる）
+  MyWorkspaceScope scope;
+  vector< double > &x_next = scope.workspace().vec( N );
+  
+  if( dout ){
+    *dout << "--- MyAxbSolve_Jacobi() ---" << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+    
+  // 反復処理。x と x_next を交互に使う（ダブルバッファ。毎回のコピーはしない）
+  vector< double > *cur = &x, *nxt = &x_next;
+#ifdef _OPENMP
+  int nt = MyNumThreadsFor( 2.0 * N * N );
+#endif
+  for( int k = 0; k < max_itr_num; k++ ){
+    const vector< double > &xc = *cur;
+    vector< double > &xn = *nxt;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = 0; i < N; i++ ){
+      double s = b[ i ];
+      for( int j = 0; j < N; j++ ){
+        if( i != j ){
+          s -= A[ i ][ j ] * xc[ j ];
+        }
+      }//j
+      assert( A[ i ][ i ] != 0 );
+      xn[ i ] = s / A[ i ][ i ];
+    }//i
+
+    // 収束判定
+    double dx = MyVecNorm( xn - xc );
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << xn << " dx: " << dx << endl;
+    std::swap( cur, nxt );
+    if( dx < thres ) break;
+
+  }//k
+
+  // 最新の値が x_next の方に入っていれば、最後に１回だけコピーする
+  if( cur != &x ) x = *cur;
+  
+  return 0;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - ヤコビ反復法
+ * - MyMat 版
+ */
+template < class T >
+inline
+int
+MyAxbSolve_Jacobi( const MyMatViewT< T > &A,
+                   std::vector< T > &x,
+                   const std::vector< T > &b,
+                   double thres = 1E-06,
+                   int max_itr_num = 100,
+                   std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  // 一時変数（作業領域から借りる）
+  MyWorkspaceScope scope;
+  vector< T > &x_next = scope.workspace().vec< T >( N );
+
+  if( dout ){
+    *dout << "--- MyAxbSolve_Jacobi() ---" << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+
+  // 反復処理。x と x_next を交互に使う（ダブルバッファ。毎回のコピーはしない）
+  vector< T > *cur = &x, *nxt = &x_next;
+#ifdef _OPENMP
+  int nt = MyNumThreadsFor( 2.0 * N * N );
+#endif
+  for( int k = 0; k < max_itr_num; k++ ){
+    const vector< T > &xc = *cur;
+    vector< T > &xn = *nxt;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = 0; i < N; i++ ){
+      T s = b[ i ];
+      for( int j = 0; j < N; j++ ){
+        if( i != j ){
+          s -= A( i, j ) * xc[ j ];
+        }
+      }//j
+      assert( A( i, i ) != 0 );
+      xn[ i ] = s / A( i, i );
+    }//i
+
+    // 収束判定
+    double dx = MyVecNorm( xn - xc );
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << xn << " dx: " << dx << endl;
+    std::swap( cur, nxt );
+    if( dx < thres ) break;
+
+  }//k
+
+  // 最新の値が x_next の方に入っていれば、最後に１回だけコピーする
+  if( cur != &x ) x = *cur;
+
+  return 0;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - Ax = b
+ * - ガウスザイデルの反復法
+ * - 係数行列が以下のいずれかの条件を満たさないと収束しない
+ *   - 対角優位（係数行列の各行について対角成分の絶対値が非対角成分の絶対値の総和よりも大きい）
+ *   - 対称行列＆正値（固有値が全て正）
+ * - 計算量は、係数行列のサイズ n に対して、O(n^2)
+ * - ヤコビの反復法に比べて、内部で使うメモリの量が少ない＆収束が速い。
+ * - なので、基本的にはヤコビ反復法よりはこっちを使った方がよい。
+ * @param A 係数行列。n x n の正方行列。
+ * @param[in,out] x 解ベクトル。初期値を入れておく or 初期値なしの空ベクトル。空の場合は初期値 0 。
+ * @param thres 収束条件：解の変化量（各要素の変化量絶対値の総和）がこの値を下回ったら計算終了
+ * @param max_itr_num 収束条件：繰り返し計算の最大繰り返し回数。
+ * @param dout デバッグ情報の表示
+ */
+int
+MyAxbSolve_GaussSeidel( const std::vector< std::vector< double > > &A,
+                        std::vector< double > &x,
+                        const std::vector< double > &b,
+                        double thres = 1E-06,
+                        int max_itr_num = 100,
+                        std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.size();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A[ 0 ].size() == N );
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  // 収束するかどうかのチェック
+  // if( ! MyMatIsDiagDominant( A ) ) return -1;
+  
+  if( dout ){
+    *dout << "--- MyAxbSolve_GaussSeidel() ---" << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+    
+  // 反復処理
+  for( int k = 0; k < max_itr_num; k++ ){
+    double dx = 0; // 解の変化量計算（収束判定のため）
+    for( int i = 0; i < N; i++ ){
+      double x_old = x[ i ]; // 更新前の値を覚えておく（解の変化量計算のため）
+      x[ i ] = b[ i ];
+      for( int j = 0; j < N; j++ ){
+        if( j != i ) x[ i ] -= A[ i ][ j ] * x[ j ];
+      }//j
+      assert( A[ i ][ i ] != 0 );
+      x[ i ] /= A[ i ][ i ];
+      dx += MyAbs( x_old - x[ i ] );
+    }//i
+    // 収束判定
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x << " dx: " << dx << endl;
+    if( dx < thres ) break;
+
+  }//k
+  
+  return 0;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - ガウスザイデルの反復法
+ * - MyMat 版
+ */
+template < class T >
+inline
+int
+MyAxbSolve_GaussSeidel( const MyMatViewT< T > &A,
+                        std::vector< T > &x,
+                        const std::vector< T > &b,
+                        double thres = 1E-06,
+                        int max_itr_num = 100,
+                        std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  if( dout ){
+    *dout << "--- MyAxbSolve_GaussSeidel() ---" << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+
+  // 反復処理
+  for( int k = 0; k < max_itr_num; k++ ){
+    double dx = 0; // 解の変化量計算（収束判定のため）
+    for( int i = 0; i < N; i++ ){
+      T x_old = x[ i ]; // 更新前の値を覚えておく（解の変化量計算のため）
+      x[ i ] = b[ i ];
+      for( int j = 0; j < N; j++ ){
+        if( j != i ) x[ i ] -= A( i, j ) * x[ j ];
+      }//j
+      assert( A( i, i ) != 0 );
+      x[ i ] /= A( i, i );
+      dx += MyAbs( x_old - x[ i ] );
+    }//i
+    // 収束判定
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x << " dx: " << dx << endl;
+    if( dx < thres ) break;
+
+  }//k
+
+  return 0;
+}
+
+/**
+ * SOR 法の１回分の更新（密行列）
+ * - 行を順番に（backward なら逆順に）更新して、解の変化量（各要素の変化量絶対値の総和）を返す。
+ */
+template < class T >
+inline
+double
+MySORSweep( const MyMatViewT< T > &A,
+            std::vector< T > &x,
+            const std::vector< T > &b,
+            double omega,
+            bool backward ){
+  int N = A.rows();
+  double dx = 0;
+  for( int n = 0; n < N; n++ ){
+    int i = backward ? N - 1 - n : n;
+    T s = b[ i ];
+    for( int j = 0; j < N; j++ ){
+      if( j != i ) s -= A( i, j ) * x[ j ];
+    }//j
+    assert( A( i, i ) != 0 );
+    T xi = ( 1 - omega ) * x[ i ] + omega * s / A( i, i );
+    dx += MyAbs( xi - x[ i ] );
+    x[ i ] = xi;
+  }//n
+  return dx;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - Ax = b
+ * - SOR 法（逐次過緩和法）
+ * - ガウスザイデル法の更新量を ω 倍する：x_i <- ( 1 - ω ) x_i + ω ( b_i - Σ_{j≠i} a_ij x_j ) / a_ii
+ * - ω = 1 でガウスザイデル法と同じ。0 < ω < 2 であること。
+ *   格子状の問題など、ガウスザイデル法では何百回も反復が必要な問題でも、1 < ω < 2 の適当な値で反復回数が大きく減る
+ *   （最適な ω は問題による。格子が細かいほど 2 に近くなる）。
+ * - 係数行列が対称正定値なら、0 < ω < 2 で収束する。
+ * - MyMat 版
+ * @param A 係数行列。n x n の正方行列。
+ * @param[in,out] x 解ベクトル。初期値を入れておく or 初期値なしの空ベクトル。空の場合は初期値 0 。
+ * @param omega 緩和係数 ω
+ * @param thres 収束条件：解の変化量（各要素の変化量絶対値の総和）がこの値を下回ったら計算終了
+ * @param max_itr_num 収束条件：繰り返し計算の最大繰り返し回数。
+ * @param dout デバッグ情報の表示
+ */
+template < class T >
+inline
+int
+MyAxbSolve_SOR( const MyMatViewT< T > &A,
+                std::vector< T > &x,
+                const std::vector< T > &b,
+                double omega,
+                double thres = 1E-06,
+                int max_itr_num = 100,
+                std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  assert( omega > 0 && omega < 2 );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  if( dout ){
+    *dout << "--- MyAxbSolve_SOR() ---" << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+
+  // 反復処理
+  for( int k = 0; k < max_itr_num; k++ ){
+    double dx = MySORSweep( A, x, b, omega, false );
+    // 収束判定
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x << " dx: " << dx << endl;
+    if( dx < thres ) break;
+  }//k
+
+  return 0;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - Ax = b
+ * - SSOR 法（対称 SOR 法）
+ * - １回の反復で、SOR 法の前向きの更新と後ろ向きの更新を１回ずつ行う。
+ * - 反復の作用素が対称になるので、対称行列では SOR 法より ω の選び方に鈍感。CG 法の前処理（MyPrecondSSOR）にも使う形。
+ * - 引数は MyAxbSolve_SOR() と同じ。解の変化量は前向きと後ろ向きの合計。
+ * - MyMat 版
+ */
+template < class T >
+inline
+int
+MyAxbSolve_SSOR( const MyMatViewT< T > &A,
+                 std::vector< T > &x,
+                 const std::vector< T > &b,
+                 double omega,
+                 double thres = 1E-06,
+                 int max_itr_num = 100,
+                 std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  assert( omega > 0 && omega < 2 );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  if( dout ){
+    *dout << "--- MyAxbSolve_SSOR() ---" << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+
+  // 反復処理
+  for( int k = 0; k < max_itr_num; k++ ){
+    double dx = MySORSweep( A, x, b, omega, false );
+    dx += MySORSweep( A, x, b, omega, true );
+    // 収束判定
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x << " dx: " << dx << endl;
+    if( dx < thres ) break;
+  }//k
+
+  return 0;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - SOR 法
+ * - 内部では作業領域の MyMat にコピーして計算する。
+ */
+inline
+int
+MyAxbSolve_SOR( const std::vector< std::vector< double > > &A,
+                std::vector< double > &x,
+                const std::vector< double > &b,
+                double omega,
+                double thres = 1E-06,
+                int max_itr_num = 100,
+                std::ostream *dout = 0 ){
+  assert( A.size() > 0 );
+  MyWorkspaceScope scope;
+  MyMat &B = scope.workspace().mat( A.size(), A[ 0 ].size() );
+  B.set( A );
+  return MyAxbSolve_SOR( B, x, b, omega, thres, max_itr_num, dout );
+}
+
+/**
+ * 連立一次方程式を解く
+ * - SSOR 法
+ * - 内部では作業領域の MyMat にコピーして計算する。
+ */
+inline
+int
+MyAxbSolve_SSOR( const std::vector< std::vector< double > > &A,
+                 std::vector< double > &x,
+                 const std::vector< double > &b,
+                 double omega,
+                 double thres = 1E-06,
+                 int max_itr_num = 100,
+                 std::ostream *dout = 0 ){
+  assert( A.size() > 0 );
+  MyWorkspaceScope scope;
+  MyMat &B = scope.workspace().mat( A.size(), A[ 0 ].size() );
+  B.set( A );
+  return MyAxbSolve_SSOR( B, x, b, omega, thres, max_itr_num, dout );
+}
+
+/*
+ * --- 帯行列 ---
+ * - 対角の近くにしか非ゼロがない行列（三重対角、帯幅の小さい行列）を、O(n) のメモリと計算量で解く。
+ *   1 次元の平滑化、３次スプラインの係数、拡散方程式の陰解法などは三重対角になる。
+ * - MyAxbSolve_Tridiag()：三重対角行列（トーマス法。ピボット選択なし。優対角か正定値なら安定）。
+ *   MyBandMatT：帯行列（下に kl 本、上に ku 本の副対角）。
+ *   MyBandLUFactorT：部分ピボット選択つきの帯 LU 分解。O(n kl (kl + ku))。
+ *   MyBandCholFactorT：対称正定値の帯行列のコレスキー分解。O(n k^2)。
+ *   MyAxbSolve_TridiagBatch()：独立な三重対角行列の方程式をたくさんまとめて解く（系をまたいで SIMD のレーンに載せる）。
+ */
+
+/**
+ * 三重対角行列の連立一次方程式 A x = d（トーマス法）
+ * - A( i, i - 1 ) = a[ i ]、A( i, i ) = b[ i ]、A( i, i + 1 ) = c[ i ]（a[ 0 ] と c[ n - 1 ] は使わない）。
+ * - ピボット選択をしないので、優対角か正定値でないと精度が悪いことがある。その場合は MyBandLUFactorT を使う。
+ * - ピボット p_i = b[ i ] - a[ i ] c'[ i - 1 ] が、その行の大きさに比べて小さい
+ *  （|p_i| <= eps ( |a[ i ]| + |b[ i ]| + |c[ i ]| )）と、解の精度が保てないので失敗にする（MyAxbSolve_TridiagBatch() と同じ判定）。
+ * - T は要素の型（double, float）。
+ * @param[out] x 解。空なら確保する。d と同じベクトルでもよい。
+ * @param eps ピボットを小さすぎるとみなす相対的な大きさ
+ * @return 0:成功、-1:ピボットが小さすぎた
+ */
+template < class T >
+inline
+int
+MyAxbSolve_Tridiag( const std::vector< T > &a,
+                    const std::vector< T > &b,
+                    const std::vector< T > &c,
+                    std::vector< T > &x,
+                    const std::vector< T > &d,
+                    double eps = MY_BATCH_SINGULAR_EPS ){
+  int n = b.size();
+  assert( n > 0 && a.size() == n && c.size() == n && d.size() == n );
+  if( x.empty() ) x.resize( n );
+  else assert( x.size() == n );
+  MyWorkspaceScope scope;
+  T *cp = scope.workspace().alloc< T >( n );
+
+  // 前進消去：c'[ i ] = c[ i ] / p、x[ i ] = ( d[ i ] - a[ i ] x[ i - 1 ] ) / p（p = b[ i ] - a[ i ] c'[ i - 1 ]）
+  T p = b[ 0 ];
+  T s = MyAbs( b[ 0 ] ) + ( n > 1 ? MyAbs( c[ 0 ] ) : 0 );
+  if( !( MyAbs( p ) > eps * s ) ) return -1;
+  cp[ 0 ] = c[ 0 ] / p;
+  x[ 0 ] = d[ 0 ] / p;
+  for( int i = 1; i < n; i++ ){
+    p = b[ i ] - a[ i ] * cp[ i - 1 ];
+    s = MyAbs( a[ i ] ) + MyAbs( b[ i ] ) + ( i < n - 1 ? MyAbs( c[ i ] ) : 0 );
+    if( !( MyAbs( p ) > eps * s ) ) return -1;
+    cp[ i ] = c[ i ] / p;
+    x[ i ] = ( d[ i ] - a[ i ] * x[ i - 1 ] ) / p;
+  }//i
+
+  // 後退代入
+  for( int i = n - 2; i >= 0; i-- ) x[ i ] -= cp[ i ] * x[ i + 1 ];
+  return 0;
+}
+
+/**
+ * 帯行列
+ * - n x n で、下に kl 本、上に ku 本の副対角を持つ（|i - j| がそれより大きい要素はゼロ）。
+ * - 行ごとに帯の部分だけを持つ：n x ( kl + ku + 1 ) の MyMat の i 行目の j - i + kl 番目が (i,j) 要素。
+ * - 帯の外の要素は、読むとゼロ、書くことはできない。
+ * - T は要素の型。MyBandMat（double）、MyBandMatf（float）を使う。
+ */
+template < class T >
+class MyBandMatT
+{
+  MyMatT< T > _d; //!< 帯の部分（n x ( kl + ku + 1 )）
+  int _kl;        //!< 下の副対角の本数
+  int _ku;        //!< 上の副対角の本数
+
+ public:
+  MyBandMatT() : _kl( 0 ), _ku( 0 ) { }
+
+  /**
+   * n x n のゼロ行列
+   */
+  MyBandMatT( int n, int kl, int ku ) : _d( n, kl + ku + 1, 0 ), _kl( kl ), _ku( ku ) {
+    assert( kl >= 0 && ku >= 0 );
+  }
+
+  /**
+   * 密行列の帯の部分を取り出す（帯の外は無視する）
+   */
+  MyBandMatT( const MyMatViewT< T > &A, int kl, int ku ) : _d( A.rows(), kl + ku + 1, 0 ), _kl( kl ), _ku( ku ) {
+    assert( MyMatIsSquare( A ) );
+    int n = A.rows();
+    for( int i = 0; i < n; i++ ){
+      for( int j = MyMax( 0, i - kl ); j <= MyMin( n - 1, i + ku ); j++ ) _d( i, j - i + kl ) = A( i, j );
+    }//i
+  }
+
+  // アクセサ
+  int rows() const { return _d.rows(); }
+  int cols() const { return _d.rows(); }
+  int kl() const { return _kl; }
+  int ku() const { return _ku; }
+  bool inBand( int i, int j ) const { return j - i <= _ku && i - j <= _kl; }
+  T & operator () ( int i, int j ){ assert( inBand( i, j ) ); return _d( i, j - i + _kl ); }
+  T operator () ( int i, int j ) const { return inBand( i, j ) ? _d( i, j - i + _kl ) : T( 0 ); }
+  /** 帯の部分（n x ( kl + ku + 1 )） */
+  const MyMatT< T > &band() const { return _d; }
+
+  /**
+   * y = A x
+   * - 行数が多ければ複数のスレッドで計算する。
+   */
+  void multiply( const std::vector< T > &x, std::vector< T > &y ) const {
+    int n = rows();
+    assert( x.size() == n );
+    if( y.empty() ) y.resize( n );
+    else assert( y.size() == n );
+    assert( &x != &y );
+#ifdef _OPENMP
+    int nt = MyNumThreadsFor( 2.0 * n * ( _kl + _ku + 1 ) );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = 0; i < n; i++ ){
+      int j0 = MyMax( 0, i - _kl ), j1 = MyMin( n - 1, i + _ku );
+      const T *ai = _d[ i ] + _kl - i;
+      T s = 0;
+      for( int j = j0; j <= j1; j++ ) s += ai[ j ] * x[ j ];
+      y[ i ] = s;
+    }//i
+  }
+
+  /**
+   * 密行列に変換
+   */
+  void toDense( MyMatT< T > &A ) const {
+    int n = rows();
+    A.resize( n, n );
+    A.fill( 0 );
+    for( int i = 0; i < n; i++ ){
+      for( int j = MyMax( 0, i - _kl ); j <= MyMin( n - 1, i + _ku ); j++ ) A( i, j ) = (*this)( i, j );
+    }//i
+  }
+};
+
+typedef MyBandMatT< double > MyBandMat;
+typedef MyBandMatT< float > MyBandMatf;
+
+/**
+ * 帯行列の LU 分解のオブジェクト（部分ピボット選択つき）
+ * - 行を入れ替えると U の帯は上に kl 本広がるので、U は上に kl + ku 本の副対角を持つ。
+ * - 計算量は O(n kl (kl + ku))、メモリは n ( 2 kl + ku + 1 ) + n kl 。
+ * - 使い方は MyLUFactor と同じ（solve() で何度でも解ける。右辺は N x K の行列でまとめて渡してもよい）。
+ * - T は要素の型。MyBandLUFactor（double）、MyBandLUFactorf（float）を使う。
+ */
+template < class T >
+class MyBandLUFactorT
+{
+  MyMatT< T > _u;            //!< U（i 行目の j - i 番目が U( i, j )、j = i, ..., i + kl + ku）
+  MyMatT< T > _l;            //!< L の乗数（k 行目の r 番目が L( k + 1 + r, k )）
+  std::vector< int > _perm;  //!< k 番目の消去で k 行目と入れ替えた行
+  int _kl;                   //!< 下の副対角の本数
+  int _info;                 //!< 0:分解済み、0以外:未分解または失敗
+
+ public:
+  MyBandLUFactorT() : _kl( 0 ), _info( -1 ) { }
+
+  /**
+   * 帯行列 A を分解する
+   */
+  explicit MyBandLUFactorT( const MyBandMatT< T > &A ) : _kl( 0 ), _info( -1 ) {
+    compute( A );
+  }
+
+  /**
+   * 帯行列 A を分解する（A は変更しない）
+   * @return 0:成功、0以外:失敗（特異）
+   */
+  int compute( const MyBandMatT< T > &A ){
+    int n = A.rows(), kl = A.kl(), ku = A.ku(), w = kl + ku + 1;
+    _kl = kl;
+    _perm.resize( n );
+    _l.resize( n, MyMax( kl, 1 ) );
+    _l.fill( 0 );
+
+    // 作業用の帯：i 行目に i - kl 列から i + kl + ku 列まで（W( i, j - i + kl )）
+    MyWorkspaceScope scope;
+    MyMatT< T > &W = scope.workspace().mat< T >( n, kl + w );
+    W.fill( 0 );
+    for( int i = 0; i < n; i++ ){
+      for( int j = MyMax( 0, i - kl ); j <= MyMin( n - 1, i + ku ); j++ ) W( i, j - i + kl ) = A( i, j );
+    }//i
+
+    _info = -1;
+    for( int k = 0; k < n; k++ ){
+      int r1 = MyMin( n - 1, k + kl ), j1 = MyMin( n - 1, k + kl + ku );
+
+      // ピボット：k 列目の k 行目から r1 行目で絶対値が最大のもの
+      int p = k;
+      T pmax = MyAbs( W( k, kl ) );
+      for( int r = k + 1; r <= r1; r++ ){
+        T v = MyAbs( W( r, k - r + kl ) );
+        if( v > pmax ){
+          pmax = v;
+          p = r;
+        }
+      }//r
+      if( pmax == 0 ) return _info;
+      _perm[ k ] = p;
+      if( p != k ){
+        for( int j = k; j <= j1; j++ ) std::swap( W( k, j - k + kl ), W( p, j - p + kl ) );
+      }
+
+      // 消去
+      T *wk = W[ k ] + kl - k;
+      T inv = 1 / wk[ k ];
+      for( int r = k + 1; r <= r1; r++ ){
+        T *wr = W[ r ] + kl - r;
+        T l = wr[ k ] * inv;
+        _l( k, r - k - 1 ) = l;
+        if( l == 0 ) continue;
+        for( int j = k + 1; j <= j1; j++ ) wr[ j ] -= l * wk[ j ];
+      }//r
+    }//k
+
+    // U を取り出す
+    _u.resize( n, kl + ku + 1 );
+    for( int i = 0; i < n; i++ ){
+      for( int q = 0; q <= kl + ku; q++ ) _u( i, q ) = W( i, q + kl );
+    }//i
+    _info = 0;
+    return _info;
+  }
+
+  // アクセサ
+  bool ok() const { return _info == 0; }
+  int size() const { return _u.rows(); }
+
+  /**
+   * A X = B を解く
+   * - X と B は同じ行列でもよい。
+   * @param[in] B N x K の右辺
+   * @param[out] X 解。空なら確保する。
+   * @return 0:成功、0以外:失敗（分解できていない）
+   */
+  int solve( const MyMatViewT< T > &B, MyMatT< T > &X ) const {
+    if( _info ) return -1;
+    int n = _u.rows(), K = B.cols(), w = _u.cols();
+    assert( B.rows() == n );
+    if( X.empty() ) X.resize( n, K );
+    else assert( X.rows() == n && X.cols() == K );
+    if( ! X.overlaps( B ) ) X = B;
+    else if( X.data() != B.data() ){
+      MyWorkspaceScope scope;
+      MyMatT< T > &S = scope.workspace().mat< T >( n, K );
+      S = B;
+      X = S;
+    }
+
+    // 行の入れ替えと L
+    for( int k = 0; k < n; k++ ){
+      T *xk = X[ k ];
+      if( _perm[ k ] != k ){
+        T *xp = X[ _perm[ k ] ];
+        for( int c = 0; c < K; c++ ) std::swap( xk[ c ], xp[ c ] );
+      }
+      int r1 = MyMin( n - 1, k + _kl );
+      for( int r = k + 1; r <= r1; r++ ){
+        T l = _l( k, r - k - 1 );
+        if( l == 0 ) continue;
+        T *xr = X[ r ];
+        for( int c = 0; c < K; c++ ) xr[ c ] -= l * xk[ c ];
+      }//r
+    }//k
+
+    // U
+    for( int i = n - 1; i >= 0; i-- ){
+      T *xi = X[ i ];
+      const T *ui = _u[ i ] - i;
+      int j1 = MyMin( n - 1, i + w - 1 );
+      for( int j = i + 1; j <= j1; j++ ){
+        T u = ui[ j ];
+        const T *xj = X[ j ];
+        for( int c = 0; c < K; c++ ) xi[ c ] -= u * xj[ c ];
+      }//j
+      T inv = 1 / ui[ i ];
+      for( int c = 0; c < K; c++ ) xi[ c ] *= inv;
+    }//i
+    return 0;
+  }
+
+  /**
+   * A x = b を解く
+   * - x と b は同じベクトルでもよい。
+   */
+  int solve( const std::vector< T > &b, std::vector< T > &x ) const {
+    int n = _u.rows();
+    assert( b.size() == n );
+    if( x.empty() ) x.resize( n );
+    else assert( x.size() == n );
+    MyMatViewT< T > Bv( const_cast< T * >( &b[ 0 ] ), n, 1, 1 );
+    MyMatT< T > Xv( x, n, 1 );
+    return solve( Bv, Xv );
+  }
+};
+
+typedef MyBandLUFactorT< double > MyBandLUFactor;
+typedef MyBandLUFactorT< float > MyBandLUFactorf;
+
+/**
+ * 対称正定値の帯行列のコレスキー分解のオブジェクト
+ * - A = L L^T 。A の対角から下の kl 本だけを参照する（ku は見ない）。L は下に kl 本の副対角を持つ。
+ * - 計算量は O(n kl^2)。ピボット選択が要らないので、帯 LU 分解の半分くらい。
+ * - 使い方は MyCholFactor と同じ。
+ * - T は要素の型。MyBandCholFactor（double）、MyBandCholFactorf（float）を使う。
+ */
+template < class T >
+class MyBandCholFactorT
+{
+  MyMatT< T > _l;  //!< L（i 行目の j - i + k 番目が L( i, j )、j = i - k, ..., i）
+  int _k;          //!< 帯幅
+  int _info;       //!< 0:分解済み、0以外:未分解または失敗
+
+ public:
+  MyBandCholFactorT() : _k( 0 ), _info( -1 ) { }
+
+  /**
+   * 帯行列 A を分解する
+   */
+  explicit MyBandCholFactorT( const MyBandMatT< T > &A ) : _k( 0 ), _info( -1 ) {
+    compute( A );
+  }
+
+  /**
+   * 帯行列 A を分解する（A は変更しない）
+   * @return 0:成功、0以外:失敗（正定値でない）
+   */
+  int compute( const MyBandMatT< T > &A ){
+    int n = A.rows(), k = A.kl();
+    _k = k;
+    _l.resize( n, k + 1 );
+    _l.fill( 0 );
+    _info = -1;
+    for( int i = 0; i < n; i++ ){
+      T *li = _l[ i ] + k - i;
+      int j0 = MyMax( 0, i - k );
+      for( int j = j0; j <= i; j++ ){
+        const T *lj = _l[ j ] + k - j;
+        T s = A( i, j );
+        for( int p = MyMax( j0, j - k ); p < j; p++ ) s -= li[ p ] * lj[ p ];
+        if( j < i ){
+          li[ j ] = s / lj[ j ];
+        }
+        else{
+          if( !( s > 0 ) ) return _info;
+          li[ i ] = std::sqrt( s );
+        }
+      }//j
+    }//i
+    _info = 0;
+    return _info;
+  }
+
+  // アクセサ
+  bool ok() const { return _info == 0; }
+  int size() const { return _l.rows(); }
+
+  /**
+   * A X = B を解く
+   * - X と B は同じ行列でもよい。
+   * @param[in] B N x K の右辺
+   * @param[out] X 解。空なら確保する。
+   * @return 0:成功、0以外:失敗（分解できていない）
+   */
+  int solve( const MyMatViewT< T > &B, MyMatT< T > &X ) const {
+    if( _info ) return -1;
+    int n = _l.rows(), K = B.cols(), k = _k;
+    assert( B.rows() == n );
+    if( X.empty() ) X.resize( n, K );
+    else assert( X.rows() == n && X.cols() == K );
+    if( ! X.overlaps( B ) ) X = B;
+    else if( X.data() != B.data() ){
+      MyWorkspaceScope scope;
+      MyMatT< T > &S = scope.workspace().mat< T >( n, K );
+      S = B;
+      X = S;
+    }
+
+    // L Y = B
+    for( int i = 0; i < n; i++ ){
+      T *xi = X[ i ];
+      const T *li = _l[ i ] + k - i;
+      for( int j = MyMax( 0, i - k ); j < i; j++ ){
+        T l = li[ j ];
+        const T *xj = X[ j ];
+        for( int c = 0; c < K; c++ ) xi[ c ] -= l * xj[ c ];
+      }//j
+      T inv = 1 / li[ i ];
+      for( int c = 0; c < K; c++ ) xi[ c ] *= inv;
+    }//i
+
+    // L^T X = Y
+    for( int i = n - 1; i >= 0; i-- ){
+      T *xi = X[ i ];
+      const T *li = _l[ i ] + k - i;
+      T inv = 1 / li[ i ];
+      for( int c = 0; c < K; c++ ) xi[ c ] *= inv;
+      for( int j = MyMax( 0, i - k ); j < i; j++ ){
+        T l = li[ j ];
+        T *xj = X[ j ];
+        for( int c = 0; c < K; c++ ) xj[ c ] -= l * xi[ c ];
+      }//j
+    }//i
+    return 0;
+  }
+
+  /**
+   * A x = b を解く
+   * - x と b は同じベクトルでもよい。
+   */
+  int solve( const std::vector< T > &b, std::vector< T > &x ) const {
+    int n = _l.rows();
+    assert( b.size() == n );
+    if( x.empty() ) x.resize( n );
+    else assert( x.size() == n );
+    MyMatViewT< T > Bv( const_cast< T * >( &b[ 0 ] ), n, 1, 1 );
+    MyMatT< T > Xv( x, n, 1 );
+    return solve( Bv, Xv );
+  }
+};
+
+typedef MyBandCholFactorT< double > MyBandCholFactor;
+typedef MyBandCholFactorT< float > MyBandCholFactorf;
+
+/**
+ * 帯行列の連立一次方程式 A x = b（部分ピボット選択つきの帯 LU 分解）
+ * @return 0:成功、0以外:失敗（特異）
+ */
+template < class T >
+inline
+int
+MyAxbSolve_Band( const MyBandMatT< T > &A, std::vector< T > &x, const std::vector< T > &b ){
+  MyBandLUFactorT< T > lu( A );
+  if( ! lu.ok() ) return -1;
+  return lu.solve( b, x );
+}
+
+/**
+ * 対称正定値の帯行列の連立一次方程式 A x = b（帯コレスキー分解）
+ * @return 0:成功、0以外:失敗（正定値でない）
+ */
+template < class T >
+inline
+int
+MyAxbSolve_BandChol( const MyBandMatT< T > &A, std::vector< T > &x, const std::vector< T > &b ){
+  MyBandCholFactorT< T > chol( A );
+  if( ! chol.ok() ) return -1;
+  return chol.solve( b, x );
+}
+
+/*
+ * 三重対角行列のバッチ計算
+ * - m 個の独立な n x n の三重対角行列の方程式を、まとめてトーマス法で解く。
+ * - 係数と右辺は n x m の MyMat で渡す。j 列目が j 番目の系（( i, j ) が j 番目の系の i 番目の式）。
+ *   隣り合う系が連続して並ぶので（MyMatBatchN と同じ SoA 形式）、系をまたいで SIMD のレーンに載せて計算できる
+ *   （AVX-512 なら 8 個、AVX2 なら 4 個ずつ）。
+ *   画像の列ごとの方程式（拡散方程式の陰解法の縦方向など）は、画像をそのまま渡せばよい。
+ *   行ごとの方程式は、転置してから渡す（MyMatTransInto()）。
+ * - ピボットが小さすぎる系（MyAxbSolve_Tridiag() と同じ相対的な判定）があっても止まらない。
+ *   系ごとのフラグ（singular）に記録して、解はゼロにする。
+ */
+
+/**
+ * 三重対角バッチのトーマス法の１ステップ（前進消去）
+ * - cp, xp は１つ前の式の c'、x' 。p はピボット。
+ * - |p| <= eps ( |a| + |b| + |c| )（NaN も含む）なら fail を 1 にする。
+ * - V は double でも SIMD のベクトル型でもよい（MyBatchKernel と同じ）。
+ */
+template < class V >
+MY_ALWAYS_INLINE
+void
+MyTridiagBatchForward( V a, V b, V c, V d, double eps, V &cp, V &xp, V &fail ){
+  V p = b - a * cp;
+  V pa = ( p > -p ) ? p : -p;
+  V s = ( ( a > -a ) ? a : -a ) + ( ( b > -b ) ? b : -b ) + ( ( c > -c ) ? c : -c );
+  fail = ( pa > eps * s ) ? fail : 1.0;
+  V inv = 1.0 / p;
+  cp = c * inv;
+  xp = ( d - a * xp ) * inv;
+}
+
+/**
+ * 三重対角バッチの駆動部分
+ * - ポータブル版。k0 番目から k1 番目の手前までの系を１個ずつ解く。
+ * - cpw は c' の作業領域（n 個）。ピボットが小さすぎた系は singular を 1 に、そうでなければ 0 にする。
+ */
+inline
+void
+MyTridiagBatchRun_Ref( const MyMat &A, const MyMat &B, const MyMat &C, const MyMat &D, MyMat &X,
+                       int k0, int k1, double *cpw, double eps, unsigned char *singular ){
+  int n = B.rows();
+  for( int k = k0; k < k1; k++ ){
+    double cp = 0, xp = 0, fail = 0;
+    for( int i = 0; i < n; i++ ){
+      MyTridiagBatchForward( i > 0 ? A( i, k ) : 0.0, B( i, k ), i < n - 1 ? C( i, k ) : 0.0, D( i, k ), eps, cp, xp, fail );
+      cpw[ i ] = cp;
+      X( i, k ) = xp;
+    }//i
+    for( int i = n - 2; i >= 0; i-- ) X( i, k ) -= cpw[ i ] * X( i + 1, k );
+    singular[ k ] = ( fail != 0 );
+  }//k
+}
+
+#if defined( MY_USE_AVX2 ) && defined( __GNUC__ )
+/**
+ * 三重対角バッチの駆動部分
+ * - AVX2 版。４個ずつ解く。端数はポータブル版で解く。cpw は 4n 個。
+ */
+MY_TARGET_AVX2
+inline
+void
+MyTridiagBatchRun_AVX2( const MyMat &A, const MyMat &B, const MyMat &C, const MyMat &D, MyMat &X,
+                        int k0, int k1, double *cpw, double eps, unsigned char *singular ){
+  int n = B.rows();
+  int k = k0;
+  for( ; k + 4 <= k1; k += 4 ){
+    __m256d cp = _mm256_setzero_pd(), xp = _mm256_setzero_pd(), zero = _mm256_setzero_pd(), fail = zero;
+    for( int i = 0; i < n; i++ ){
+      __m256d a = ( i > 0 ) ? _mm256_loadu_pd( A[ i ] + k ) : zero;
+      __m256d c = ( i < n - 1 ) ? _mm256_loadu_pd( C[ i ] + k ) : zero;
+      MyTridiagBatchForward( a, _mm256_loadu_pd( B[ i ] + k ), c, _mm256_loadu_pd( D[ i ] + k ), eps, cp, xp, fail );
+      _mm256_storeu_pd( cpw + 4 * i, cp );
+      _mm256_storeu_pd( X[ i ] + k, xp );
+    }//i
+    __m256d xn = xp;
+    for( int i = n - 2; i >= 0; i-- ){
+      xn = _mm256_loadu_pd( X[ i ] + k ) - _mm256_loadu_pd( cpw + 4 * i ) * xn;
+      _mm256_storeu_pd( X[ i ] + k, xn );
+    }//i
+    double f[ 4 ];
+    _mm256_storeu_pd( f, fail );
+    for( int l = 0; l < 4; l++ ) singular[ k + l ] = ( f[ l ] != 0 );
+  }//k
+  MyTridiagBatchRun_Ref( A, B, C, D, X, k, k1, cpw, eps, singular );
+}
+#endif
+
+#if defined( MY_USE_AVX512 ) && defined( __GNUC__ )
+/**
+ * 三重対角バッチの駆動部分
+ * - AVX-512 版。８個ずつ解く。端数はポータブル版で解く。cpw は 8n 個。
+ */
+MY_TARGET_AVX512
+inline
+void
+MyTridiagBatchRun_AVX512( const MyMat &A, const MyMat &B, const MyMat &C, const MyMat &D, MyMat &X,
+                          int k0, int k1, double *cpw, double eps, unsigned char *singular ){
+  int n = B.rows();
+  int k = k0;
+  for( ; k + 8 <= k1; k += 8 ){
+    __m512d cp = _mm512_setzero_pd(), xp = _mm512_setzero_pd(), zero = _mm512_setzero_pd(), fail = zero;
+    for( int i = 0; i < n; i++ ){
+      __m512d a = ( i > 0 ) ? _mm512_loadu_pd( A[ i ] + k ) : zero;
+      __m512d c = ( i < n - 1 ) ? _mm512_loadu_pd( C[ i ] + k ) : zero;
+      MyTridiagBatchForward( a, _mm512_loadu_pd( B[ i ] + k ), c, _mm512_loadu_pd( D[ i ] + k ), eps, cp, xp, fail );
+      _mm512_storeu_pd( cpw + 8 * i, cp );
+      _mm512_storeu_pd( X[ i ] + k, xp );
+    }//i
+    __m512d xn = xp;
+    for( int i = n - 2; i >= 0; i-- ){
+      xn = _mm512_loadu_pd( X[ i ] + k ) - _mm512_loadu_pd( cpw + 8 * i ) * xn;
+      _mm512_storeu_pd( X[ i ] + k, xn );
+    }//i
+    double f[ 8 ];
+    _mm512_storeu_pd( f, fail );
+    for( int l = 0; l < 8; l++ ) singular[ k + l ] = ( f[ l ] != 0 );
+  }//k
+  MyTridiagBatchRun_Ref( A, B, C, D, X, k, k1, cpw, eps, singular );
+}
+#endif
+
+/**
+ * 三重対角行列の連立一次方程式のバッチ計算（トーマス法）
+ * - m 個の系 A_j x_j = d_j をまとめて解く。A_j( i, i - 1 ) = A( i, j )、A_j( i, i ) = B( i, j )、A_j( i, i + 1 ) = C( i, j )
+ *   （A の 0 行目と C の n - 1 行目は使わない）。右辺 D と解 X も j 列目が j 番目の系。
+ * - 使える SIMD 命令セットの版で計算する。計算量がしきい値以上なら、系を８個単位の区間に分けて複数のスレッドで計算する。
+ * - ピボット選択はしない。ピボットが小さすぎた（|p_i| <= eps ( |a_i| + |b_i| + |c_i| )）系と、
+ *   解が有限の値にならなかった系は、singular にフラグを立て、解をゼロにする。
+ * @param[out] X n x m の解。空なら確保する。D と同じ行列でもよい。
+ * @param[out] singular 系ごとの特異フラグ（1:特異）。空ならリサイズする。
+ * @param eps ピボットを小さすぎるとみなす相対的な大きさ
+ * @return 特異だった系の個数（0 なら全部成功）
+ */
+inline
+int
+MyAxbSolve_TridiagBatch( const MyMat &A, const MyMat &B, const MyMat &C,
+                         MyMat &X, const MyMat &D, std::vector< unsigned char > &singular,
+                         double eps = MY_BATCH_SINGULAR_EPS ){
+  int n = B.rows(), m = B.cols();
+  assert( MyMatAreTheSameSize( A, B ) && MyMatAreTheSameSize( C, B ) && MyMatAreTheSameSize( D, B ) );
+  if( X.empty() ) X.resize( n, m );
+  else assert( MyMatAreTheSameSize( X, B ) );
+  if( singular.empty() ) singular.resize( m );
+  else assert( singular.size() == m );
+  if( n == 0 || m == 0 ) return 0;
+
+  MySimdLevelType level = MySimdLevel();
+  int nt = MyNumThreadsFor( 8.0 * n * m );
+  int nb = ( m + 7 ) / 8;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+  for( int t = 0; t < nt; t++ ){
+    int k0 = MyMin( m, (int)( (long long)t * nb / nt ) * 8 );
+    int k1 = MyMin( m, (int)( (long long)( t + 1 ) * nb / nt ) * 8 );
+    MyWorkspaceScope scope;
+    double *cpw = scope.workspace().alloc< double >( 8 * (size_t)n );
+#if defined( MY_USE_AVX512 ) && defined( __GNUC__ )
+    if( level >= MY_SIMD_AVX512 ){ MyTridiagBatchRun_AVX512( A, B, C, D, X, k0, k1, cpw, eps, &singular[ 0 ] ); continue; }
+#endif
+#if defined( MY_USE_AVX2 ) && defined( __GNUC__ )
+    if( level >= MY_SIMD_AVX2 ){ MyTridiagBatchRun_AVX2( A, B, C, D, X, k0, k1, cpw, eps, &singular[ 0 ] ); continue; }
+#endif
+    MyTridiagBatchRun_Ref( A, B, C, D, X, k0, k1, cpw, eps, &singular[ 0 ] );
+  }//t
+  (void)level;
+
+  // 有限の値にならなかった系（ピボットの判定は通ったが、途中で桁あふれした）
+  for( int i = 0; i < n; i++ ){
+    const double *xi = X[ i ];
+    for( int k = 0; k < m; k++ ){
+      if( !( MyAbs( xi[ k ] ) <= std::numeric_limits< double >::max() ) ) singular[ k ] = 1;
+    }//k
+  }//i
+  int count = 0;
+  for( int k = 0; k < m; k++ ){
+    if( ! singular[ k ] ) continue;
+    count++;
+    for( int i = 0; i < n; i++ ) X( i, k ) = 0;
+  }//k
+  return count;
+}
+
+/*
+ * --- 疎行列 ---
+ * - ほとんどの要素がゼロの行列を、非ゼロ要素だけ CSR（Compressed Sparse Row）形式で持つ。
+ * - i 行目の非ゼロ要素は、k = rowPtr()[ i ] から rowPtr()[ i + 1 ] - 1 までの (colIdx()[ k ], values()[ k ]) 。
+ *   各行の中では列番号の昇順に並んでいる。
+ * - メモリ量は非ゼロ要素数に比例するので、10^5 〜 10^6 元の連立一次方程式も扱える。
+ * - 作るときは、(行, 列, 値) の三つ組（MySpTriplet）を順不同で並べて渡す（同じ位置の値は足し合わされる）。
+ * - 転置（trans()）は CSR 形式の転置行列を作る。これは元の行列の CSC 形式と同じもの。
+ */
+
+/**
+ * 疎行列の要素（行, 列, 値）
+ */
+struct MySpTriplet {
+  int row;    //!< 行
+  int col;    //!< 列
+  double val; //!< 値
+  MySpTriplet() : row( 0 ), col( 0 ), val( 0 ) { }
+  MySpTriplet( int r, int c, double v ) : row( r ), col( c ), val( v ) { }
+};
+
+/**
+ * 疎行列クラス（CSR 形式）
+ */
+class MySpMat
+{
+  int _rows;                 //!< 行数
+  int _cols;                 //!< 列数
+  std::vector< int > _ptr;   //!< 各行の先頭の位置（rows + 1 個）
+  std::vector< int > _idx;   //!< 非ゼロ要素の列番号
+  std::vector< double > _val; //!< 非ゼロ要素の値
+
+ public:
+  MySpMat() : _rows( 0 ), _cols( 0 ), _ptr( 1, 0 ) { }
+
+  /**
+   * rows x cols のゼロ行列
+   */
+  MySpMat( int rows, int cols ) : _rows( rows ), _cols( cols ), _ptr( rows + 1, 0 ) {
+    assert( rows >= 0 && cols >= 0 );
+  }
+
+  /**
+   * 三つ組から作る
+   * - 順番は任意。同じ位置の要素が複数あれば足し合わせる。
+   * - 計算量は、要素数を nnz として O(nnz log(行あたりの要素数)) 。
+   */
+  MySpMat( int rows, int cols, const std::vector< MySpTriplet > &t ){
+    setFromTriplets( rows, cols, t );
+  }
+
+  /**
+   * 密行列から作る
+   * - 絶対値が zero_thres より大きい要素だけを持つ。
+   */
+  explicit MySpMat( const MyMatView &A, double zero_thres = 0 ) : _rows( A.rows() ), _cols( A.cols() ) {
+    _ptr.resize( _rows + 1 );
+    _ptr[ 0 ] = 0;
+    for( int i = 0; i < _rows; i++ ){
+      for( int j = 0; j < _cols; j++ ){
+        if( MyAbs( A( i, j ) ) > zero_thres ){
+          _idx.push_back( j );
+          _val.push_back( A( i, j ) );
+        }
+      }//j
+      _ptr[ i + 1 ] = _idx.size();
+    }//i
+  }
+
+  /**
+   * 三つ組から作り直す
+   * - 行ごとに数え上げて振り分け（バケットソート）、行の中を列番号でソートして、重複を足し合わせる。
+   */
+  void setFromTriplets( int rows, int cols, const std::vector< MySpTriplet > &t ){
+    assert( rows >= 0 && cols >= 0 );
+    _rows = rows;
+    _cols = cols;
+
+    // 行ごとの個数を数えて、行ごとに振り分ける
+    std::vector< int > cnt( rows + 1, 0 );
+    for( size_t k = 0; k < t.size(); k++ ){
+      assert( t[ k ].row >= 0 && t[ k ].row < rows && t[ k ].col >= 0 && t[ k ].col < cols );
+      cnt[ t[ k ].row + 1 ]++;
+    }
+    for( int i = 0; i < rows; i++ ) cnt[ i + 1 ] += cnt[ i ];
+    std::vector< std::pair< int, double > > e( t.size() );
+    std::vector< int > pos( cnt.begin(), cnt.end() - 1 );
+    for( size_t k = 0; k < t.size(); k++ ){
+      e[ pos[ t[ k ].row ]++ ] = std::make_pair( t[ k ].col, t[ k ].val );
+    }
+
+    // 行の中を列番号でソートし、同じ列を足し合わせる
+    _ptr.assign( rows + 1, 0 );
+    _idx.clear();
+    _val.clear();
+    _idx.reserve( t.size() );
+    _val.reserve( t.size() );
+    for( int i = 0; i < rows; i++ ){
+      std::sort( e.begin() + cnt[ i ], e.begin() + cnt[ i + 1 ] );
+      for( int k = cnt[ i ]; k < cnt[ i + 1 ]; k++ ){
+        if( (int)_idx.size() > _ptr[ i ] && _idx.back() == e[ k ].first ) _val.back() += e[ k ].second;
+        else{
+          _idx.push_back( e[ k ].first );
+          _val.push_back( e[ k ].second );
+        }
+      }//k
+      _ptr[ i + 1 ] = _idx.size();
+    }//i
+  }
+
+  // アクセサ
+  int rows() const { return _rows; }
+  int cols() const { return _cols; }
+  int nnz() const { return _val.size(); }
+  const std::vector< int > & rowPtr() const { return _ptr; }
+  const std::vector< int > & colIdx() const { return _idx; }
+  const std::vector< double > & values() const { return _val; }
+  /** 値だけを書き換える用（非ゼロ要素の位置は変えられない） */
+  std::vector< double > & values() { return _val; }
+
+  /**
+   * (i,j) 要素の値
+   * - 行の中を二分探索する。非ゼロ要素として持っていなければ 0 。
+   */
+  double operator () ( int i, int j ) const {
+    assert( i >= 0 && i < _rows && j >= 0 && j < _cols );
+    const int *b = _idx.empty() ? 0 : &_idx[ 0 ];
+    const int *p = std::lower_bound( b + _ptr[ i ], b + _ptr[ i + 1 ], j );
+    return ( p != b + _ptr[ i + 1 ] && *p == j ) ? _val[ p - b ] : 0;
+  }
+
+  /**
+   * 転置行列
+   * - 元の行列の CSC 形式と同じもの。計算量は O(rows + cols + nnz) 。
+   */
+  MySpMat trans() const {
+    MySpMat T( _cols, _rows );
+    T._idx.resize( nnz() );
+    T._val.resize( nnz() );
+    for( int k = 0; k < nnz(); k++ ) T._ptr[ _idx[ k ] + 1 ]++;
+    for( int j = 0; j < _cols; j++ ) T._ptr[ j + 1 ] += T._ptr[ j ];
+    std::vector< int > pos( T._ptr.begin(), T._ptr.end() - 1 );
+    for( int i = 0; i < _rows; i++ ){
+      for( int k = _ptr[ i ]; k < _ptr[ i + 1 ]; k++ ){
+        int q = pos[ _idx[ k ] ]++;
+        T._idx[ q ] = i;
+        T._val[ q ] = _val[ k ];
+      }//k
+    }//i
+    return T;
+  }
+
+  /**
+   * 密行列に書き出す
+   */
+  void get( MyMat &A ) const {
+    if( A.empty() ) A.resize( _rows, _cols );
+    else assert( A.rows() == _rows && A.cols() == _cols );
+    A.fill( 0 );
+    for( int i = 0; i < _rows; i++ ){
+      for( int k = _ptr[ i ]; k < _ptr[ i + 1 ]; k++ ) A( i, _idx[ k ] ) = _val[ k ];
+    }
+  }
+
+  /**
+   * 対角成分を取り出す（持っていない位置は 0）
+   */
+  void diag( std::vector< double > &d ) const {
+    int n = MyMin( _rows, _cols );
+    d.resize( n );
+    for( int i = 0; i < n; i++ ) d[ i ] = (*this)( i, i );
+  }
+};
+
+/**
+ * 疎行列の行を、非ゼロ要素の数がほぼ均等になるように nt 個に分けたときの、t 番目の区間の先頭の行
+ */
+inline
+int
+MySpMatRowSplit( const MySpMat &A, int t, int nt ){
+  if( t <= 0 ) return 0;
+  if( t >= nt ) return A.rows();
+  const std::vector< int > &p = A.rowPtr();
+  int target = (int)( (long long)t * A.nnz() / nt );
+  return std::lower_bound( p.begin(), p.end(), target ) - p.begin();
+}
+
+/**
+ * 疎行列とベクトルの掛け算 y = A * x（SpMV）
+ * - y が空ならリサイズする。空でなければサイズが合っていること。y は x と同じベクトルでないこと。
+ * - 計算量が MySetParallelThreshold() のしきい値以上なら、非ゼロ要素の数が均等になるように行を分けて複数のスレッドで計算する。
+ *   行ごとの足し算の順番は変わらないので、結果はシリアル版と同じ。
+ */
+inline
+void
+MySpMatVecMulInto( const MySpMat &A, const std::vector< double > &x, std::vector< double > &y ){
+  assert( A.cols() == (int)x.size() );
+  assert( &x != &y );
+  int M = A.rows();
+  if( y.empty() ) y.resize( M );
+  else assert( y.size() == M );
+  if( A.nnz() == 0 ){
+    std::fill( y.begin(), y.end(), 0.0 );
+    return;
+  }
+  const int *ptr = &A.rowPtr()[ 0 ], *idx = &A.colIdx()[ 0 ];
+  const double *val = &A.values()[ 0 ];
+  int nt = MyNumThreadsFor( 2.0 * A.nnz() );
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+  for( int t = 0; t < nt; t++ ){
+    int i1 = MySpMatRowSplit( A, t + 1, nt );
+    for( int i = MySpMatRowSplit( A, t, nt ); i < i1; i++ ){
+      double sum = 0;
+      for( int k = ptr[ i ]; k < ptr[ i + 1 ]; k++ ) sum += val[ k ] * x[ idx[ k ] ];
+      y[ i ] = sum;
+    }//i
+  }//t
+}
+
+/**
+ * 疎行列とベクトルの掛け算
+ */
+inline
+std::vector< double >
+operator * ( const MySpMat &A, const std::vector< double > &x ){
+  std::vector< double > y;
+  MySpMatVecMulInto( A, x, y );
+  return y;
+}
+
+/**
+ * 疎行列どうしの掛け算 C = A * B
+ * - A の i 行目の非ゼロ要素 a_ik ごとに、B の k 行目を a_ik 倍して C の i 行目に足し込む（Gustavson の方法）。
+ * - 計算量は、掛け算の回数（Σ_ik B の k 行目の非ゼロ要素の数）に比例する。
+ */
+inline
+MySpMat
+MySpMatMul( const MySpMat &A, const MySpMat &B ){
+  assert( A.cols() == B.rows() );
+  const std::vector< int > &ap = A.rowPtr(), &ai = A.colIdx(), &bp = B.rowPtr(), &bi = B.colIdx();
+  const std::vector< double > &av = A.values(), &bv = B.values();
+
+  // pos[ j ] は、今の行の列 j の要素が t のどこにあるか（今の行より前を指していれば、まだない）
+  std::vector< MySpTriplet > t;
+  std::vector< int > pos( B.cols(), -1 );
+  for( int i = 0; i < A.rows(); i++ ){
+    int t0 = t.size();
+    for( int q = ap[ i ]; q < ap[ i + 1 ]; q++ ){
+      int k = ai[ q ];
+      for( int r = bp[ k ]; r < bp[ k + 1 ]; r++ ){
+        int j = bi[ r ];
+        if( pos[ j ] < t0 ){
+          pos[ j ] = t.size();
+          t.push_back( MySpTriplet( i, j, av[ q ] * bv[ r ] ) );
+        }
+        else t[ pos[ j ] ].val += av[ q ] * bv[ r ];
+      }//r
+    }//q
+  }//i
+  return MySpMat( A.rows(), B.cols(), t );
+}
+
+/**
+ * 連立一次方程式を解く
+ * - ヤコビ反復法
+ * - 疎行列版。１回の反復の計算量は O(非ゼロ要素の数) 。
+ * - 各行の計算は独立なので、非ゼロ要素の数が多ければ行を分けて複数のスレッドで計算する（結果はシリアル版と同じ）。
+ * - 密行列版と同じく、ダブルバッファで反復ごとのコピーはない。
+ * - 対角成分はすべて非ゼロであること。
+ * - omega を指定すると重み付きヤコビ法：x <- ( 1 - ω ) x + ω x_jacobi 。
+ *   マルチグリッド法の平滑化に使うときは ω = 2/3 くらい（ω = 1 だと一番細かい振動の誤差が減らない）。
+ */
+inline
+int
+MyAxbSolve_Jacobi( const MySpMat &A,
+                   std::vector< double > &x,
+                   const std::vector< double > &b,
+                   double thres = 1E-06,
+                   int max_itr_num = 100,
+                   std::ostream *dout = 0,
+                   double omega = 1.0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  // 一時変数（作業領域から借りる）
+  MyWorkspaceScope scope;
+  vector< double > &x_next = scope.workspace().vec( N );
+  vector< double > &d = scope.workspace().vec( N );
+  for( int i = 0; i < N; i++ ){
+    d[ i ] = A( i, i );
+    assert( d[ i ] != 0 );
+  }
+
+  if( dout ){
+    *dout << "--- MyAxbSolve_Jacobi() ---" << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+
+  const int *ptr = &A.rowPtr()[ 0 ], *idx = A.nnz() ? &A.colIdx()[ 0 ] : 0;
+  const double *val = A.nnz() ? &A.values()[ 0 ] : 0;
+  int nt = MyNumThreadsFor( 2.0 * A.nnz() );
+
+  // 反復処理。x と x_next を交互に使う（ダブルバッファ。毎回のコピーはしない）
+  vector< double > *cur = &x, *nxt = &x_next;
+  for( int k = 0; k < max_itr_num; k++ ){
+    const double *xc = &( *cur )[ 0 ];
+    double *xn = &( *nxt )[ 0 ];
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int t = 0; t < nt; t++ ){
+      int i1 = MySpMatRowSplit( A, t + 1, nt );
+      for( int i = MySpMatRowSplit( A, t, nt ); i < i1; i++ ){
+        double s = b[ i ];
+        for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+          if( idx[ q ] != i ) s -= val[ q ] * xc[ idx[ q ] ];
+        }//q
+        xn[ i ] = ( 1 - omega ) * xc[ i ] + omega * s / d[ i ];
+      }//i
+    }//t
+
+    // 収束判定
+    double dx = MyVecNorm( *nxt - *cur );
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << *nxt << " dx: " << dx << endl;
+    std::swap( cur, nxt );
+    if( dx < thres ) break;
+
+  }//k
+
+  // 最新の値が x_next の方に入っていれば、最後に１回だけコピーする
+  if( cur != &x ) x = *cur;
+
+  return 0;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - ガウスザイデルの反復法
+ * - 疎行列版。１回の反復の計算量は O(非ゼロ要素の数) 。
+ * - 前の行の更新結果を使うので、１スレッドで計算する。
+ * - 対角成分はすべて非ゼロであること。
+ */
+inline
+int
+MyAxbSolve_GaussSeidel( const MySpMat &A,
+                        std::vector< double > &x,
+                        const std::vector< double > &b,
+                        double thres = 1E-06,
+                        int max_itr_num = 100,
+                        std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  // 対角成分（作業領域から借りる）
+  MyWorkspaceScope scope;
+  vector< double > &d = scope.workspace().vec( N );
+  for( int i = 0; i < N; i++ ){
+    d[ i ] = A( i, i );
+    assert( d[ i ] != 0 );
+  }
+
+  if( dout ){
+    *dout << "--- MyAxbSolve_GaussSeidel() ---" << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+
+  const int *ptr = &A.rowPtr()[ 0 ], *idx = A.nnz() ? &A.colIdx()[ 0 ] : 0;
+  const double *val = A.nnz() ? &A.values()[ 0 ] : 0;
+
+  // 反復処理
+  for( int k = 0; k < max_itr_num; k++ ){
+    double dx = 0; // 解の変化量計算（収束判定のため）
+    for( int i = 0; i < N; i++ ){
+      double s = b[ i ];
+      for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+        if( idx[ q ] != i ) s -= val[ q ] * x[ idx[ q ] ];
+      }//q
+      s /= d[ i ];
+      dx += MyAbs( x[ i ] - s );
+      x[ i ] = s;
+    }//i
+    // 収束判定
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x << " dx: " << dx << endl;
+    if( dx < thres ) break;
+
+  }//k
+
+  return 0;
+}
+
+/**
+ * SOR 法の１行分の更新（疎行列）
+ * - x[ i ] を更新して、変化量の絶対値を返す。
+ */
+inline
+double
+MySpMatSORRow( const int *ptr, const int *idx, const double *val, const double *d,
+               const std::vector< double > &b, std::vector< double > &x, double omega, int i ){
+  double s = b[ i ];
+  for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+    if( idx[ q ] != i ) s -= val[ q ] * x[ idx[ q ] ];
+  }//q
+  double xi = ( 1 - omega ) * x[ i ] + omega * s / d[ i ];
+  double dx = MyAbs( xi - x[ i ] );
+  x[ i ] = xi;
+  return dx;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - SOR 法（symmetric なら SSOR 法）
+ * - 疎行列版。行の順番に更新するので、１スレッドで計算する。並列に計算したい場合は MyAxbSolve_SORColor() 。
+ * - 引数は密行列版と同じ。対角成分はすべて非ゼロであること。
+ */
+inline
+int
+MyAxbSolve_SOR( const MySpMat &A,
+                std::vector< double > &x,
+                const std::vector< double > &b,
+                double omega,
+                double thres = 1E-06,
+                int max_itr_num = 100,
+                std::ostream *dout = 0,
+                bool symmetric = false ){
+  using namespace std;
+
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  assert( omega > 0 && omega < 2 );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  // 対角成分（作業領域から借りる）
+  MyWorkspaceScope scope;
+  vector< double > &d = scope.workspace().vec( N );
+  A.diag( d );
+  for( int i = 0; i < N; i++ ) assert( d[ i ] != 0 );
+
+  if( dout ){
+    *dout << ( symmetric ? "--- MyAxbSolve_SSOR() ---" : "--- MyAxbSolve_SOR() ---" ) << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+
+  const int *ptr = &A.rowPtr()[ 0 ], *idx = A.nnz() ? &A.colIdx()[ 0 ] : 0;
+  const double *val = A.nnz() ? &A.values()[ 0 ] : 0;
+
+  // 反復処理
+  for( int k = 0; k < max_itr_num; k++ ){
+    double dx = 0;
+    for( int i = 0; i < N; i++ ) dx += MySpMatSORRow( ptr, idx, val, &d[ 0 ], b, x, omega, i );
+    if( symmetric ){
+      for( int i = N - 1; i >= 0; i-- ) dx += MySpMatSORRow( ptr, idx, val, &d[ 0 ], b, x, omega, i );
+    }
+    // 収束判定
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x << " dx: " << dx << endl;
+    if( dx < thres ) break;
+  }//k
+
+  return 0;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - SSOR 法
+ * - 疎行列版。MyAxbSolve_SOR( A, x, b, omega, thres, max_itr_num, dout, true ) と同じ。
+ */
+inline
+int
+MyAxbSolve_SSOR( const MySpMat &A,
+                 std::vector< double > &x,
+                 const std::vector< double > &b,
+                 double omega,
+                 double thres = 1E-06,
+                 int max_itr_num = 100,
+                 std::ostream *dout = 0 ){
+  return MyAxbSolve_SOR( A, x, b, omega, thres, max_itr_num, dout, true );
+}
+
+// 並列計算で和をとるときのブロックの要素数（ブロックごとの部分和をブロックの順に足すので、スレッド数によらず結果が同じになる）
+#ifndef MY_PAR_VEC_BLOCK
+#define MY_PAR_VEC_BLOCK 4096
+#endif
+
+/**
+ * 疎行列の多色順序付け（マルチカラー）
+ * - 互いに参照しあう（a_ij か a_ji が非ゼロの）行どうしが違う色になるように、行に色を塗る（貪欲法）。
+ * - 同じ色の行どうしは互いの値を使わないので、ガウスザイデル法や SOR 法で同時に更新できる。
+ * - 格子状の５点差分の行列を自然な順番で塗ると、赤と黒の２色（チェッカーボード）になる。
+ * @param[out] color 各行の色（0, 1, ...）
+ * @return 色の数
+ */
+inline
+int
+MySpMatColoring( const MySpMat &A, std::vector< int > &color ){
+  int N = A.rows();
+  assert( A.cols() == N );
+  MySpMat At = A.trans();
+  const std::vector< int > *ptr[ 2 ] = { &A.rowPtr(), &At.rowPtr() };
+  const std::vector< int > *idx[ 2 ] = { &A.colIdx(), &At.colIdx() };
+  color.assign( N, -1 );
+
+  // used[ c ] == i なら、i 行目の隣に色 c がすでに使われている
+  std::vector< int > used( N + 1, -1 );
+  int ncolor = 0;
+  for( int i = 0; i < N; i++ ){
+    for( int m = 0; m < 2; m++ ){
+      for( int q = ( *ptr[ m ] )[ i ]; q < ( *ptr[ m ] )[ i + 1 ]; q++ ){
+        int c = color[ ( *idx[ m ] )[ q ] ];
+        if( c >= 0 ) used[ c ] = i;
+      }//q
+    }//m
+    int c = 0;
+    while( used[ c ] == i ) c++;
+    color[ i ] = c;
+    ncolor = MyMax( ncolor, c + 1 );
+  }//i
+  return ncolor;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - 多色順序付けの SOR 法
+ * - MySpMatColoring() で行を色分けし、色ごとに順番に更新する。同じ色の行は互いに独立なので、複数のスレッドで同時に更新する。
+ *   格子状の問題ではレッド・ブラック SOR 法になる。
+ * - 更新の順番が自然な順番と違うので、MyAxbSolve_SOR() と結果は一致しない（収束の速さは同程度）。
+ * - 収束判定に使う変化量は MY_PAR_VEC_BLOCK 行ずつの部分和を決まった順に足すので、スレッド数によらず結果は同じ。
+ * - 対称版（SSOR 法）はない。色の順に前向き・後ろ向きに更新すると、レッド・ブラックでは過緩和の効果が打ち消されて
+ *   収束が非常に遅くなるため。対称な反復が必要なら MyAxbSolve_SSOR()（１スレッド）を使う。
+ * - 引数は MyAxbSolve_SOR() と同じ（symmetric はない）。
+ */
+inline
+int
+MyAxbSolve_SORColor( const MySpMat &A,
+                     std::vector< double > &x,
+                     const std::vector< double > &b,
+                     double omega,
+                     double thres = 1E-06,
+                     int max_itr_num = 100,
+                     std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = A.rows();
+
+  // 入力チェック
+  assert( N > 0 );
+  assert( A.cols() == N );
+  assert( b.size() == N );
+  assert( omega > 0 && omega < 2 );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  // 色分けして、行を色の順に並べる（order[ cs[ c ] ] 〜 order[ cs[ c + 1 ] - 1 ] が色 c の行）
+  vector< int > color;
+  int ncolor = MySpMatColoring( A, color );
+  vector< int > cs( ncolor + 1, 0 ), order( N );
+  for( int i = 0; i < N; i++ ) cs[ color[ i ] + 1 ]++;
+  for( int c = 0; c < ncolor; c++ ) cs[ c + 1 ] += cs[ c ];
+  vector< int > pos( cs.begin(), cs.end() - 1 );
+  for( int i = 0; i < N; i++ ) order[ pos[ color[ i ] ]++ ] = i;
+
+  // 対角成分
+  vector< double > d;
+  A.diag( d );
+  for( int i = 0; i < N; i++ ) assert( d[ i ] != 0 );
+
+  if( dout ){
+    *dout << "--- MyAxbSolve_SORColor() --- colors: " << ncolor << endl;
+    *dout << "[0]\t" << x << endl;
+  }
+
+  const int *ptr = &A.rowPtr()[ 0 ], *idx = A.nnz() ? &A.colIdx()[ 0 ] : 0;
+  const double *val = A.nnz() ? &A.values()[ 0 ] : 0;
+#ifdef _OPENMP
+  int nt = MyNumThreadsFor( 2.0 * A.nnz() / ncolor );
+#endif
+
+  // 変化量の部分和（色ごとに、MY_PAR_VEC_BLOCK 行ずつ）
+  int nbmax = 1;
+  for( int c = 0; c < ncolor; c++ ) nbmax = MyMax( nbmax, ( cs[ c + 1 ] - cs[ c ] + MY_PAR_VEC_BLOCK - 1 ) / MY_PAR_VEC_BLOCK );
+  MyWorkspaceScope scope;
+  double *part = scope.workspace().alloc( nbmax );
+
+  // 反復処理
+  for( int k = 0; k < max_itr_num; k++ ){
+    double dx = 0;
+    for( int c = 0; c < ncolor; c++ ){
+      int p0 = cs[ c ], p1 = cs[ c + 1 ], nb = ( p1 - p0 + MY_PAR_VEC_BLOCK - 1 ) / MY_PAR_VEC_BLOCK;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+      for( int t = 0; t < nb; t++ ){
+        int q1 = MyMin( p1, p0 + ( t + 1 ) * MY_PAR_VEC_BLOCK );
+        double s = 0;
+        for( int p = p0 + t * MY_PAR_VEC_BLOCK; p < q1; p++ ){
+          s += MySpMatSORRow( ptr, idx, val, &d[ 0 ], b, x, omega, order[ p ] );
+        }//p
+        part[ t ] = s;
+      }//t
+      for( int t = 0; t < nb; t++ ) dx += part[ t ];
+    }//c
+    // 収束判定
+    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x << " dx: " << dx << endl;
+    if( dx < thres ) break;
+  }//k
+
+  return 0;
+}
+
+/*
+ * --- クリロフ部分空間法 ---
+ * - 行列とベクトルの積 y = A x だけを使って連立一次方程式を解く反復法（CG 法など）。
+ * - 係数行列は MyMat、MySpMat、vector< vector< double > > のほか、y = A x を計算する関数オブジェクト（関数でも可）で渡せる。
+ *     void operator () ( const std::vector< double > &x, std::vector< double > &y ) const;  // y はサイズ確保済み
+ *   行列を作らずに済むので、投影と逆投影の組のように、A が処理としてしか定義されていない問題も解ける。
+ * - 対称正定値なら MyAxbSolve_CG()、非対称なら MyAxbSolve_GMRES() か MyAxbSolve_BiCGSTAB() 。
+ * - 前処理は MyPrecond の派生クラスをポインタで渡す。
+ *   対称用：MyPrecondJacobi, MyPrecondSSOR, MyPrecondIC0 。非対称用：MyPrecondILU0, MyPrecondBlockJacobi（Jacobi も可）。
+ * - 収束判定は相対残差 || b - A x || / || b || 。反復回数と残差の履歴は MyIterInfo で受け取れる。
+ * - ベクトルの内積や更新（MyParDot, MyParAxpby）は、長ければ複数のスレッドで計算する。
+ */
+
+/**
+ * y = A x
+ * - クリロフ部分空間法で係数行列の種類の違いを吸収する。関数オブジェクトの場合は A( x, y ) を呼ぶ。
+ */
+inline
+void
+MyLinOpApply( const MyMatView &A, const std::vector< double > &x, std::vector< double > &y ){
+  MyMatVecMulInto( A, x, y );
+}
+
+inline
+void
+MyLinOpApply( const MyMat &A, const std::vector< double > &x, std::vector< double > &y ){
+  MyMatVecMulInto( A, x, y );
+}
+
+inline
+void
+MyLinOpApply( const MySpMat &A, const std::vector< double > &x, std::vector< double > &y ){
+  MySpMatVecMulInto( A, x, y );
+}
+
+inline
+void
+MyLinOpApply( const std::vector< std::vector< double > > &A, const std::vector< double > &x, std::vector< double > &y ){
+  MyMatVecMulInto( A, x, y );
+}
+
+template < class Op >
+inline
+void
+MyLinOpApply( const Op &A, const std::vector< double > &x, std::vector< double > &y ){
+  A( x, y );
+}
+
+/**
+ * 内積（クリロフ部分空間法用の並列版）
+ * - MY_PAR_VEC_BLOCK 要素ずつの部分和を複数のスレッドで計算し、最後にブロックの順番に足し合わせる。
+ *   ブロックの分け方はスレッド数によらないので、スレッド数を変えても結果は同じ。
+ */
+inline
+double
+MyParDot( const double *a, const double *b, int n ){
+  int nb = ( n + MY_PAR_VEC_BLOCK - 1 ) / MY_PAR_VEC_BLOCK;
+  MyWorkspaceScope scope;
+  double *part = scope.workspace().alloc( MyMax( nb, 1 ) );
+#ifdef _OPENMP
+  int nt = MyNumThreadsFor( 2.0 * n );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+  for( int t = 0; t < nb; t++ ){
+    int i1 = MyMin( n, ( t + 1 ) * MY_PAR_VEC_BLOCK );
+    double s = 0;
+    for( int i = t * MY_PAR_VEC_BLOCK; i < i1; i++ ) s += a[ i ] * b[ i ];
+    part[ t ] = s;
+  }//t
+  double s = 0;
+  for( int t = 0; t < nb; t++ ) s += part[ t ];
+  return s;
+}
+
+inline
+double
+MyParDot( const std::vector< double > &a, const std::vector< double > &b ){
+  assert( a.size() == b.size() );
+  return a.empty() ? 0 : MyParDot( &a[ 0 ], &b[ 0 ], a.size() );
+}
+
+inline
+double
+MyParNorm( const std::vector< double > &a ){
+  return sqrt( MyParDot( a, a ) );
+}
+
+/**
+ * y = a x + b y（クリロフ部分空間法用の並列版）
+ * - b が 0 のときは y の元の値を読まない。
+ */
+inline
+void
+MyParAxpby( double a, const double *x, double b, double *y, int n ){
+#ifdef _OPENMP
+  int nt = MyNumThreadsFor( 2.0 * n );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+  for( int i = 0; i < n; i++ ) y[ i ] = ( b == 0 ) ? a * x[ i ] : a * x[ i ] + b * y[ i ];
+}
+
+inline
+void
+MyParAxpby( double a, const std::vector< double > &x, double b, std::vector< double > &y ){
+  assert( x.size() == y.size() );
+  if( ! x.empty() ) MyParAxpby( a, &x[ 0 ], b, &y[ 0 ], x.size() );
+}
+
+/**
+ * 反復法の結果
+ */
+struct MyIterInfo {
+  int itr;                        //!< 反復回数
+  double res;                     //!< 最後の相対残差 || b - A x || / || b ||
+  bool converged;                 //!< 収束したかどうか
+  std::vector< double > history;  //!< 各反復の相対残差（history[ 0 ] は初期値での残差）
+  MyIterInfo() : itr( 0 ), res( 0 ), converged( false ) { }
+};
+
+/**
+ * 前処理
+ * - z = M^-1 r を計算する。M は A に近くて、逆が安く計算できる行列。
+ */
+class MyPrecond
+{
+ public:
+  virtual ~MyPrecond(){ }
+
+  /**
+   * z = M^-1 r
+   * - z はサイズ確保済み。r と z は別のベクトルであること。
+   */
+  virtual void apply( const std::vector< double > &r, std::vector< double > &z ) const = 0;
+};
+
+/**
+ * ヤコビ前処理（対角スケーリング）
+ * - M = diag( A ) 。対角成分だけ分かれば使えるので、行列を作らない場合にも使える。
+ */
+class MyPrecondJacobi : public MyPrecond
+{
+  std::vector< double > _inv;  //!< 対角成分の逆数
+
+  void invert(){
+    for( size_t i = 0; i < _inv.size(); i++ ){
+      assert( _inv[ i ] != 0 );
+      _inv[ i ] = 1 / _inv[ i ];
+    }
+  }
+
+ public:
+  explicit MyPrecondJacobi( const MySpMat &A ){
+    A.diag( _inv );
+    invert();
+  }
+
+  explicit MyPrecondJacobi( const MyMatView &A ){
+    A.diag().get( _inv );
+    invert();
+  }
+
+  /**
+   * 対角成分を直接与える
+   */
+  explicit MyPrecondJacobi( const std::vector< double > &d ) : _inv( d ) {
+    invert();
+  }
+
+  void apply( const std::vector< double > &r, std::vector< double > &z ) const {
+    int N = _inv.size();
+    for( int i = 0; i < N; i++ ) z[ i ] = _inv[ i ] * r[ i ];
+  }
+};
+
+/**
+ * SSOR 前処理
+ * - A = L + D + U（狭義下三角、対角、狭義上三角）として、
+ *   M = ω / ( 2 - ω ) * ( D / ω + L ) ( D / ω )^-1 ( D / ω + U ) 。
+ * - 適用は前進代入と後退代入を１回ずつ（SSOR の１反復分）。A が対称なら M も対称正定値なので、CG 法に使える。
+ * - 内部に疎行列の形でコピーを持つ。
+ */
+class MyPrecondSSOR : public MyPrecond
+{
+  MySpMat _a;                //!< 係数行列
+  std::vector< double > _d;  //!< 対角成分
+  double _omega;             //!< 緩和係数（0 < ω < 2）
+
+  void init(){
+    assert( _a.rows() == _a.cols() );
+    assert( _omega > 0 && _omega < 2 );
+    _a.diag( _d );
+    for( size_t i = 0; i < _d.size(); i++ ) assert( _d[ i ] != 0 );
+  }
+
+ public:
+  explicit MyPrecondSSOR( const MySpMat &A, double omega = 1.0 ) : _a( A ), _omega( omega ) {
+    init();
+  }
+
+  explicit MyPrecondSSOR( const MyMatView &A, double omega = 1.0 ) : _a( A ), _omega( omega ) {
+    init();
+  }
+
+  void apply( const std::vector< double > &r, std::vector< double > &z ) const {
+    int N = _a.rows();
+    double w = _omega;
+    const int *ptr = &_a.rowPtr()[ 0 ], *idx = _a.nnz() ? &_a.colIdx()[ 0 ] : 0;
+    const double *val = _a.nnz() ? &_a.values()[ 0 ] : 0;
+
+    // 前進代入：( D / ω + L ) y = r
+    for( int i = 0; i < N; i++ ){
+      double s = r[ i ];
+      for( int q = ptr[ i ]; q < ptr[ i + 1 ] && idx[ q ] < i; q++ ) s -= val[ q ] * z[ idx[ q ] ];
+      z[ i ] = s * w / _d[ i ];
+    }//i
+
+    // 後退代入：( D / ω + U ) z = ( D / ω ) y
+    for( int i = N - 1; i >= 0; i-- ){
+      double s = z[ i ] * _d[ i ] / w;
+      for( int q = ptr[ i + 1 ] - 1; q >= ptr[ i ] && idx[ q ] > i; q-- ) s -= val[ q ] * z[ idx[ q ] ];
+      z[ i ] = s * w / _d[ i ];
+    }//i
+
+    double c = ( 2 - w ) / w;
+    for( int i = 0; i < N; i++ ) z[ i ] *= c;
+  }
+};
+
+/**
+ * 不完全コレスキー分解 IC(0) による前処理
+ * - A の下三角の非ゼロパターンの中だけで A ≒ L L^T と分解する（フィルインを作らない）。
+ * - 対称正定値でも途中で対角が負になることがある。その場合は対角に ( 1 + shift ) を掛けて分解し直す
+ *   （shift は 0.001 から倍々に増やす）。
+ * - A は対称であること（下三角だけを参照する）。対角成分はすべて非ゼロパターンに入っていること。
+ */
+class MyPrecondIC0 : public MyPrecond
+{
+  std::vector< int > _ptr;     //!< L の各行の先頭の位置（各行の最後の要素が対角）
+  std::vector< int > _idx;     //!< L の列番号
+  std::vector< double > _val;  //!< L の値
+  double _shift;               //!< 分解に使った対角のシフト量
+
+  /**
+   * 対角に ( 1 + shift ) を掛けて分解する
+   */
+  int factor( const MySpMat &A, double shift ){
+    int N = A.rows();
+    const std::vector< int > &ap = A.rowPtr();
+    const std::vector< double > &av = A.values();
+    for( int i = 0; i < N; i++ ){
+      int q0 = _ptr[ i ], dq = _ptr[ i + 1 ] - 1;
+      for( int q = q0; q <= dq; q++ ) _val[ q ] = av[ ap[ i ] + ( q - q0 ) ];
+      _val[ dq ] *= 1 + shift;
+
+      // L( i, k ) = ( A( i, k ) - Σ_{j<k} L( i, j ) L( k, j ) ) / L( k, k )
+      for( int q = q0; q < dq; q++ ){
+        int k = _idx[ q ];
+        double s = _val[ q ];
+        int p1 = q0, p2 = _ptr[ k ], e2 = _ptr[ k + 1 ] - 1;
+        while( p1 < q && p2 < e2 ){
+          if( _idx[ p1 ] < _idx[ p2 ] ) p1++;
+          else if( _idx[ p1 ] > _idx[ p2 ] ) p2++;
+          else s -= _val[ p1++ ] * _val[ p2++ ];
+        }
+        _val[ q ] = s / _val[ e2 ];
+      }//q
+
+      // L( i, i ) = sqrt( A( i, i ) - Σ_{j<i} L( i, j )^2 )
+      double s = _val[ dq ];
+      for( int q = q0; q < dq; q++ ) s -= _val[ q ] * _val[ q ];
+      if( ! ( s > 0 ) ) return -1;
+      _val[ dq ] = sqrt( s );
+    }//i
+    return 0;
+  }
+
+ public:
+  explicit MyPrecondIC0( const MySpMat &A ){
+    compute( A );
+  }
+
+  explicit MyPrecondIC0( const MyMatView &A ){
+    compute( MySpMat( A ) );
+  }
+
+  /**
+   * 分解する
+   * @return 0:成功、0以外:失敗（シフトを大きくしても分解できなかった）
+   */
+  int compute( const MySpMat &A ){
+    int N = A.rows();
+    assert( A.cols() == N );
+
+    // 下三角の非ゼロパターンを取り出す
+    const std::vector< int > &ap = A.rowPtr();
+    const std::vector< int > &ai = A.colIdx();
+    _ptr.assign( N + 1, 0 );
+    _idx.clear();
+    for( int i = 0; i < N; i++ ){
+      for( int q = ap[ i ]; q < ap[ i + 1 ] && ai[ q ] <= i; q++ ) _idx.push_back( ai[ q ] );
+      assert( ! _idx.empty() && _idx.back() == i );
+      _ptr[ i + 1 ] = _idx.size();
+    }//i
+    _val.resize( _idx.size() );
+
+    _shift = 0;
+    for( int t = 0; t < 30; t++ ){
+      if( factor( A, _shift ) == 0 ) return 0;
+      _shift = ( _shift == 0 ) ? 1E-03 : _shift * 2;
+    }//t
+    return -1;
+  }
+
+  /**
+   * 分解に使った対角のシフト量（0 ならシフトなし）
+   */
+  double shift() const { return _shift; }
+
+  void apply( const std::vector< double > &r, std::vector< double > &z ) const {
+    int N = _ptr.size() - 1;
+
+    // 前進代入：L y = r
+    for( int i = 0; i < N; i++ ){
+      int dq = _ptr[ i + 1 ] - 1;
+      double s = r[ i ];
+      for( int q = _ptr[ i ]; q < dq; q++ ) s -= _val[ q ] * z[ _idx[ q ] ];
+      z[ i ] = s / _val[ dq ];
+    }//i
+
+    // 後退代入：L^T z = y（L の行を列として使う）
+    for( int i = N - 1; i >= 0; i-- ){
+      int dq = _ptr[ i + 1 ] - 1;
+      z[ i ] /= _val[ dq ];
+      double zi = z[ i ];
+      for( int q = _ptr[ i ]; q < dq; q++ ) z[ _idx[ q ] ] -= _val[ q ] * zi;
+    }//i
+  }
+};
+
+/**
+ * 不完全 LU 分解 ILU(0) による前処理
+ * - A の非ゼロパターンの中だけで A ≒ L U と分解する（フィルインを作らない）。非対称行列用。
+ * - L は単位下三角、U は上三角で、A と同じ形の CSR にまとめて持つ。
+ * - 対角成分はすべて非ゼロパターンに入っていること。
+ */
+class MyPrecondILU0 : public MyPrecond
+{
+  std::vector< int > _ptr;     //!< 各行の先頭の位置
+  std::vector< int > _idx;     //!< 列番号
+  std::vector< int > _diag;    //!< 各行の対角成分の位置
+  std::vector< double > _val;  //!< L（対角の 1 は持たない）と U の値
+
+ public:
+  explicit MyPrecondILU0( const MySpMat &A ){
+    compute( A );
+  }
+
+  explicit MyPrecondILU0( const MyMatView &A ){
+    compute( MySpMat( A ) );
+  }
+
+  /**
+   * 分解する
+   * @return 0:成功、0以外:失敗（U の対角にゼロが出た）
+   */
+  int compute( const MySpMat &A ){
+    int N = A.rows();
+    assert( A.cols() == N );
+    _ptr = A.rowPtr();
+    _idx = A.colIdx();
+    _val = A.values();
+    _diag.assign( N, -1 );
+    for( int i = 0; i < N; i++ ){
+      for( int q = _ptr[ i ]; q < _ptr[ i + 1 ]; q++ ) if( _idx[ q ] == i ) _diag[ i ] = q;
+      assert( _diag[ i ] >= 0 );
+    }//i
+
+    // i 行目の k < i の要素について、k 行目を使って消去する（IKJ 版）。パターンの外への書き込みは捨てる。
+    std::vector< int > pos( N, -1 );
+    for( int i = 0; i < N; i++ ){
+      for( int q = _ptr[ i ]; q < _ptr[ i + 1 ]; q++ ) pos[ _idx[ q ] ] = q;
+      for( int q = _ptr[ i ]; q < _diag[ i ]; q++ ){
+        int k = _idx[ q ];
+        double ukk = _val[ _diag[ k ] ];
+        if( ukk == 0 ) return -1;
+        double l = _val[ q ] / ukk;
+        _val[ q ] = l;
+        for( int p = _diag[ k ] + 1; p < _ptr[ k + 1 ]; p++ ){
+          int j = pos[ _idx[ p ] ];
+          if( j >= 0 ) _val[ j ] -= l * _val[ p ];
+        }//p
+      }//q
+      for( int q = _ptr[ i ]; q < _ptr[ i + 1 ]; q++ ) pos[ _idx[ q ] ] = -1;
+      if( _val[ _diag[ i ] ] == 0 ) return -1;
+    }//i
+    return 0;
+  }
+
+  void apply( const std::vector< double > &r, std::vector< double > &z ) const {
+    int N = _diag.size();
+
+    // 前進代入：L y = r
+    for( int i = 0; i < N; i++ ){
+      double s = r[ i ];
+      for( int q = _ptr[ i ]; q < _diag[ i ]; q++ ) s -= _val[ q ] * z[ _idx[ q ] ];
+      z[ i ] = s;
+    }//i
+
+    // 後退代入：U z = y
+    for( int i = N - 1; i >= 0; i-- ){
+      double s = z[ i ];
+      for( int q = _diag[ i ] + 1; q < _ptr[ i + 1 ]; q++ ) s -= _val[ q ] * z[ _idx[ q ] ];
+      z[ i ] = s / _val[ _diag[ i ] ];
+    }//i
+  }
+};
+
+/**
+ * ブロックヤコビ前処理
+ * - 対角に並ぶ bs x bs のブロック（最後は余り）だけを取り出して LU 分解しておき、ブロックごとに解く。
+ * - ブロックどうしは独立なので、適用は複数のスレッドで計算する。
+ * - 各対角ブロックは正則であること。
+ */
+class MyPrecondBlockJacobi : public MyPrecond
+{
+  int _bs;                          //!< ブロックの大きさ
+  std::vector< MyLUFactor > _lu;    //!< 対角ブロックの LU 分解
+
+ public:
+  MyPrecondBlockJacobi( const MySpMat &A, int bs ) : _bs( bs ) {
+    int N = A.rows();
+    assert( A.cols() == N && bs > 0 );
+    const std::vector< int > &ptr = A.rowPtr();
+    const std::vector< int > &idx = A.colIdx();
+    const std::vector< double > &val = A.values();
+    MyMat D;
+    for( int i0 = 0; i0 < N; i0 += bs ){
+      int n = MyMin( bs, N - i0 );
+      D.resize( n, n );
+      D.fill( 0 );
+      for( int i = i0; i < i0 + n; i++ ){
+        for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+          if( idx[ q ] >= i0 && idx[ q ] < i0 + n ) D( i - i0, idx[ q ] - i0 ) = val[ q ];
+        }//q
+      }//i
+      _lu.push_back( MyLUFactor( D ) );
+      assert( _lu.back().ok() );
+    }//i0
+  }
+
+  MyPrecondBlockJacobi( const MyMatView &A, int bs ) : _bs( bs ) {
+    int N = A.rows();
+    assert( A.cols() == N && bs > 0 );
+    for( int i0 = 0; i0 < N; i0 += bs ){
+      int n = MyMin( bs, N - i0 );
+      _lu.push_back( MyLUFactor( A.block( i0, i0, n, n ) ) );
+      assert( _lu.back().ok() );
+    }//i0
+  }
+
+  void apply( const std::vector< double > &r, std::vector< double > &z ) const {
+    int nb = _lu.size();
+#ifdef _OPENMP
+    int nt = MyNumThreadsFor( 2.0 * _bs * r.size() );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int t = 0; t < nb; t++ ){
+      int i0 = t * _bs, n = _lu[ t ].size();
+      MyMatView Rv( const_cast< double * >( &r[ i0 ] ), n, 1, 1 );
+      MyMat Zv( &z[ i0 ], n, 1, 1 );
+      _lu[ t ].solve( Rv, Zv );
+    }//t
+  }
+};
+
+/**
+ * 連立一次方程式を解く
+ * - Ax = b
+ * - （前処理つき）共役勾配法（CG 法）
+ * - 係数行列は対称正定値であること。前処理の M も対称正定値であること。
+ * - １回の反復で A x を１回、前処理を１回計算する。A は MyMat、MySpMat、vector< vector< double > >、
+ *   または y = A x を計算する関数オブジェクト（この節の先頭を参照）。
+ * - 密行列のヤコビ法、ガウスザイデル法に比べて、条件数の悪い問題でも収束が速い（反復回数は条件数の平方根に比例）。
+ * @param A 係数行列
+ * @param[in,out] x 解ベクトル。初期値を入れておく or 初期値なしの空ベクトル。空の場合は初期値 0 。
+ * @param b 定数ベクトル。
+ * @param M 前処理（0 なら前処理なし）
+ * @param thres 収束条件：相対残差 || b - A x || / || b || がこの値を下回ったら計算終了
+ * @param max_itr_num 収束条件：繰り返し計算の最大繰り返し回数。
+ * @param[out] info 反復回数と残差の履歴（不要なら 0）
+ * @param dout デバッグ情報の表示
+ * @return 0:収束した、0以外:収束しなかった
+ */
+template < class Op >
+inline
+int
+MyAxbSolve_CG( const Op &A,
+               std::vector< double > &x,
+               const std::vector< double > &b,
+               const MyPrecond *M = 0,
+               double thres = 1E-06,
+               int max_itr_num = 1000,
+               MyIterInfo *info = 0,
+               std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = b.size();
+
+  // 入力チェック
+  assert( N > 0 );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+  if( info ){
+    info->history.clear();
+    info->converged = false;
+  }
+
+  // 一時変数（作業領域から借りる）
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  vector< double > &r = ws.vec( N ), &z = ws.vec( N ), &p = ws.vec( N ), &q = ws.vec( N );
+
+  // 初期残差 r = b - A x
+  MyLinOpApply( A, x, q );
+  for( int i = 0; i < N; i++ ) r[ i ] = b[ i ] - q[ i ];
+  double bnorm = MyParNorm( b );
+  if( bnorm == 0 ) bnorm = 1;
+  double res = MyParNorm( r ) / bnorm;
+  if( info ) info->history.push_back( res );
+  if( dout ) *dout << "--- MyAxbSolve_CG() ---" << endl << "[0]\t res: " << res << endl;
+
+  bool converged = ( res < thres );
+  int k = 0;
+  if( ! converged ){
+    if( M ) M->apply( r, z );
+    else z = r;
+    p = z;
+    double rz = MyParDot( r, z );
+
+    // 反復処理
+    for( k = 0; k < max_itr_num; k++ ){
+      MyLinOpApply( A, p, q );
+      double pq = MyParDot( p, q );
+      if( ! ( pq > 0 ) ) break; // 正定値でない
+
+      double alpha = rz / pq;
+      MyParAxpby( alpha, p, 1, x );
+      MyParAxpby( -alpha, q, 1, r );
+
+      // 収束判定
+      res = MyParNorm( r ) / bnorm;
+      if( info ) info->history.push_back( res );
+      if( dout ) *dout << "[" << k + 1 << "]\t res: " << res << endl;
+      if( res < thres ){
+        converged = true;
+        k++;
+        break;
+      }
+
+      // 次の探索方向 p = z + β p
+      if( M ) M->apply( r, z );
+      else z = r;
+      double rz_next = MyParDot( r, z );
+      double beta = rz_next / rz;
+      rz = rz_next;
+      MyParAxpby( 1, z, beta, p );
+    }//k
+  }
+
+  if( info ){
+    info->itr = k;
+    info->res = res;
+    info->converged = converged;
+  }
+  return converged ? 0 : -1;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - Ax = b
+ * - （前処理つき）リスタート付き GMRES 法（GMRES(m)）
+ * - 係数行列は正則ならよい（対称でなくても、対角優位でなくてもよい）。
+ * - m 回の反復ごとにリスタートする。１回の反復で A x を１回、前処理を１回計算し、
+ *   それまでの基底ベクトルとの直交化（修正グラム・シュミット法）に O(m N) かかる。メモリは (m + 1) N 。
+ * - 前処理は右から掛ける（A M^-1 u = b を解いて x = M^-1 u）ので、反復中の残差は前処理をしない元の方程式の残差。
+ * - 係数行列の渡し方、info、収束判定は MyAxbSolve_CG() と同じ。max_itr_num は内側の反復の合計回数。
+ * @param restart リスタートまでの反復回数 m
+ * @return 0:収束した、0以外:収束しなかった
+ */
+template < class Op >
+inline
+int
+MyAxbSolve_GMRES( const Op &A,
+                  std::vector< double > &x,
+                  const std::vector< double > &b,
+                  const MyPrecond *M = 0,
+                  int restart = 30,
+                  double thres = 1E-06,
+                  int max_itr_num = 1000,
+                  MyIterInfo *info = 0,
+                  std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = b.size();
+  int m = MyMin( restart, N );
+
+  // 入力チェック
+  assert( N > 0 && restart > 0 );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+  if( info ){
+    info->history.clear();
+    info->converged = false;
+  }
+
+  // 一時変数（作業領域から借りる）。V の各行が基底ベクトル。
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  MyMat &V = ws.mat( m + 1, N ), &H = ws.mat( m + 1, m );
+  vector< double > &cs = ws.vec( m ), &sn = ws.vec( m ), &g = ws.vec( m + 1 );
+  vector< double > &w = ws.vec( N ), &t = ws.vec( N ), &z = ws.vec( N );
+
+  double bnorm = MyParNorm( b );
+  if( bnorm == 0 ) bnorm = 1;
+  if( dout ) *dout << "--- MyAxbSolve_GMRES() ---" << endl;
+
+  bool converged = false;
+  int total = 0;
+  double res = 0;
+  for( ;; ){
+    // 残差 r = b - A x（リスタートのたびに計算し直す）
+    MyLinOpApply( A, x, w );
+    for( int i = 0; i < N; i++ ) t[ i ] = b[ i ] - w[ i ];
+    double beta = MyParNorm( t );
+    res = beta / bnorm;
+    if( total == 0 ){
+      if( info ) info->history.push_back( res );
+      if( dout ) *dout << "[0]\t res: " << res << endl;
+    }
+    if( res < thres ){
+      converged = true;
+      break;
+    }
+    if( total >= max_itr_num ) break;
+
+    MyParAxpby( 1 / beta, &t[ 0 ], 0, V[ 0 ], N );
+    std::fill( g.begin(), g.end(), 0.0 );
+    g[ 0 ] = beta;
+
+    // アーノルディ過程
+    int j = 0;
+    bool breakdown = false;
+    while( j < m && total < max_itr_num ){
+      total++;
+
+      // w = A M^-1 v_j
+      std::copy( V[ j ], V[ j ] + N, t.begin() );
+      if( M ) M->apply( t, z );
+      else z = t;
+      MyLinOpApply( A, z, w );
+
+      // 修正グラム・シュミット法で直交化
+      for( int i = 0; i <= j; i++ ){
+        double h = MyParDot( &w[ 0 ], V[ i ], N );
+        H( i, j ) = h;
+        MyParAxpby( -h, V[ i ], 1, &w[ 0 ], N );
+      }//i
+      double h = MyParNorm( w );
+      H( j + 1, j ) = h;
+      if( h != 0 ) MyParAxpby( 1 / h, &w[ 0 ], 0, V[ j + 1 ], N );
+
+      // これまでのギブンス回転を新しい列に掛けてから、H( j + 1, j ) を消す回転を作る
+      for( int i = 0; i < j; i++ ){
+        double a = cs[ i ] * H( i, j ) + sn[ i ] * H( i + 1, j );
+        H( i + 1, j ) = -sn[ i ] * H( i, j ) + cs[ i ] * H( i + 1, j );
+        H( i, j ) = a;
+      }//i
+      double rr = sqrt( H( j, j ) * H( j, j ) + h * h );
+      if( rr == 0 ){
+        breakdown = true;
+        break;
+      }
+      cs[ j ] = H( j, j ) / rr;
+      sn[ j ] = h / rr;
+      H( j, j ) = rr;
+      H( j + 1, j ) = 0;
+      g[ j + 1 ] = -sn[ j ] * g[ j ];
+      g[ j ] = cs[ j ] * g[ j ];
+      j++;
+
+      // 収束判定（回転後の右辺の最後の要素が残差のノルム）
+      res = MyAbs( g[ j ] ) / bnorm;
+      if( info ) info->history.push_back( res );
+      if( dout ) *dout << "[" << total << "]\t res: " << res << endl;
+      if( res < thres || h == 0 ) break;
+    }//j
+
+    // 上三角の H y = g を解いて、x += M^-1 V^T y
+    for( int i = j - 1; i >= 0; i-- ){
+      double s = g[ i ];
+      for( int k = i + 1; k < j; k++ ) s -= H( i, k ) * g[ k ];
+      g[ i ] = s / H( i, i );
+    }//i
+    std::fill( t.begin(), t.end(), 0.0 );
+    for( int i = 0; i < j; i++ ) MyParAxpby( g[ i ], V[ i ], 1, &t[ 0 ], N );
+    if( M ) M->apply( t, z );
+    else z = t;
+    MyParAxpby( 1, z, 1, x );
+    if( breakdown ) break;
+  }
+
+  if( info ){
+    info->itr = total;
+    info->res = res;
+    info->converged = converged;
+  }
+  return converged ? 0 : -1;
+}
+
+/**
+ * 連立一次方程式を解く
+ * - Ax = b
+ * - （前処理つき）BiCGSTAB 法
+ * - 係数行列は正則ならよい（対称でなくてもよい）。GMRES(m) と違ってメモリは一定（ベクトル 8 本）。
+ *   ただし残差は単調には減らず、まれに途中で破綻する（その場合は収束しなかったとして返る）。
+ * - １回の反復で A x を２回、前処理を２回計算する。前処理は右から掛ける。
+ * - 収束したら本当の残差 b - A x を計算し直して確かめる（足りなければそこから反復をやり直す）。
+ * - 係数行列の渡し方、info、収束判定は MyAxbSolve_CG() と同じ。
+ * @return 0:収束した、0以外:収束しなかった
+ */
+template < class Op >
+inline
+int
+MyAxbSolve_BiCGSTAB( const Op &A,
+                     std::vector< double > &x,
+                     const std::vector< double > &b,
+                     const MyPrecond *M = 0,
+                     double thres = 1E-06,
+                     int max_itr_num = 1000,
+                     MyIterInfo *info = 0,
+                     std::ostream *dout = 0 ){
+  using namespace std;
+
+  // 次元
+  int N = b.size();
+
+  // 入力チェック
+  assert( N > 0 );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+  if( info ){
+    info->history.clear();
+    info->converged = false;
+  }
+
+  // 一時変数（作業領域から借りる）
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  vector< double > &r = ws.vec( N ), &r0 = ws.vec( N ), &p = ws.vec( N ), &v = ws.vec( N );
+  vector< double > &s = ws.vec( N ), &t = ws.vec( N ), &ph = ws.vec( N ), &sh = ws.vec( N );
+
+  // 初期残差 r = b - A x
+  MyLinOpApply( A, x, t );
+  for( int i = 0; i < N; i++ ) r[ i ] = b[ i ] - t[ i ];
+  r0 = r;
+  std::fill( p.begin(), p.end(), 0.0 );
+  std::fill( v.begin(), v.end(), 0.0 );
+  double bnorm = MyParNorm( b );
+  if( bnorm == 0 ) bnorm = 1;
+  double res = MyParNorm( r ) / bnorm;
+  if( info ) info->history.push_back( res );
+  if( dout ) *dout << "--- MyAxbSolve_BiCGSTAB() ---" << endl << "[0]\t res: " << res << endl;
+
+  bool converged = ( res < thres );
+  double rho = 1, alpha = 1, omega = 1;
+  int k = 0;
+  for( ; ! converged && k < max_itr_num; k++ ){
+    double rho_next = MyParDot( r0, r );
+    if( rho_next == 0 || omega == 0 ) break; // 破綻
+    double beta = ( rho_next / rho ) * ( alpha / omega );
+    rho = rho_next;
+
+    // p = r + β ( p - ω v )
+    MyParAxpby( -omega, v, 1, p );
+    MyParAxpby( 1, r, beta, p );
+    if( M ) M->apply( p, ph );
+    else ph = p;
+    MyLinOpApply( A, ph, v );
+    double r0v = MyParDot( r0, v );
+    if( r0v == 0 ) break; // 破綻
+    alpha = rho / r0v;
+
+    // s = r - α v
+    s = r;
+    MyParAxpby( -alpha, v, 1, s );
+    if( MyParNorm( s ) / bnorm < thres ){
+      MyParAxpby( alpha, ph, 1, x );
+      r = s;
+      res = MyParNorm( r ) / bnorm;
+      converged = true;
+    }
+    else{
+      if( M ) M->apply( s, sh );
+      else sh = s;
+      MyLinOpApply( A, sh, t );
+      double tt = MyParDot( t, t );
+      omega = ( tt == 0 ) ? 0 : MyParDot( t, s ) / tt;
+
+      // x += α p^ + ω s^ 、r = s - ω t
+      MyParAxpby( alpha, ph, 1, x );
+      MyParAxpby( omega, sh, 1, x );
+      r = s;
+      MyParAxpby( -omega, t, 1, r );
+      res = MyParNorm( r ) / bnorm;
+      converged = ( res < thres );
+    }
+
+    // 漸化式で更新した残差は丸め誤差で本当の残差からずれていくので、収束したら計算し直して確かめる。
+    // まだ収束していなければ、本当の残差から反復をやり直す。
+    if( converged ){
+      MyLinOpApply( A, x, t );
+      for( int i = 0; i < N; i++ ) r[ i ] = b[ i ] - t[ i ];
+      res = MyParNorm( r ) / bnorm;
+      if( res >= thres ){
+        converged = false;
+        r0 = r;
+        std::fill( p.begin(), p.end(), 0.0 );
+        std::fill( v.begin(), v.end(), 0.0 );
+        rho = alpha = omega = 1;
+      }
+    }
+    if( info ) info->history.push_back( res );
+    if( dout ) *dout << "[" << k + 1 << "]\t res: " << res << endl;
+  }//k
+
+  if( info ){
+    info->itr = k;
+    info->res = res;
+    info->converged = converged;
+  }
+  return converged ? 0 : -1;
+}
+
+/*
+ * --- マルチグリッド法 ---
+ * - ガウスザイデル法などの反復法は、細かく振動する誤差はすぐ消えるが、なめらかな（低周波の）誤差はなかなか消えない。
+ *   そこで、数回反復して（平滑化）残った誤差を粗い格子に移して解き、その結果で細かい格子の解を補正する。これを再帰的に繰り返す。
+ *   １回のサイクルで誤差が減る割合が格子の大きさにほとんどよらないので、計算量は未知数の数にほぼ比例する。
+ * - 細かい格子と粗い格子の間の移し方（延長 P：粗 → 細、制限 R = P^T：細 → 粗）は２通り。
+ *   - 幾何的：width x height の２次元格子（MyImageDat と同じ並び、i = y * width + x）を、縦横 1/2 に間引く。
+ *     延長は双線形補間。MyGridProlongation()、MyMultigrid::setupGrid()
+ *   - 代数的（AMG）：格子の形を使わず、行列の値の大きさ（強く結合している未知数どうし）で未知数をまとめ、
+ *     まとまりごとに１つの粗い未知数にする（smoothed aggregation）。MySpMatAggregate()、MyMultigrid::setupAMG()
+ * - 粗い格子の係数行列は A_c = R A P（ガラーキン近似）。一番粗い格子は LU 分解で直接解く。
+ * - 平滑化には MyAxbSolve_GaussSeidel()、MyAxbSolve_SSOR()（ω = 1）、MyAxbSolve_Jacobi()（ω = 2/3）を使う。
+ * - MyMultigrid は MyPrecond の派生クラスなので、そのまま CG 法などの前処理にも使える。
+ */
+
+/**
+ * ２次元格子の延長の行列（双線形補間）
+ * - 細かい格子 width x height と、粗い格子 ( width + 1 ) / 2 x ( height + 1 ) / 2 の間の行列（( width * height ) x ( 粗い格子の数 )）。
+ * - 粗い格子の点 ( X, Y ) は、細かい格子の点 ( 2X, 2Y ) に重なる。その間の点は両隣の平均。
+ *   幅が偶数のとき、右端の列は右隣の粗い点がないので、その外側を 0 として平均する（ディリクレ境界条件と同じ扱い）。
+ *   左隣の値をそのまま使うと、ディリクレ境界の問題で境界付近の補正が合わず、レベルが増えるほど収束が遅くなる。
+ *   幅と高さが 2^k + 1 のときが一番素直（間引いても端の点がそのまま残る）。
+ * - 転置が制限の行列（重みは 1/16, 1/8, 1/4 の full weighting の 4 倍）。
+ */
+inline
+MySpMat
+MyGridProlongation( int width, int height ){
+  assert( width >= 2 && height >= 2 );
+  int wc = ( width + 1 ) / 2, hc = ( height + 1 ) / 2;
+
+  // １次元の補間の重み。fine 座標 x に対して、粗い座標 c[ 0 ], c[ 1 ] と重み w[ 0 ], w[ 1 ]
+  struct Interp {
+    static int get( int x, int nc, int *c, double *w ){
+      if( x % 2 == 0 ){
+        c[ 0 ] = x / 2;
+        w[ 0 ] = 1;
+        return 1;
+      }
+      if( ( x + 1 ) / 2 >= nc ){
+        c[ 0 ] = x / 2;
+        w[ 0 ] = 0.5;
+        return 1;
+      }
+      c[ 0 ] = x / 2;
+      c[ 1 ] = x / 2 + 1;
+      w[ 0 ] = w[ 1 ] = 0.5;
+      return 2;
+    }
+  };
+
+  std::vector< MySpTriplet > t;
+  t.reserve( width * height * 4 );
+  for( int y = 0; y < height; y++ ){
+    int cy[ 2 ], ny;
+    double wy[ 2 ];
+    ny = Interp::get( y, hc, cy, wy );
+    for( int x = 0; x < width; x++ ){
+      int cx[ 2 ], nx;
+      double wx[ 2 ];
+      nx = Interp::get( x, wc, cx, wx );
+      for( int a = 0; a < ny; a++ ){
+        for( int c = 0; c < nx; c++ ) t.push_back( MySpTriplet( y * width + x, cy[ a ] * wc + cx[ c ], wy[ a ] * wx[ c ] ) );
+      }//a
+    }//x
+  }//y
+  return MySpMat( width * height, wc * hc, t );
+}
+
+/**
+ * 疎行列の未知数を、強く結合しているものどうしでまとめる（アグリゲーション）
+ * - i と j（i ≠ j）は、| a_ij | >= theta * sqrt( | a_ii a_jj | ) のとき強く結合しているとする。
+ * - 1) 強い結合の相手がまだどこにも入っていない点を選んで、その点と相手全部で新しいまとまりを作る。
+ *   2) 残った点は、1) でできたまとまりのうち、一番強く結合しているものに入れる。
+ *   3) それでも残った点は、まだ入っていない強い結合の相手と一緒に新しいまとまりを作る。
+ * - ２次元の５点差分なら、まとまりはほぼ 3x3 の大きさになる。
+ * @param[out] agg 各未知数が入ったまとまりの番号
+ * @return まとまりの数
+ */
+inline
+int
+MySpMatAggregate( const MySpMat &A, std::vector< int > &agg, double theta = 0.08 ){
+  int N = A.rows();
+  assert( A.cols() == N );
+  const std::vector< int > &ptr = A.rowPtr(), &idx = A.colIdx();
+  const std::vector< double > &val = A.values();
+  std::vector< double > d;
+  A.diag( d );
+
+  // 強い結合かどうか
+  std::vector< char > strong( A.nnz(), 0 );
+  for( int i = 0; i < N; i++ ){
+    for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+      int j = idx[ q ];
+      strong[ q ] = ( j != i && MyAbs( val[ q ] ) >= theta * std::sqrt( MyAbs( d[ i ] * d[ j ] ) ) );
+    }//q
+  }//i
+
+  // 1) 強い結合の相手が全部まだ入っていない点から、まとまりを作る
+  agg.assign( N, -1 );
+  int n = 0;
+  for( int i = 0; i < N; i++ ){
+    if( agg[ i ] >= 0 ) continue;
+    bool free = true;
+    for( int q = ptr[ i ]; q < ptr[ i + 1 ] && free; q++ ){
+      if( strong[ q ] && agg[ idx[ q ] ] >= 0 ) free = false;
+    }//q
+    if( ! free ) continue;
+    agg[ i ] = n;
+    for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+      if( strong[ q ] ) agg[ idx[ q ] ] = n;
+    }//q
+    n++;
+  }//i
+
+  // 2) 残った点を、1) のまとまりのうち一番強く結合しているものに入れる
+  std::vector< int > agg1( agg );
+  for( int i = 0; i < N; i++ ){
+    if( agg1[ i ] >= 0 ) continue;
+    double amax = 0;
+    for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+      if( strong[ q ] && agg1[ idx[ q ] ] >= 0 && MyAbs( val[ q ] ) > amax ){
+        amax = MyAbs( val[ q ] );
+        agg[ i ] = agg1[ idx[ q ] ];
+      }
+    }//q
+  }//i
+
+  // 3) それでも残った点から、新しいまとまりを作る
+  for( int i = 0; i < N; i++ ){
+    if( agg[ i ] >= 0 ) continue;
+    agg[ i ] = n;
+    for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+      if( strong[ q ] && agg[ idx[ q ] ] < 0 ) agg[ idx[ q ] ] = n;
+    }//q
+    n++;
+  }//i
+
+  return n;
+}
+
+// マルチグリッド法で一番粗いレベルを密行列の LU 分解で解く未知数の数の上限（setupGrid() で使う）
+#ifndef MY_MG_DIRECT_MAX
+#define MY_MG_DIRECT_MAX 1024
+#endif
+
+/**
+ * マルチグリッド法の平滑化の方法
+ */
+enum MyMGSmootherType {
+  MY_MG_GAUSS_SEIDEL = 0,        //!< ガウスザイデル法（MyAxbSolve_GaussSeidel）
+  MY_MG_SYMMETRIC_GAUSS_SEIDEL,  //!< 前向きと後ろ向きのガウスザイデル法（MyAxbSolve_SSOR で ω = 1）
+  MY_MG_JACOBI                   //!< 重み付きヤコビ法（MyAxbSolve_Jacobi で ω = 2/3）
+};
+
+/**
+ * マルチグリッド法
+ * - 使い方：
+ *     MyMultigrid mg;                      // ガウスザイデル法で前後２回ずつ平滑化する V サイクル
+ *     mg.setupGrid( A, width, height );    // 画像の格子の問題。一般の疎行列なら mg.setupAMG( A )
+ *     MyAxbSolve_MG( mg, x, b );           // サイクルを繰り返して解く
+ *     MyAxbSolve_CG( A, x, b, &mg );       // CG 法の前処理にする場合
+ * - cycle が 1 なら V サイクル、2 なら W サイクル（各レベルで粗い格子を２回ずつ解く。計算量は増えるが１回あたりの収束は速い）。
+ *   setupAMG() は１レベルで未知数が 1/9 くらいまで減るので、W サイクルにしても計算量はあまり増えない。
+ *   V サイクルだと問題が大きくなるにつれてサイクル数が増えるので、AMG は W サイクルか、CG 法の前処理として使う。
+ * - CG 法の前処理にするときは、前処理が対称になるように MY_MG_SYMMETRIC_GAUSS_SEIDEL か MY_MG_JACOBI で、
+ *   前後の平滑化の回数を同じにする。
+ * - 各レベルの係数行列を持つ（メモリは元の行列の 2 倍弱）。apply() は作業領域しか使わないので、複数のスレッドから同時に呼べる。
+ * - 一番粗いレベルは密行列にして LU 分解で解く。ただし、未知数が多いまま粗くできなくなった場合
+ *  （setupAMG() でまとめても減らない、setupGrid() で MY_MG_DIRECT_MAX より多い）は、O(N^2) のメモリを使わないように、
+ *   一番粗いレベルも平滑化（前後の回数の和）だけにする。
+ */
+class MyMultigrid : public MyPrecond
+{
+  std::vector< MySpMat > _a;  //!< 各レベルの係数行列（0 が一番細かい）
+  std::vector< MySpMat > _p;  //!< 延長（レベル l + 1 → l）
+  std::vector< MySpMat > _r;  //!< 制限（レベル l → l + 1）。_p の転置
+  MyLUFactor _coarse;         //!< 一番粗いレベルの LU 分解
+  bool _direct;               //!< 一番粗いレベルを LU 分解で解くか（false なら平滑化だけ）
+  MyMGSmootherType _smoother; //!< 平滑化の方法
+  int _cycle;                 //!< 1:V サイクル、2:W サイクル
+  int _nu1;                   //!< 前平滑化の回数
+  int _nu2;                   //!< 後平滑化の回数
+
+  // 延長の行列を足して、次のレベルの係数行列 A_c = P^T A P を作る
+  void addLevel( const MySpMat &P ){
+    _p.push_back( P );
+    _r.push_back( P.trans() );
+    _a.push_back( MySpMatMul( _r.back(), MySpMatMul( _a[ _a.size() - 1 ], P ) ) );
+  }
+
+  // 一番粗いレベルを LU 分解する（未知数が max_direct より多ければ、分解せずに平滑化だけにする）
+  int setupCoarse( int max_direct ){
+    _direct = ( _a.back().rows() <= max_direct );
+    if( ! _direct ){
+      _coarse = MyLUFactor();
+      return 0;
+    }
+    MyMat C;
+    _a.back().get( C );
+    return _coarse.compute( C );
+  }
+
+  // 平滑化を n 回
+  void smooth( int l, std::vector< double > &x, const std::vector< double > &b, int n ) const {
+    if( n <= 0 ) return;
+    if( _smoother == MY_MG_GAUSS_SEIDEL ) MyAxbSolve_GaussSeidel( _a[ l ], x, b, 0, n );
+    else if( _smoother == MY_MG_SYMMETRIC_GAUSS_SEIDEL ) MyAxbSolve_SSOR( _a[ l ], x, b, 1.0, 0, n );
+    else MyAxbSolve_Jacobi( _a[ l ], x, b, 0, n, 0, 2.0 / 3 );
+  }
+
+ public:
+  MyMultigrid( MyMGSmootherType smoother = MY_MG_GAUSS_SEIDEL, int cycle = 1, int nu1 = 2, int nu2 = 2 )
+    : _direct( false ), _smoother( smoother ), _cycle( cycle ), _nu1( nu1 ), _nu2( nu2 ) {
+    assert( cycle >= 1 );
+  }
+
+  /**
+   * ２次元格子の問題として準備する（幾何的マルチグリッド）
+   * - A の未知数は width x height の格子の点（i = y * width + x）。５点差分、９点差分など、近くの点どうしの結合であること。
+   * - 格子の点の数が coarse_size 以下になるか、縦横どちらかが 2 以下になるまで、縦横 1/2 に間引いていく。
+   *   細長い格子で、一番粗い格子の点が MY_MG_DIRECT_MAX（と coarse_size の大きい方）より多く残った場合は、そのレベルは平滑化だけにする。
+   * @return 0:成功、-1:一番粗い格子の行列が正則でない
+   */
+  int setupGrid( const MySpMat &A, int width, int height, int coarse_size = 64 ){
+    assert( A.rows() == width * height && A.cols() == width * height );
+    _a.assign( 1, A );
+    _p.clear();
+    _r.clear();
+    while( width * height > coarse_size && width > 2 && height > 2 ){
+      addLevel( MyGridProlongation( width, height ) );
+      width = ( width + 1 ) / 2;
+      height = ( height + 1 ) / 2;
+    }
+    return setupCoarse( MyMax( coarse_size, MY_MG_DIRECT_MAX ) );
+  }
+
+  /**
+   * 一般の疎行列の問題として準備する（アグリゲーションによる代数的マルチグリッド）
+   * - MySpMatAggregate() でまとめた未知数に、まとまりごとに 1 を入れたもの（区分的に定数）を、
+   *   重み付きヤコビ法１回分でなめらかにして延長とする：P = ( I - ω D^-1 A ) P0 、ω = 4 / ( 3 ρ ) 。
+   *   ρ は D^-1 A の固有値の最大値で、ここでは上界 max_i Σ_j | a_ij | / | a_ii | を使う。
+   * - 未知数の数が coarse_size 以下になるか、まとめても減らなくなるまで繰り返す。
+   *   まとめても減らない（強い結合がない。対角優位が強いので平滑化だけでよく収束する）まま coarse_size より多く残った場合は、
+   *   一番粗いレベルを密行列にせず、平滑化だけにする（元の行列のままのこともある）。
+   * - 対称正定値（に近い）行列向け。対角成分はすべて非ゼロであること。
+   * @param theta 強い結合の判定のしきい値（MySpMatAggregate()）
+   * @return 0:成功、-1:一番粗い格子の行列が正則でない
+   */
+  int setupAMG( const MySpMat &A, double theta = 0.08, int coarse_size = 64 ){
+    assert( A.rows() == A.cols() );
+    _a.assign( 1, A );
+    _p.clear();
+    _r.clear();
+    std::vector< int > agg;
+    std::vector< double > d;
+    while( _a.back().rows() > coarse_size ){
+      const MySpMat &Al = _a.back();
+      int N = Al.rows();
+      int nc = MySpMatAggregate( Al, agg, theta );
+      if( nc >= N ) break;
+
+      // ρ( D^-1 A ) の上界
+      const std::vector< int > &ptr = Al.rowPtr(), &idx = Al.colIdx();
+      const std::vector< double > &val = Al.values();
+      Al.diag( d );
+      double rho = 0;
+      for( int i = 0; i < N; i++ ){
+        assert( d[ i ] != 0 );
+        double s = 0;
+        for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ) s += MyAbs( val[ q ] );
+        rho = MyMax( rho, s / MyAbs( d[ i ] ) );
+      }//i
+      double omega = 4.0 / ( 3.0 * rho );
+
+      // P = ( I - ω D^-1 A ) P0 。P0 は i 行目の agg[ i ] 列だけが 1 なので、S P0 の各要素は S の要素を列 agg[ j ] に足したもの
+      std::vector< MySpTriplet > t;
+      t.reserve( Al.nnz() + N );
+      for( int i = 0; i < N; i++ ){
+        t.push_back( MySpTriplet( i, agg[ i ], 1 ) );
+        for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ) t.push_back( MySpTriplet( i, agg[ idx[ q ] ], - omega * val[ q ] / d[ i ] ) );
+      }//i
+      addLevel( MySpMat( N, nc, t ) );
+    }
+    return setupCoarse( coarse_size );
+  }
+
+  /**
+   * レベルの数（一番粗いレベルを含む）
+   */
+  int levels() const { return _a.size(); }
+
+  /**
+   * 一番粗いレベルを LU 分解で解くか（false なら平滑化だけ）
+   */
+  bool direct() const { return _direct; }
+
+  /**
+   * レベル l の係数行列（0 が元の行列）
+   */
+  const MySpMat & matrix( int l ) const { return _a[ l ]; }
+
+  /**
+   * 元の問題の未知数の数
+   */
+  int size() const { return _a.empty() ? 0 : _a[ 0 ].rows(); }
+
+  /**
+   * レベル l の問題 A_l x = b を、１サイクル分だけ解き進める
+   * - 前平滑化 → 残差を制限 → 粗いレベルで誤差の方程式を解く（V サイクルなら１回、W サイクルなら２回）→ 延長して補正 → 後平滑化。
+   */
+  void cycle( int l, std::vector< double > &x, const std::vector< double > &b ) const {
+    int L = _a.size() - 1;
+    assert( l >= 0 && l <= L );
+    if( l == L ){
+      if( _direct ) _coarse.solve( b, x );
+      else smooth( l, x, b, _nu1 + _nu2 );
+      return;
+    }
+    smooth( l, x, b, _nu1 );
+
+    // 残差を粗いレベルに移す
+    int N = _a[ l ].rows(), Nc = _a[ l + 1 ].rows();
+    MyWorkspaceScope scope;
+    std::vector< double > &r = scope.workspace().vec( N );
+    std::vector< double > &bc = scope.workspace().vec( Nc );
+    std::vector< double > &xc = scope.workspace().vec( Nc );
+    MySpMatVecMulInto( _a[ l ], x, r );
+    for( int i = 0; i < N; i++ ) r[ i ] = b[ i ] - r[ i ];
+    MySpMatVecMulInto( _r[ l ], r, bc );
+
+    // 粗いレベルで誤差を求める（一番粗いレベルを直接解くなら１回で十分）
+    std::fill( xc.begin(), xc.end(), 0.0 );
+    int ncycle = ( l + 1 == L && _direct ) ? 1 : _cycle;
+    for( int c = 0; c < ncycle; c++ ) cycle( l + 1, xc, bc );
+
+    // 延長して補正
+    MySpMatVecMulInto( _p[ l ], xc, r );
+    for( int i = 0; i < N; i++ ) x[ i ] += r[ i ];
+
+    smooth( l, x, b, _nu2 );
+  }
+
+  /**
+   * 前処理として：z = M^-1 r（初期値 0 から１サイクル）
+   */
+  void apply( const std::vector< double > &r, std::vector< double > &z ) const {
+    assert( ! _a.empty() );
+    std::fill( z.begin(), z.end(), 0.0 );
+    cycle( 0, z, r );
+  }
+};
+
+/**
+ * 連立一次方程式を解く
+ * - マルチグリッド法。準備済みの MyMultigrid のサイクルを、収束するまで繰り返す。
+ * - 収束判定はクリロフ部分空間法と同じく相対残差 || b - A x || / || b || 。
+ * @param mg setupGrid() か setupAMG() で準備したもの
+ * @param[in,out] x 解ベクトル。初期値を入れておく or 初期値なしの空ベクトル。空の場合は初期値 0 。
+ * @param thres 収束条件：相対残差がこの値を下回ったら計算終了
+ * @param max_itr_num 収束条件：サイクルの最大回数
+ * @param info 反復回数と残差の履歴（不要なら 0）
+ * @param dout デバッグ情報の表示
+ * @return 0:収束した、-1:収束しなかった
+ */
+inline
+int
+MyAxbSolve_MG( const MyMultigrid &mg,
+               std::vector< double > &x,
+               const std::vector< double > &b,
+               double thres = 1E-06,
+               int max_itr_num = 100,
+               MyIterInfo *info = 0,
+               std::ostream *dout = 0 ){
+  using namespace std;
+
+  const MySpMat &A = mg.matrix( 0 );
+  int N = A.rows();
+  assert( b.size() == N );
+  if( x.empty() ) x.resize( N, 0 );
+  else assert( x.size() == N );
+
+  MyWorkspaceScope scope;
+  vector< double > &r = scope.workspace().vec( N );
+  double bnorm = MyParNorm( b );
+  if( bnorm == 0 ) bnorm = 1;
+
+  if( dout ) *dout << "--- MyAxbSolve_MG() --- levels: " << mg.levels() << endl;
+  if( info ) info->history.clear();
+
+  int k = 0;
+  double res = 0;
+  bool converged = false;
+  for( ; ; k++ ){
+    MySpMatVecMulInto( A, x, r );
+    for( int i = 0; i < N; i++ ) r[ i ] = b[ i ] - r[ i ];
+    res = MyParNorm( r ) / bnorm;
+    if( info ) info->history.push_back( res );
+    if( dout ) *dout << "[" << k << "]\t res: " << res << endl;
+    converged = ( res < thres );
+    if( converged || k >= max_itr_num ) break;
+    mg.cycle( 0, x, b );
+  }//k
+
+  if( info ){
+    info->itr = k;
+    info->res = res;
+    info->converged = converged;
+  }
+  return converged ? 0 : -1;
+}
+
+/**
+ * QR 分解を行う。
+ * - MyMat 版
+ * - A は M x N（M >= N）。Q は M x N（列が正規直交）、R は N x N の上三角。
+ * - ハウスホルダー変換のブロック版 QR 分解（MyQRFactor）で計算して、Q と R を取り出す。
+ *   グラム・シュミット法と違い、条件数の悪い行列でも Q の直交性が崩れない。
+ * - R の対角が非負になるように符号をそろえる（A がフルランクなら、グラム・シュミット法の結果と同じもの）。
+ * - Q を作らずに掛けるだけなら、MyQRFactor を直接使うほうが速い。
+ */
+inline
+int MyQRDecomp( const MyMatView &A,
+                MyMat &Q,
+                MyMat &R ){
+  int M = A.rows(), N = A.cols();
+  assert( M >= N && N > 0 );
+
+  MyQRFactor qr( A );
+  qr.getQ( Q );
+  qr.getR( R );
+
+  // R の対角が負の行は、R の行と Q の列の符号を反転する
+  for( int i = 0; i < N; i++ ){
+    if( R( i, i ) >= 0 ) continue;
+    for( int j = i; j < N; j++ ) R( i, j ) = - R( i, j );
+    for( int l = 0; l < M; l++ ) Q( l, i ) = - Q( l, i );
+  }//i
+
+  return 0;
+}
+
+/**
+ * QR 分解を行う。
+ * - A は M x N（M >= N）。
+ * - 原点移動による高速化は未実装。
+ * - ハウスホルダー変換で計算する（MyMat 版を参照）。
+ * - A がフルランクなら、Q は A の列ベクトルをシュミットの直交化をした結果としても利用可能。
+ * - 内部では MyMat に変換して計算する。
+ */
+int MyQRDecomp( const std::vector< std::vector< double > > &A,
+                std::vector< std::vector< double > > &Q,
+                std::vector< std::vector< double > > &R ){
+  MyMat Q2, R2;
+  int ret = MyQRDecomp( MyMat( A ), Q2, R2 );
+  Q2.get( Q );
+  R2.get( R );
+  return ret;
+}
+
+/*
+ * --- 対称行列の固有値分解 ---
+ * - 1) ハウスホルダー変換で三重対角行列にする：A = Q T Q^T（O(n^3) 、１回だけ）
+ *   2) 三重対角行列 T を、ウィルキンソンの原点移動つきの陰的 QL 法で対角化する（固有値だけなら O(n^2) ）
+ *   3) 固有ベクトルが必要なら、2) のギブンス回転を Q に掛けていく
+ * - 毎回密行列の QR 分解をする単純な QR 法（原点移動なし）と違い、固有値が近接していても数回の反復で収束する。
+ */
+
+/**
+ * 対称行列を三重対角行列にする（ハウスホルダー変換）
+ * - A = Q T Q^T 。T の対角を d（n 個）、副対角を e（e[ i ] = T( i, i + 1 )、n 個で最後は 0）に入れる。
+ * - Qt が 0 でなければ、Q^T（n x n）を入れる。
+ * - A の上三角と下三角の両方を使う（対称であること）。A は変更しない。
+ * - 右下の小行列の更新 A22 -= v w^T + w v^T と、A22 v は行ごとに複数のスレッドで計算する。
+ */
+template < class T >
+inline
+void
+MyTridiagonalize( const MyMatViewT< T > &A,
+                  std::vector< T > &d,
+                  std::vector< T > &e,
+                  MyMatT< T > *Qt = 0 ){
+  int n = A.rows();
+  assert( A.cols() == n && n > 0 );
+  d.resize( n );
+  e.assign( n, 0 );
+
+  // 作業用のコピー。k 行目の k + 2 列目から右に、k 番目のハウスホルダーベクトル（先頭の 1 は持たない）を残していく
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  MyMatT< T > &B = ws.mat< T >( n, n );
+  B = A;
+  std::vector< T > &tau = ws.vec< T >( n );
+  std::vector< T > &v = ws.vec< T >( n );
+  std::vector< T > &w = ws.vec< T >( n );
+  std::fill( tau.begin(), tau.end(), T( 0 ) );
+
+  for( int k = 0; k + 2 < n; k++ ){
+    // k 行目の k + 1 列目から右（= k 列目の k + 1 行目から下）を ( beta, 0, ..., 0 ) に移すハウスホルダーベクトル
+    T *bk = B[ k ];
+    d[ k ] = bk[ k ];
+    T s = 0;
+    for( int j = k + 2; j < n; j++ ) s += bk[ j ] * bk[ j ];
+    if( s == 0 ){
+      e[ k ] = bk[ k + 1 ];
+      continue;
+    }
+    T x0 = bk[ k + 1 ];
+    T nrm = std::sqrt( s + x0 * x0 );
+    T beta = ( x0 >= 0 ) ? -nrm : nrm;
+    T scale = 1 / ( x0 - beta );
+    for( int j = k + 2; j < n; j++ ) bk[ j ] *= scale;
+    tau[ k ] = ( beta - x0 ) / beta;
+    e[ k ] = beta;
+
+    // v = ( 1, bk[ k + 2 ], ... )（インデックスは k + 1 から）
+    int m = n - k - 1;
+    T *vp = &v[ 0 ], *wp = &w[ 0 ];
+    vp[ 0 ] = 1;
+    for( int j = 1; j < m; j++ ) vp[ j ] = bk[ k + 1 + j ];
+
+    // p = tau A22 v 、w = p - ( tau / 2 )( p^T v ) v
+    T tk = tau[ k ];
+#ifdef _OPENMP
+    int nt = MyNumThreadsFor( 2.0 * m * m );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = 0; i < m; i++ ){
+      const T *bi = B[ k + 1 + i ] + k + 1;
+      T z = 0;
+      for( int j = 0; j < m; j++ ) z += bi[ j ] * vp[ j ];
+      wp[ i ] = tk * z;
+    }//i
+    T pv = 0;
+    for( int i = 0; i < m; i++ ) pv += wp[ i ] * vp[ i ];
+    T alpha = - tk * pv / 2;
+    for( int i = 0; i < m; i++ ) wp[ i ] += alpha * vp[ i ];
+
+    // A22 -= v w^T + w v^T
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = 0; i < m; i++ ){
+      T *bi = B[ k + 1 + i ] + k + 1;
+      T vi = vp[ i ], wi = wp[ i ];
+      for( int j = 0; j < m; j++ ) bi[ j ] -= vi * wp[ j ] + wi * vp[ j ];
+    }//i
+  }//k
+  if( n >= 2 ){
+    d[ n - 2 ] = B( n - 2, n - 2 );
+    e[ n - 2 ] = B( n - 2, n - 1 );
+  }
+  d[ n - 1 ] = B( n - 1, n - 1 );
+
+  if( ! Qt ) return;
+
+  // Q = H_0 H_1 ... H_{n-3} を後ろから作る（H_k を掛けるとき、Q の k + 1 行目、列から右下以外は単位行列のまま）
+  MyMatT< T > &Q = ws.mat< T >( n, n );
+  Q.fill( 0 );
+  for( int i = 0; i < n; i++ ) Q( i, i ) = 1;
+  for( int k = n - 3; k >= 0; k-- ){
+    if( tau[ k ] == 0 ) continue;
+    int m = n - k - 1;
+    T *vp = &v[ 0 ], *wp = &w[ 0 ];
+    vp[ 0 ] = 1;
+    for( int j = 1; j < m; j++ ) vp[ j ] = B( k, k + 1 + j );
+    // w = v^T Q22 、Q22 -= tau v w
+    std::fill( w.begin(), w.begin() + m, T( 0 ) );
+    for( int i = 0; i < m; i++ ){
+      const T *qi = Q[ k + 1 + i ] + k + 1;
+      T vi = vp[ i ];
+      for( int j = 0; j < m; j++ ) wp[ j ] += vi * qi[ j ];
+    }//i
+    T tk = tau[ k ];
+#ifdef _OPENMP
+    int nt = MyNumThreadsFor( 2.0 * m * m );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = 0; i < m; i++ ){
+      T *qi = Q[ k + 1 + i ] + k + 1;
+      T tv = tk * vp[ i ];
+      for( int j = 0; j < m; j++ ) qi[ j ] -= tv * wp[ j ];
+    }//i
+  }//k
+  MyMatTransInto( Q, *Qt );
+}
+
+/**
+ * sqrt( a^2 + b^2 )
+ * - 大きい方で割ってから２乗するので、途中でオーバーフロー、アンダーフローしない。
+ */
+template < class T >
+inline
+T
+MyHypot( T a, T b ){
+  a = MyAbs( a );
+  b = MyAbs( b );
+  if( a < b ) std::swap( a, b );
+  if( a == 0 ) return 0;
+  T r = b / a;
+  return a * std::sqrt( 1 + r * r );
+}
+
+/**
+ * 対称三重対角行列の固有値分解（ウィルキンソンの原点移動つきの陰的 QL 法）
+ * - d（対角、n 個）と e（副対角、e[ i ] = T( i, i + 1 )）を受け取り、d に固有値を入れる（順番はそろえない）。e は壊れる。
+ * - Zt が 0 でなければ、ギブンス回転を Zt の行に掛けていく。
+ *   Zt に Q^T（MyTridiagonalize()）を入れておけば、Zt の i 行目が d[ i ] に対応する元の行列の固有ベクトルになる。
+ *   回転は１回のスイープ分ためておき、Zt の列を分けて複数のスレッドでまとめて掛ける。
+ * - 固有値１つあたり 30 回反復しても収束しなければ失敗。
+ * @return 0:成功、-1:収束しなかった
+ */
+template < class T >
+inline
+int
+MyTridiagQL( std::vector< T > &d,
+             std::vector< T > &e,
+             MyMatT< T > *Zt = 0 ){
+  int n = d.size();
+  assert( e.size() == n );
+  if( Zt ) assert( Zt->rows() == n );
+  int nz = Zt ? Zt->cols() : 0;
+  e[ n - 1 ] = 0;
+  const T eps = std::numeric_limits< T >::epsilon();
+
+  // １回のスイープのギブンス回転（i 行目と i + 1 行目の回転の c, s）
+  MyWorkspaceScope scope;
+  T *rc = scope.workspace().alloc< T >( n );
+  T *rs = scope.workspace().alloc< T >( n );
+
+  for( int l = 0; l < n; l++ ){
+    int itr = 0;
+    for( ; ; ){
+      // e[ m ] が無視できる m を探す（l から m までのブロックを対角化する）
+      int m = l;
+      for( ; m < n - 1; m++ ){
+        T dd = MyAbs( d[ m ] ) + MyAbs( d[ m + 1 ] );
+        if( MyAbs( e[ m ] ) <= eps * dd ) break;
+      }//m
+      if( m == l ) break;
+      if( itr++ == 30 ) return -1;
+
+      // ウィルキンソンの原点移動（l, l + 1 の 2x2 の固有値のうち d[ l ] に近い方）
+      T g = ( d[ l + 1 ] - d[ l ] ) / ( 2 * e[ l ] );
+      T r = MyHypot( g, T( 1 ) );
+      g = d[ m ] - d[ l ] + e[ l ] / ( g + ( g >= 0 ? r : -r ) );
+      T s = 1, c = 1, p = 0;
+      int i = m - 1, i_end = l;
+      for( ; i >= l; i-- ){
+        T f = s * e[ i ], b = c * e[ i ];
+        r = MyHypot( f, g );
+        e[ i + 1 ] = r;
+        if( r == 0 ){
+          // 途中で分離したので、ここまでの回転で打ち切ってやり直す
+          d[ i + 1 ] -= p;
+          e[ m ] = 0;
+          i_end = i + 1;
+          break;
+        }
+        s = f / r;
+        c = g / r;
+        g = d[ i + 1 ] - p;
+        r = ( d[ i ] - g ) * s + 2 * c * b;
+        p = s * r;
+        d[ i + 1 ] = g + p;
+        g = c * r - b;
+        rc[ i ] = c;
+        rs[ i ] = s;
+      }//i
+
+      // ためておいた回転（i = m - 1, ..., i_end の順）を Zt の行に掛ける
+      if( Zt ){
+        MyMatT< T > &Z = *Zt;
+#ifdef _OPENMP
+        int nt = MyNumThreadsFor( 6.0 * ( m - i_end ) * nz );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+        for( int j0 = 0; j0 < nz; j0 += 64 ){
+          int j1 = MyMin( j0 + 64, nz );
+          for( int q = m - 1; q >= i_end; q-- ){
+            T *z0 = Z[ q ], *z1 = Z[ q + 1 ];
+            T cq = rc[ q ], sq = rs[ q ];
+            for( int j = j0; j < j1; j++ ){
+              T f = z1[ j ];
+              z1[ j ] = sq * z0[ j ] + cq * f;
+              z0[ j ] = cq * z0[ j ] - sq * f;
+            }//j
+          }//q
+        }//j0
+      }
+      if( r == 0 && i >= l ) continue;
+      d[ l ] -= p;
+      e[ l ] = g;
+      e[ m ] = 0;
+    }
+  }//l
+  return 0;
+}
+
+/**
+ * 対称行列の固有値分解
+ * - A = U^T diag( L ) U 。U の i 行目が L[ i ] の固有ベクトル（MyEig_QR() と同じく、固有ベクトルが行方向に並ぶ）。
+ * - MyTridiagonalize() で三重対角にして、MyTridiagQL() で対角化する。
+ * - 固有値は小さい順（descending なら大きい順）に並べる。
+ * - U が 0 なら固有値だけ計算する（三重対角にした後は O(n^2) なので、ずっと速い）。
+ * - A の上三角と下三角の両方を使う（対称であること）。A は変更しない。
+ * - T は要素の型（double, float）。
+ * @param[out] L 固有値（n 個）
+ * @param[out] U 固有ベクトル（n x n）。不要なら 0 。
+ * @return 0:成功、-1:収束しなかった
+ */
+template < class T >
+inline
+int
+MyEigSym( const MyMatViewT< T > &A,
+          std::vector< T > &L,
+          MyMatT< T > *U = 0,
+          bool descending = false ){
+  int n = A.rows();
+  assert( A.cols() == n && n > 0 );
+  MyWorkspaceScope scope;
+  std::vector< T > &e = scope.workspace().vec< T >( n );
+  if( ! U ){
+    MyTridiagonalize( A, L, e );
+    if( MyTridiagQL( L, e ) ) return -1;
+    std::sort( L.begin(), L.end() );
+    if( descending ) std::reverse( L.begin(), L.end() );
+    return 0;
+  }
+
+  MyMatT< T > &Zt = scope.workspace().mat< T >( n, n );
+  MyTridiagonalize( A, L, e, &Zt );
+  if( MyTridiagQL( L, e, &Zt ) ) return -1;
+
+  // 固有値の順に並べ替える
+  std::vector< std::pair< T, int > > o( n );
+  for( int i = 0; i < n; i++ ) o[ i ] = std::make_pair( descending ? -L[ i ] : L[ i ], i );
+  std::sort( o.begin(), o.end() );
+  U->resize( n, n );
+  for( int i = 0; i < n; i++ ){
+    int k = o[ i ].second;
+    L[ i ] = descending ? -o[ i ].first : o[ i ].first;
+    const T *zk = Zt[ k ];
+    T *ui = ( *U )[ i ];
+    for( int j = 0; j < n; j++ ) ui[ j ] = zk[ j ];
+  }//i
+  return 0;
+}
+
+/**
+ * QR 法による固有値と固有ベクトルの計算
+ * - MyMat 版
+ * - 三重対角化と原点移動つきの陰的 QL 法（MyEigSym()）で計算する。
+ *   以前の原点移動なしの QR 法（毎回密行列を QR 分解する）より、n = 500 で数百倍速く、固有値が近接していても収束する。
+ * - 固有値は絶対値の大きい順に並べる（原点移動なしの QR 法が収束したときと同じ並び）。
+ * - itr_end_thres と max_itr_num は、以前の呼び出しとの互換のために残してある（使わない）。
+ * @param A n x n の正方対称行列であること
+ * @param[out] U 固有ベクトルが入る。固有ベクトルが列でなく行方向に並んだもの。
+ * @param[out] L 固有値が入る。
+ * @return 0:成功、-1:収束しなかった
+ */
+inline
+int MyEig_QR( const MyMatView &A,
+              MyMat &U,
+              std::vector< double > &L,
+              double itr_end_thres = 1E-10,
+              double max_itr_num = 100
+              ){
+  using namespace std;
+  assert( MyMatIsSymmetric( A ) );
+  (void)itr_end_thres;  // 互換のためだけの引数
+  (void)max_itr_num;
+  int n = A.rows();
+
+  MyWorkspaceScope scope;
+  MyMat &V = scope.workspace().mat( n, n );
+  if( MyEigSym( A, L, &V ) ) return -1;
+
+  // 絶対値の大きい順に並べ替える
+  vector< pair< double, int > > o( n );
+  for( int i = 0; i < n; i++ ) o[ i ] = make_pair( - MyAbs( L[ i ] ), i );
+  sort( o.begin(), o.end() );
+  vector< double > L0( L );
+  U.resize( n, n );
+  for( int i = 0; i < n; i++ ){
+    int k = o[ i ].second;
+    L[ i ] = L0[ k ];
+    for( int j = 0; j < n; j++ ) U( i, j ) = V( k, j );
+  }//i
+  return 0;
+}
+
+/**
+ * QR 法による固有値と固有ベクトルの計算
+ * A は、対称行列であること。
+ * - 内部では MyMat に変換して計算する。
+ * @param A n x n の正方対称行列であること
+ * @param[out] U 固有ベクトルが入る。i 番目の固有値に対応。固有ベクトルが列でなく行方向に並んだもの。
+ * @param[out] L 固有値が入る。i 番目の固有ベクトルに対応。
+ * @param itr_end_thres 収束条件。毎回の固有値の変化量（ノルム）がこの値を下回ったら計算終了。5x5行列を使ったテストでは1E-06では精度がいまいちだった。なので、デフォルトでは、なんとなく1E-10としてある。固有値と固有ベクトルの計算結果から判断して要調整。
+ * @param max_itr_num 収束条件。この回数を超えたら計算終了。itr_end_thres に合わせてこれも要調整。
+ */ 
+int MyEig_QR( const std::vector< std::vector< double > > &A,
+              std::vector< std::vector< double > > &U,
+              std::vector< double > &L,
+              double itr_end_thres = 1E-10,
+              double max_itr_num = 100
+              ){
+  assert( MyMatIsSymmetric( A ) );
+  MyMat U2;
+  int ret = MyEig_QR( MyMat( A ), U2, L, itr_end_thres, max_itr_num );
+  U2.get( U );
+  return ret;
+}
+
+/*
+ * --- 部分固有値問題（大きい方から k 個） ---
+ * - 大きな対称行列の固有値のうち、大きい方（または小さい方）の k 個と固有ベクトルだけを求める。
+ *   行列とベクトルの積だけを使うので、計算量は O(n^3) でなく、(k に比例する回数の) 積の計算量で済む。
+ * - 係数行列はクリロフ部分空間法と同じく、MyMat、MySpMat、vector< vector< double > >、y = A x を計算する関数オブジェクトで渡せる。
+ * - MyEigLanczos()：thick-restart ランチョス法。ベクトル１本ずつの積。前処理なしなら、積の回数はたいていこちらが少ない。
+ *   ただし、１本の初期ベクトルから作る基底なので、重複した固有値は（丸め誤差で拾えない限り）１つしか見つからない。
+ *   MyEigLOBPCG()：ブロック版。k 本まとめて積を計算する（密行列なら MyGemm() 、疎行列なら行を分けて複数のスレッドで計算する）。
+ *   重複した固有値も見つかる。前処理（MyPrecond。MyMultigrid など）が使えて、よい前処理があれば積の回数がずっと少なくなる。
+ * - 固有値は求めたい方から順に（largest なら大きい順、そうでなければ小さい順）並べる。
+ *   固有ベクトルは、MyEigSym() と同じく U の行に入れる（k x n）。符号は、絶対値が最大の成分が正になるようにそろえる。
+ * - 収束判定は、各固有対の残差 || A u - λ u || を、求めた固有値の絶対値の最大値で割ったもの。
+ *   MyIterInfo の itr には行列とベクトルの積の回数を、history にはリスタート（反復）ごとの残差の最大値を入れる。
+ */
+
+/**
+ * Y = A X（X の各列に A を掛ける）
+ * - 部分固有値問題のブロック版で、係数行列の種類の違いを吸収する。Y は n x k で確保済み。
+ * - 密行列は MyGemm() 、疎行列は行を分けて複数のスレッドで計算する。関数オブジェクトは列ごとに A( x, y ) を呼ぶ。
+ */
+inline
+void
+MyLinOpApplyBlock( const MyMatView &A, const MyMatView &X, MyMat &Y ){
+  MyGemm( 1, A, X, 0, Y );
+}
+
+inline
+void
+MyLinOpApplyBlock( const MyMat &A, const MyMatView &X, MyMat &Y ){
+  MyGemm( 1, A, X, 0, Y );
+}
+
+inline
+void
+MyLinOpApplyBlock( const MySpMat &A, const MyMatView &X, MyMat &Y ){
+  int M = A.rows(), K = X.cols();
+  assert( A.cols() == X.rows() && Y.rows() == M && Y.cols() == K );
+  const std::vector< int > &ptr = A.rowPtr(), &idx = A.colIdx();
+  const std::vector< double > &val = A.values();
+  int nt = MyNumThreadsFor( 2.0 * A.nnz() * K );
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+  for( int t = 0; t < nt; t++ ){
+    int i1 = MySpMatRowSplit( A, t + 1, nt );
+    for( int i = MySpMatRowSplit( A, t, nt ); i < i1; i++ ){
+      double *yi = Y[ i ];
+      for( int c = 0; c < K; c++ ) yi[ c ] = 0;
+      for( int q = ptr[ i ]; q < ptr[ i + 1 ]; q++ ){
+        double a = val[ q ];
+        for( int c = 0; c < K; c++ ) yi[ c ] += a * X( idx[ q ], c );
+      }//q
+    }//i
+  }//t
+}
+
+template < class Op >
+inline
+void
+MyLinOpApplyBlock( const Op &A, const MyMatView &X, MyMat &Y ){
+  int N = X.rows(), K = X.cols();
+  MyWorkspaceScope scope;
+  std::vector< double > &x = scope.workspace().vec( N );
+  std::vector< double > &y = scope.workspace().vec( Y.rows() );
+  for( int c = 0; c < K; c++ ){
+    X.col( c ).get( x );
+    MyLinOpApply( A, x, y );
+    for( int i = 0; i < Y.rows(); i++ ) Y( i, c ) = y[ i ];
+  }//c
+}
+
+/**
+ * 固有値計算の初期ベクトル用の疑似乱数（[-0.5, 0.5) 、seed ごとに決まった列）
+ * - rand() の状態は変えない。
+ */
+inline
+void
+MyEigStartVector( double *x, int n, unsigned int seed ){
+  unsigned int s = seed * 2654435761u + 12345u;
+  for( int i = 0; i < n; i++ ){
+    s = s * 1664525u + 1013904223u;
+    x[ i ] = ( s >> 8 ) / 16777216.0 - 0.5;
+  }//i
+}
+
+/**
+ * 固有ベクトルの符号をそろえる（各行の絶対値が最大の成分を正にする）
+ */
+inline
+void
+MyEigNormalizeSign( MyMatViewT< double > &U ){
+  for( int i = 0; i < U.rows(); i++ ){
+    double *u = U[ i ];
+    int jmax = 0;
+    for( int j = 1; j < U.cols(); j++ ){
+      if( MyAbs( u[ j ] ) > MyAbs( u[ jmax ] ) ) jmax = j;
+    }//j
+    if( u[ jmax ] < 0 ){
+      for( int j = 0; j < U.cols(); j++ ) u[ j ] = -u[ j ];
     }
-  }
-
-  return detA;
+  }//i
 }
 
 /**
- * ４x４の逆行列
- * - 解析解
- * @param [in] src 計算対象の行列。
- * @param [out] dst メモリが確保済みでなければ内部で確保。src と同じサイズの確保済みを渡しても OK 。
- * @return 行列式の値を返す。行列式がゼロの場合はエラー。
+ * w を V の 0 〜 j - 1 行目（正規直交）に対して直交化する（古典グラム・シュミット法を２回）
+ * - 係数の合計を h（j 個）に入れる。
+ * - 行列とベクトルの積なので、MyGemm() は使わず（パッキングの手間の方が大きい）、長ければ複数のスレッドで計算する。
  */
 inline
-double
-MyMatInv4x4( const std::vector< std::vector< double > > &src,
-             std::vector< std::vector< double > > &dst )
-{
-  // assert( src.size() == 4 );
-  // assert( src[ 0 ].size() == 4 );
-  assert( MyMatSize( src ) == MyPoint2i( 4, 4 ) );
-  
-  double detA =
-      src[0][0]*src[1][1]*src[2][2]*src[3][3] + src[0][0]*src[1][2]*src[2][3]*src[3][1] + src[0][0]*src[1][3]*src[2][1]*src[3][2] +
-      src[0][1]*src[1][0]*src[2][3]*src[3][2] + src[0][1]*src[1][2]*src[2][0]*src[3][3] + src[0][1]*src[1][3]*src[2][2]*src[3][0] +
-      src[0][2]*src[1][0]*src[2][1]*src[3][3] + src[0][2]*src[1][1]*src[2][3]*src[3][0] + src[0][2]*src[1][3]*src[2][0]*src[3][1] +
-      src[0][3]*src[1][0]*src[2][2]*src[3][1] + src[0][3]*src[1][1]*src[2][0]*src[3][2] + src[0][3]*src[1][2]*src[2][1]*src[3][0] -
-      src[0][0]*src[1][1]*src[2][3]*src[3][2] - src[0][0]*src[1][2]*src[2][1]*src[3][3] - src[0][0]*src[1][3]*src[2][2]*src[3][1] -
-      src[0][1]*src[1][0]*src[2][2]*src[3][3] - src[0][1]*src[1][2]*src[2][3]*src[3][0] - src[0][1]*src[1][3]*src[2][0]*src[3][2] -
-      src[0][2]*src[1][0]*src[2][3]*src[3][1] - src[0][2]*src[1][1]*src[2][0]*src[3][3] - src[0][2]*src[1][3]*src[2][1]*src[3][0] -
-      src[0][3]*src[1][0]*src[2][1]*src[3][2] - src[0][3]*src[1][1]*src[2][2]*src[3][0] - src[0][3]*src[1][2]*src[2][0]*src[3][1];
+void
+MyEigOrthogonalize( const MyMatView &V, int j, std::vector< double > &w, std::vector< double > &h ){
+  int n = V.cols();
+  MyWorkspaceScope scope;
+  std::vector< double > &c = scope.workspace().vec( j );
+  std::fill( h.begin(), h.begin() + j, 0.0 );
+  for( int pass = 0; pass < 2; pass++ ){
+    // c = V w
+#ifdef _OPENMP
+    int nt = MyNumThreadsFor( 2.0 * j * n );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int i = 0; i < j; i++ ){
+      const double *vi = V[ i ];
+      double s = 0;
+      for( int l = 0; l < n; l++ ) s += vi[ l ] * w[ l ];
+      c[ i ] = s;
+    }//i
 
-  assert( detA != 0 );
+    // w -= V^T c（要素ごとに分ける）
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static )
+#endif
+    for( int l0 = 0; l0 < n; l0 += 256 ){
+      int l1 = MyMin( n, l0 + 256 );
+      for( int i = 0; i < j; i++ ){
+        const double *vi = V[ i ];
+        double ci = c[ i ];
+        for( int l = l0; l < l1; l++ ) w[ l ] -= ci * vi[ l ];
+      }//i
+    }//l0
+    for( int i = 0; i < j; i++ ) h[ i ] += c[ i ];
+  }//pass
+}
 
-  if( dst.empty() ) dst.resize( 4, std::vector< double >( 4 ) );
-  else{
-    assert( dst.size() == 4 );
-    assert( dst[ 0 ].size() == 4 );
-  }
+/**
+ * 対称行列の固有値を大きい方（または小さい方）から k 個求める（thick-restart ランチョス法）
+ * - m = min( n, max( 2k + 1, k + 20 ) ) 本の正規直交基底を作り（毎回全部に対して直交化し直す）、
+ *   基底の上で固有値を求める（レイリー・リッツ法、MyEigSym()）。
+ *   収束していなければ、求めたい方のリッツベクトル（k + ( m - k ) / 2 本）と残差の方向だけを残して基底を作り直す（thick restart）。
+ * - 行列とベクトルの積は、リスタートごとに m - k 回くらい。
+ * @param A 係数行列（MyMat、MySpMat、vector< vector< double > >、関数オブジェクト）。対称であること。
+ * @param n 行列の大きさ
+ * @param k 求める固有値の個数（1 〜 n）
+ * @param[out] L 固有値（k 個）
+ * @param[out] U 固有ベクトル（k x n、行が固有ベクトル）。不要なら 0 。
+ * @param largest true なら大きい方、false なら小さい方から求める
+ * @param thres 収束条件：残差 / 固有値の絶対値の最大値
+ * @param max_itr_num 最大リスタート回数
+ * @param info 行列とベクトルの積の回数と残差の履歴（不要なら 0）
+ * @param dout デバッグ情報の表示
+ * @return 0:収束した、-1:収束しなかった（L、U には最後の近似値が入る）
+ */
+template < class Op >
+inline
+int
+MyEigLanczos( const Op &A,
+              int n,
+              int k,
+              std::vector< double > &L,
+              MyMat *U = 0,
+              bool largest = true,
+              double thres = 1E-08,
+              int max_itr_num = 100,
+              MyIterInfo *info = 0,
+              std::ostream *dout = 0 ){
+  using namespace std;
+  assert( n > 0 && k > 0 && k <= n );
+  int m = MyMin( n, MyMax( 2 * k + 1, k + 20 ) );
+
+  // 基底 V（行が基底ベクトル。m 行目は残差の方向）、基底の上の行列 H = V^T A V 、その固有ベクトル S（行）
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  MyMat &V = ws.mat( m + 1, n );
+  MyMat &H = ws.mat( m, m );
+  MyMat &S = ws.mat( m, m );
+  MyMat &Y = ws.mat( m, n );
+  vector< double > &theta = ws.vec( m );
+  vector< double > &h = ws.vec( m + 1 );
+  vector< double > &x = ws.vec( n );
+  vector< double > &w = ws.vec( n );
+  H.fill( 0 );
+  V.fill( 0 );
+  MyEigStartVector( V[ 0 ], n, 0 );
+  double v0 = std::sqrt( MyParDot( V[ 0 ], V[ 0 ], n ) );
+  for( int i = 0; i < n; i++ ) V( 0, i ) /= v0;
+
+  if( dout ) *dout << "--- MyEigLanczos() --- n: " << n << " k: " << k << " m: " << m << endl;
+  if( info ) info->history.clear();
+
+  int j0 = 0, nmv = 0, itr = 0;
+  double beta = 0, res = 0;
+  bool converged = false;
+  for( ; itr < max_itr_num; itr++ ){
+    // 基底を m 本まで伸ばす
+    for( int j = j0; j < m; j++ ){
+      const double *vj = V[ j ];
+      for( int i = 0; i < n; i++ ) x[ i ] = vj[ i ];
+      MyLinOpApply( A, x, w );
+      nmv++;
+      double wnorm = MyParNorm( w );
+      MyEigOrthogonalize( V, j + 1, w, h );
+      for( int i = 0; i <= j; i++ ) H( i, j ) = H( j, i ) = h[ i ];
+      beta = MyParNorm( w );
+
+      // 不変部分空間に入った（w がほぼゼロ）ら、新しい方向を乱数で作る（結合の係数は 0）
+      if( beta <= 1E-12 * wnorm || beta == 0 ){
+        beta = 0;
+        if( j + 1 >= n ){
+          std::fill( V[ j + 1 ], V[ j + 1 ] + n, 0.0 );
+          continue;
+        }
+        MyEigStartVector( &w[ 0 ], n, j + 1 );
+        MyEigOrthogonalize( V, j + 1, w, h );
+        double wn = MyParNorm( w );
+        for( int i = 0; i < n; i++ ) V( j + 1, i ) = w[ i ] / wn;
+        continue;
+      }
+      for( int i = 0; i < n; i++ ) V( j + 1, i ) = w[ i ] / beta;
+      if( j + 1 < m ) H( j + 1, j ) = H( j, j + 1 ) = beta;
+    }//j
 
-  dst[0][0] = src[1][1]*src[2][2]*src[3][3]+src[1][2]*src[2][3]*src[3][1]+src[1][3]*src[2][1]*src[3][2]-src[1][1]*src[2][3]*src[3][2]-src[1][2]*src[2][1]*src[3][3]-src[1][3]*src[2][2]*src[3][1];
-  dst[0][1] = src[0][1]*src[2][3]*src[3][2]+src[0][2]*src[2][1]*src[3][3]+src[0][3]*src[2][2]*src[3][1]-src[0][1]*src[2][2]*src[3][3]-src[0][2]*src[2][3]*src[3][1]-src[0][3]*src[2][1]*src[3][2];
-  dst[0][2] = src[0][1]*src[1][2]*src[3][3]+src[0][2]*src[1][3]*src[3][1]+src[0][3]*src[1][1]*src[3][2]-src[0][1]*src[1][3]*src[3][2]-src[0][2]*src[1][1]*src[3][3]-src[0][3]*src[1][2]*src[3][1];
-  dst[0][3] = src[0][1]*src[1][3]*src[2][2]+src[0][2]*src[1][1]*src[2][3]+src[0][3]*src[1][2]*src[2][1]-src[0][1]*src[1][2]*src[2][3]-src[0][2]*src[1][3]*src[2][1]-src[0][3]*src[1][1]*src[2][2];
-  dst[1][0] = src[1][0]*src[2][3]*src[3][2]+src[1][2]*src[2][0]*src[3][3]+src[1][3]*src[2][2]*src[3][0]-src[1][0]*src[2][2]*src[3][3]-src[1][2]*src[2][3]*src[3][0]-src[1][3]*src[2][0]*src[3][2];
-  dst[1][1] = src[0][0]*src[2][2]*src[3][3]+src[0][2]*src[2][3]*src[3][0]+src[0][3]*src[2][0]*src[3][2]-src[0][0]*src[2][3]*src[3][2]-src[0][2]*src[2][0]*src[3][3]-src[0][3]*src[2][2]*src[3][0];
-  dst[1][2] = src[0][0]*src[1][3]*src[3][2]+src[0][2]*src[1][0]*src[3][3]+src[0][3]*src[1][2]*src[3][0]-src[0][0]*src[1][2]*src[3][3]-src[0][2]*src[1][3]*src[3][0]-src[0][3]*src[1][0]*src[3][2];
-  dst[1][3] = src[0][0]*src[1][2]*src[2][3]+src[0][2]*src[1][3]*src[2][0]+src[0][3]*src[1][0]*src[2][2]-src[0][0]*src[1][3]*src[2][2]-src[0][2]*src[1][0]*src[2][3]-src[0][3]*src[1][2]*src[2][0];
-  dst[2][0] = src[1][0]*src[2][1]*src[3][3]+src[1][1]*src[2][3]*src[3][0]+src[1][3]*src[2][0]*src[3][1]-src[1][0]*src[2][3]*src[3][1]-src[1][1]*src[2][0]*src[3][3]-src[1][3]*src[2][1]*src[3][0];
-  dst[2][1] = src[0][0]*src[2][3]*src[3][1]+src[0][1]*src[2][0]*src[3][3]+src[0][3]*src[2][1]*src[3][0]-src[0][0]*src[2][1]*src[3][3]-src[0][1]*src[2][3]*src[3][0]-src[0][3]*src[2][0]*src[3][1];
-  dst[2][2] = src[0][0]*src[1][1]*src[3][3]+src[0][1]*src[1][3]*src[3][0]+src[0][3]*src[1][0]*src[3][1]-src[0][0]*src[1][3]*src[3][1]-src[0][1]*src[1][0]*src[3][3]-src[0][3]*src[1][1]*src[3][0];
-  dst[2][3] = src[0][0]*src[1][3]*src[2][1]+src[0][1]*src[1][0]*src[2][3]+src[0][3]*src[1][1]*src[2][0]-src[0][0]*src[1][1]*src[2][3]-src[0][1]*src[1][3]*src[2][0]-src[0][3]*src[1][0]*src[2][1];
-  dst[3][0] = src[1][0]*src[2][2]*src[3][1]+src[1][1]*src[2][0]*src[3][2]+src[1][2]*src[2][1]*src[3][0]-src[1][0]*src[2][1]*src[3][2]-src[1][1]*src[2][2]*src[3][0]-src[1][2]*src[2][0]*src[3][1];
-  dst[3][1] = src[0][0]*src[2][1]*src[3][2]+src[0][1]*src[2][2]*src[3][0]+src[0][2]*src[2][0]*src[3][1]-src[0][0]*src[2][2]*src[3][1]-src[0][1]*src[2][0]*src[3][2]-src[0][2]*src[2][1]*src[3][0];
-  dst[3][2] = src[0][0]*src[1][2]*src[3][1]+src[0][1]*src[1][0]*src[3][2]+src[0][2]*src[1][1]*src[3][0]-src[0][0]*src[1][1]*src[3][2]-src[0][1]*src[1][2]*src[3][0]-src[0][2]*src[1][0]*src[3][1];
-  dst[3][3] = src[0][0]*src[1][1]*src[2][2]+src[0][1]*src[1][2]*src[2][0]+src[0][2]*src[1][0]*src[2][1]-src[0][0]*src[1][2]*src[2][1]-src[0][1]*src[1][0]*src[2][2]-src[0][2]*src[1][1]*src[2][0];
-  
-  for( int j = 0; j < 4; j++ ){
-    for( int i = 0; i < 4; i++ ){
-      dst[ i ][ j ] /= detA;
+    // レイリー・リッツ法。求めたい方から並べる
+    if( MyEigSym( H, theta, &S, largest ) ) return -1;
+
+    // リッツ対の残差は β | S の最後の成分 |
+    double tmax = 0;
+    for( int i = 0; i < k; i++ ) tmax = MyMax( tmax, MyAbs( theta[ i ] ) );
+    if( tmax == 0 ) tmax = 1;
+    res = 0;
+    for( int i = 0; i < k; i++ ) res = MyMax( res, MyAbs( beta * S( i, m - 1 ) ) / tmax );
+    converged = ( res < thres ) || ( m == n );
+    if( info ) info->history.push_back( res );
+    if( dout ) *dout << "[" << itr + 1 << "]\t matvec: " << nmv << " res: " << res << endl;
+    if( converged || itr + 1 == max_itr_num ) break;
+
+    // thick restart：求めたい方のリッツベクトル p 本と、残差の方向 v_m を残す
+    int p = MyMin( m - 1, k + ( m - k ) / 2 );
+    MyMatView Sp = S.block( 0, 0, p, m ), Vm = V.block( 0, 0, m, n );
+    MyMatView Yp = Y.block( 0, 0, p, n );
+    MyGemm( 1, Sp, Vm, 0, Yp );
+    for( int i = 0; i < p; i++ ){
+      for( int l = 0; l < n; l++ ) V( i, l ) = Y( i, l );
     }//i
+    for( int l = 0; l < n; l++ ) V( p, l ) = V( m, l );
+    H.fill( 0 );
+    for( int i = 0; i < p; i++ ) H( i, i ) = theta[ i ];
+    j0 = p;
+  }//itr
+
+  L.assign( theta.begin(), theta.begin() + k );
+  if( U ){
+    U->resize( k, n );
+    MyMatView Sk = S.block( 0, 0, k, m ), Vm = V.block( 0, 0, m, n );
+    MyGemm( 1, Sk, Vm, 0, *U );
+    MyEigNormalizeSign( *U );
+  }
+  if( info ){
+    info->itr = nmv;
+    info->res = res;
+    info->converged = converged;
+  }
+  return converged ? 0 : -1;
+}
+
+/**
+ * ブロック B（n x c）を、正規直交なブロック Q（n x q）に対して直交化する（古典グラム・シュミット法を２回）
+ * - AB が 0 でなければ、AB = A B も同じ一次結合で更新する（AQ = A Q を使う）。
+ */
+inline
+void
+MyEigBlockOrthogonalize( const MyMatView &Q, const MyMatView &AQ, MyMatView &B, MyMatView *AB = 0 ){
+  if( Q.cols() == 0 || B.cols() == 0 ) return;
+  MyWorkspaceScope scope;
+  MyMat &C = scope.workspace().mat( Q.cols(), B.cols() );
+  for( int pass = 0; pass < 2; pass++ ){
+    MyGemm( 1, Q.trans(), B, 0, C );
+    MyGemm( -1, Q, C, 1, B );
+    if( AB ) MyGemm( -1, AQ, C, 1, *AB );
+  }//pass
+}
+
+/**
+ * ブロック B（n x c）の列を正規直交にする（SVQB：B^T B の固有値分解で B <- B Z Λ^-1/2）
+ * - 列の長さをそろえてから B^T B を作り、一次従属に近い列（固有値が最大の 1E-14 倍以下）は捨てて、残った r 列を B の先頭に詰める。
+ * - AB が 0 でなければ、AB = A B も同じ一次結合で更新する。
+ * @return 残った列の数 r
+ */
+inline
+int
+MyEigBlockSVQB( MyMatView &B, MyMatView *AB = 0 ){
+  int n = B.rows(), c = B.cols();
+  if( c == 0 ) return 0;
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  MyMat &G = ws.mat( c, c ), &Z = ws.mat( c, c ), &T = ws.mat( c, c ), &Tmp = ws.mat( n, c );
+  std::vector< double > &lam = ws.vec( c );
+  std::vector< double > &d = ws.vec( c );
+  for( int j = 0; j < c; j++ ){
+    double s = 0;
+    for( int i = 0; i < n; i++ ) s += B( i, j ) * B( i, j );
+    d[ j ] = ( s > 0 ) ? 1 / std::sqrt( s ) : 0;
   }//j
 
-  return detA;
+  // 列の大きさがばらばらでも小さい列を捨てないように、D^-1/2 B^T B D^-1/2 の固有値分解をする
+  MyGemm( 1, B.trans(), B, 0, G );
+  for( int i = 0; i < c; i++ ){
+    for( int j = 0; j < c; j++ ) G( i, j ) *= d[ i ] * d[ j ];
+  }//i
+  if( MyEigSym( G, lam, &Z, true ) ) return 0;
+  int r = 0;
+  while( r < c && lam[ r ] > 1E-14 * lam[ 0 ] && lam[ r ] > 0 ) r++;
+  if( r == 0 ) return 0;
+
+  // T = D^-1/2 Z( 0:r, : )^T diag( λ )^-1/2（c x r）
+  for( int i = 0; i < c; i++ ){
+    for( int j = 0; j < r; j++ ) T( i, j ) = d[ i ] * Z( j, i ) / std::sqrt( lam[ j ] );
+  }//i
+  MyMatView Tr = T.block( 0, 0, c, r ), Tmpr = Tmp.block( 0, 0, n, r );
+  MyGemm( 1, B, Tr, 0, Tmpr );
+  MyMatView Br = B.block( 0, 0, n, r );
+  Br = Tmpr;
+  if( AB ){
+    MyGemm( 1, *AB, Tr, 0, Tmpr );
+    MyMatView ABr = AB->block( 0, 0, n, r );
+    ABr = Tmpr;
+  }
+  return r;
 }
 
 /**
- * 多項式近似
- * - 二次式 y = a x^2 + b x + c でのフィッティング
- * - 二次元のデータ列、(x_i, y_i) (i=0,1,2,...)、に対するフィッティング
+ * 対称行列の固有値を大きい方（または小さい方）から k 個求める（ブロック版 LOBPCG 法）
+ * - 近似固有ベクトルのブロック X（n x k）、残差（前処理つきなら M^-1 をかけたもの）のブロック W、前回からの変化の方向 P を並べた
+ *   [ X P W ] を正規直交化して（MyEigBlockSVQB()）、その上で固有値を求める（レイリー・リッツ法）ことを繰り返す。
+ * - １回の反復で行列とベクトルの積は k 回（W の分だけ。AX、AP は一次結合で更新する）。
+ *   積はブロックでまとめて計算するので（MyLinOpApplyBlock()）、密行列や疎行列なら複数のスレッドで計算される。
+ * - 収束したら A X を計算し直して、本当の残差で確かめる（一次結合の更新でたまった丸め誤差で、収束を誤判定しないように）。
+ * - 3k >= n の小さな問題は、単位ベクトルに掛けて密行列を作り、MyEigSym() で解く。
+ * - 引数は MyEigLanczos() と同じ。M は前処理（A に近い行列の逆。不要なら 0 ）、max_itr_num は最大反復回数。
+ * @return 0:収束した、-1:収束しなかった（L、U には最後の近似値が入る）
  */
+template < class Op >
+inline
 int
-MyFitQuad( const std::vector< double > &data_x,
-           const std::vector< double > &data_y,
-           double *a, double *b, double *c )
-{
+MyEigLOBPCG( const Op &A,
+             int n,
+             int k,
+             std::vector< double > &L,
+             MyMat *U = 0,
+             bool largest = true,
+             const MyPrecond *M = 0,
+             double thres = 1E-08,
+             int max_itr_num = 500,
+             MyIterInfo *info = 0,
+             std::ostream *dout = 0 ){
   using namespace std;
-  
-  int N = data_x.size();
-  assert( N > 0 );
-  assert( N == data_y.size() );
-  
-  double n = 0.0, sum_x = 0.0, sum_x2 = 0.0, sum_x3 = 0.0, sum_x4 = 0.0, 
-      sum_y = 0.0, sum_xy = 0.0, sum_x2y = 0.0;
-  
-  for( int i = 0; i < N; i++ ){
-    n += 1;
-    sum_x += data_x[ i ];
-    sum_x2 += data_x[ i ] * data_x[ i ];
-    sum_x3 += data_x[ i ] * data_x[ i ] * data_x[ i ];
-    sum_x4 += data_x[ i ] * data_x[ i ] * data_x[ i ] * data_x[ i ];
-    sum_y += data_y[ i ];
-    sum_xy += data_x[ i ] * data_y[ i ];
-    sum_x2y += data_x[ i ] * data_x[ i ] * data_y[ i ];
-  }// i
-  
-  vector< vector< double > > A( 3, vector< double >( 3 ) );
-  A[ 0 ][ 0 ] = n;      A[ 0 ][ 1 ] = sum_x;  A[ 0 ][ 2 ] = sum_x2;
-  A[ 1 ][ 0 ] = sum_x;  A[ 1 ][ 1 ] = sum_x2; A[ 1 ][ 2 ] = sum_x3;
-  A[ 2 ][ 0 ] = sum_x2; A[ 2 ][ 1 ] = sum_x3; A[ 2 ][ 2 ] = sum_x4;
+  assert( n > 0 && k > 0 && k <= n );
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  if( info ) info->history.clear();
+
+  // 小さな問題は密行列にして解く
+  if( 3 * k >= n ){
+    MyMat &I = ws.mat( n, n ), &D = ws.mat( n, n ), &Z = ws.mat( n, n );
+    vector< double > &lam = ws.vec( n );
+    I.fill( 0 );
+    for( int i = 0; i < n; i++ ) I( i, i ) = 1;
+    MyLinOpApplyBlock( A, I, D );
+    if( MyEigSym( D, lam, &Z, largest ) ) return -1;
+    L.assign( lam.begin(), lam.begin() + k );
+    if( U ){
+      *U = Z.block( 0, 0, k, n );
+      MyEigNormalizeSign( *U );
+    }
+    if( info ){
+      info->itr = n;
+      info->res = 0;
+      info->converged = true;
+    }
+    return 0;
+  }
 
-  vector< double > B( 3 );
-  B[ 0 ] = sum_y;
-  B[ 1 ] = sum_xy;
-  B[ 2 ] = sum_x2y;
+  // S = [ X P W ]、AS = A S（列のブロック）
+  MyMat &S = ws.mat( n, 3 * k ), &AS = ws.mat( n, 3 * k );
+  MyMat &Tx = ws.mat( n, k ), &Ta = ws.mat( n, k );
+  MyMat &C = ws.mat( 3 * k, k );
+  vector< double > &theta = ws.vec( 3 * k );
+  vector< double > &res_i = ws.vec( k );
+  vector< double > &r = ws.vec( n ), &z = ws.vec( n );
+  MyMatView X = S.block( 0, 0, n, k ), AX = AS.block( 0, 0, n, k );
+
+  // 初期値：疑似乱数を正規直交化して、A X を計算し、レイリー・リッツ法で回転しておく
+  for( int c = 0; c < k; c++ ){
+    MyEigStartVector( &r[ 0 ], n, c );
+    for( int i = 0; i < n; i++ ) X( i, c ) = r[ i ];
+  }//c
+  if( MyEigBlockSVQB( X ) < k ) return -1;
+  MyLinOpApplyBlock( A, X, Tx );
+  AX = Tx;
+  int nmv = k;
+  int np = 0, itr = 0;
+  double res = 0;
+  bool converged = false;
+
+  // X だけでレイリー・リッツ法
+  {
+    MyWorkspaceScope iscope;
+    MyMat &Gk = iscope.workspace().mat( k, k ), &Zk = iscope.workspace().mat( k, k );
+    MyMat &Ck = iscope.workspace().mat( k, k );
+    MyGemm( 1, X.trans(), AX, 0, Gk );
+    for( int i = 0; i < k; i++ ){
+      for( int j = 0; j < i; j++ ) Gk( i, j ) = Gk( j, i ) = ( Gk( i, j ) + Gk( j, i ) ) / 2;
+    }//i
+    if( MyEigSym( Gk, theta, &Zk, largest ) ) return -1;
+    Ck = Zk.trans();
+    MyGemm( 1, X, Ck, 0, Tx );
+    MyGemm( 1, AX, Ck, 0, Ta );
+    X = Tx;
+    AX = Ta;
+  }
 
-  vector< vector< double > > InvA;
-  MyMatInv3x3( A, InvA );
+  for( ; ; itr++ ){
+    MyWorkspaceScope iscope;
+    MyWorkspace &iws = iscope.workspace();
+    int s = k + np;
+
+    // 残差 R = A X - X diag( θ )。収束していない列だけ W に入れる（soft locking）
+    double tmax = 0;
+    for( int c = 0; c < k; c++ ) tmax = MyMax( tmax, MyAbs( theta[ c ] ) );
+    if( tmax == 0 ) tmax = 1;
+    res = 0;
+    int nw = 0;
+    for( int c = 0; c < k; c++ ){
+      double rn = 0;
+      for( int i = 0; i < n; i++ ){
+        double ri = AX( i, c ) - theta[ c ] * X( i, c );
+        S( i, s + nw ) = ri;
+        rn += ri * ri;
+      }//i
+      res_i[ c ] = std::sqrt( rn ) / tmax;
+      res = MyMax( res, res_i[ c ] );
+      if( res_i[ c ] >= thres ) nw++;
+    }//c
+    if( info ) info->history.push_back( res );
+    if( dout ) *dout << "[" << itr << "]\t matvec: " << nmv << " res: " << res << endl;
+
+    // 収束したら、A X を計算し直して確かめる
+    if( res < thres ){
+      MyLinOpApplyBlock( A, X, Ta );
+      nmv += k;
+      AX = Ta;
+      res = 0;
+      nw = 0;
+      for( int c = 0; c < k; c++ ){
+        double rn = 0;
+        for( int i = 0; i < n; i++ ){
+          double ri = AX( i, c ) - theta[ c ] * X( i, c );
+          S( i, s + nw ) = ri;
+          rn += ri * ri;
+        }//i
+        res = MyMax( res, std::sqrt( rn ) / tmax );
+        if( std::sqrt( rn ) / tmax >= thres ) nw++;
+      }//c
+      if( res < thres ){
+        converged = true;
+        break;
+      }
+    }
+    if( itr >= max_itr_num ) break;
+
+    // W = M^-1 R
+    MyMatView W = S.block( 0, s, n, nw );
+    if( M ){
+      for( int c = 0; c < nw; c++ ){
+        W.col( c ).get( r );
+        M->apply( r, z );
+        for( int i = 0; i < n; i++ ) W( i, c ) = z[ i ];
+      }//c
+    }
 
-  *c = InvA[0][0] * B[0] + InvA[0][1] * B[1]  + InvA[0][2] * B[2];
-  *b = InvA[1][0] * B[0] + InvA[1][1] * B[1]  + InvA[1][2] * B[2];
-  *a = InvA[2][0] * B[0] + InvA[2][1] * B[1]  + InvA[2][2] * B[2];
+    // P を X に対して、W を [ X P ] に対して直交化して正規直交にし、A W を計算する
+    MyMatView P = S.block( 0, k, n, np ), AP = AS.block( 0, k, n, np );
+    MyEigBlockOrthogonalize( X, AX, P, &AP );
+    np = MyEigBlockSVQB( P, &AP );
+    MyMatView XP = S.block( 0, 0, n, k + np ), AXP = AS.block( 0, 0, n, k + np );
+    if( k + np != s ){
+      // P の列が減った分、W を前に詰める
+      for( int i = 0; i < n; i++ ){
+        for( int c = 0; c < nw; c++ ) S( i, k + np + c ) = S( i, s + c );
+      }//i
+    }
+    MyMatView W0 = S.block( 0, k + np, n, nw );
+    MyEigBlockOrthogonalize( XP, AXP, W0 );
+    nw = MyEigBlockSVQB( W0 );
+    MyMatView W1 = S.block( 0, k + np, n, nw );
+    MyEigBlockOrthogonalize( XP, AXP, W1 );
+    nw = MyEigBlockSVQB( W1 );
+    if( nw == 0 ) break;
+    MyMatView Ww = S.block( 0, k + np, n, nw ), AW = AS.block( 0, k + np, n, nw );
+    MyMat &Taw = iws.mat( n, nw );
+    MyLinOpApplyBlock( A, Ww, Taw );
+    AW = Taw;
+    nmv += nw;
+
+    // [ X P W ] の上でレイリー・リッツ法
+    int ns = k + np + nw;
+    MyMatView Sb = S.block( 0, 0, n, ns ), ASb = AS.block( 0, 0, n, ns );
+    MyMat &Gs = iws.mat( ns, ns ), &Zs = iws.mat( ns, ns );
+    MyGemm( 1, Sb.trans(), ASb, 0, Gs );
+    for( int i = 0; i < ns; i++ ){
+      for( int j = 0; j < i; j++ ) Gs( i, j ) = Gs( j, i ) = ( Gs( i, j ) + Gs( j, i ) ) / 2;
+    }//i
+    if( MyEigSym( Gs, theta, &Zs, largest ) ) return -1;
+    MyMatView Cs = C.block( 0, 0, ns, k );
+    for( int i = 0; i < ns; i++ ){
+      for( int c = 0; c < k; c++ ) Cs( i, c ) = Zs( c, i );
+    }//i
 
-  return 0;
+    // 新しい P = [ P W ] の部分の一次結合、新しい X = [ X P W ] の一次結合
+    MyMatView Cpw = C.block( k, 0, np + nw, k );
+    MyMatView Spw = S.block( 0, k, n, np + nw ), ASpw = AS.block( 0, k, n, np + nw );
+    MyMatView Pn = S.block( 0, k, n, k ), APn = AS.block( 0, k, n, k );
+    MyMat &Pt = iws.mat( n, k ), &APt = iws.mat( n, k );
+    MyGemm( 1, Sb, Cs, 0, Tx );
+    MyGemm( 1, ASb, Cs, 0, Ta );
+    MyGemm( 1, Spw, Cpw, 0, Pt );
+    MyGemm( 1, ASpw, Cpw, 0, APt );
+    X = Tx;
+    AX = Ta;
+    Pn = Pt;
+    APn = APt;
+    np = k;
+  }//itr
+
+  L.assign( theta.begin(), theta.begin() + k );
+  if( U ){
+    *U = X.trans();
+    MyEigNormalizeSign( *U );
+  }
+  if( info ){
+    info->itr = nmv;
+    info->res = res;
+    info->converged = converged;
+  }
+  return converged ? 0 : -1;
 }
 
+/*
+ * --- 特異値分解 ---
+ * - A = U diag( S ) V^T（M x N の A、p = min( M, N ) として U は M x p、V は N x p で列が正規直交、S は p 個で大きい順）。
+ * - MySVD()：全部の特異値を求める。M >= N なら、まず A = QR と分解して（MyQRFactorT、ほとんどが MyGemm() の行列積）、
+ *   N x N の R に片側ヤコビ法（R の行どうしを回転で直交させる）をかける。A^T A を作らないので、小さな特異値も精度よく求まる。
+ *   M < N なら A^T を分解する。
+ *   ヤコビ法は、互いに重ならない行の組（N / 2 組、総当たりの順番）ごとに、複数のスレッドで回転する。
+ * - MyRandomizedSVD()：大きい方から k 個だけ求める（ランダムな射影で A の値域の近似を作る、Halko らの方法）。
+ *   計算は A との積（MyGemm()）と細長い行列の QR 分解がほとんどで、100000 x 1000 の行列の低ランク近似なども現実的な時間でできる。
+ * - 符号は、V の各列の絶対値が最大の成分が正になるようにそろえる。
+ */
+
 /**
- * 多項式近似
- * - 三次式 y = a x^3 + b x^2  + c x + d でのフィッティング
- * - 二次元のデータ列、(x_i, y_i) (i=0,1,2,...)、に対するフィッティング
+ * 片側ヤコビ法。G（n x n）の行どうしを回転で直交させる
+ * - 同じ回転を J（n x n、行の数は n）の行にもかける。
+ * - 総当たりの順番（１ステップで n / 2 組）で、組ごとに複数のスレッドで計算する。
+ * @return 0:収束した、-1:max_sweep 回で収束しなかった
  */
+template < class T >
+inline
 int
-MyFitCubic( const std::vector< double > &data_x,
-            const std::vector< double > &data_y, 
-            double *a, double *b, double *c, double *d )
-{
+MySVDJacobi( MyMatViewT< T > &G, MyMatViewT< T > &J, int max_sweep = 30 ){
+  int n = G.rows(), cols = G.cols(), jcols = J.cols();
+  assert( J.rows() == n );
+  if( n < 2 ) return 0;
+  T tol = std::numeric_limits< T >::epsilon() * std::sqrt( (T)cols );
+  int nn = n + ( n & 1 );  // 奇数なら、ダミーを１つ足して偶数にする
+  for( int sweep = 0; sweep < max_sweep; sweep++ ){
+    int nrot = 0;
+    for( int step = 0; step < nn - 1; step++ ){
+#ifdef _OPENMP
+      int nt = MyNumThreadsFor( 6.0 * ( cols + jcols ) * nn / 2 );
+#pragma omp parallel for num_threads( nt ) if( nt > 1 ) schedule( static ) reduction( + : nrot )
+#endif
+      for( int q = 0; q < nn / 2; q++ ){
+        int a = ( q == 0 ) ? nn - 1 : ( step + q ) % ( nn - 1 );
+        int b = ( step + nn - 1 - q ) % ( nn - 1 );
+        if( a >= n || b >= n ) continue;
+        T *ga = G[ a ], *gb = G[ b ];
+        T alpha = 0, beta = 0, gamma = 0;
+        for( int l = 0; l < cols; l++ ){
+          alpha += ga[ l ] * ga[ l ];
+          beta += gb[ l ] * gb[ l ];
+          gamma += ga[ l ] * gb[ l ];
+        }//l
+        if( gamma == 0 || MyAbs( gamma ) <= tol * std::sqrt( alpha ) * std::sqrt( beta ) ) continue;
+
+        // ga・gb = 0 となる回転
+        T zeta = ( beta - alpha ) / ( 2 * gamma );
+        T t = ( zeta >= 0 ? 1 : -1 ) / ( MyAbs( zeta ) + std::sqrt( 1 + zeta * zeta ) );
+        T c = 1 / std::sqrt( 1 + t * t ), s = c * t;
+        for( int l = 0; l < cols; l++ ){
+          T x = ga[ l ], y = gb[ l ];
+          ga[ l ] = c * x - s * y;
+          gb[ l ] = s * x + c * y;
+        }//l
+        T *ja = J[ a ], *jb = J[ b ];
+        for( int l = 0; l < jcols; l++ ){
+          T x = ja[ l ], y = jb[ l ];
+          ja[ l ] = c * x - s * y;
+          jb[ l ] = s * x + c * y;
+        }//l
+        nrot++;
+      }//q
+    }//step
+    if( nrot == 0 ) return 0;
+  }//sweep
+  return -1;
+}
+
+/**
+ * 特異値分解 A = U diag( S ) V^T（QR 分解 + 片側ヤコビ法）
+ * - A は M x N の任意の行列。p = min( M, N ) として、U は M x p、V は N x p（列が特異ベクトル）、S は p 個で大きい順。
+ * - U、V が不要なら 0 。U、V は大きさを合わせる（空でなくてもよい）。
+ * - ランク落ちしている場合、ゼロの特異値に対応する V の列は、他の列と直交するように補う。
+ * @return 0:成功、-1:ヤコビ法が収束しなかった（結果は入るが精度が悪い）
+ */
+template < class T >
+inline
+int
+MySVD( const MyMatViewT< T > &A, std::vector< T > &S, MyMatT< T > *U = 0, MyMatT< T > *V = 0 ){
   using namespace std;
-  
-  int N = data_x.size();
+  int M = A.rows(), N = A.cols();
+  if( M < N ) return MySVD( A.trans(), S, V, U );
   assert( N > 0 );
-  assert( N == data_y.size() );
 
-  double sum_m = 0.0, sum_x = 0.0, sum_x2 = 0.0, sum_x3 = 0.0;
-  double sum_x4 = 0.0, sum_x5 = 0.0, sum_x6 = 0.0;
-  double sum_y = 0.0, sum_yx = 0.0, sum_yx2 = 0.0, sum_yx3 = 0.0;
-  
+  // A = QR
+  MyQRFactorT< T > qr( A );
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+  MyMatT< T > &G = ws.mat< T >( N, N ), &J = ws.mat< T >( N, N );
+  G.fill( 0 );
+  J.fill( 0 );
+  const MyMatT< T > &F = qr.qr();
   for( int i = 0; i < N; i++ ){
-    sum_m  += 1;
-    sum_x  += data_x[i];
-    sum_x2 += data_x[i]*data_x[i];
-    sum_x3 += data_x[i]*data_x[i]*data_x[i];
-    sum_x4 += data_x[i]*data_x[i]*data_x[i]*data_x[i];
-    sum_x5 += data_x[i]*data_x[i]*data_x[i]*data_x[i]*data_x[i];
-    sum_x6 += data_x[i]*data_x[i]*data_x[i]*data_x[i]*data_x[i]*data_x[i];
-    sum_y  += data_y[i];
-    sum_yx += data_y[i]*data_x[i];
-    sum_yx2 += data_y[i]*data_x[i]*data_x[i];
-    sum_yx3 += data_y[i]*data_x[i]*data_x[i]*data_x[i];
-  }
-
-  vector< vector< double > > A( 4, vector< double >( 4 ) );
-  A[0][0] = sum_m;  A[0][1] = sum_x;  A[0][2] = sum_x2; A[0][3] = sum_x3;
-  A[1][0] = sum_x;  A[1][1] = sum_x2; A[1][2] = sum_x3; A[1][3] = sum_x4;
-  A[2][0] = sum_x2; A[2][1] = sum_x3; A[2][2] = sum_x4; A[2][3] = sum_x5;
-  A[3][0] = sum_x3; A[3][1] = sum_x4; A[3][2] = sum_x5; A[3][3] = sum_x6;
-               
-  vector< double > B( 4 );
-  B[0] = sum_y;
-  B[1] = sum_yx;
-  B[2] = sum_yx2;
-  B[3] = sum_yx3;
-  
-  vector< vector< double > > InvA;
-  MyMatInv4x4( A, InvA );
+    for( int j = i; j < N; j++ ) G( i, j ) = F( i, j );
+    J( i, i ) = 1;
+  }//i
 
-  *d = InvA[0][0] * B[0] + InvA[0][1] * B[1]  + InvA[0][2] * B[2] + InvA[0][3] * B[3];
-  *c = InvA[1][0] * B[0] + InvA[1][1] * B[1]  + InvA[1][2] * B[2] + InvA[1][3] * B[3];
-  *b = InvA[2][0] * B[0] + InvA[2][1] * B[1]  + InvA[2][2] * B[2] + InvA[2][3] * B[3];
-  *a = InvA[3][0] * B[0] + InvA[3][1] * B[1]  + InvA[3][2] * B[2] + InvA[3][3] * B[3];
+  // 前処理：R R^T の固有ベクトル（MyEigSym()）を J の初期値にして、G = J R とする。
+  // G の行はほぼ直交しているので、ヤコビ法は数回のスイープで収束する（精度はヤコビ法で決まる）
+  if( N > 8 ){
+    MyMatT< T > &C = ws.mat< T >( N, N ), &J0 = ws.mat< T >( N, N );
+    vector< T > &lam = ws.vec< T >( N );
+    MyGemm( 1, G, G.trans(), 0, C );
+    if( MyEigSym( C, lam, &J0, true ) == 0 ){
+      MyGemm( 1, J0, G, 0, C );
+      G = C;
+      J = J0;
+    }
+  }
 
-  return 0;
-}
+  // J R = G（行が直交）、R = J^T diag( S ) Y（Y は G の行を正規化したもの）
+  int ret = MySVDJacobi( G, J );
 
-// /**
-//  * 乱数生成
-//  * - 平均 mu、分散 sg2 の正規分布で分布する乱数を発生する。 
-//  */
-// double MyRandGauss( double mu, double sg2 ){
-//   using namespace std;
-//   // Box-Muller's Method
-//   double X = rand() / (double)RAND_MAX;
-//   double Y = rand() / (double)RAND_MAX;
-//   double Z1 = sqrt( sg2 ) * sqrt( -2 * log( X ) ) * cos( 2 * M_PI * Y ) + mu;
-//   //double Z2 = sqrt( sg2 ) * sqrt( -2 * log( X ) ) * sin( 2 * M_PI * Y ) + mu;
-//   return Z1;
-// }
+  // 行の長さが特異値。大きい順に並べる
+  vector< pair< T, int > > order( N );
+  for( int i = 0; i < N; i++ ){
+    T s = 0;
+    for( int l = 0; l < N; l++ ) s += G( i, l ) * G( i, l );
+    order[ i ] = make_pair( - std::sqrt( s ), i );
+  }//i
+  stable_sort( order.begin(), order.end() );
+  S.resize( N );
+  for( int i = 0; i < N; i++ ) S[ i ] = - order[ i ].first;
+
+  // Y：G の行を正規化（ゼロの行は、ほかの行と直交する単位ベクトルで補う）
+  MyMatT< T > &Y = ws.mat< T >( N, N );
+  int e = 0;
+  for( int i = 0; i < N; i++ ){
+    T *y = Y[ i ];
+    const T *g = G[ order[ i ].second ];
+    if( S[ i ] > 0 && S[ i ] > S[ 0 ] * std::numeric_limits< T >::epsilon() * N ){
+      for( int l = 0; l < N; l++ ) y[ l ] = g[ l ] / S[ i ];
+      continue;
+    }
+    for( ; ; e++ ){
+      assert( e < N );
+      for( int l = 0; l < N; l++ ) y[ l ] = ( l == e ) ? 1 : 0;
+      for( int pass = 0; pass < 2; pass++ ){
+        for( int r = 0; r < i; r++ ){
+          T d = 0;
+          for( int l = 0; l < N; l++ ) d += Y( r, l ) * y[ l ];
+          for( int l = 0; l < N; l++ ) y[ l ] -= d * Y( r, l );
+        }//r
+      }//pass
+      T yn = 0;
+      for( int l = 0; l < N; l++ ) yn += y[ l ] * y[ l ];
+      if( yn > 0.25 ){
+        yn = std::sqrt( yn );
+        for( int l = 0; l < N; l++ ) y[ l ] /= yn;
+        e++;
+        break;
+      }
+    }//e
+  }//i
+
+  // 符号をそろえる：Y の各行の絶対値が最大の成分を正に
+  vector< T > &sgn = ws.vec< T >( N );
+  for( int i = 0; i < N; i++ ){
+    int lmax = 0;
+    for( int l = 1; l < N; l++ ){
+      if( MyAbs( Y( i, l ) ) > MyAbs( Y( i, lmax ) ) ) lmax = l;
+    }//l
+    sgn[ i ] = ( Y( i, lmax ) < 0 ) ? -1 : 1;
+  }//i
+
+  if( V ){
+    V->resize( N, N );
+    for( int l = 0; l < N; l++ ){
+      for( int i = 0; i < N; i++ ) (*V)( l, i ) = sgn[ i ] * Y( i, l );
+    }//l
+  }
+
+  // U = Q [ J^T ; 0 ]（列の順番は特異値の順。J は直交行列なので、ゼロの特異値の列も正規直交になる）
+  if( U ){
+    U->resize( M, N );
+    U->fill( 0 );
+    for( int i = 0; i < N; i++ ){
+      const T *ji = J[ order[ i ].second ];
+      for( int l = 0; l < N; l++ ) (*U)( l, i ) = sgn[ i ] * ji[ l ];
+    }//i
+    qr.applyQ( *U );
+  }
+  return ret;
+}
 
 /**
- * 乱数生成
- * - 平均 mu、標準偏差 sg の正規分布で分布する乱数を発生する。 
+ * 特異値分解（大きい方から k 個、ランダム化アルゴリズム）
+ * - A（M x N）に乱数の N x l 行列（l = k + oversample）を掛けて、A の値域を近似する正規直交基底 Q（M x l）を作り、
+ *   l x N の小さな行列 B = Q^T A を MySVD() で分解して U = Q U_B とする。
+ * - power_itr 回、( A A^T ) を掛けて基底を改善する（特異値の減り方が遅い行列向け。毎回 QR 分解で正規直交化する）。
+ * - 乱数は決まった列なので、同じ入力なら結果は同じ。
+ * - U（M x k）、V（N x k）は大きさを合わせる（空でなくてもよい）。不要なら 0 。
+ * @return 0:成功
  */
-double MyRandGauss( double mu, double sg ){
+template < class T >
+inline
+int
+MyRandomizedSVD( const MyMatViewT< T > &A, int k, std::vector< T > &S, MyMatT< T > *U = 0, MyMatT< T > *V = 0,
+                 int oversample = 10, int power_itr = 2 ){
   using namespace std;
-  // Box-Muller's Method
-  double X = rand() / (double)RAND_MAX;
-  double Y = rand() / (double)RAND_MAX;
-  double Z1 = sg * sqrt( -2 * log( X ) ) * cos( 2 * M_PI * Y ) + mu;
-  return Z1;
+  int M = A.rows(), N = A.cols();
+  int p = MyMin( M, N );
+  assert( k > 0 && k <= p );
+  int l = MyMin( p, k + oversample );
+  MyWorkspaceScope scope;
+  MyWorkspace &ws = scope.workspace();
+
+  // Y = A Ω
+  MyMatT< T > &Om = ws.mat< T >( N, l ), &Y = ws.mat< T >( M, l ), &Z = ws.mat< T >( N, l );
+  vector< double > &r = ws.vec( N );
+  for( int c = 0; c < l; c++ ){
+    MyEigStartVector( &r[ 0 ], N, c );
+    for( int i = 0; i < N; i++ ) Om( i, c ) = (T)r[ i ];
+  }//c
+  MyGemm( 1, A, Om, 0, Y );
+
+  // Q = orth( Y )、power iteration：Q = orth( A orth( A^T Q ) )
+  MyQRFactorT< T > qr;
+  MyMatT< T > Q;
+  qr.compute( Y );
+  qr.getQ( Q );
+  for( int it = 0; it < power_itr; it++ ){
+    MyGemm( 1, A.trans(), Q, 0, Z );
+    MyQRFactorT< T > qz( Z );
+    MyMatT< T > Qz;
+    qz.getQ( Qz );
+    MyGemm( 1, A, Qz, 0, Y );
+    qr.compute( Y );
+    qr.getQ( Q );
+  }//it
+
+  // B = Q^T A（l x N）を分解
+  MyMatT< T > &B = ws.mat< T >( l, N );
+  MyGemm( 1, Q.trans(), A, 0, B );
+  vector< T > Sb;
+  MyMatT< T > Ub, Vb;
+  int ret = MySVD( B, Sb, U ? &Ub : 0, V ? &Vb : 0 );
+  S.assign( Sb.begin(), Sb.begin() + k );
+  if( U ){
+    U->resize( M, k );
+    MyMatViewT< T > Ubk = Ub.block( 0, 0, l, k );
+    MyGemm( 1, Q, Ubk, 0, *U );
+  }
+  if( V ){
+    V->resize( N, k );
+    *V = Vb.block( 0, 0, N, k );
+  }
+  return ret;
 }
 
 /**
- * 乱数生成
- * - ポアソン分布に従う乱数を発生する。
- * - ただし、lambda が大きいと exp( -lambda ) が 0 になり、返ってこないので注意。
+ * 特異値分解。
+ * - MyMat 版
+ * - P = Ur * MyMatDiag( Sr ) * MyMatTrans( Vr ) となる Ur, Sr, Vr が返される。
+ * - MySVD() で分解して、ゼロとみなせる特異値（二乗が zero_eig_val_thres 未満）の分を切り捨てる。
  */
-int MyRandPoisson( double lambda ){
+inline
+int
+MySimpleSVD( const MyMatView &P,
+             MyMat &Ur,
+             std::vector< double > &Sr,
+             MyMat &Vr,
+             double zero_eig_val_thres = 1E-6 ){
   using namespace std;
-  assert( lambda > 0 );
-  double x = rand() / (double)RAND_MAX;
-  int k = 0;
-  double a = exp( -lambda );
-  while( x >= a ){
-    x = x * rand() / (double)RAND_MAX;
-    k = k + 1;
-  }
-  return k;
+  MyMat U, V;
+  if( MySVD( P, Sr, &U, &V ) ) return -1;
+  int r = 0;
+  while( r < (int)Sr.size() && Sr[ r ] * Sr[ r ] >= zero_eig_val_thres ) r++;
+  Sr.resize( r );
+  Ur = U.block( 0, 0, U.rows(), r );
+  Vr = V.block( 0, 0, V.rows(), r );
+  return 0;
 }
 
-/** 
- * 行列の LU 分解
- * - 枢軸選択（ピボッティング）は実装していない。なので計算に失敗する場合もあり。
- * @param[in,out] A 対象となる行列。LU 分解した結果で上書きされる。
- * @return 0:成功、0以外:失敗
+/**
+ * 特異値分解。
+ * - P = Ur * MyMatDiag( Sr ) * MyMatTrans( Vr ) となる Ur, Sr, Vr が返される。
+ * - 内部では MyMat に変換して計算する。
+ * @param P 対象となる、n x N の長方行列。任意でOK（なはず）。
+ * @param Sr 特異値。
+ * @param zero_eig_val_thres ゼロとみなして切り捨てる閾値。特異値の二乗（P^TP の固有値）に対してなされる。その結果、ランクが r になる。その r が、Ur, Sr, Vr のサイズになる。
  */
 int
-MyLUDecomp( std::vector< std::vector< double > > &A ){
-  int N = A.size();
-  assert( N > 0 );
-  assert( A[ 0 ].size() == N );
-  for( int i = 0; i < N - 1; i++ ){
-    if( A[ i ][ i ] == 0 ) return -1; 
-    for( int j = i + 1; j < N; j++ ){
-      A[ j ][ i ] = A[ j ][ i ] / A[ i ][ i ];
-      for( int k = i + 1; k < N; k++ ){
-        A[ j ][ k ] = A[ j ][ k ] - A[ j ][ i ] * A[ i ][ k ];
-      }
-    }
-  }
+MySimpleSVD( const std::vector< std::vector< double > > &P,
+             std::vector< std::vector< double > > &Ur,
+             std::vector< double > &Sr,
+             std::vector< std::vector< double > > &Vr,
+             double zero_eig_val_thres = 1E-6 ){
+  MyMat Ur2, Vr2;
+  int ret = MySimpleSVD( MyMat( P ), Ur2, Sr, Vr2, zero_eig_val_thres );
+  Ur2.get( Ur );
+  Vr2.get( Vr );
+  return ret;
+}
+
+/**
+ * 多項式近似
+ * - 二次式 y = a x^2 + b x + c でのフィッティング
+ * - 二次元のデータ列、(x_i, y_i) (i=0,1,2,...)、に対するフィッティング
+ * - 計画行列（i 行目が 1, x_i, x_i^2）を作り、MyLeastSquaresInPlace()（QR 分解）で解く。正規方程式は作らない。
+ * - 計画行列は作業領域に作ってその場で分解するので、同じ点数なら２回目以降はヒープのメモリ確保はない。
+ * @return 0:成功、0以外:失敗（x の値が２種類以下など、解が決まらない）
+ */
+int
+MyFitQuad( const std::vector< double > &data_x,
+           const std::vector< double > &data_y,
+           double *a, double *b, double *c )
+{
+  using namespace std;
+  
+  int N = data_x.size();
+  assert( N > 0 );
+  assert( N == data_y.size() );
+
+  MyWorkspaceScope scope;
+  MyMat &A = scope.workspace().mat( N, 3 );
+  vector< double > &X = scope.workspace().vec( 3 );
+  for( int i = 0; i < N; i++ ){
+    A( i, 0 ) = 1;
+    A( i, 1 ) = data_x[ i ];
+    A( i, 2 ) = data_x[ i ] * data_x[ i ];
+  }// i
+
+  vector< double > &Y = scope.workspace().vec( N );
+  Y = data_y;
+  if( MyLeastSquaresInPlace( A, &X[ 0 ], &Y[ 0 ] ) ) return -1;
+
+  *c = X[ 0 ];
+  *b = X[ 1 ];
+  *a = X[ 2 ];
+
   return 0;
 }
 
 /**
- * LU 分解による連立一次方程式の計算
- * - 計算量は、係数行列のサイズ n に対して、O(n^3)
- * @param[in,out] A 正方行列。関数の呼び出し後は、LU 分解された結果が入る。
- * @param[in,out] x 解。初期値は不要。メモリは確保済みでも確保済みでなくても可。
- * @param[in,out] b 定数ベクトル。内部で変数として利用されるため、呼び出し後、中身は変更されている。
+ * 多項式近似
+ * - 三次式 y = a x^3 + b x^2  + c x + d でのフィッティング
+ * - 二次元のデータ列、(x_i, y_i) (i=0,1,2,...)、に対するフィッティング
+ * - 計画行列（i 行目が 1, x_i, x_i^2, x_i^3）を作り、MyLeastSquaresInPlace()（QR 分解）で解く。
+ *   正規方程式だと x^6 までの和が入って条件数が２乗になるので、x の範囲が広いと精度が落ちていた。
+ * - 計画行列は作業領域に作ってその場で分解するので、同じ点数なら２回目以降はヒープのメモリ確保はない。
+ * @return 0:成功、0以外:失敗（x の値が３種類以下など、解が決まらない）
  */
 int
-MyAxbSolve_LU( std::vector< std::vector< double > > &A,
-               std::vector< double > &x,
-               std::vector< double > &b
-               ){
-  // 次元
-  int N = A.size();
-
-  // 入力チェック
+MyFitCubic( const std::vector< double > &data_x,
+            const std::vector< double > &data_y, 
+            double *a, double *b, double *c, double *d )
+{
+  using namespace std;
+  
+  int N = data_x.size();
   assert( N > 0 );
-  assert( A[ 0 ].size() == N );
-  assert( b.size() == N );
-  if( x.empty() ) x.resize( N );
-  else assert( x.size() == N );
-
-  // LU 分解をする
-  assert( ! MyLUDecomp( A ) );
+  assert( N == data_y.size() );
 
-  // 前進代入
+  MyWorkspaceScope scope;
+  MyMat &A = scope.workspace().mat( N, 4 );
+  vector< double > &X = scope.workspace().vec( 4 );
   for( int i = 0; i < N; i++ ){
-    b[ i ] = b[ i ];
-    for( int j = 0; j < i; j++ ){
-      b[ i ] -= A[ i ][ j ] * b[ j ];
-    }
+    A( i, 0 ) = 1;
+    A( i, 1 ) = data_x[ i ];
+    A( i, 2 ) = data_x[ i ] * data_x[ i ];
+    A( i, 3 ) = data_x[ i ] * data_x[ i ] * data_x[ i ];
   }
 
-  // 後退代入
-  for( int i = N - 1; i >= 0; i-- ){
-    x[ i ] = b[ i ];
-    for( int j = i + 1; j < N; j++ ){
-      x[ i ] -= A[ i ][ j ] * x[ j ];
-    }
-    assert( A[ i ][ i ] != 0 );
-    x[ i ] /= A[ i ][ i ];
-  }
+  vector< double > &Y = scope.workspace().vec( N );
+  Y = data_y;
+  if( MyLeastSquaresInPlace( A, &X[ 0 ], &Y[ 0 ] ) ) return -1;
+
+  *d = X[ 0 ];
+  *c = X[ 1 ];
+  *b = X[ 2 ];
+  *a = X[ 3 ];
 
   return 0;
 }
 
 /**
- * LU 分解による連立一次方程式の計算
- * - 事前に LU 分解済みの行列を渡す。
- * - 定数ベクトル b を次々変えて方程式を解きたい用。
- * - 計算量は、係数行列のサイズ n に対して、O(n^2)
- * @param[in] L 下半分行列。
- * @param[in] U 上半分行列。
- * @param[in,out] x 解。初期値は不要。メモリは確保済みでも確保済みでなくても可。
- * @param[in,out] b 定数ベクトル。内部で変数として利用されるため、呼び出し後、中身は変更されている。
+ * ３次元の点群データを平面の式（z = a x + b y + c) で回帰する。最小二乗法。
+ * - 計画行列（i 行目が x_i, y_i, 1）を作り、MyLeastSquaresInPlace()（QR 分解）で解く。正規方程式は作らない。
+ * - 計画行列は作業領域に作ってその場で分解するので、同じ点数なら２回目以降はヒープのメモリ確保はない。
+ * @return 0:成功、0以外:失敗（点が一直線上に並んでいるなど、解が決まらない）
  */
 int
-MyAxbSolve_LU( const std::vector< std::vector< double > > &L,
-               const std::vector< std::vector< double > > &U,
-               std::vector< double > &x,
-               std::vector< double > &b
-               ){
-  // 入力チェック
-  assert( MyMatIsSquare( L ) && MyMatIsSquare( U ) );
-  assert( MyMatSize( L ) == MyMatSize( U ) );
-  int N = L.size();
-  assert( b.size() == N );
-  if( x.empty() ) x.resize( N );
-  else assert( x.size() == N );
-
-  // 前進代入
-  for( int i = 0; i < N; i++ ){
-    b[ i ] = b[ i ];
-    for( int j = 0; j < i; j++ ){
-      b[ i ] -= L[ i ][ j ] * b[ j ];
-    }
-  }
-
-  // 後退代入
-  for( int i = N - 1; i >= 0; i-- ){
-    x[ i ] = b[ i ];
-    for( int j = i + 1; j < N; j++ ){
-      x[ i ] -= U[ i ][ j ] * x[ j ];
-    }
-    assert( U[ i ][ i ] != 0 );
-    x[ i ] /= U[ i ][ i ];
+MyPlaneFit( const std::vector< double > &x_buf,
+            const std::vector< double > &y_buf,
+            const std::vector< double > &z_buf,
+            double *a,
+            double *b,
+            double *c ){
+  using namespace std;
+  int n = x_buf.size();
+  assert( y_buf.size() == n && z_buf.size() == n );
+  MyWorkspaceScope scope;
+  MyMat &A = scope.workspace().mat( n, 3 );
+  vector< double > &X = scope.workspace().vec( 3 );
+  for( int i = 0; i < n; i++ ){
+    A( i, 0 ) = x_buf[ i ];
+    A( i, 1 ) = y_buf[ i ];
+    A( i, 2 ) = 1;
   }
-  
+  vector< double > &Z = scope.workspace().vec( n );
+  Z = z_buf;
+  if( MyLeastSquaresInPlace( A, &X[ 0 ], &Z[ 0 ] ) ) return -1;
+  *a = X[ 0 ];
+  *b = X[ 1 ];
+  *c = X[ 2 ];
   return 0;
 }
 
 /**
- * LU 分解された結果が一緒になった行列 A から、下半分行列 L、上半分行列 U を抽出する。
- * @param[in] A MyLUDecomp() で LU 分解済みの行列を渡すこと
- * @param[out] L 下半分行列。メモリは確保済み or 未確保でも良い。
- * @param[out] U 上半分行列。メモリは確保済み or 未確保でも良い。
+ * ３次元の点群データを平面の式（z = a x + b y + c) で回帰する。最小二乗法。
+ * - バッチ版。n 個のパッチ（各 m 点）の平面をまとめて求める。
+ * - 正規方程式をパッチごとに SoA 形式で作り、MyAxbSolveBatch() でまとめて解く。
+ * - 解が決まらないパッチ（点が一直線上に並んでいるなど）があっても止まらない。fail にフラグを立て、係数はゼロにする。
+ * @param x_buf, y_buf, z_buf m x n の行列。j 列目が j 番目のパッチの m 個の点の座標。
+ * @param[out] a, b, c n 個の係数。空ならリサイズする。
+ * @param[out] fail パッチごとの失敗フラグ（1:失敗）。空ならリサイズする。
+ * @return 失敗したパッチの個数（0 なら全部成功）
  */
+inline
 int
-MyLUSet( const std::vector< std::vector< double > > &A,
-         std::vector< std::vector< double > > &L,
-         std::vector< std::vector< double > > &U ){
-  using namespace std;
+MyPlaneFitBatch( const MyMatView &x_buf,
+                 const MyMatView &y_buf,
+                 const MyMatView &z_buf,
+                 std::vector< double > &a,
+                 std::vector< double > &b,
+                 std::vector< double > &c,
+                 std::vector< unsigned char > &fail ){
+  int m = x_buf.rows(), n = x_buf.cols();
+  assert( MyMatAreTheSameSize( x_buf, y_buf ) && MyMatAreTheSameSize( x_buf, z_buf ) );
+  if( a.empty() ) a.resize( n );
+  else assert( a.size() == n );
+  if( b.empty() ) b.resize( n );
+  else assert( b.size() == n );
+  if( c.empty() ) c.resize( n );
+  else assert( c.size() == n );
+  if( n == 0 ){ fail.clear(); return 0; }
+
+  // 正規方程式の係数の面（対称行列なので独立な６面＋右辺３面）
+  // - 桁落ちを防ぐため、各パッチの最初の点を原点にした座標で和をとる。
+  MyWorkspaceScope scope;
+  double *s = scope.workspace().alloc( (size_t)9 * n );
+  double *sxx = s, *sxy = s + n, *sx = s + 2 * n, *syy = s + 3 * n, *sy = s + 4 * n, *sm = s + 5 * n;
+  double *sxz = s + 6 * n, *syz = s + 7 * n, *sz = s + 8 * n;
+  std::fill( s, s + (size_t)9 * n, 0.0 );
+  int xs = x_buf.colStride(), ys = y_buf.colStride(), zs = z_buf.colStride();
+  const double *x0 = x_buf.ptr( 0, 0 ), *y0 = y_buf.ptr( 0, 0 ), *z0 = z_buf.ptr( 0, 0 );
+  for( int i = 1; i < m; i++ ){
+    const double *xi = x_buf.ptr( i, 0 ), *yi = y_buf.ptr( i, 0 ), *zi = z_buf.ptr( i, 0 );
+    for( int k = 0; k < n; k++ ){
+      double x = xi[ (size_t)k * xs ] - x0[ (size_t)k * xs ];
+      double y = yi[ (size_t)k * ys ] - y0[ (size_t)k * ys ];
+      double z = zi[ (size_t)k * zs ] - z0[ (size_t)k * zs ];
+      sxx[ k ] += x * x;
+      sxy[ k ] += x * y;
+      sx[ k ] += x;
+      syy[ k ] += y * y;
+      sy[ k ] += y;
+      sxz[ k ] += x * z;
+      syz[ k ] += y * z;
+      sz[ k ] += z;
+    }//k
+  }//i
+  std::fill( sm, sm + n, (double)m );
 
-  assert( MyMatIsSquare( A ) );
-  int N = A.size();
-  if( L.empty() ) L.resize( N, vector< double >( N ) );
-  else assert( MyMatAreTheSameSize( L, A ) );
-  if( U.empty() ) U.resize( N, vector< double >( N ) );
-  else assert( MyMatAreTheSameSize( U, A ) );
+  // まとめて解く
+  double *det = scope.workspace().alloc( n ), *scale = scope.workspace().alloc( n );
+  const double *in[ 12 ] = { sxx, sxy, sx, sxy, syy, sy, sx, sy, sm, sxz, syz, sz };
+  double *out[ 5 ] = { &a[ 0 ], &b[ 0 ], &c[ 0 ], det, scale };
+  MyBatchRun< MyBatchKernelSolve3x3 >( in, out, n );
 
-  for( int i = 0; i < N; i++ ){
-    for( int j = i; j < N; j++ ){
-      U[ i ][ j ] = A[ i ][ j ];
-    }
-    for( int j = 0; j < i; j++ ){
-      L[ i ][ j ] = A[ i ][ j ];
-    }
-    L[ i ][ i ] = 1;
+  // 原点を元に戻す
+  for( int k = 0; k < n; k++ ){
+    c[ k ] += z0[ (size_t)k * zs ] - a[ k ] * x0[ (size_t)k * xs ] - b[ k ] * y0[ (size_t)k * ys ];
   }
-  return 0;
+  return MyBatchMarkSingular( det, scale, n, out, 3, MY_BATCH_SINGULAR_EPS, fail );
 }
+  
+/*
+ * --- 高速フーリエ変換（FFT） ---
+ * - MyDFT, MyIDFT の中身。複素数は実部と虚部を交互に並べた配列（re0, im0, re1, im1, ...）で扱う。
+ * - N を小さな因数（4, 2, 3, 5, 7, ...）の積に分解し、桁反転の並べ替えのあと、
+ *   基数ごとのバタフライ演算を段ごとに行う（混合基数の時間間引き）。N が 2 の累乗なら基数 4 と 2 だけになる。
+ * - MY_FFT_MAX_RADIX より大きな素因数を持つ N（大きな素数など）は、Bluestein の方法（chirp-z 変換）で
+ *   2 の累乗の長さの FFT による畳み込みに直す。
+ * - なので、どの N でも計算量は O(N log N)。
+ * - 回転因子などの表は長さと向きごとのプラン（MyFFTPlanT）に持たせ、プロセス全体でキャッシュして使い回す（MyFFTGetPlan）。
+ *   キャッシュは MY_FFT_PLAN_CACHE_BYTES バイトまでで、超えたら古いプランから外す（使用中のプランは参照がなくなったときに解放する）。
+ * - 符号 sign は -1 で順変換（exp( -2πi kl / N )）、+1 で逆変換。正規化はしない。
+ */
+
+// 混合基数で扱う素因数の上限（これより大きな素因数があれば Bluestein の方法を使う）
+#ifndef MY_FFT_MAX_RADIX
+#define MY_FFT_MAX_RADIX 13
+#endif
+
+// FFT のプランのキャッシュ（MyFFTGetPlan）に置くプランの合計の上限（バイト）
+#ifndef MY_FFT_PLAN_CACHE_BYTES
+#define MY_FFT_PLAN_CACHE_BYTES ( 64 << 20 )
+#endif
 
 /**
- * 行列が対角優位かどうかのチェック
- * - 対角優位：係数行列の各行について、対角成分の絶対値が非対角成分の絶対値の総和よりも大きいこと
- * @return 対角優位:true, そうでない場合:false
+ * FFT の基数への分解
+ * - N を 2, 4, 3, 5, 7, ... の積に分解して、最初の段から順に radix に入れる。
+ * - MY_FFT_MAX_RADIX より大きな素因数があれば false を返す（radix は不定）。
  */
+inline
 bool
-MyMatIsDiagDominant( const std::vector< std::vector< double > > &A ){
-  int N = A.size();
-  for( int i = 0; i < N; i++ ){
-    double sum = 0;
-    for( int j = 0; j < N; j++ ){
-      if( i != j ) sum += MyAbs( A[ i ][ j ] );
-    }
-    if( sum > MyAbs( A[ i ][ i ] ) ) return false;
-  }
-  return true;
+MyFFTFactorize( int N, std::vector< int > &radix ){
+  radix.clear();
+  int n = N, n4 = 0;
+  while( n % 4 == 0 ){ n /= 4; n4++; }
+  if( n % 2 == 0 ){ n /= 2; radix.push_back( 2 ); }
+  for( int i = 0; i < n4; i++ ) radix.push_back( 4 );
+  for( int p = 3; p <= MY_FFT_MAX_RADIX; p += 2 ){
+    while( n % p == 0 ){ n /= p; radix.push_back( p ); }
+  }//p
+  return n == 1;
 }
 
 /**
- * 連立一次方程式を解く
- * - Ax = b
- * - ヤコビ反復法
- * - 係数行列が以下のいずれかの条件を満たさないと収束しない
- *   - 対角優位（係数行列の各行について対角成分の絶対値が非対角成分の絶対値の総和よりも大きい）
- *   - 対称行列＆正値（固有値が全て正）
- * - 計算量は、係数行列のサイズ n に対して、O(n^2)
- * @param A 係数行列。n x n の正方行列。
- * @param[in,out] x 解ベクトル。初期値を入れておく or 初期値なしの空ベクトル。空の場合は初期値 0 。
- * @param thres 収束条件：解の変化量（ノルム）がこの値を下回ったら計算終了
- * @param max_itr_num 収束条件：繰り返し計算の最大繰り返し回数。
- * @param dout デバッグ情報の表示
+ * FFT の桁反転の並べ替え
+ * - 変換前の作業配列の p 番目に入れる入力の番号 perm[ p ] を求める。
+ * - 基数が全部 2 なら、いわゆるビット反転。
  */
-int
-MyAxbSolve_Jacobi( const std::vector< std::vector< double > > &A,
-                   std::vector< double > &x,
-                   const std::vector< double > &b,
-                   double thres = 1E-06,
-                   int max_itr_num = 100,
-                   std::ostream *dout = 0 ){
-  using namespace std;
+inline
+void
+MyFFTPermutation( const std::vector< int > &radix, int *perm ){
+  int N = 1;
+  for( size_t s = 0; s < radix.size(); s++ ) N *= radix[ s ];
+  for( int n = 0; n < N; n++ ){
+    int m = n, p = 0, L = N;
+    for( int s = (int)radix.size() - 1; s >= 0; s-- ){
+      L /= radix[ s ];
+      p += ( m % radix[ s ] ) * L;
+      m /= radix[ s ];
+    }//s
+    perm[ p ] = n;
+  }//n
+}
 
-  // 次元
-  int N = A.size();
+/**
+ * FFT の回転因子の表の大きさ（要素数。複素数１つで２要素）
+ */
+inline
+int
+MyFFTTwiddleSize( const std::vector< int > &radix ){
+  int size = 0, L = 1;
+  for( size_t s = 0; s < radix.size(); s++ ){
+    size += 2 * L * ( radix[ s ] - 1 );
+    if( radix[ s ] > 5 ) size += 2 * radix[ s ];
+    L *= radix[ s ];
+  }//s
+  return size;
+}
 
-  // 入力チェック
-  assert( N > 0 );
-  assert( A[ 0 ].size() == N );
-  assert( b.size() == N );
-  if( x.empty() ) x.resize( N, 0 );
-  else assert( x.size() == N );
+/**
+ * FFT の回転因子の表
+ * - 段 s（基数 r、それまでの長さ L）について、exp( sign 2πi jq / rL )（0 <= j < L, 1 <= q < r）を j, q の順に並べたもの。
+ * - 専用のバタフライがない基数（7 以上）は、続けて exp( sign 2πi k / r )（0 <= k < r）を置く。
+ * - 角度は整数のまま剰余をとってから計算するので、N が大きくても精度は落ちない。
+ * @param[out] tw MyFFTTwiddleSize( radix ) 要素の領域
+ */
+template < class T >
+inline
+void
+MyFFTTwiddle( const std::vector< int > &radix, int sign, T *tw ){
+  int L = 1;
+  for( size_t s = 0; s < radix.size(); s++ ){
+    int r = radix[ s ], L1 = L * r;
+    for( int j = 0; j < L; j++ ){
+      for( int q = 1; q < r; q++ ){
+        double t = sign * 2.0 * M_PI * ( (long long)j * q % L1 ) / L1;
+        *tw++ = (T)cos( t );
+        *tw++ = (T)sin( t );
+      }//q
+    }//j
+    if( r > 5 ){
+      for( int k = 0; k < r; k++ ){
+        double t = sign * 2.0 * M_PI * k / r;
+        *tw++ = (T)cos( t );
+        *tw++ = (T)sin( t );
+      }//k
+    }
+    L = L1;
+  }//s
+}
 
-  // 収束するかどうかのチェック
-  // if( ! MyMatIsDiagDominant( A ) ) return -1;
-  
-  // 一時変数
-  vector< double > x_next( N );
-  
-  if( dout ){
-    *dout << "--- MyAxbSolve_Jacobi() ---" << endl;
-    *dout << "[0]\t" << x << endl;
-  }
-    
-  // 反復処理
-  for( int k = 0; k < max_itr_num; k++ ){
-    for( int i = 0; i < N; i++ ){
-      x_next[ i ] = b[ i ];
-      for( int j = 0; j < N; j++ ){
-        if( i != j ){
-          x_next[ i ] -= A[ i ][ j ] * x[ j ];
+/**
+ * FFT のバタフライ演算（全段）
+ * - z は MyFFTPermutation() の順に並べ替え済みの N 個の複素数。変換結果は自然な順で z に入る。
+ * - tw は同じ radix, sign で作った MyFFTTwiddle() の表。
+ */
+template < class T >
+inline
+void
+MyFFTButterfly( T *z, int N, const std::vector< int > &radix, int sign, const T *tw ){
+  const T h3 = (T)( sign * 0.86602540378443864676 );  // sign * sin( 2π / 3 )
+  const T c1 = (T)0.30901699437494742410, c2 = (T)-0.80901699437494742410;  // cos( 2π / 5 ), cos( 4π / 5 )
+  const T s1 = (T)( sign * 0.95105651629515357212 ), s2 = (T)( sign * 0.58778525229247312917 );  // sign * sin( 2π / 5 ), sign * sin( 4π / 5 )
+  int L = 1;
+  for( size_t s = 0; s < radix.size(); s++ ){
+    const int r = radix[ s ], L1 = L * r, d = 2 * L;
+    for( int b = 0; b < N; b += L1 ){
+      for( int j = 0; j < L; j++ ){
+        T *x = z + 2 * ( b + j );
+        const T *w = tw + 2 * j * ( r - 1 );
+        // 回転因子を掛けたもの a[ q ] = x[ q ] * w[ q ]
+        T a[ 2 * MY_FFT_MAX_RADIX ];
+        a[ 0 ] = x[ 0 ];
+        a[ 1 ] = x[ 1 ];
+        for( int q = 1; q < r; q++ ){
+          T xr = x[ q * d ], xi = x[ q * d + 1 ], wr = w[ 2 * q - 2 ], wi = w[ 2 * q - 1 ];
+          a[ 2 * q ] = xr * wr - xi * wi;
+          a[ 2 * q + 1 ] = xr * wi + xi * wr;
+        }//q
+        // 長さ r の DFT
+        if( r == 2 ){
+          x[ 0 ] = a[ 0 ] + a[ 2 ];  x[ 1 ] = a[ 1 ] + a[ 3 ];
+          x[ d ] = a[ 0 ] - a[ 2 ];  x[ d + 1 ] = a[ 1 ] - a[ 3 ];
+        }
+        else if( r == 4 ){
+          T t0r = a[ 0 ] + a[ 4 ], t0i = a[ 1 ] + a[ 5 ], t1r = a[ 0 ] - a[ 4 ], t1i = a[ 1 ] - a[ 5 ];
+          T t2r = a[ 2 ] + a[ 6 ], t2i = a[ 3 ] + a[ 7 ];
+          // sign * i * ( a1 - a3 )
+          T ur = -sign * ( a[ 3 ] - a[ 7 ] ), ui = sign * ( a[ 2 ] - a[ 6 ] );
+          x[ 0 ] = t0r + t2r;          x[ 1 ] = t0i + t2i;
+          x[ d ] = t1r + ur;           x[ d + 1 ] = t1i + ui;
+          x[ 2 * d ] = t0r - t2r;      x[ 2 * d + 1 ] = t0i - t2i;
+          x[ 3 * d ] = t1r - ur;       x[ 3 * d + 1 ] = t1i - ui;
+        }
+        else if( r == 3 ){
+          T sr = a[ 2 ] + a[ 4 ], si = a[ 3 ] + a[ 5 ];
+          T mr = a[ 0 ] - (T)0.5 * sr, mi = a[ 1 ] - (T)0.5 * si;
+          T ur = -h3 * ( a[ 3 ] - a[ 5 ] ), ui = h3 * ( a[ 2 ] - a[ 4 ] );
+          x[ 0 ] = a[ 0 ] + sr;        x[ 1 ] = a[ 1 ] + si;
+          x[ d ] = mr + ur;            x[ d + 1 ] = mi + ui;
+          x[ 2 * d ] = mr - ur;        x[ 2 * d + 1 ] = mi - ui;
+        }
+        else if( r == 5 ){
+          T p1r = a[ 2 ] + a[ 8 ], p1i = a[ 3 ] + a[ 9 ], m1r = a[ 2 ] - a[ 8 ], m1i = a[ 3 ] - a[ 9 ];
+          T p2r = a[ 4 ] + a[ 6 ], p2i = a[ 5 ] + a[ 7 ], m2r = a[ 4 ] - a[ 6 ], m2i = a[ 5 ] - a[ 7 ];
+          T q1r = a[ 0 ] + c1 * p1r + c2 * p2r, q1i = a[ 1 ] + c1 * p1i + c2 * p2i;
+          T q2r = a[ 0 ] + c2 * p1r + c1 * p2r, q2i = a[ 1 ] + c2 * p1i + c1 * p2i;
+          // i * ( s1 m1 + s2 m2 ), i * ( s2 m1 - s1 m2 )
+          T u1r = -( s1 * m1i + s2 * m2i ), u1i = s1 * m1r + s2 * m2r;
+          T u2r = -( s2 * m1i - s1 * m2i ), u2i = s2 * m1r - s1 * m2r;
+          x[ 0 ] = a[ 0 ] + p1r + p2r; x[ 1 ] = a[ 1 ] + p1i + p2i;
+          x[ d ] = q1r + u1r;          x[ d + 1 ] = q1i + u1i;
+          x[ 2 * d ] = q2r + u2r;      x[ 2 * d + 1 ] = q2i + u2i;
+          x[ 3 * d ] = q2r - u2r;      x[ 3 * d + 1 ] = q2i - u2i;
+          x[ 4 * d ] = q1r - u1r;      x[ 4 * d + 1 ] = q1i - u1i;
+        }
+        else {
+          // 専用のバタフライがない基数は定義どおりに計算する
+          const T *e = tw + 2 * L * ( r - 1 );
+          for( int k = 0; k < r; k++ ){
+            T yr = 0, yi = 0;
+            for( int q = 0, m = 0; q < r; q++, m = ( m + k ) % r ){
+              yr += a[ 2 * q ] * e[ 2 * m ] - a[ 2 * q + 1 ] * e[ 2 * m + 1 ];
+              yi += a[ 2 * q ] * e[ 2 * m + 1 ] + a[ 2 * q + 1 ] * e[ 2 * m ];
+            }//q
+            x[ k * d ] = yr;
+            x[ k * d + 1 ] = yi;
+          }//k
         }
       }//j
-      assert( A[ i ][ i ] != 0 );
-      x_next[ i ] /= A[ i ][ i ];
-    }//i
+    }//b
+    tw += 2 * L * ( r - 1 );
+    if( r > 5 ) tw += 2 * r;
+    L = L1;
+  }//s
+}
+
+/**
+ * FFT のプラン
+ * - 長さ n、向き sign（-1 で順変換、+1 で逆変換）、精度 T ごとに一度だけ作り、何度でも使い回す。
+ * - 作るときに、回転因子の表、桁反転の並べ替え、Bluestein の方法で使うチャープとその FFT を計算しておく。
+ *   なので、実行時には三角関数の計算もヒープのメモリ確保も起きない。
+ * - 表は MY_MAT_ALIGN バイト境界に揃えてある（MyMatT で持つ）。
+ * - 作業領域は、呼び出したスレッドの MyWorkspace から借りる（同じ長さなら２回目以降はメモリ確保なし）。
+ *   プラン自体は作った後に書き換えないので、同じプランを複数のスレッドから同時に実行してよい。
+ * - 使い方：
+ *     MyFFTPlanRef plan = MyFFTGetPlan< double >( n, -1 ); // キャッシュから取り出す（なければ作る）
+ *     plan->execute( re, im, z ); // re, im（n 要素）の FFT を z（2n 要素、実部と虚部が交互）に入れる
+ *     plan->execute( z );         // z（2n 要素）をその場で変換する
+ *   キャッシュを通さずに MyFFTPlan plan( n, -1 ); と自分で作ってもよい。
+ */
+template < class T >
+class MyFFTPlanT
+{
+  int _n;                        //!< データの数
+  int _sign;                     //!< 向き（-1 で順変換、+1 で逆変換）
+  std::vector< int > _radix;     //!< 各段の基数（混合基数のとき）
+  std::vector< int > _perm;      //!< 桁反転の並べ替え（混合基数のとき）
+  MyMatT< T > _tw;               //!< 回転因子の表（1 x MyFFTTwiddleSize( _radix )）
+  const MyFFTPlanT *_conv;       //!< Bluestein の方法の畳み込みに使う長さ M の順変換のプラン（このプランが持つ。混合基数なら 0）
+  MyMatT< T > _chirp;            //!< チャープ c_n = exp( sign πi n^2 / N )（N x 2、行が複素数）
+  MyMatT< T > _b;                //!< conj( c_n ) を並べた長さ M の列の FFT を M で割ったもの（M x 2、自然な順）
+
+  // コピー禁止
+  MyFFTPlanT( const MyFFTPlanT & );
+  MyFFTPlanT & operator = ( const MyFFTPlanT & );
+
+  /**
+   * 桁反転の順に並べ替えながら読み込む（混合基数のとき）
+   * - 入力の n 番目は re[ n * stride ], im[ n * stride ]。
+   */
+  template < class S >
+  void load( const S *re, const S *im, int stride, T *z ) const {
+    const int *perm = &_perm[ 0 ];
+    for( int p = 0; p < _n; p++ ){
+      size_t n = (size_t)perm[ p ] * stride;
+      z[ 2 * p ] = (T)re[ n ];
+      z[ 2 * p + 1 ] = (T)im[ n ];
+    }//p
+  }
+
+  /**
+   * Bluestein の方法
+   * - X_k = Σ x_n exp( sign 2πi nk / N ) を、nk = ( n^2 + k^2 - (k - n)^2 ) / 2 と書き直して
+   *   チャープとの畳み込み X_k = c_k Σ ( x_n c_n ) conj( c_{k-n} ) にする。
+   * - 畳み込みは長さ M（2N - 1 以上の 2 の累乗）の FFT で計算する。逆変換は共役をとって順変換で代用する。
+   */
+  template < class S >
+  void bluestein( const S *re, const S *im, int stride, T *z ) const {
+    MyWorkspaceScope scope;
+    const int N = _n, M = _conv->_n;
+    const int *perm = &_conv->_perm[ 0 ];
+    T *a = scope.workspace().alloc< T >( 2 * M ), *y = scope.workspace().alloc< T >( 2 * M );
+
+    // x_n c_n の FFT
+    for( int p = 0; p < M; p++ ){
+      int n = perm[ p ];
+      if( n < N ){
+        T xr = (T)re[ (size_t)n * stride ], xi = (T)im[ (size_t)n * stride ];
+        T cr = _chirp( n, 0 ), ci = _chirp( n, 1 );
+        a[ 2 * p ] = xr * cr - xi * ci;
+        a[ 2 * p + 1 ] = xr * ci + xi * cr;
+      }
+      else a[ 2 * p ] = a[ 2 * p + 1 ] = 0;
+    }//p
+    _conv->butterfly( a );
+
+    // 積の共役を並べ替えて、もう一度順変換
+    for( int n = 0; n < M; n++ ){
+      T ar = a[ 2 * n ], ai = a[ 2 * n + 1 ], br = _b( n, 0 ), bi = _b( n, 1 );
+      a[ 2 * n ] = ar * br - ai * bi;
+      a[ 2 * n + 1 ] = -( ar * bi + ai * br );
+    }//n
+    for( int p = 0; p < M; p++ ){
+      y[ 2 * p ] = a[ 2 * perm[ p ] ];
+      y[ 2 * p + 1 ] = a[ 2 * perm[ p ] + 1 ];
+    }//p
+    _conv->butterfly( y );
+
+    // 共役を戻してチャープを掛ける
+    for( int k = 0; k < N; k++ ){
+      T yr = y[ 2 * k ], yi = -y[ 2 * k + 1 ], cr = _chirp( k, 0 ), ci = _chirp( k, 1 );
+      z[ 2 * k ] = yr * cr - yi * ci;
+      z[ 2 * k + 1 ] = yr * ci + yi * cr;
+    }//k
+  }
+
+  /**
+   * 並べ替え済みのデータにバタフライ演算を行う（混合基数のとき）
+   */
+  void butterfly( T *z ) const {
+    MyFFTButterfly( z, _n, _radix, _sign, _tw.data() );
+  }
+
+ public:
+  /**
+   * プランを作る
+   * - 通常は MyFFTGetPlan() でキャッシュされたものを使う。
+   * @param n データの数（いくつでもよい）
+   * @param sign -1 で順変換、+1 で逆変換
+   */
+  MyFFTPlanT( int n, int sign ) : _n( n ), _sign( sign ), _conv( 0 ) {
+    using namespace std;
+    assert( n > 0 );
+    assert( sign == -1 || sign == 1 );
+    if( MyFFTFactorize( n, _radix ) ){
+      _perm.resize( n );
+      MyFFTPermutation( _radix, &_perm[ 0 ] );
+      _tw.resize( 1, MyMax( MyFFTTwiddleSize( _radix ), 1 ) );
+      MyFFTTwiddle( _radix, sign, _tw.data() );
+      return;
+    }
+
+    // 大きな素因数がある：Bluestein の方法
+    _radix.clear();
+    int M = 1;
+    while( M < 2 * n - 1 ) M *= 2;
+    MyFFTPlanT *conv = new MyFFTPlanT( M, -1 );
+    _conv = conv;
+
+    // チャープ（角度は n^2 を 2N で割った余りで計算する）
+    _chirp.resize( n, 2 );
+    for( int k = 0; k < n; k++ ){
+      double t = sign * M_PI * ( (long long)k * k % ( 2 * n ) ) / n;
+      _chirp( k, 0 ) = (T)cos( t );
+      _chirp( k, 1 ) = (T)sin( t );
+    }//k
+
+    // 畳み込む相手 conj( c_{-k} ) の FFT（逆変換の 1 / M もここに含める）
+    _b.resize( M, 2 );
+    T *b = _b.data();
+    const int *perm = &_conv->_perm[ 0 ];
+    for( int p = 0; p < M; p++ ){
+      int k = perm[ p ];
+      if( k >= n ) k = M - k;
+      if( k < n ){
+        b[ 2 * p ] = _chirp( k, 0 ) / M;
+        b[ 2 * p + 1 ] = -_chirp( k, 1 ) / M;
+      }
+      else b[ 2 * p ] = b[ 2 * p + 1 ] = 0;
+    }//p
+    _conv->butterfly( b );
+  }
+
+  ~MyFFTPlanT(){ delete _conv; }
+
+  /**
+   * データの数
+   */
+  int size() const { return _n; }
+
+  /**
+   * 向き（-1 で順変換、+1 で逆変換）
+   */
+  int sign() const { return _sign; }
+
+  /**
+   * Bluestein の方法を使うか
+   */
+  bool bluestein() const { return _conv != 0; }
 
-    // 収束判定
-    double dx = MyVecNorm( x_next - x );
-    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x_next << " dx: " << dx << endl;
-    if( dx < thres ) break;
+  /**
+   * 表などに使っているメモリ（バイト）
+   */
+  size_t bytes() const {
+    size_t s = sizeof( *this ) + ( _radix.size() + _perm.size() ) * sizeof( int );
+    s += ( (size_t)_tw.rows() * _tw.cols() + (size_t)_chirp.rows() * _chirp.cols() + (size_t)_b.rows() * _b.cols() ) * sizeof( T );
+    if( _conv ) s += _conv->bytes();
+    return s;
+  }
 
-    // 更新
-    x = x_next;
+  /**
+   * 実行
+   * - 実部 re と虚部 im に分かれた n 個の入力を変換して、複素数の配列 z に入れる。正規化はしない。
+   * @param re 入力の実部
+   * @param im 入力の虚部
+   * @param[out] z 出力（2n 要素。実部と虚部を交互に並べたもの）
+   */
+  template < class S >
+  void execute( const S *re, const S *im, T *z ) const {
+    if( _conv ) bluestein( re, im, 1, z );
+    else {
+      load( re, im, 1, z );
+      butterfly( z );
+    }
+  }
 
-  }//k
-  
-  return 0;
-}
+  /**
+   * その場で実行
+   * @param[in,out] z 2n 要素（実部と虚部を交互に並べたもの）
+   */
+  void execute( T *z ) const {
+    if( _conv ) bluestein( z, z + 1, 2, z );
+    else {
+      MyWorkspaceScope scope;
+      T *x = scope.workspace().alloc< T >( 2 * _n );
+      std::copy( z, z + 2 * _n, x );
+      load( x, x + 1, 2, z );
+      butterfly( z );
+    }
+  }
+};
+
+typedef MyFFTPlanT< double > MyFFTPlan;
+typedef MyFFTPlanT< float > MyFFTPlanf;
 
 /**
- * 連立一次方程式を解く
- * - Ax = b
- * - ガウスザイデルの反復法
- * - 係数行列が以下のいずれかの条件を満たさないと収束しない
- *   - 対角優位（係数行列の各行について対角成分の絶対値が非対角成分の絶対値の総和よりも大きい）
- *   - 対称行列＆正値（固有値が全て正）
- * - 計算量は、係数行列のサイズ n に対して、O(n^2)
- * - ヤコビの反復法に比べて、内部で使うメモリの量が少ない＆収束が速い。
- * - なので、基本的にはヤコビ反復法よりはこっちを使った方がよい。
- * @param A 係数行列。n x n の正方行列。
- * @param[in,out] x 解ベクトル。初期値を入れておく or 初期値なしの空ベクトル。空の場合は初期値 0 。
- * @param thres 収束条件：解の変化量（各要素の変化量絶対値の総和）がこの値を下回ったら計算終了
- * @param max_itr_num 収束条件：繰り返し計算の最大繰り返し回数。
- * @param dout デバッグ情報の表示
+ * FFT のプランのキャッシュ（MyFFTGetPlan() の中身）
+ * - (n, sign) ごとのプランを、参照の数と最後に取り出した順番と一緒に持つ（ノード）。
+ * - 参照の数は、キャッシュに入っている間のキャッシュの分の１と、取り出した MyFFTPlanRefT の数。
+ *   キャッシュから外しても、取り出した側が使い終わる（参照がなくなる）までは解放しない。
+ * - 操作はすべて mutex をロックして行う。
  */
-int
-MyAxbSolve_GaussSeidel( const std::vector< std::vector< double > > &A,
-                        std::vector< double > &x,
-                        const std::vector< double > &b,
-                        double thres = 1E-06,
-                        int max_itr_num = 100,
-                        std::ostream *dout = 0 ){
-  using namespace std;
+template < class T >
+struct MyFFTPlanCacheT
+{
+  struct Node {
+    MyFFTPlanT< T > plan;
+    int refs;             //!< 参照の数
+    unsigned long stamp;  //!< 最後に取り出した順番（小さいほど古い）
+    Node( int n, int sign ) : plan( n, sign ), refs( 0 ), stamp( 0 ) { }
+  };
+  typedef std::map< std::pair< int, int >, Node * > Map;
+  Map map;
+  unsigned long clock;  //!< 取り出した順番を数える
+  size_t bytes;         //!< キャッシュに入っているプランの合計のメモリ
+  MyMutex mutex;
+
+  MyFFTPlanCacheT() : clock( 0 ), bytes( 0 ) { }
+
+  ~MyFFTPlanCacheT(){
+    for( typename Map::iterator it = map.begin(); it != map.end(); ++it ){
+      if( --it->second->refs == 0 ) delete it->second;
+    }//it
+  }
 
-  // 次元
-  int N = A.size();
+  // 参照を１つ増やす（ロックして呼ぶ）
+  Node *acquire( Node *node ){
+    node->refs++;
+    node->stamp = ++clock;
+    return node;
+  }
 
-  // 入力チェック
-  assert( N > 0 );
-  assert( A[ 0 ].size() == N );
-  assert( b.size() == N );
-  if( x.empty() ) x.resize( N, 0 );
-  else assert( x.size() == N );
+  // 参照を１つ減らし、なくなれば解放する
+  void release( Node *node ){
+    bool last;
+    {
+      MyMutexLock lock( mutex );
+      last = ( --node->refs == 0 );
+    }
+    if( last ) delete node;
+  }
 
-  // 収束するかどうかのチェック
-  // if( ! MyMatIsDiagDominant( A ) ) return -1;
-  
-  if( dout ){
-    *dout << "--- MyAxbSolve_GaussSeidel() ---" << endl;
-    *dout << "[0]\t" << x << endl;
+  // keep 以外のプランを、古い順に、合計が limit バイト以下になるまでキャッシュから外す（ロックして呼ぶ）
+  void shrink( size_t limit, const Node *keep ){
+    while( bytes > limit ){
+      typename Map::iterator victim = map.end();
+      for( typename Map::iterator it = map.begin(); it != map.end(); ++it ){
+        if( it->second != keep && ( victim == map.end() || it->second->stamp < victim->second->stamp ) ) victim = it;
+      }//it
+      if( victim == map.end() ) break;
+      Node *node = victim->second;
+      bytes -= node->plan.bytes();
+      map.erase( victim );
+      if( --node->refs == 0 ) delete node;
+    }
   }
-    
-  // 反復処理
-  for( int k = 0; k < max_itr_num; k++ ){
-    double dx = 0; // 解の変化量計算（収束判定のため）
-    for( int i = 0; i < N; i++ ){
-      double x_old = x[ i ]; // 更新前の値を覚えておく（解の変化量計算のため）
-      x[ i ] = b[ i ];
-      for( int j = 0; j < N; j++ ){
-        if( j != i ) x[ i ] -= A[ i ][ j ] * x[ j ];
-      }//j
-      assert( A[ i ][ i ] != 0 );
-      x[ i ] /= A[ i ][ i ];
-      dx += MyAbs( x_old - x[ i ] );
-    }//i
-    // 収束判定
-    if( dout ) *dout << "[" << k + 1 << "]\t x: " << x << " dx: " << dx << endl;
-    if( dx < thres ) break;
+};
 
-  }//k
-  
-  return 0;
+/**
+ * FFT のプランのキャッシュ（T ごとにプロセスに１つ）
+ */
+template < class T >
+inline
+MyFFTPlanCacheT< T > &
+MyFFTPlanCache(){
+  static MyFFTPlanCacheT< T > cache;
+  return cache;
 }
 
 /**
- * QR 分解を行う。
- * - A は、正方＆正則であること。
- * - 原点移動による高速化は未実装。
- * - 内部でシュミットの直交化を行っている。
- * - A の列ベクトルに対して、Q を、シュミットの直交化の結果としても利用可能。
+ * キャッシュから取り出した FFT のプランへの参照
+ * - 持っている間は、キャッシュから外されてもプランは解放されない（参照の数を数える）。
+ * - コピーしてよい。複数のスレッドで別々に持ってよい。
  */
-int MyQRDecomp( const std::vector< std::vector< double > > &A,
-                std::vector< std::vector< double > > &Q,
-                std::vector< std::vector< double > > &R ){
-  using namespace std;
+template < class T >
+class MyFFTPlanRefT
+{
+  typedef typename MyFFTPlanCacheT< T >::Node Node;
+  Node *_node;
 
-  // A は、正方行列＆逆行列が存在する必要（正則）
-  assert( MyMatIsSquare( A ) );
-  // assert( A が正則 );
+ public:
+  MyFFTPlanRefT() : _node( 0 ) { }
 
-  int n = A.size();
-  Q = vector< vector< double > >( n );
-  R = MyMatZero( n );
+  /**
+   * 参照を引き取る（node の参照の数は増やさない。MyFFTGetPlan() が使う）
+   */
+  explicit MyFFTPlanRefT( Node *node ) : _node( node ) { }
 
-  vector< vector< double > > a = MyGetColVectors( A );
-  for( int i = 0; i < n; i++ ){
-    vector< double > u = a[ i ];
-    for( int j = 0; j < i; j++ ){
-      R[ j ][ i ] = MyVecDot( a[ i ], Q[ j ] );
-      u = u - R[ j ][ i ] * Q[ j ];
-    }//j
-    R[ i ][ i ] = MyVecNorm( u );
-    Q[ i ] = u / R[ i ][ i ];
-  }//i
+  MyFFTPlanRefT( const MyFFTPlanRefT &r ) : _node( r._node ) {
+    if( _node ){
+      MyFFTPlanCacheT< T > &cache = MyFFTPlanCache< T >();
+      MyMutexLock lock( cache.mutex );
+      cache.acquire( _node );
+    }
+  }
 
-  Q = MyMatTrans( Q );
+  MyFFTPlanRefT & operator = ( const MyFFTPlanRefT &r ){
+    MyFFTPlanRefT tmp( r );
+    std::swap( _node, tmp._node );
+    return *this;
+  }
 
-  return 0;
-}
+  ~MyFFTPlanRefT(){
+    if( _node ) MyFFTPlanCache< T >().release( _node );
+  }
+
+  bool empty() const { return _node == 0; }
+  const MyFFTPlanT< T > & operator * () const { return _node->plan; }
+  const MyFFTPlanT< T > * operator -> () const { return &_node->plan; }
+};
+
+typedef MyFFTPlanRefT< double > MyFFTPlanRef;
+typedef MyFFTPlanRefT< float > MyFFTPlanReff;
 
 /**
- * QR 法による固有値と固有ベクトルの計算
- * A は、対称行列であること。
- * @param A n x n の正方対称行列であること
- * @param[out] U 固有ベクトルが入る。i 番目の固有値に対応。固有ベクトルが列でなく行方向に並んだもの。
- * @param[out] L 固有値が入る。i 番目の固有ベクトルに対応。
- * @param itr_end_thres 収束条件。毎回の固有値の変化量（ノルム）がこの値を下回ったら計算終了。5x5行列を使ったテストでは1E-06では精度がいまいちだった。なので、デフォルトでは、なんとなく1E-10としてある。固有値と固有ベクトルの計算結果から判断して要調整。
- * @param max_itr_num 収束条件。この回数を超えたら計算終了。itr_end_thres に合わせてこれも要調整。
- */ 
-int MyEig_QR( const std::vector< std::vector< double > > &A,
-              std::vector< std::vector< double > > &U,
-              std::vector< double > &L,
-              double itr_end_thres = 1E-10,
-              double max_itr_num = 100
-              ){
-  using namespace std;
-  assert( MyMatIsSymmetric( A ) );
-  vector< vector< double > > A_k = A, Q, R;
-  U = MyMatIdentity( A.size() );
-  vector< double > last = MyGetDiagVector( A_k );
-  for( int k = 0; k < max_itr_num; k++ ){
-    assert( ! MyQRDecomp( A_k, Q, R ) );
-    A_k = R * Q;
-    L = MyGetDiagVector( A_k );
-    if( k > 0 && MyVecNorm( L - last ) < itr_end_thres ) break;
-    last = L;
-    U = U * Q;
-  }//k
-  U = MyMatTrans( U );
-  return 0;
+ * FFT のプランのキャッシュから取り出す
+ * - (n, sign) ごとのプランを、プロセス全体で共有する（T ごとに別のキャッシュ）。なければ作って登録する。
+ * - キャッシュのプランの合計が MY_FFT_PLAN_CACHE_BYTES バイトを超えたら、古いプランからキャッシュから外す（LRU）。
+ *   外したプランも、返した MyFFTPlanRefT が残っている間は使える。
+ * - 複数のスレッドから呼んでよい（OpenMP がなくても MyMutex で排他する）。
+ */
+template < class T >
+inline
+MyFFTPlanRefT< T >
+MyFFTGetPlan( int n, int sign ){
+  typedef MyFFTPlanCacheT< T > Cache;
+  Cache &cache = MyFFTPlanCache< T >();
+  std::pair< int, int > key( n, sign );
+  typename Cache::Node *found = 0;
+  {
+    MyMutexLock lock( cache.mutex );
+    typename Cache::Map::iterator it = cache.map.find( key );
+    if( it != cache.map.end() ) found = cache.acquire( it->second );
+  }
+  if( ! found ){
+    // 作るのはロックの外。先を越されたら捨てる。
+    typename Cache::Node *node = new typename Cache::Node( n, sign );
+    {
+      MyMutexLock lock( cache.mutex );
+      std::pair< typename Cache::Map::iterator, bool > r = cache.map.insert( std::make_pair( key, node ) );
+      if( r.second ){
+        node->refs = 1;
+        cache.bytes += node->plan.bytes();
+        node = 0;
+      }
+      found = cache.acquire( r.first->second );
+      cache.shrink( MY_FFT_PLAN_CACHE_BYTES, found );
+    }
+    delete node;
+  }
+  return MyFFTPlanRefT< T >( found );
 }
 
 /**
- * 特異値分解。
- * - 反復計算でなく、直接計算するバージョン。多分、大きな行列には向かない。特異値分解の勉強用。
- * - P = Ur * MyMatDiag( Sr ) * MyMatTrans( Vr ) となる Ur, Sr, Vr が返される（はず）。
- * @param P 対象となる、n x N の長方行列。任意でOK（なはず）。
- * @param Sr 特異値。
- * @param zero_eig_val_thres ゼロとみなして切り捨てる固有値の閾値。P^TP の固有値に対してなされる。その結果、ランクが r になる。その r が、Ur, Sr, Vr のサイズになる。
+ * FFT のプランのキャッシュを空にする
+ * - 使用中のプラン（MyFFTPlanRefT が残っているもの）は、使い終わったときに解放される。
  */
-int
-MySimpleSVD( const std::vector< std::vector< double > > &P,
-             std::vector< std::vector< double > > &Ur,
-             std::vector< double > &Sr,
-             std::vector< std::vector< double > > &Vr,
-             double zero_eig_val_thres = 1E-6 ){
-  using namespace std;
-  vector< vector< double > > N = MyMatTrans( P ) * P;
-  vector< vector< double > > V;
-  vector< double > L;
-  assert( ! MyEig_QR( N, V, L ) );
-  Sr.clear();
-  for( int i = 0; i < L.size(); i++ ){
-    if( MyAbs( L[ i ] ) >= zero_eig_val_thres ){
-      assert( L[ i ] > 0 );
-      Sr.push_back( sqrt( L[ i ] ) );
-    }
-  }
-  int r = Sr.size();
-  Vr.clear();
-  for( int i = 0; i < r; i++ ){
-    Vr.push_back( V[ i ] );
-  }
-  Vr = MyMatTrans( Vr );
-  vector< vector< double > > PVrT = MyMatTrans( P * Vr );
-  Ur.clear();
-  for( int i = 0; i < r; i++ ){
-    assert( Sr[ i ] > 0 );
-    Ur.push_back( PVrT[ i ] / Sr[ i ] );
-  }
-  Ur = MyMatTrans( Ur );
-  return 0;
+template < class T >
+inline
+void
+MyFFTClearPlanCache(){
+  MyFFTPlanCacheT< T > &cache = MyFFTPlanCache< T >();
+  MyMutexLock lock( cache.mutex );
+  cache.shrink( 0, 0 );
 }
 
 /**
- * ３次元の点群データを平面の式（z = a x + b y + c) で回帰する。最小二乗法。
+ * FFT
+ * - 実部 re と虚部 im に分かれた N 個の入力を、Acc 型の複素数の配列 z に変換する。正規化はしない。
+ * - N はいくつでもよい。
+ * - キャッシュされたプラン（MyFFTGetPlan< Acc >( N, sign )）を使う。
+ * @param re 入力の実部
+ * @param im 入力の虚部
+ * @param[out] z 出力（2N 要素。実部と虚部を交互に並べたもの）
+ * @param N データの数
+ * @param sign -1 で順変換、+1 で逆変換
  */
-int
-MyPlaneFit( const std::vector< double > &x_buf,
-            const std::vector< double > &y_buf,
-            const std::vector< double > &z_buf,
-            double *a,
-            double *b,
-            double *c ){
-  using namespace std;
-  int n = x_buf.size();
-  assert( y_buf.size() == n && z_buf.size() == n );
-  vector< vector< double > > A( 3, vector< double >( 3, 0 ) );
-  vector< double > B( 3, 0 );
-  for( int i = 0; i < n; i++ ){
-    A[ 0 ][ 0 ] += x_buf[ i ] * x_buf[ i ];
-    A[ 0 ][ 1 ] += x_buf[ i ] * y_buf[ i ];
-    A[ 0 ][ 2 ] += x_buf[ i ];
-    A[ 1 ][ 0 ] += x_buf[ i ] * y_buf[ i ];
-    A[ 1 ][ 1 ] += y_buf[ i ] * y_buf[ i ];
-    A[ 1 ][ 2 ] += y_buf[ i ];
-    A[ 2 ][ 0 ] += x_buf[ i ];
-    A[ 2 ][ 1 ] += y_buf[ i ];
-    A[ 2 ][ 2 ] += 1;
-    B[ 0 ] += x_buf[ i ] * z_buf[ i ];
-    B[ 1 ] += y_buf[ i ] * z_buf[ i ];
-    B[ 2 ] += z_buf[ i ];
-  }
-  vector< double > X( 3 );
-  assert( ! MyAxbSolve_LU( A, X, B ) );
-  *a = X[ 0 ];
-  *b = X[ 1 ];
-  *c = X[ 2 ];
-  return 0;
+template < class Acc, class T >
+inline
+void
+MyFFT( const T *re, const T *im, Acc *z, int N, int sign ){
+  MyFFTGetPlan< Acc >( N, sign )->execute( re, im, z );
 }
-  
+
 /**
  * 離散フーリエ変換
  * - １次元
- * - FFT でない。計算量は、データのサイズ n に対して、O(n^2)。
- * - 入力のデータサイズは、2 の累乗でなくてよい。
+ * - FFT で計算する（MyFFT）。計算量は、データのサイズ n に対して、O(n log n)。
+ * - 入力のデータサイズは、2 の累乗でなくてよい（大きな素数でもよい）。
+ * - 出力はデータ数 n で割って正規化する。
+ * - 出力は上書きする（足し込まない）。
+ * - 計算は Acc 型で行う（MyDFT< double >( ... ) で float の信号を double で計算する）。
  * @param in_re 入力信号の実部
  * @param in_im 入力信号の虚部
  * @param[out] out_re 出力信号の実部
  * @param[out] out_im 出力信号の虚部
  */
+template < class Acc, class T >
+inline
 int
-MyDFT( const std::vector< double > &in_re,
-       const std::vector< double > &in_im,
-       std::vector< double > &out_re,
-       std::vector< double > &out_im ){
+MyDFT( const std::vector< T > &in_re,
+       const std::vector< T > &in_im,
+       std::vector< T > &out_re,
+       std::vector< T > &out_im ){
   using namespace std;
 
   // データの数
@@ -1866,21 +11421,35 @@ MyDFT( const std::vector< double > &in_re,
   else assert( out_im.size() == N );
 
   // 係数の計算
+  MyWorkspaceScope scope;
+  Acc *z = scope.workspace().alloc< Acc >( 2 * N );
+  MyFFT( &in_re[ 0 ], &in_im[ 0 ], z, N, -1 );
   for( int k = 0; k < N; k++ ){
-    for( int l = 0; l < N; l++ ){
-      out_re[ k ] += ( in_re[ l ] * cos( 2.0 * M_PI * k * l / N ) +
-                       in_im[ l ] * sin( 2.0 * M_PI * k * l / N ) );
-      out_im[ k ] -= ( in_re[ l ] * sin( 2.0 * M_PI * k * l / N ) -
-                       in_im[ l ] * cos( 2.0 * M_PI * k * l / N ) );
-    }//l
     // データ数で正規化
-    out_re[ k ] /= N;
-    out_im[ k ] /= N;
+    out_re[ k ] = (T)( z[ 2 * k ] / N );
+    out_im[ k ] = (T)( z[ 2 * k + 1 ] / N );
   }//k
 
   return 0;
 }
 
+int
+MyDFT( const std::vector< double > &in_re,
+       const std::vector< double > &in_im,
+       std::vector< double > &out_re,
+       std::vector< double > &out_im ){
+  return MyDFT< double >( in_re, in_im, out_re, out_im );
+}
+
+inline
+int
+MyDFT( const std::vector< float > &in_re,
+       const std::vector< float > &in_im,
+       std::vector< float > &out_re,
+       std::vector< float > &out_im ){
+  return MyDFT< float >( in_re, in_im, out_re, out_im );
+}
+
 /**
  * 離散フーリエ変換
  * - 入力の虚部を省略したバージョン
@@ -1892,21 +11461,33 @@ MyDFT( const std::vector< double > &in_re,
   return MyDFT( in_re, std::vector< double >( in_re.size(), 0 ), out_re, out_im );
 }
 
+inline
+int
+MyDFT( const std::vector< float > &in_re,
+       std::vector< float > &out_re,
+       std::vector< float > &out_im ){
+  return MyDFT( in_re, std::vector< float >( in_re.size(), 0 ), out_re, out_im );
+}
+
 /**
  * 離散フーリエ逆変換
  * - １次元
- * - FFT でない。計算量は、データのサイズ n に対して、O(n^2)。
- * - 入力のデータサイズは、2 の累乗でなくてよい。
+ * - FFT で計算する（MyFFT）。計算量は、データのサイズ n に対して、O(n log n)。
+ * - 入力のデータサイズは、2 の累乗でなくてよい（大きな素数でもよい）。
+ * - 出力は上書きする（足し込まない）。
+ * - 計算は Acc 型で行う（MyIDFT< double >( ... ) で float の信号を double で計算する）。
  * @param in_re 入力信号の実部
  * @param in_im 入力信号の虚部
  * @param[out] out_re 出力信号の実部
  * @param[out] out_im 出力信号の虚部
  */
+template < class Acc, class T >
+inline
 int
-MyIDFT( const std::vector< double > &in_re,
-        const std::vector< double > &in_im,
-        std::vector< double > &out_re,
-        std::vector< double > &out_im ){
+MyIDFT( const std::vector< T > &in_re,
+        const std::vector< T > &in_im,
+        std::vector< T > &out_re,
+        std::vector< T > &out_im ){
   using namespace std;
 
   // データの数
@@ -1923,30 +11504,49 @@ MyIDFT( const std::vector< double > &in_re,
   else assert( out_im.size() == N );
 
   // 係数の計算
+  MyWorkspaceScope scope;
+  Acc *z = scope.workspace().alloc< Acc >( 2 * N );
+  MyFFT( &in_re[ 0 ], &in_im[ 0 ], z, N, +1 );
   for( int k = 0; k < N; k++ ){
-    for( int l = 0; l < N; l++ ){
-      out_re[ k ] += ( in_re[ l ] * cos( 2.0 * M_PI * k * l / N ) -
-                       in_im[ l ] * sin( 2.0 * M_PI * k * l / N ) );
-      out_im[ k ] += ( in_re[ l ] * sin( 2.0 * M_PI * k * l / N ) +
-                       in_im[ l ] * cos( 2.0 * M_PI * k * l / N ) );
-    }//l
+    out_re[ k ] = (T)z[ 2 * k ];
+    out_im[ k ] = (T)z[ 2 * k + 1 ];
   }//k
 
   return 0;
 }
 
+int
+MyIDFT( const std::vector< double > &in_re,
+        const std::vector< double > &in_im,
+        std::vector< double > &out_re,
+        std::vector< double > &out_im ){
+  return MyIDFT< double >( in_re, in_im, out_re, out_im );
+}
+
+inline
+int
+MyIDFT( const std::vector< float > &in_re,
+        const std::vector< float > &in_im,
+        std::vector< float > &out_re,
+        std::vector< float > &out_im ){
+  return MyIDFT< float >( in_re, in_im, out_re, out_im );
+}
+
 /**
  * 離散コサイン変換
  * - １次元
  * - FFT でない。計算量は、データのサイズ n に対して、O(n^2)。
  * - 入力のデータサイズは、2 の累乗でなくてよい。
  * - 複素数は出てこない。実部のみ。
+ * - 足し込みは Acc 型で行う（MyDCT< double >( in, out ) で float の信号を double で足し込む）。
  * @param in 入力信号
  * @param[out] out 出力信号
  */
+template < class Acc, class T >
+inline
 int
-MyDCT( const std::vector< double > &in,
-       std::vector< double > &out ){
+MyDCT( const std::vector< T > &in,
+       std::vector< T > &out ){
   using namespace std;
 
   // データの数
@@ -1961,27 +11561,45 @@ MyDCT( const std::vector< double > &in,
 
   // 係数の計算
   for( int k = 0; k < N; k++ ){
+    Acc sum = out[ k ];
     for( int l = 0; l < N; l++ ){
-      out[ k ] += in[ l ] * cos( M_PI * k * ( 2.0 * l + 1 ) / ( 2.0 * N ) );
+      sum += (Acc)in[ l ] * (Acc)cos( M_PI * k * ( 2.0 * l + 1 ) / ( 2.0 * N ) );
     }//l
-    out[ k ] *= 2.0 / N;
+    sum *= 2.0 / N;
+    out[ k ] = sum;
   }//k
 
   return 0;
 }
 
+int
+MyDCT( const std::vector< double > &in,
+       std::vector< double > &out ){
+  return MyDCT< double >( in, out );
+}
+
+inline
+int
+MyDCT( const std::vector< float > &in,
+       std::vector< float > &out ){
+  return MyDCT< float >( in, out );
+}
+
 /**
  * 離散コサイン逆変換
  * - １次元
  * - FFT でない。計算量は、データのサイズ n に対して、O(n^2)。
  * - 入力のデータサイズは、2 の累乗でなくてよい。
  * - 複素数は出てこない。実部のみ。
+ * - 足し込みは Acc 型で行う（MyIDCT< double >( in, out ) で float の信号を double で足し込む）。
  * @param in 入力信号
  * @param[out] out 出力信号
  */
+template < class Acc, class T >
+inline
 int
-MyIDCT( const std::vector< double > &in,
-        std::vector< double > &out ){
+MyIDCT( const std::vector< T > &in,
+        std::vector< T > &out ){
   using namespace std;
 
   // データの数
@@ -1996,15 +11614,29 @@ MyIDCT( const std::vector< double > &in,
 
   // 係数の計算
   for( int l = 0; l < N; l++ ){
-    out[ l ] = in[ 0 ] / 2.0;
+    Acc sum = in[ 0 ] / 2.0;
     for( int k = 1; k < N; k++ ){
-      out[ l ] += in[ k ] * cos( M_PI * k * ( 2.0 * l + 1 ) / ( 2.0 * N ) );
+      sum += (Acc)in[ k ] * (Acc)cos( M_PI * k * ( 2.0 * l + 1 ) / ( 2.0 * N ) );
     }//l
+    out[ l ] = sum;
   }//k
 
   return 0;
 }
 
+int
+MyIDCT( const std::vector< double > &in,
+        std::vector< double > &out ){
+  return MyIDCT< double >( in, out );
+}
+
+inline
+int
+MyIDCT( const std::vector< float > &in,
+        std::vector< float > &out ){
+  return MyIDCT< float >( in, out );
+}
+
 //#########################################################################################
 // 最小化
 //#########################################################################################
@@ -2044,13 +11676,16 @@ class MyMinSearch {
   static const std::vector< double > *_LineSearch_x; //<! 直線検索内部で使う変数
   static const std::vector< double > *_LineSearch_dx; //<! 直線検索内部で使う変数
   static double (*_LineSearch_fx)( const std::vector< double > & ); //<! 直線検索内部で使う変数
+  static std::vector< double > _LineSearch_xt; //<! 直線検索内部で使う変数（x + t * dx を入れる作業領域）
   /** 直線検索内部で使う関数 */
   static double lineSearch_Ft( double t ){
-    return _LineSearch_fx( (*_LineSearch_x) + t * (*_LineSearch_dx) );
+    MyVecEval( (*_LineSearch_x) + t * (*_LineSearch_dx), _LineSearch_xt );
+    return _LineSearch_fx( _LineSearch_xt );
   }
   static double lineSearch_Ft2( const std::vector< double > &t ){
     assert( t.size() > 0 );
-    return _LineSearch_fx( (*_LineSearch_x) + t[0] * (*_LineSearch_dx) );
+    MyVecEval( (*_LineSearch_x) + t[0] * (*_LineSearch_dx), _LineSearch_xt );
+    return _LineSearch_fx( _LineSearch_xt );
   }
   DebugOutType _dout_type; //!< デバッグ出力の際の表示オプション
 
@@ -2379,9 +12014,9 @@ class MyMinSearch {
       // シンプレックスの重心を求める
       vector< double > smp_cent( n, 0 );
       for( map_type::const_iterator it = smp.begin(); it != smp.end(); it++ ){
-        smp_cent = smp_cent + it->second;
+        smp_cent += it->second;
       }
-      smp_cent = smp_cent / (double)( smp.size() );
+      MyVecEval( smp_cent / (double)( smp.size() ), smp_cent );
 
       // 重心点からのシンプレックスの各頂点の距離の平均値をシンプレックスサイズとする
       double smp_size = 0;
@@ -2416,10 +12051,10 @@ class MyMinSearch {
       vector< double > x_c( n, 0 );
       map_type::iterator it = smp.begin();
       for( int j = 0; j < smp.size() - 1; j++ ){
-        x_c = x_c + it->second;
+        x_c += it->second;
         it++;
       }
-      x_c = x_c / (double)n;
+      MyVecEval( x_c / (double)n, x_c );
 
       // その重心位置に対象に、関数値が最大となっている頂点位置を移動
       vector< double > x_max = (smp.rbegin())->second;
@@ -2714,6 +12349,9 @@ class MyMinSearch {
     // 繰り返し計算回数（これも別途保持）
     int itr_count = 0;
 
+    // 勾配ベクトル、移動量（繰り返しの中で使い回す）
+    vector< double > x_grad( x.size() ), dx( x.size() );
+
     // 現時点での評価値
     //double fx_val = fx( x );
 
@@ -2721,7 +12359,6 @@ class MyMinSearch {
     for( itr_count = 0; itr_count < _max_itr_count; itr_count++ ){
 
       // 現在位置での勾配
-      vector< double > x_grad;
       assert( ! MyVecGrad( fx, x, x_grad ) );
 
       // 勾配方向に直線検索
@@ -2729,8 +12366,8 @@ class MyMinSearch {
       assert( ! runLineSearch( fx, x, x_grad, &t ) );
 
       // 位置の更新
-      vector< double > dx = t * x_grad;
-      x = x + dx;
+      MyVecEval( t * x_grad, dx );
+      x += dx;
 
       // 収束判定評価値
       // １）移動量
@@ -2812,12 +12449,16 @@ class MyMinSearch {
       // 現在位置でのヘッセ
       Hx( x, H_x );
 
-      // 連立一次方程式 H Δx = -∇f を解く 
-      n_x = -1.0 * n_x;
-      assert( ! MyAxbSolve_LU( H_x, dx, n_x ) );
+      // 連立一次方程式 H Δx = -∇f を解く（ヘッセが正定値ならコレスキー分解、そうでなければ LU 分解）
+      MyVecEval( -1.0 * n_x, n_x );
+      if( MyAxbSolve_Chol( H_x, dx, n_x ) ){
+        int ret = MyAxbSolve_LU( H_x, dx, n_x );
+        assert( ! ret );
+        (void)ret;
+      }
 
       // x の値を更新
-      x = x + dx;
+      x += dx;
 
       // 収束判定評価値
       // １）移動量
@@ -2878,12 +12519,16 @@ class MyMinSearch {
       // 現在位置でのヘッセ
       MyMatHessian( fx, x, H_x );
 
-      // 連立一次方程式 H Δx = -∇f を解く 
-      n_x = -1.0 * n_x;
-      assert( ! MyAxbSolve_LU( H_x, dx, n_x ) );
+      // 連立一次方程式 H Δx = -∇f を解く（ヘッセが正定値ならコレスキー分解、そうでなければ LU 分解）
+      MyVecEval( -1.0 * n_x, n_x );
+      if( MyAxbSolve_Chol( H_x, dx, n_x ) ){
+        int ret = MyAxbSolve_LU( H_x, dx, n_x );
+        assert( ! ret );
+        (void)ret;
+      }
 
       // x の値を更新
-      x = x + dx;
+      x += dx;
 
       // 収束判定評価値
       // １）移動量
@@ -2954,6 +12599,9 @@ class MyMinSearch {
     // 共役勾配方向
     vector< double > m_k1( n, 0 );
 
+    // ヘッセとベクトルの積を入れる作業ベクトル
+    vector< double > H_v( n );
+
     // 係数
     double a_k = 0;
     
@@ -2971,22 +12619,24 @@ class MyMinSearch {
 
       // 共役勾配方向の計算
       if( itr_count > 0 ){
-        double a1 = MyVecDot( m_k1, H_x * n_x );
-        double a2 = MyVecDot( m_k1, H_x * m_k1 );
+        MyMatVecMulInto( H_x, n_x, H_v );
+        double a1 = MyVecDot( m_k1, H_v );
+        MyMatVecMulInto( H_x, m_k1, H_v );
+        double a2 = MyVecDot( m_k1, H_v );
         assert( a2 != 0 );
         a_k = - a1 / a2;
       }
-      m_k1 = n_x + a_k * m_k1;
+      MyVecEval( n_x + a_k * m_k1, m_k1 );
 
       // 直線検索
       double t = 0;
       assert( ! runLineSearch( fx, x, m_k1, &t ) );
 
       // 移動量
-      dx = t * m_k1;
+      MyVecEval( t * m_k1, dx );
 
       // 値の更新
-      x = x + dx;
+      x += dx;
       
       // 収束判定評価値
       // １）移動量
@@ -3140,17 +12790,17 @@ class MyMinSearch {
         assert( a2 != 0 );
         a_k = - a1 / a2;
       }
-      m_k1 = n_x + a_k * m_k1;
+      MyVecEval( n_x + a_k * m_k1, m_k1 );
 
       // 直線検索
       double t = 0;
       assert( ! runLineSearch( fx, x, m_k1, &t ) );
 
       // 移動量
-      dx = t * m_k1;
+      MyVecEval( t * m_k1, dx );
 
       // 値の更新
-      x = x + dx;
+      x += dx;
       
       // 収束判定評価値
       // １）移動量
@@ -3210,12 +12860,13 @@ class MyMinSearch {
     // 勾配ベクトル、移動量
     vector< double > n_x( n ), dx( n );
 
-    // 更新後の勾配ベクトル
-    vector< double > n_x_new( n );
+    // 更新後の勾配ベクトル、勾配の変化量
+    vector< double > n_x_new( n ), yk( n );
 
-    // ヘッセの近似に使う行列
-    vector< vector< double > > I = MyMatIdentity( n );
-    vector< vector< double > > Bk = MyMatIdentity( n );
+    // ヘッセ（の逆行列）の近似に使う行列
+    // - 更新式 Bk <- A^T Bk A + b dx dx^T（A = I - b yk dx^T）を、確保済みの行列の上で計算する
+    MyMat Bk = MyMat::identity( n );
+    MyMat A( n, n ), T1( n, n ), T2( n, n );
 
     // 現時点での評価値
     // double fx_val = fx( x );
@@ -3227,17 +12878,18 @@ class MyMinSearch {
       MyVecGrad( fx, x, n_x );
     
       // 探索方向
-      dx = -1.0 * ( Bk * n_x );
+      MyMatVecMulInto( Bk, n_x, dx );
+      MyVecEval( -1.0 * dx, dx );
 
       // 直線探索
       double t = 0;
       assert( ! runLineSearch( fx, x, dx, &t ) );
 
       // 移動量
-      dx = t * dx;
+      MyVecEval( t * dx, dx );
 
       // 値の更新
-      x = x + dx;
+      x += dx;
 
       // 収束判定評価値
       // １）移動量
@@ -3263,12 +12915,18 @@ class MyMinSearch {
 
       // Bk の更新
       MyVecGrad( fx, x, n_x_new );
-      vector< double > yk = n_x_new - n_x;
+      MyVecEval( n_x_new - n_x, yk );
       double a = MyVecDot( yk, dx );
       assert( a != 0 );
       double b = 1.0 / a;
-      vector< vector< double > > A = I - b * ( MyVec2Mat( yk ) * MyVecTrans( dx ) );
-      Bk = MyMatTrans( A ) * Bk * A + b * ( MyVec2Mat( dx ) * MyVecTrans( dx ) );
+      for( int i = 0; i < n; i++ ){
+        for( int j = 0; j < n; j++ ) A( i, j ) = ( i == j ? 1.0 : 0.0 ) - b * ( yk[ i ] * dx[ j ] );
+      }
+      MyMatMulInto( A.trans(), Bk, T1 );
+      MyMatMulInto( T1, A, T2 );
+      for( int i = 0; i < n; i++ ){
+        for( int j = 0; j < n; j++ ) Bk( i, j ) = T2( i, j ) + b * ( dx[ i ] * dx[ j ] );
+      }
       
     }
     
@@ -3298,26 +12956,34 @@ class MyMinSearch {
     
     int m = vfx.size();
     int n = x.size();
+
+    // 勾配、ヘッセ、移動量（繰り返しの中で使い回す）
+    vector< double > nf( n ), nx( n ), dx( n );
+    vector< vector< double > > H( n, vector< double >( n ) );
       
     // 反復処理
     for( _itr_count = 0; _itr_count < _max_itr_count; _itr_count++ ){
 
-      vector< double > nf = MyVecZero( n );
-      vector< vector< double > > H = MyMatZero( n );
+      std::fill( nf.begin(), nf.end(), 0.0 );
+      for( int i = 0; i < n; i++ ) std::fill( H[ i ].begin(), H[ i ].end(), 0.0 );
 
       for( int i = 0; i < m; i++ ){
-        vector< double > nx( n );
         MyVecGrad( vfx[ i ], x, nx );
-        nf = nf - vfx[ i ]( x ) * nx;
-        H = H + MyVec2Mat( nx ) * MyVecTrans( nx );
+        nf -= vfx[ i ]( x ) * nx;
+        for( int k = 0; k < n; k++ ){
+          for( int l = 0; l < n; l++ ) H[ k ][ l ] += nx[ k ] * nx[ l ];
+        }
       }
 
-      // 連立一次方程式を解く
-      vector< double > dx;
-      assert( ! MyAxbSolve_LU( H, dx, nf ) );
+      // 連立一次方程式を解く（J^T J は半正定値なので、まずコレスキー分解で解く）
+      if( MyAxbSolve_Chol( H, dx, nf ) ){
+        int ret = MyAxbSolve_LU( H, dx, nf );
+        assert( ! ret );
+        (void)ret;
+      }
 
       // 移動
-      x = x + dx;
+      x += dx;
 
       // 収束判定評価値
       _cur_error = MyVecNorm( dx );
@@ -3368,38 +13034,43 @@ class MyMinSearch {
       J += a * a;
     }
 
+    // 勾配、ヘッセ、移動量、移動先（繰り返しの中で使い回す）
+    vector< double > nf( n ), nx( n ), dx( n ), x2( n );
+    vector< vector< double > > H( n, vector< double >( n ) );
+
     // 反復処理
     for( _itr_count = 0; _itr_count < _max_itr_count; _itr_count++ ){
 
-      vector< double > nf = MyVecZero( n );
-      vector< vector< double > > H = MyMatZero( n );
-      vector< vector< double > > I = MyMatIdentity( n );
+      std::fill( nf.begin(), nf.end(), 0.0 );
+      for( int i = 0; i < n; i++ ) std::fill( H[ i ].begin(), H[ i ].end(), 0.0 );
 
       // 現在位置での勾配とヘッセ行列を求める。
       // ここはガウス・ニュートン法と同じ
       for( int i = 0; i < m; i++ ){
-        vector< double > nx( n );
         MyVecGrad( vfx[ i ], x, nx );
-        nf = nf - vfx[ i ]( x ) * nx;
-        H = H + MyVec2Mat( nx ) * MyVecTrans( nx );
+        nf -= vfx[ i ]( x ) * nx;
+        for( int k = 0; k < n; k++ ){
+          for( int l = 0; l < n; l++ ) H[ k ][ l ] += nx[ k ] * nx[ l ];
+        }
       }
 
-      vector< double > dx;
-
       const int MAX_ITR_COUNT2 = 100;
       for( int k = 0; k < MAX_ITR_COUNT2; k++ ){
 
         // ヘッセ行列を修正しながら探索。
         // c が大きいと勾配法に近づく。
         // c が小さいとガウスニュートン法に近づく。
-        H = H + c * I;
+        for( int i = 0; i < n; i++ ) H[ i ][ i ] += c;
       
-        // 連立一次方程式を解く
-        dx.clear();
-        assert( ! MyAxbSolve_LU( H, dx, nf ) );
+        // 連立一次方程式を解く（H + cI は正定値なので、コレスキー分解で解ける）
+        if( MyAxbSolve_Chol( H, dx, nf ) ){
+          int ret = MyAxbSolve_LU( H, dx, nf );
+          assert( ! ret );
+          (void)ret;
+        }
 
         // 新しい位置に移動
-        vector< double > x2 = x + dx;
+        MyVecEval( x + dx, x2 );
 
         // 新しい位置での評価関数の値を計算
         double J2 = 0;
@@ -3450,6 +13121,7 @@ class MyMinSearch {
 const std::vector< double > * MyMinSearch::_LineSearch_x;
 const std::vector< double > * MyMinSearch::_LineSearch_dx;
 double (*(MyMinSearch::_LineSearch_fx))( const std::vector< double > & );
+std::vector< double > MyMinSearch::_LineSearch_xt;
 
 //#########################################################################################
 // 画像操作
@@ -555,6 +555,83 @@ MyPrjBackDat( const MyImageDat<double> *img_in,
   return 0;
 }
 
+/**
+ * 画像を縦横 1/2 に縮小する（マルチグリッド法の制限）
+ * - MyGridProlongation() の転置を掛けて、画素ごとに重みの合計で割ったもの（定数の画像は同じ値のまま）。
+ * - img_out の大きさは、( img_in の幅 + 1 ) / 2 x ( img_in の高さ + 1 ) / 2 であること。
+ */
+int
+MyImageRestrict( const MyImageDat<double> *img_in,
+                 MyImageDat<double> *img_out
+                 ){
+  using namespace std;
+  int w = img_in->width();
+  int h = img_in->height();
+  assert( img_out->width() == ( w + 1 ) / 2 );
+  assert( img_out->height() == ( h + 1 ) / 2 );
+  MySpMat R = MyGridProlongation( w, h ).trans();
+  vector< double > in, one( w * h, 1.0 );
+  img_in->get( in );
+  vector< double > out = R * in;
+  vector< double > wsum = R * one;
+  for( size_t i = 0; i < out.size(); i++ ) out[ i ] /= wsum[ i ];
+  img_out->set( out );
+  return 0;
+}
+
+/**
+ * 画像を縦横 2 倍に拡大する（マルチグリッド法の延長、双線形補間）
+ * - MyGridProlongation() を掛けて、画素ごとに重みの合計で割ったもの（幅や高さが偶数のときの端の画素は、隣の値をそのまま使う）。
+ * - img_in の大きさは、( img_out の幅 + 1 ) / 2 x ( img_out の高さ + 1 ) / 2 であること。
+ */
+int
+MyImageProlong( const MyImageDat<double> *img_in,
+                MyImageDat<double> *img_out
+                ){
+  using namespace std;
+  int w = img_out->width();
+  int h = img_out->height();
+  assert( img_in->width() == ( w + 1 ) / 2 );
+  assert( img_in->height() == ( h + 1 ) / 2 );
+  MySpMat P = MyGridProlongation( w, h );
+  vector< double > in, one( img_in->width() * img_in->height(), 1.0 );
+  img_in->get( in );
+  vector< double > out = P * in;
+  vector< double > wsum = P * one;
+  for( size_t i = 0; i < out.size(); i++ ) out[ i ] /= wsum[ i ];
+  img_out->set( out );
+  return 0;
+}
+
+/**
+ * 画像の格子の上の連立一次方程式 A x = b を、幾何的マルチグリッド法で解く
+ * - x と b は画像。A の i 行目は画素 ( i % 幅, i / 幅 ) に対応する（MyImageDat の並びと同じ）。
+ * - img_x の値を初期値にして、結果で上書きする。
+ * - ポアソン方程式など、近くの画素どうしの結合だけの問題向け。引数は MyAxbSolve_MG() と同じ。
+ * @return 0:収束した、-1:収束しなかった
+ */
+int
+MyImageSolve_MG( const MySpMat &A,
+                 const MyImageDat<double> *img_b,
+                 MyImageDat<double> *img_x,
+                 double thres = 1E-06,
+                 int max_itr_num = 100,
+                 MyIterInfo *info = 0
+                 ){
+  using namespace std;
+  int w = img_b->width();
+  int h = img_b->height();
+  assert( img_x->width() == w && img_x->height() == h );
+  MyMultigrid mg;
+  if( mg.setupGrid( A, w, h ) ) return -1;
+  vector< double > x, b;
+  img_x->get( x );
+  img_b->get( b );
+  int ret = MyAxbSolve_MG( mg, x, b, thres, max_itr_num, info );
+  img_x->set( x );
+  return ret;
+}
+
 }//namespace
 
 #endif